@@ -22,6 +22,7 @@
 */
 
 #include "vetsim.h"
+#include "simsched.h"
 #include <cmath>     // round, roundf
 using namespace std;
 
@@ -40,37 +41,30 @@ char sessionsPath[1088];
 
 // Time values, to track start time and elapsed time
 // This is the "absolute" time
-std::time_t scenario_start_time;
-std::time_t now;
+uint64_t scenario_start_msec = 0;	// clock_msec() at the start of the scenario
 std::time_t scenario_run_time;
 
-std::time_t nibp_next_time;
-std::time_t nibp_run_complete_time;
+uint64_t nibp_next_time;			// clock_msec() of the next periodic NIBP read
+uint64_t nibp_run_complete_time;	// clock_msec() when the running NIBP read completes
 
 
-#define SCENARIO_LOOP_COUNT		19	// Run the scenario every SCENARIO_LOOP_COUNT iterations of the 10 msec loop
-#define SCENARIO_PROCCHECK  	1
-#define SCENARIO_COMMCHECK  	5
-#define SCENARIO_EVENTCHECK		10
-#define SCENARIO_CPRCHECK		13
-#define SCENARIO_SHOCKCHECK		14
-#define SCENARIO_AWRRCHECK		15
-#define SCENARIO_TIMECHECK		18
-
-int scenarioCount = 0;
 struct simmgr_shm shmSpace;
 struct localConfiguration localConfig;
 #define BUF_SIZE 2048
 char msg_buf[BUF_SIZE];
-int vs_iiLockTaken = 0;
 int hrCheckCount = 0;
 bool currentIsPulsed = FALSE;
 bool currentIsRegular = FALSE;
+static int trendTask = -1;		// sched index of trend_task
+int headless = 0;				// Run by the scenario runner: one thread, no listeners
 
 void simmgrInitialize(void);
+static void scan_commands_task(void);
+static void trend_task(void);
 void resetAllParameters(void);
 void clearAllTrends(void);
 void hrcheck_handler(void);
+static void rate_windows_init(void);
 int updateScenarioState(ScenarioState new_state);
 
 ScenarioState scenario_state = ScenarioState::ScenarioStopped;
@@ -217,6 +211,7 @@ int vetsim()
 	(void)start_task("pluseTask", pulseTask);
 	(void)start_task("simstatusMain", simstatusMain);
 	(void)start_task("bcastReply", bcastReply);
+	(void)start_task("scenarioPreload", scenario_cache_preload);
 	printf("Hostname: %s\n", simmgr_shm->server.name);
 	sprintf_s(msg_buf, BUF_SIZE, "simmgrInitialization %s", "Done");
 	log_message("", msg_buf);
@@ -226,6 +221,7 @@ int vetsim()
 		printf("Could not start PHP Server\n" );
 		sprintf_s(msg_buf, BUF_SIZE, "%s", "Could not start PHP Server");
 		log_message("", msg_buf);
+		log_flush();
 		exit(202);
 	}
 	else
@@ -238,9 +234,8 @@ int vetsim()
 	obsd.obsWnd = NULL;
 #endif
 
-	while (1)
+	while (task_running())
 	{
-		sim_sleep_ms(10);
 		if (last != simmgr_shm->status.cardiac.pulseCount)
 		{
 			last = simmgr_shm->status.cardiac.pulseCount;
@@ -261,8 +256,14 @@ int vetsim()
 				break;
 			}
 		}
-		simmgrRun();
+		simmgrRun();	// Blocks until the next task deadline or trigger
+	}
+	if (!task_running())
+	{
+		// Window closed; stop_tasks was called from WndProc
+		return (0);
 	}
+	(void)stop_tasks(TASK_JOIN_TIMEOUT);
 #ifdef DEBUG
 	printf("Close window to exit\n" );
 	while (1)
@@ -306,6 +307,7 @@ simmgrInitialize(void)
 	sprintf_s(simmgr_shm->server.ip_addr, STR_SIZE, "%s", ptr);
 	// server_time and msec_time are updated in the loop
 
+	rate_windows_init();
 	resetAllParameters();
 
 	// status/scenario
@@ -315,12 +317,6 @@ simmgrInitialize(void)
 	sprintf_s(simmgr_shm->status.scenario.error_message, STR_SIZE, "%s", "");
 	simmgr_shm->status.scenario.error_flag = 0;
 
-	// instructor/sema
-
-	simmgr_shm->instructor.sema = sim_create_mutex();
-
-	vs_iiLockTaken = 0;
-
 	// instructor/scenario
 	sprintf_s(simmgr_shm->instructor.scenario.active, STR_SIZE, "%s", "");
 	sprintf_s(simmgr_shm->instructor.scenario.state, STR_SIZE, "%s", "");
@@ -356,8 +352,34 @@ simmgrInitialize(void)
 
 	clearAllTrends();
 
-	timer_start(hrcheck_handler, 5 );
-	timer_start(awrr_check, 10);
+	if (headless)
+	{
+		// One thread: the tasks run inline and the timers become scheduler tasks
+		task_set_inline(true);
+		(void)sched_add("hrcheck", hrcheck_handler, 5, 0);
+		(void)sched_add("awrr_check", awrr_check, 10, 0);
+		scenario_headless_init();
+	}
+	else
+	{
+		timer_start("hrcheck", hrcheck_handler, 5 );
+		timer_start("awrr_check", awrr_check, 10);
+	}
+
+	// Periodic tasks for the main loop. awrr_check runs on its own timer above.
+	(void)sched_add("scan_commands", scan_commands_task, localConfig.scan_period, NOTIFY_MASK(NOTIFY_INSTRUCTOR));
+	(void)sched_add("checkEvents", checkEvents, localConfig.event_period, NOTIFY_MASK(NOTIFY_EVENT));
+	(void)sched_add("cpr_check", cpr_check, localConfig.cpr_period, 0);
+	(void)sched_add("shock_check", shock_check, localConfig.shock_period, 0);
+	(void)sched_add("time_update", time_update, localConfig.time_period, 0);
+	(void)sched_add("comm_check", comm_check, localConfig.comm_period, 0);
+	(void)sched_add("trace_check", trace_check, 1000, 0);
+	trendTask = sched_add("trends", trend_task, 0, 0);	// Woken by setTrend and by itself
+
+	if (localConfig.trace_window > 0)
+	{
+		trace_start(localConfig.trace_window);
+	}
 }
 
 void
@@ -550,214 +572,69 @@ resetAllParameters(void)
 	simmgr_shm->instructor.defibrillation.shock = -1;
 
 	clearAllTrends();
+	notify_signal(NOTIFY_STATUS);
 }
 
 /*
  * awrr_check
  *
- * Calculate awrr based on count of breaths, both manual and 'normal'
+ * Calculate awrr from the breaths, both manual and 'normal'
  *
- * 1 - Detect and log breath when either natural or manual start
- * 2 - If no breaths are recorded in the past 20 seconds (excluding the past 2 seconds) report AWRR as zero
- * 3 - Calculate AWRR based on the average time of the recorded breaths within the past 90 seconds, excluding the past 2 seconds
+ * 1 - Breaths are logged by the breath handlers, with the time each was due (awrrLogBreath)
+ * 2 - If no breaths are recorded in the past 20 seconds report AWRR as zero
+ * 3 - Calculate AWRR from the last BREATH_CALC_LIMIT breaths within the past 47 seconds
  *
+ * Both the log and the calculation are constant time, so awrr_check only has to
+ * notice that the breaths have stopped.
 */
 #define BREATH_CALC_LIMIT		4		// Max number of recorded breaths to count in calculation
-#define BREATH_LOG_LEN			128
-ULONGLONG breathLog[BREATH_LOG_LEN] = { 0, };
-int breathLogNext = 0;
-
-#define BREATH_LOG_STATE_IDLE	0
-#define BREATH_LOG_STATE_DETECT	1
-int breathLogState = BREATH_LOG_STATE_IDLE;
-
-ULONGLONG breathLogLastNatural = 0;	// breathCount, last natural
-ULONGLONG breathLogLastManual = 0;	// manual_count, last manual
-ULONGLONG breathLogLast = 0;			// Time of last breath
-
-#define BREATH_LOG_DELAY	(2)
-int breathLogDelay = 0;
+#define BREATH_CALC_MIN			3		// Fewest intervals that give a rate
+#define BREATH_MAX_AGE			47000	// msec
+#define BREATH_IDLE				20000	// msec
+#define BREATH_MIN_GAP			30		// msec; a manual breath that restarts the timer is one breath
 
-#define BREATH_LOG_CHANGE_LOOPS	1
-int breathLogReportLoops = 0;
+static struct rate_window breathWindow;
 
-void
-awrr_restart(void)
-{
-	breathLogLastNatural = 0;
-	breathLogLastManual = 0;
-	breathLogNext = 0;
-	breathLogLast = 0;
-	breathLogDelay = 0;
-	breathLogReportLoops = 0;
-	ULONGLONG now = simmgr_shm->server.msec_time; //  time(NULL);	// Current sec time
-	breathLog[breathLogNext] = now - 40000;
-	breathLogNext += 1;
-	breathLog[breathLogNext] = now - 39000;
-	breathLogNext += 1;
-	breathLog[breathLogNext] = now - 38000;
-	breathLogNext += 1;
-}
-void
-awrr_check(void)
+static void
+awrr_report(ULONGLONG now)
 {
-	ULONGLONG now = simmgr_shm->server.msec_time; //  time(NULL);	// Current sec time
-	int prev;
-	int breaths;
-	ULONGLONG totalTime;
-	ULONGLONG lastTime;
-	ULONGLONG firstTime;
-	ULONGLONG diff;
 	float awRR;
-	int i;
-	int intervals;
-	int oldRate;
 	int newRate;
-	//int setRate;
-
-	oldRate = simmgr_shm->status.respiration.awRR;
 
-	// Breath Detect and Log
-	if (breathLogState == BREATH_LOG_STATE_DETECT)
+	awRR = rate_get(&breathWindow, now, BREATH_CALC_MIN, BREATH_CALC_LIMIT);
+	if (awRR > 60)
 	{
-		// After detect, wait 400 msec (two calls) before another detect allowed
-		if (breathLogDelay++ >= BREATH_LOG_DELAY)
-		{
-			breathLogState = BREATH_LOG_STATE_IDLE;
-			breathLogLastNatural = simmgr_shm->status.respiration.breathCount;
-			breathLogLastManual = simmgr_shm->status.respiration.manual_count;
-		}
+		awRR = 60;
 	}
-	else if (breathLogState == BREATH_LOG_STATE_IDLE)
+	newRate = (int)roundf(awRR);
+	if (simmgr_shm->status.respiration.awRR != newRate)
 	{
-		if (breathLogLastNatural != simmgr_shm->status.respiration.breathCount)
-		{
-			breathLogState = BREATH_LOG_STATE_DETECT;
-			breathLogLastNatural = simmgr_shm->status.respiration.breathCount;
-			breathLogLast = now;
-			breathLog[breathLogNext] = now;
-			breathLogDelay = 0;
-			breathLogNext += 1;
-			if (breathLogNext >= BREATH_LOG_LEN)
-			{
-				breathLogNext = 0;
-			}
-		}
-		else if (breathLogLastManual != simmgr_shm->status.respiration.manual_count)
-		{
-			breathLogState = BREATH_LOG_STATE_DETECT;
-			breathLogLastManual = simmgr_shm->status.respiration.manual_count;
-			breathLogLast = now;
-			breathLog[breathLogNext] = now;
-			breathLogDelay = 0;
-			breathLogNext += 1;
-			if (breathLogNext >= BREATH_LOG_LEN)
-			{
-				breathLogNext = 0;
-			}
-		}
+		simmgr_shm->status.respiration.awRR = newRate;
+		notify_signal(NOTIFY_STATUS);
 	}
+}
 
-	// AWRR Calculation - Look at no more than BREATH_CALC_LIMIT breaths - Skip if no breaths within 20 seconds
-	lastTime = 0;
-	firstTime = 0;
-
-	if (breathLogNext == 0)
-	{
-		prev = (BREATH_LOG_LEN - 1);
-	}
-	else
-	{
-		prev = breathLogNext - 1;
-	}
+void
+awrrLogBreath(ULONGLONG when)
+{
+	rate_beat(&breathWindow, when);
+	awrr_report(when);
+}
 
-	breaths = 0;
-	intervals = 0;
-	lastTime = breathLog[prev];
+void
+awrr_restart(void)
+{
+	ULONGLONG now = clock_coarse_msec();
 
-	if (lastTime <= 0)  // Don't look at empty logs
-	{
-		simmgr_shm->status.respiration.awRR = 0;
-	}
-	else
-	{
-		diff = now - lastTime;
-		if (diff > 20000)
-		{
-			simmgr_shm->status.respiration.awRR = 0;
-		}
-		else
-		{
-			prev -= 1;
-			if (prev < 0)
-			{
-				prev = BREATH_LOG_LEN - 1;
-			}
-			for (i = 0; i < BREATH_CALC_LIMIT; i++)
-			{
-				diff = now - breathLog[prev];
-				if (diff > 47000) // Over Limit seconds since this recorded breath
-				{
-					break;
-				}
-				else
-				{
-					firstTime = breathLog[prev]; // Recorded start of the first breath
-					breaths += 1;
-					intervals += 1;
-					prev -= 1;
-					if (prev < 0)
-					{
-						prev = BREATH_LOG_LEN - 1;
-					}
-				}
-			}
-		}
-		if (intervals > 2)
-		{
-			totalTime = lastTime - firstTime;
-			if (totalTime == 0)
-			{
-				awRR = 0;
-			}
-			else
-			{
-				awRR = ((((float)intervals / (float)totalTime)) * 60000);
-			}
-			if (awRR < 0)
-			{
-				awRR = 0;
-			}
-			else if (awRR > 60)
-			{
-				awRR = 60;
-			}
-		}
-		else
-		{
-			awRR = 0;
-		}
-		if (breathLogReportLoops++ == BREATH_LOG_CHANGE_LOOPS)
-		{
-			breathLogReportLoops = 0;
-			newRate = (int)roundf(awRR);
-			if (oldRate != newRate)
-			{
-				// setRespirationPeriods(oldRate, newRate );
-/*
-				setRate = simmgr_shm->status.respiration.rate;
-				if ((newRate <= (setRate + 3)) &&
-					(newRate >= (setRate - 3)))
-				{
-					simmgr_shm->status.respiration.awRR = setRate;
-				}
-				else */
-				{
-					simmgr_shm->status.respiration.awRR = newRate;
-				}
-			}
-		}
-	}
+	rate_reset(&breathWindow);
+	rate_beat(&breathWindow, now - 40000);
+	rate_beat(&breathWindow, now - 39000);
+	rate_beat(&breathWindow, now - 38000);
+}
+void
+awrr_check(void)
+{
+	awrr_report(clock_coarse_msec());
 }
 
 ULONGLONG cprLast = 0;
@@ -767,7 +644,7 @@ ULONGLONG cprDuration = 2000;
 void
 cpr_check(void)
 {
-	ULONGLONG now = simmgr_shm->server.msec_time;
+	ULONGLONG now = clock_coarse_msec();
 	ULONGLONG cprCurrent = simmgr_shm->status.cpr.last;
 
 	if (cprCurrent != cprLast)
@@ -803,8 +680,9 @@ ULONGLONG shockDuration = 2000;
 void
 shock_check(void)
 {
-	ULONGLONG now = simmgr_shm->server.msec_time;
+	ULONGLONG now = clock_coarse_msec();
 	ULONGLONG shockCurrent = simmgr_shm->status.defibrillation.last;
+	int shock = simmgr_shm->status.defibrillation.shock;
 
 	if (shockCurrent != shockLast)
 	{
@@ -835,219 +713,108 @@ shock_check(void)
 			shockStartTime = 0;
 		}
 	}
+	if (simmgr_shm->status.defibrillation.shock != shock)
+	{
+		notify_signal(NOTIFY_STATUS);	// The scenario loop waits out a shock
+	}
 }
 /*
  * hrcheck_handler
  *
- * Calculate heart rate based on count of beats, (normal, CPR and  VPC)
+ * Calculate heart rate from the beats, (normal, CPR and  VPC)
  *
- * 1 - Detect and log beat when any of natural, vpc or CPR
- * 2 - If no beats are recorded in the past 20 seconds (excluding the past 2 seconds) report rate as zero
- * 3 - Calculate beats based on the average time of the recorded beats within the past 90 seconds, excluding the past 2 seconds
+ * 1 - Beats are logged by the pulse handler, with the time each was due (hrLogBeat)
+ * 2 - If no beats are recorded in the past 20 seconds report rate as zero
+ * 3 - Calculate the rate from the last HR_CALC_LIMIT beats within the past 20 seconds
  *
 */
 #define HR_CALC_LIMIT		10		// Max number of recorded beats to count in calculation
 #define HR_CALC_LIMIT_FAST	40		// Beats to cound with fast heart rate (over 160 BPM)
-#define HR_LOG_LEN			64
-ULONGLONG hrLog[HR_LOG_LEN] = { 0, };
-int hrLogNext = 0;
-ULONGLONG hrLogLastNatural = 0;	// beatCount, last natural
-ULONGLONG hrLogLastVPC = 0;	// VPC count, last VPC
+#define HR_MAX_AGE			20000	// msec
+#define HR_IDLE				20000	// msec
 
-int hrLogDelay = 0;
+static struct rate_window hrWindow;
 
-#define HR_LOG_CHANGE_LOOPS	10	// hr_check is called every 5 msec. So this will cause a recalc every 50 msec
-int hrLogReportLoops = 0;
-
-void hrLogBeat(void)
+static void
+rate_windows_init(void)
 {
-	hrLog[hrLogNext] = msec_time_update();
-	hrLogNext += 1;
-	if (hrLogNext >= HR_LOG_LEN)
-	{
-		hrLogNext = 0;
-	}
+	rate_init(&hrWindow, HR_MAX_AGE, HR_IDLE, 0);
+	rate_init(&breathWindow, BREATH_MAX_AGE, BREATH_IDLE, BREATH_MIN_GAP);
 }
-void hrcheck_handler(void )     // current system time  )    // additional information 
+
+static void
+hr_report(ULONGLONG now)
 {
-	ULONGLONG now; // Current msec time
-	int prev;
-	int beats;
-	ULONGLONG totalTime;
-	ULONGLONG lastTime;
-	ULONGLONG firstTime;
-	ULONGLONG diff = 0;
-	float avg_rate = -10;
-	float seconds;
-	float minutes;
-	int i;
-	int intervals = -1;
-	// int oldRate;
-	int newRate;
-	int setRate = simmgr_shm->status.cardiac.rate;
-	int newBeat = 0;
-	static int reports = 0;
+	float avg_rate;
 	int calcLimit;
+	int newRate;
 
-	hrCheckCount++;
-
-	now = msec_time_update();
-	if (simmgr_shm->status.cpr.running)
+	if (simmgr_shm->status.cardiac.rate > 160)
 	{
-		hrLogLastNatural = simmgr_shm->status.cardiac.pulseCount;
-		hrLogLastVPC = simmgr_shm->status.cardiac.pulseCountVpc;
-		simmgr_shm->status.cardiac.avg_rate = 0;
-		firstTime = now - 30000;
-		for (i = 0; i < HR_LOG_LEN; i++)
-		{
-			hrLog[i] = firstTime;
-		}
-		return;
+		calcLimit = HR_CALC_LIMIT_FAST;
 	}
-	else if (hrLogLastNatural != simmgr_shm->status.cardiac.pulseCount)
+	else
 	{
-		hrLogLastNatural = simmgr_shm->status.cardiac.pulseCount;
-		newBeat = 1;
+		calcLimit = HR_CALC_LIMIT;
 	}
-	else if (hrLogLastVPC != simmgr_shm->status.cardiac.pulseCountVpc)
+	avg_rate = rate_get(&hrWindow, now, 1, calcLimit);
+	if (avg_rate > 360)
 	{
-		hrLogLastVPC = simmgr_shm->status.cardiac.pulseCountVpc;
-		newBeat = 1;
+		avg_rate = 360;
 	}
-
-	if (hrLogReportLoops++ >= HR_LOG_CHANGE_LOOPS)
+	newRate = (int)round(avg_rate);
+	if (simmgr_shm->status.cardiac.avg_rate != newRate)
 	{
-		avg_rate = -9;
-		hrLogReportLoops = 0;
-		// AVG Calculation - Look at no more than 10 beats - Skip if no beats within 20 seconds
-		lastTime = 0;
-		firstTime = 0;
+		simmgr_shm->status.cardiac.avg_rate = newRate;
+		notify_signal(NOTIFY_STATUS);
+	}
+}
 
-		beats = 0;
-		intervals = 0;
+void
+hrLogBeat(ULONGLONG when)
+{
+	rate_beat(&hrWindow, when);
+	if (!simmgr_shm->status.cpr.running)
+	{
+		hr_report(when);
+	}
+}
+void
+hrcheck_handler(void)
+{
+	ULONGLONG now; // Current msec time
 
-		prev = hrLogNext - 1;
-		if (prev < 0)
-		{
-			prev = (HR_LOG_LEN - 1);
-		}
-		lastTime = hrLog[prev];
-		if (lastTime <= 0)  // Don't look at empty logs
-		{
-			avg_rate = 0;
-		}
-		else
-		{
-			diff = now - lastTime;
-			if (diff > 20000)
-			{
-				simmgr_shm->status.cardiac.avg_rate = 4;
-			}
-			else
-			{
-				if (prev <= 0)
-				{
-					prev = (HR_LOG_LEN - 1);
-				}
-				else
-				{
-					prev -= 1;
-				}
-				if ( setRate > 160 )
-				{
-					calcLimit = HR_CALC_LIMIT_FAST;
-				}
-				else
-				{
-					calcLimit = HR_CALC_LIMIT;
-				}
-				for (i = 0; i < calcLimit; i++)
-				{
-					diff = now - hrLog[prev];
-					if (diff > 20000) // Over Limit seconds since this recorded beat
-					{
-						break;
-					}
-					else
-					{
-						firstTime = hrLog[prev]; // Recorded start of the first beat
-						beats += 1;
-						intervals += 1;
-						prev -= 1;
-						if (prev < 0)
-						{
-							prev = (HR_LOG_LEN - 1);
-						}
-					}
-				}
-			}
+	hrCheckCount++;
 
-			if (intervals > 0)
-			{
-				totalTime = lastTime - firstTime;
-				if (totalTime == 0)
-				{
-					avg_rate = -7;
-				}
-				else
-				{
-					seconds = (float)totalTime / 1000;
-					minutes = seconds / 60;
-					avg_rate = (float)intervals / minutes;
-				}
-				if (avg_rate < 0)
-				{
-					avg_rate = -6;
-				}
-				else if (avg_rate > 360)
-				{
-					avg_rate = 360;
-				}
-			}
-			else
-			{
-				avg_rate = -5;
-			}
-		}
-		if (avg_rate < 0)
+	now = msec_time_update();
+	if (simmgr_shm->status.cpr.running)
+	{
+		rate_reset(&hrWindow);
+		if (simmgr_shm->status.cardiac.avg_rate != 0)
 		{
 			simmgr_shm->status.cardiac.avg_rate = 0;
+			notify_signal(NOTIFY_STATUS);
 		}
-		else
-		{
-			newRate = (int)round(avg_rate);
-			/*
-			if (currentIsRegular)
-			{
-				if ((newRate <= (setRate + 5)) &&
-					(newRate >= (setRate - 5)))
-				{
-					newRate = setRate;
-				}				
-			}
-			*/
-			simmgr_shm->status.cardiac.avg_rate = newRate;
-		}
-#ifdef DEBUG
-		if (simmgr_shm->status.cardiac.avg_rate < 7)
-		{
-			sprintf_s(msg_buf, BUF_SIZE, "HRCHECK: avg_rate %f Intervals %d NewBeat %d, hrLogNext %d, diff %llu ",
-				avg_rate, intervals, newBeat, hrLogNext, diff);
-			log_message("", msg_buf);
-		}
-#endif
+		return;
 	}
+	hr_report(now);
 }
 
 /*
  * msec_time_update
+ *
+ * Refresh the coarse clock (clock_coarse_msec) and its copy in the server
+ * block of the SHM (server.msec_time).
+ *
+ * RETURNS:
+ *		The new msec time
 */
 ULONGLONG
 msec_time_update(void)
 {
 	ULONGLONG msec;
 
-	msec = GetTickCount64();
+	msec = clock_tick();
 
 	simmgr_shm->server.msec_time = msec;
 	// printf("Tick %ull\n", simmgr_shm->server.msec_time);
@@ -1070,9 +837,9 @@ time_update(void)
 	int sec;
 	double temperature;
 	char buf[BUF_SIZE];
+	uint64_t now;
 
 #ifdef WIN32
-	time_t now;
 	SYSTEMTIME st;
 
 	GetLocalTime(&st);
@@ -1083,21 +850,18 @@ time_update(void)
 		st.wHour,
 		st.wMinute,
 		st.wSecond);
-	now = time(nullptr);
-	elapsedTimeSeconds = (int)difftime(now, scenario_start_time);
 #else
 	struct tm tm;
 	time_t the_time;
-	std::time_t now;
 	the_time = time(NULL);
 
 	(void)localtime_r(&the_time, &tm);
 	(void)asctime_r(&tm, buf);
 	strtok(buf, "\n");		// Remove Line Feed
 	sprintf_s(simmgr_shm->server.server_time, STR_SIZE, "%s", buf);
-	now = std::time(nullptr);
-	elapsedTimeSeconds = (int)difftime(now, scenario_start_time);
 #endif
+	now = clock_msec();
+	elapsedTimeSeconds = (int)((now - scenario_start_msec) / 1000);
 
 	if ((scenario_state == ScenarioState::ScenarioRunning) ||
 		(scenario_state == ScenarioState::ScenarioPaused))
@@ -1120,13 +884,14 @@ time_update(void)
 		sprintf_s(buf, BUF_SIZE, "Scenario: MAX Scenario Runtime exceeded. Terminating.");
 		simlog_entry(buf);
 		printf("Scenario: MAX Scenario Runtime exceeded. Terminating.\n");
-		printf("Now:   %lld\n", now);
-		printf("Start: %lld\n", scenario_start_time);
+		printf("Now:   %llu\n", (unsigned long long)now);
+		printf("Start: %llu\n", (unsigned long long)scenario_start_msec);
 
 		printf("Elapsed Time %d\n", elapsedTimeSeconds);
-		takeInstructorLock();
+		takeInstructorSections(II_MASK(II_SCENARIO));
 		sprintf_s(simmgr_shm->instructor.scenario.state, STR_SIZE, "%s", "Terminate");
-		releaseInstructorLock();
+		releaseInstructorSections(II_MASK(II_SCENARIO));
+		notify_signal(NOTIFY_INSTRUCTOR);
 	}
 	else if (scenario_state == ScenarioState::ScenarioRunning)
 	{
@@ -1187,103 +952,89 @@ comm_check(void)
 }
 
 /*
- * Cardiac Process
+ * Trends
  *
- * Based on the rate and target selected, modify the pulse rate
+ * The rates, pressures, SpO2, EtCO2 and temperature move to a new value over the
+ * transfer time. simtrend evaluates them on the millisecond clock; the trend task
+ * runs only when one of the reported values is due to change.
  */
-struct trend cardiacTrend;
-struct trend respirationTrend;
-struct trend sysTrend;
-struct trend diaTrend;
-struct trend tempTrend;
-struct trend spo2Trend;
-struct trend etco2Trend;
 
 int
-clearTrend(struct trend* trend, int current)
+clearTrend(int trend, int current)
 {
-	trend->end = current;
-	trend->current = current;
-
-	return ((int)trend->current);
+	return (trend_clear(trend, current));
 }
 
 void
 clearAllTrends(void)
 {
 	// Clear running trends
-	(void)clearTrend(&cardiacTrend, simmgr_shm->status.cardiac.rate);
-	(void)clearTrend(&sysTrend, simmgr_shm->status.cardiac.bps_sys);
-	(void)clearTrend(&diaTrend, simmgr_shm->status.cardiac.bps_dia);
-	(void)clearTrend(&respirationTrend, simmgr_shm->status.respiration.rate);
-	(void)clearTrend(&spo2Trend, simmgr_shm->status.respiration.spo2);
-	(void)clearTrend(&etco2Trend, simmgr_shm->status.respiration.etco2);
-	(void)clearTrend(&tempTrend, simmgr_shm->status.general.temperature);
+	(void)clearTrend(TREND_CARDIAC_RATE, simmgr_shm->status.cardiac.rate);
+	(void)clearTrend(TREND_BPS_SYS, simmgr_shm->status.cardiac.bps_sys);
+	(void)clearTrend(TREND_BPS_DIA, simmgr_shm->status.cardiac.bps_dia);
+	(void)clearTrend(TREND_RESPIRATION_RATE, simmgr_shm->status.respiration.rate);
+	(void)clearTrend(TREND_SPO2, simmgr_shm->status.respiration.spo2);
+	(void)clearTrend(TREND_ETCO2, simmgr_shm->status.respiration.etco2);
+	(void)clearTrend(TREND_TEMPERATURE, simmgr_shm->status.general.temperature);
+	sched_wake(trendTask, 0);
 }
 
-
 int
-setTrend(struct trend* trend, int end, int current, int duration)
+setTrend(int trend, int end, int current, int duration)
 {
-	double diff;
+	int rval;
+
+	rval = trend_set(trend, end, current, duration, localConfig.trend_curve);
+	sched_wake(trendTask, trend_next_deadline());
+	return (rval);
+}
 
-	trend->end = (double)end;
-	diff = (double)abs(end - current);
+/*
+ * trend_task
+ *
+ * Copy the trend values that changed into the status block, then sleep until
+ * the next value is due to change.
+ */
+static void
+trend_task(void)
+{
+	int values[TREND_COUNT];
+	unsigned int changed;
 
-	if ((duration > 0) && (diff > 0))
+	changed = trend_process(clock_msec(), values);
+	if (changed & TREND_MASK(TREND_CARDIAC_RATE))
 	{
-		trend->current = (double)current;
-		trend->changePerSecond = diff / duration;
-		trend->nextTime = time(0) + 1;
+		simmgr_shm->status.cardiac.rate = values[TREND_CARDIAC_RATE];
 	}
-	else
+	if (changed & TREND_MASK(TREND_BPS_SYS))
 	{
-		trend->current = end;
-		trend->changePerSecond = 0;
-		trend->nextTime = 0;
+		simmgr_shm->status.cardiac.bps_sys = values[TREND_BPS_SYS];
 	}
-	return ((int)trend->current);
-}
-
-int
-trendProcess(struct trend* trend)
-{
-	time_t now;
-	double newval;
-	int rval;
-
-	now = time(0);
-
-	if (trend->nextTime && (trend->nextTime <= now))
+	if (changed & TREND_MASK(TREND_BPS_DIA))
 	{
-		if (trend->end > trend->current)
-		{
-			newval = trend->current + trend->changePerSecond;
-			if (newval > trend->end)
-			{
-				newval = trend->end;
-			}
-		}
-		else
-		{
-			newval = trend->current - trend->changePerSecond;
-			if (newval < trend->end)
-			{
-				newval = trend->end;
-			}
-		}
-		trend->current = newval;
-		if (trend->current == trend->end)
-		{
-			trend->nextTime = 0;
-		}
-		else
-		{
-			trend->nextTime = now + 1;
-		}
+		simmgr_shm->status.cardiac.bps_dia = values[TREND_BPS_DIA];
+	}
+	if (changed & TREND_MASK(TREND_RESPIRATION_RATE))
+	{
+		setRespirationPeriods(simmgr_shm->status.respiration.rate, values[TREND_RESPIRATION_RATE]);
+	}
+	if (changed & TREND_MASK(TREND_SPO2))
+	{
+		simmgr_shm->status.respiration.spo2 = values[TREND_SPO2];
+	}
+	if (changed & TREND_MASK(TREND_ETCO2))
+	{
+		simmgr_shm->status.respiration.etco2 = values[TREND_ETCO2];
+	}
+	if (changed & TREND_MASK(TREND_TEMPERATURE))
+	{
+		simmgr_shm->status.general.temperature = values[TREND_TEMPERATURE];
+	}
+	sched_wake(trendTask, trend_next_deadline());
+	if (changed)
+	{
+		notify_signal(NOTIFY_STATUS);
 	}
-	rval = (int)round(trend->current);
-	return (rval);
 }
 
 bool
@@ -1335,6 +1086,27 @@ setRespirationPeriods(int oldRate, int newRate)
 	}
 }
 
+/*
+ * statusChanged
+ *
+ * Compare the status block with a copy taken before scan_commands ran.
+ * The beat counters and the calculated rates are advanced by the pulse and
+ * rate threads on their own, and the scenario section is owned by the
+ * scenario thread, so those are not counted as a change.
+ */
+static bool
+statusChanged(struct status* before)
+{
+	before->cardiac.pulseCount = simmgr_shm->status.cardiac.pulseCount;
+	before->cardiac.pulseCountVpc = simmgr_shm->status.cardiac.pulseCountVpc;
+	before->cardiac.avg_rate = simmgr_shm->status.cardiac.avg_rate;
+	before->respiration.breathCount = simmgr_shm->status.respiration.breathCount;
+	before->respiration.awRR = simmgr_shm->status.respiration.awRR;
+	memcpy(&before->scenario, &simmgr_shm->status.scenario, sizeof(struct scenario));
+
+	return (memcmp(before, &simmgr_shm->status, sizeof(struct status)) != 0);
+}
+
 /*
  * Scan commands from Initiator Interface
  *
@@ -1347,651 +1119,853 @@ int
 scan_commands(void)
 {
 	int trycount;
-	int oldRate;
-	int newRate;
 	bool newIsPulsed;
 	int v;
+	unsigned int dirty;
+	int field;
 	char buf[BUF_SIZE];
+	static struct status before;
+	uint64_t gen;
+	uint64_t now;
 
-	// Lock the command interface before processing commands
-	trycount = 0;
+	// Every instructor write signalled up to here is applied by this pass
+	gen = notify_generation(NOTIFY_INSTRUCTOR);
+	memcpy(&before, &simmgr_shm->status, sizeof(struct status));
 
-	if (takeInstructorLock())
-	{
-		vs_iiLockTaken = 1;
-	}
-	// Check for instructor commands
+	// Check for instructor commands. Each section is locked only while its change set is applied,
+	// and only the fields marked in the change set are visited.
+	trycount = 0;
 
 	// Scenario
-	if (simmgr_shm->instructor.scenario.record >= 0)
+	takeInstructorSections(II_MASK(II_SCENARIO));
+	dirty = simmgr_shm->instructor.dirty[II_SCENARIO];
+	simmgr_shm->instructor.dirty[II_SCENARIO] = 0;
+	while (dirty)
 	{
-		simmgr_shm->status.scenario.record = simmgr_shm->instructor.scenario.record;
-		simmgr_shm->instructor.scenario.record = -1;
-	}
-	if (simmgr_shm->instructor.scenario.error_flag >= 0)
-	{
-		simmgr_shm->status.scenario.error_flag = simmgr_shm->instructor.scenario.error_flag;
-		snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "%s", simmgr_shm->instructor.scenario.error_message);
-		simmgr_shm->instructor.scenario.error_flag = -1;
-	}
-	if (strlen(simmgr_shm->instructor.scenario.state) > 0)
-	{
-		strToLower(simmgr_shm->instructor.scenario.state);
-
-		sprintf_s(msg_buf, BUF_SIZE, "State Request: \"%s\" Current \"%s\" State %d",
-			simmgr_shm->instructor.scenario.state,
-			simmgr_shm->status.scenario.state,
-			scenario_state);
-		log_message("", msg_buf);
-
-		if (strcmp(simmgr_shm->instructor.scenario.state, "paused") == 0)
+		field = instructorNextField(&dirty);
+		switch (field)
 		{
-			printf("paused\n");
-			if (scenario_state == ScenarioState::ScenarioRunning)
+		case SCENARIO_F_RECORD:
+			if (simmgr_shm->instructor.scenario.record >= 0)
 			{
-				updateScenarioState(ScenarioState::ScenarioPaused);
+				simmgr_shm->status.scenario.record = simmgr_shm->instructor.scenario.record;
+				simmgr_shm->instructor.scenario.record = -1;
 			}
-		}
-		else if (strcmp(simmgr_shm->instructor.scenario.state, "running") == 0)
-		{
-			sprintf_s(simmgr_shm->instructor.scenario.state, STR_SIZE, "%s", "");
-			if (scenario_state == ScenarioState::ScenarioPaused)
-			{
-				printf("Calling updateScenarioState(Running)\n");
-				updateScenarioState(ScenarioState::ScenarioRunning);
-			}
-			else if (scenario_state == ScenarioState::ScenarioStopped)
-			{
-				printf("Starting start_scenario\n");
-				start_task("start_scenario", start_scenario );
-			}
-			else if(scenario_state == ScenarioState::ScenarioRunning)
-			{
-				printf("Error: scenario_state is Running \n");
-			}
-			else if (scenario_state == ScenarioState::ScenarioTerminate)
+			break;
+		case SCENARIO_F_ERROR:
+			if (simmgr_shm->instructor.scenario.error_flag >= 0)
 			{
-				printf("Error: scenario_state is Terminate \n");
+				simmgr_shm->status.scenario.error_flag = simmgr_shm->instructor.scenario.error_flag;
+				snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "%s", simmgr_shm->instructor.scenario.error_message);
+				simmgr_shm->instructor.scenario.error_flag = -1;
 			}
-		}
-		else if (strcmp(simmgr_shm->instructor.scenario.state, "terminate") == 0)
-		{
-			printf("terminated\n");
-			if (scenario_state != ScenarioState::ScenarioTerminate)
+			break;
+		case SCENARIO_F_STATE:
+			if (strlen(simmgr_shm->instructor.scenario.state) > 0)
 			{
-				updateScenarioState(ScenarioState::ScenarioTerminate);
+				strToLower(simmgr_shm->instructor.scenario.state);
+
+				sprintf_s(msg_buf, BUF_SIZE, "State Request: \"%s\" Current \"%s\" State %d",
+					simmgr_shm->instructor.scenario.state,
+					simmgr_shm->status.scenario.state,
+					scenario_state);
+				log_message("", msg_buf);
+
+				if (strcmp(simmgr_shm->instructor.scenario.state, "paused") == 0)
+				{
+					printf("paused\n");
+					if (scenario_state == ScenarioState::ScenarioRunning)
+					{
+						updateScenarioState(ScenarioState::ScenarioPaused);
+					}
+				}
+				else if (strcmp(simmgr_shm->instructor.scenario.state, "running") == 0)
+				{
+					sprintf_s(simmgr_shm->instructor.scenario.state, STR_SIZE, "%s", "");
+					if (scenario_state == ScenarioState::ScenarioPaused)
+					{
+						printf("Calling updateScenarioState(Running)\n");
+						updateScenarioState(ScenarioState::ScenarioRunning);
+					}
+					else if (scenario_state == ScenarioState::ScenarioStopped)
+					{
+						printf("Starting start_scenario\n");
+						start_task("start_scenario", start_scenario );
+					}
+					else if(scenario_state == ScenarioState::ScenarioRunning)
+					{
+						printf("Error: scenario_state is Running \n");
+					}
+					else if (scenario_state == ScenarioState::ScenarioTerminate)
+					{
+						printf("Error: scenario_state is Terminate \n");
+					}
+				}
+				else if (strcmp(simmgr_shm->instructor.scenario.state, "terminate") == 0)
+				{
+					printf("terminated\n");
+					if (scenario_state != ScenarioState::ScenarioTerminate)
+					{
+						updateScenarioState(ScenarioState::ScenarioTerminate);
+					}
+				}
+				else if (strcmp(simmgr_shm->instructor.scenario.state, "stopped") == 0)
+				{
+					printf("stopped\n");
+					if (scenario_state != ScenarioState::ScenarioStopped)
+					{
+						updateScenarioState(ScenarioState::ScenarioStopped);
+					}
+				}
+				else
+				{
+					printf("unknown\n");
+				}
+				sprintf_s(simmgr_shm->instructor.scenario.state, STR_SIZE, "%s", "");
 			}
-		}
-		else if (strcmp(simmgr_shm->instructor.scenario.state, "stopped") == 0)
-		{
-			printf("stopped\n");
-			if (scenario_state != ScenarioState::ScenarioStopped)
+			break;
+		case SCENARIO_F_ACTIVE:
+			if (strlen(simmgr_shm->instructor.scenario.active) > 0)
 			{
-				updateScenarioState(ScenarioState::ScenarioStopped);
+				sprintf_s(msg_buf, BUF_SIZE,"Set Active: %s State %d", simmgr_shm->instructor.scenario.active, scenario_state);
+				log_message("", msg_buf);
+				switch (scenario_state)
+				{
+				case ScenarioState::ScenarioTerminate:
+				default:
+					break;
+				case ScenarioState::ScenarioStopped:
+					sprintf_s(simmgr_shm->status.scenario.active, STR_SIZE, "%s", simmgr_shm->instructor.scenario.active);
+					break;
+				}
+				sprintf_s(simmgr_shm->instructor.scenario.active, STR_SIZE, "%s", "");
 			}
-		}
-		else
-		{
-			printf("unknown\n");
-		}
-		sprintf_s(simmgr_shm->instructor.scenario.state, STR_SIZE, "%s", "");
-	}
-	if (strlen(simmgr_shm->instructor.scenario.active) > 0)
-	{
-		sprintf_s(msg_buf, BUF_SIZE,"Set Active: %s State %d", simmgr_shm->instructor.scenario.active, scenario_state);
-		log_message("", msg_buf);
-		switch (scenario_state)
-		{
-		case ScenarioState::ScenarioTerminate:
-		default:
 			break;
-		case ScenarioState::ScenarioStopped:
-			sprintf_s(simmgr_shm->status.scenario.active, STR_SIZE, "%s", simmgr_shm->instructor.scenario.active);
+		default:
 			break;
 		}
-		sprintf_s(simmgr_shm->instructor.scenario.active, STR_SIZE, "%s", "");
 	}
+	releaseInstructorSections(II_MASK(II_SCENARIO));
 
 	// Cardiac
-	if (strlen(simmgr_shm->instructor.cardiac.rhythm) > 0)
+	takeInstructorSections(II_MASK(II_CARDIAC));
+	dirty = simmgr_shm->instructor.dirty[II_CARDIAC];
+	simmgr_shm->instructor.dirty[II_CARDIAC] = 0;
+	while (dirty)
 	{
-		if (strcmp(simmgr_shm->status.cardiac.rhythm, simmgr_shm->instructor.cardiac.rhythm) != 0)
+		field = instructorNextField(&dirty);
+		switch (field)
 		{
-			// When changing to pulseless rhythm, the rate will be set to zero.
-			newIsPulsed = isRhythmPulsed(simmgr_shm->instructor.cardiac.rhythm);
-			if (newIsPulsed == false)
+		case CARDIAC_F_RHYTHM:
+			if (strlen(simmgr_shm->instructor.cardiac.rhythm) > 0)
 			{
-				simmgr_shm->instructor.cardiac.rate = 0;
-				simmgr_shm->instructor.cardiac.transfer_time = 0;
+				if (strcmp(simmgr_shm->status.cardiac.rhythm, simmgr_shm->instructor.cardiac.rhythm) != 0)
+				{
+					// When changing to pulseless rhythm, the rate will be set to zero.
+					newIsPulsed = isRhythmPulsed(simmgr_shm->instructor.cardiac.rhythm);
+					if (newIsPulsed == false)
+					{
+						simmgr_shm->instructor.cardiac.rate = 0;
+						simmgr_shm->instructor.cardiac.transfer_time = 0;
+						dirty |= II_FIELD(CARDIAC_F_RATE) | II_FIELD(CARDIAC_F_TRANSFER_TIME);
+					}
+					else
+					{
+						// When changing from a pulseless rhythm to a pulse rhythm, the rate will be set to 100
+						// This can be overridden in the command by setting the rate explicitly
+						currentIsPulsed = isRhythmPulsed(simmgr_shm->status.cardiac.rhythm);
+						if ((currentIsPulsed == false) && (newIsPulsed == true))
+						{
+							if (simmgr_shm->instructor.cardiac.rate < 0)
+							{
+								simmgr_shm->instructor.cardiac.rate = 100;
+								simmgr_shm->instructor.cardiac.transfer_time = 0;
+								dirty |= II_FIELD(CARDIAC_F_RATE) | II_FIELD(CARDIAC_F_TRANSFER_TIME);
+							}
+						}
+					}
+					sprintf_s(simmgr_shm->status.cardiac.rhythm, STR_SIZE, "%s", simmgr_shm->instructor.cardiac.rhythm);
+					sprintf_s(buf, BUF_SIZE, "Setting: %s: %s", "Cardiac Rhythm", simmgr_shm->instructor.cardiac.rhythm);
+					simlog_entry(buf);
+				}
+				sprintf_s(simmgr_shm->instructor.cardiac.rhythm, STR_SIZE, "%s", "");
+
 			}
-			else
+			break;
+		case CARDIAC_F_RATE:
+			if (simmgr_shm->instructor.cardiac.rate >= 0)
 			{
-				// When changing from a pulseless rhythm to a pulse rhythm, the rate will be set to 100
-				// This can be overridden in the command by setting the rate explicitly
 				currentIsPulsed = isRhythmPulsed(simmgr_shm->status.cardiac.rhythm);
-				if ((currentIsPulsed == false) && (newIsPulsed == true))
+				if (currentIsPulsed == true)
 				{
-					if (simmgr_shm->instructor.cardiac.rate < 0)
+					if (simmgr_shm->instructor.cardiac.rate != simmgr_shm->status.cardiac.rate)
 					{
-						simmgr_shm->instructor.cardiac.rate = 100;
-						simmgr_shm->instructor.cardiac.transfer_time = 0;
+						simmgr_shm->status.cardiac.rate = setTrend(TREND_CARDIAC_RATE,
+							simmgr_shm->instructor.cardiac.rate,
+							simmgr_shm->status.cardiac.rate,
+							simmgr_shm->instructor.cardiac.transfer_time);
+						if (simmgr_shm->instructor.cardiac.transfer_time >= 0)
+						{
+							sprintf_s(buf, BUF_SIZE, "Setting: %s: %d time %d", "Cardiac Rate",simmgr_shm->instructor.cardiac.rate, simmgr_shm->instructor.cardiac.transfer_time);
+						}
+						else
+						{
+							sprintf_s(buf, BUF_SIZE, "Setting: %s: %d", "Cardiac Rate", simmgr_shm->instructor.cardiac.rate);
+						}
+						simlog_entry(buf);
 					}
 				}
+				else
+				{
+					if (simmgr_shm->instructor.cardiac.rate > 0)
+					{
+						sprintf_s(buf, BUF_SIZE, "Setting: %s: %d", "Cardiac Rate cannot be set while in pulseless rhythm", simmgr_shm->instructor.cardiac.rate);
+						simlog_entry(buf);
+					}
+					else
+					{
+						simmgr_shm->status.cardiac.rate = setTrend(TREND_CARDIAC_RATE,
+							0,
+							simmgr_shm->status.cardiac.rate,
+							0);
+					}
+				}
+				simmgr_shm->instructor.cardiac.rate = -1;
 			}
-			sprintf_s(simmgr_shm->status.cardiac.rhythm, STR_SIZE, "%s", simmgr_shm->instructor.cardiac.rhythm);
-			sprintf_s(buf, BUF_SIZE, "Setting: %s: %s", "Cardiac Rhythm", simmgr_shm->instructor.cardiac.rhythm);
-			simlog_entry(buf);
-		}
-		sprintf_s(simmgr_shm->instructor.cardiac.rhythm, STR_SIZE, "%s", "");
-
-	}
-	if (simmgr_shm->instructor.cardiac.rate >= 0)
-	{
-		currentIsPulsed = isRhythmPulsed(simmgr_shm->status.cardiac.rhythm);
-		if (currentIsPulsed == true)
-		{
-			if (simmgr_shm->instructor.cardiac.rate != simmgr_shm->status.cardiac.rate)
+			break;
+		case CARDIAC_F_NIBP_RATE:
+			if (simmgr_shm->instructor.cardiac.nibp_rate >= 0)
+			{
+				if (simmgr_shm->status.cardiac.nibp_rate != simmgr_shm->instructor.cardiac.nibp_rate)
+				{
+					simmgr_shm->status.cardiac.nibp_rate = simmgr_shm->instructor.cardiac.nibp_rate;
+					sprintf_s(buf, BUF_SIZE, "Setting: %s: %d", "NIBP Rate", simmgr_shm->instructor.cardiac.rate);
+					simlog_entry(buf);
+				}
+				simmgr_shm->instructor.cardiac.nibp_rate = -1;
+			}
+			break;
+		case CARDIAC_F_NIBP_READ:
+			if (simmgr_shm->instructor.cardiac.nibp_read >= 0)
 			{
-				simmgr_shm->status.cardiac.rate = setTrend(&cardiacTrend,
-					simmgr_shm->instructor.cardiac.rate,
-					simmgr_shm->status.cardiac.rate,
+				if (simmgr_shm->status.cardiac.nibp_read != simmgr_shm->instructor.cardiac.nibp_read)
+				{
+					simmgr_shm->status.cardiac.nibp_read = simmgr_shm->instructor.cardiac.nibp_read;
+				}
+				simmgr_shm->instructor.cardiac.nibp_read = -1;
+			}
+			break;
+		case CARDIAC_F_NIBP_LINKED_HR:
+			if (simmgr_shm->instructor.cardiac.nibp_linked_hr >= 0)
+			{
+				if (simmgr_shm->status.cardiac.nibp_linked_hr != simmgr_shm->instructor.cardiac.nibp_linked_hr)
+				{
+					simmgr_shm->status.cardiac.nibp_linked_hr = simmgr_shm->instructor.cardiac.nibp_linked_hr;
+				}
+				simmgr_shm->instructor.cardiac.nibp_linked_hr = -1;
+			}
+			break;
+		case CARDIAC_F_NIBP_FREQ:
+			if (simmgr_shm->instructor.cardiac.nibp_freq >= 0)
+			{
+				if (simmgr_shm->status.cardiac.nibp_freq != simmgr_shm->instructor.cardiac.nibp_freq)
+				{
+					simmgr_shm->status.cardiac.nibp_freq = simmgr_shm->instructor.cardiac.nibp_freq;
+					if (nibp_state == NibpState::NibpWaiting) // Cancel current wait and allow reset to new rate
+					{
+						nibp_state = NibpState::NibpIdle;
+					}
+				}
+				simmgr_shm->instructor.cardiac.nibp_freq = -1;
+			}
+			break;
+		case CARDIAC_F_PWAVE:
+			if (strlen(simmgr_shm->instructor.cardiac.pwave) > 0)
+			{
+				sprintf_s(simmgr_shm->status.cardiac.pwave, STR_SIZE, "%s", simmgr_shm->instructor.cardiac.pwave);
+				sprintf_s(simmgr_shm->instructor.cardiac.pwave, STR_SIZE, "%s", "");
+			}
+			break;
+		case CARDIAC_F_PR_INTERVAL:
+			if (simmgr_shm->instructor.cardiac.pr_interval >= 0)
+			{
+				simmgr_shm->status.cardiac.pr_interval = simmgr_shm->instructor.cardiac.pr_interval;
+				simmgr_shm->instructor.cardiac.pr_interval = -1;
+			}
+			break;
+		case CARDIAC_F_QRS_INTERVAL:
+			if (simmgr_shm->instructor.cardiac.qrs_interval >= 0)
+			{
+				simmgr_shm->status.cardiac.qrs_interval = simmgr_shm->instructor.cardiac.qrs_interval;
+				simmgr_shm->instructor.cardiac.qrs_interval = -1;
+			}
+			break;
+		case CARDIAC_F_BPS_SYS:
+			if (simmgr_shm->instructor.cardiac.bps_sys >= 0)
+			{
+				simmgr_shm->status.cardiac.bps_sys = setTrend(TREND_BPS_SYS,
+					simmgr_shm->instructor.cardiac.bps_sys,
+					simmgr_shm->status.cardiac.bps_sys,
 					simmgr_shm->instructor.cardiac.transfer_time);
-				if (simmgr_shm->instructor.cardiac.transfer_time >= 0)
+				simmgr_shm->instructor.cardiac.bps_sys = -1;
+			}
+			break;
+		case CARDIAC_F_BPS_DIA:
+			if (simmgr_shm->instructor.cardiac.bps_dia >= 0)
+			{
+				simmgr_shm->status.cardiac.bps_dia = setTrend(TREND_BPS_DIA,
+					simmgr_shm->instructor.cardiac.bps_dia,
+					simmgr_shm->status.cardiac.bps_dia,
+					simmgr_shm->instructor.cardiac.transfer_time);
+				simmgr_shm->instructor.cardiac.bps_dia = -1;
+			}
+			break;
+		case CARDIAC_F_PEA:
+			if (simmgr_shm->instructor.cardiac.pea >= 0)
+			{
+				simmgr_shm->status.cardiac.pea = simmgr_shm->instructor.cardiac.pea;
+				simmgr_shm->instructor.cardiac.pea = -1;
+			}
+			break;
+		case CARDIAC_F_RIGHT_DORSAL_PULSE:
+			if (simmgr_shm->instructor.cardiac.right_dorsal_pulse_strength >= 0)
+			{
+				simmgr_shm->status.cardiac.right_dorsal_pulse_strength = simmgr_shm->instructor.cardiac.right_dorsal_pulse_strength;
+				simmgr_shm->instructor.cardiac.right_dorsal_pulse_strength = -1;
+			}
+			break;
+		case CARDIAC_F_RIGHT_FEMORAL_PULSE:
+			if (simmgr_shm->instructor.cardiac.right_femoral_pulse_strength >= 0)
+			{
+				simmgr_shm->status.cardiac.right_femoral_pulse_strength = simmgr_shm->instructor.cardiac.right_femoral_pulse_strength;
+				simmgr_shm->instructor.cardiac.right_femoral_pulse_strength = -1;
+			}
+			break;
+		case CARDIAC_F_LEFT_DORSAL_PULSE:
+			if (simmgr_shm->instructor.cardiac.left_dorsal_pulse_strength >= 0)
+			{
+				simmgr_shm->status.cardiac.left_dorsal_pulse_strength = simmgr_shm->instructor.cardiac.left_dorsal_pulse_strength;
+				simmgr_shm->instructor.cardiac.left_dorsal_pulse_strength = -1;
+			}
+			break;
+		case CARDIAC_F_LEFT_FEMORAL_PULSE:
+			if (simmgr_shm->instructor.cardiac.left_femoral_pulse_strength >= 0)
+			{
+				simmgr_shm->status.cardiac.left_femoral_pulse_strength = simmgr_shm->instructor.cardiac.left_femoral_pulse_strength;
+				simmgr_shm->instructor.cardiac.left_femoral_pulse_strength = -1;
+			}
+			break;
+		case CARDIAC_F_VPC_FREQ:
+			if (simmgr_shm->instructor.cardiac.vpc_freq >= 0)
+			{
+				simmgr_shm->status.cardiac.vpc_freq = simmgr_shm->instructor.cardiac.vpc_freq;
+				simmgr_shm->instructor.cardiac.vpc_freq = -1;
+			}
+			break;
+			/*
+			if ( simmgr_shm->instructor.cardiac.vpc_delay >= 0 )
+			{
+				simmgr_shm->status.cardiac.vpc_delay = simmgr_shm->instructor.cardiac.vpc_delay;
+				simmgr_shm->instructor.cardiac.vpc_delay = -1;
+			}
+			*/
+		case CARDIAC_F_VPC:
+			if (strlen(simmgr_shm->instructor.cardiac.vpc) > 0)
+			{
+				sprintf_s(simmgr_shm->status.cardiac.vpc, STR_SIZE, "%s", simmgr_shm->instructor.cardiac.vpc);
+				sprintf_s(simmgr_shm->instructor.cardiac.vpc, STR_SIZE, "%s", "");
+				switch (simmgr_shm->status.cardiac.vpc[0])
 				{
-					sprintf_s(buf, BUF_SIZE, "Setting: %s: %d time %d", "Cardiac Rate",simmgr_shm->instructor.cardiac.rate, simmgr_shm->instructor.cardiac.transfer_time);
+				case '1':
+					simmgr_shm->status.cardiac.vpc_type = 1;
+					break;
+				case '2':
+					simmgr_shm->status.cardiac.vpc_type = 2;
+					break;
+				default:
+					simmgr_shm->status.cardiac.vpc_type = 0;
+					resetVpc();
+					break;
 				}
-				else
+				switch (simmgr_shm->status.cardiac.vpc[2])
 				{
-					sprintf_s(buf, BUF_SIZE, "Setting: %s: %d", "Cardiac Rate", simmgr_shm->instructor.cardiac.rate);
+				case '1':
+					simmgr_shm->status.cardiac.vpc_count = 1;
+					break;
+				case '2':
+					simmgr_shm->status.cardiac.vpc_count = 2;
+					break;
+				case '3':
+					simmgr_shm->status.cardiac.vpc_count = 3;
+					break;
+				default:
+					simmgr_shm->status.cardiac.vpc_count = 0;
+					simmgr_shm->status.cardiac.vpc_type = 0;
+					resetVpc();
+					break;
 				}
-				simlog_entry(buf);
 			}
-		}
-		else
-		{
-			if (simmgr_shm->instructor.cardiac.rate > 0)
+			break;
+		case CARDIAC_F_VFIB_AMPLITUDE:
+			if (strlen(simmgr_shm->instructor.cardiac.vfib_amplitude) > 0)
 			{
-				sprintf_s(buf, BUF_SIZE, "Setting: %s: %d", "Cardiac Rate cannot be set while in pulseless rhythm", simmgr_shm->instructor.cardiac.rate);
-				simlog_entry(buf);
+				sprintf_s(simmgr_shm->status.cardiac.vfib_amplitude, STR_SIZE, "%s", simmgr_shm->instructor.cardiac.vfib_amplitude);
+				sprintf_s(simmgr_shm->instructor.cardiac.vfib_amplitude, STR_SIZE, "%s", "");
 			}
-			else
+			break;
+		case CARDIAC_F_HEART_SOUND:
+			if (strlen(simmgr_shm->instructor.cardiac.heart_sound) > 0)
 			{
-				simmgr_shm->status.cardiac.rate = setTrend(&cardiacTrend,
-					0,
-					simmgr_shm->status.cardiac.rate,
-					0);
+				sprintf_s(simmgr_shm->status.cardiac.heart_sound, STR_SIZE, "%s", simmgr_shm->instructor.cardiac.heart_sound);
+				sprintf_s(simmgr_shm->instructor.cardiac.heart_sound, STR_SIZE, "%s", "");
 			}
-		}
-		simmgr_shm->instructor.cardiac.rate = -1;
-	}
-	if (simmgr_shm->instructor.cardiac.nibp_rate >= 0)
-	{
-		if (simmgr_shm->status.cardiac.nibp_rate != simmgr_shm->instructor.cardiac.nibp_rate)
-		{
-			simmgr_shm->status.cardiac.nibp_rate = simmgr_shm->instructor.cardiac.nibp_rate;
-			sprintf_s(buf, BUF_SIZE, "Setting: %s: %d", "NIBP Rate", simmgr_shm->instructor.cardiac.rate);
-			simlog_entry(buf);
-		}
-		simmgr_shm->instructor.cardiac.nibp_rate = -1;
-	}
-	if (simmgr_shm->instructor.cardiac.nibp_read >= 0)
-	{
-		if (simmgr_shm->status.cardiac.nibp_read != simmgr_shm->instructor.cardiac.nibp_read)
-		{
-			simmgr_shm->status.cardiac.nibp_read = simmgr_shm->instructor.cardiac.nibp_read;
-		}
-		simmgr_shm->instructor.cardiac.nibp_read = -1;
-	}
-	if (simmgr_shm->instructor.cardiac.nibp_linked_hr >= 0)
-	{
-		if (simmgr_shm->status.cardiac.nibp_linked_hr != simmgr_shm->instructor.cardiac.nibp_linked_hr)
-		{
-			simmgr_shm->status.cardiac.nibp_linked_hr = simmgr_shm->instructor.cardiac.nibp_linked_hr;
-		}
-		simmgr_shm->instructor.cardiac.nibp_linked_hr = -1;
-	}
-	if (simmgr_shm->instructor.cardiac.nibp_freq >= 0)
-	{
-		if (simmgr_shm->status.cardiac.nibp_freq != simmgr_shm->instructor.cardiac.nibp_freq)
-		{
-			simmgr_shm->status.cardiac.nibp_freq = simmgr_shm->instructor.cardiac.nibp_freq;
-			if (nibp_state == NibpState::NibpWaiting) // Cancel current wait and allow reset to new rate
+			break;
+		case CARDIAC_F_HEART_SOUND_VOLUME:
+			if (simmgr_shm->instructor.cardiac.heart_sound_volume >= 0)
 			{
-				nibp_state = NibpState::NibpIdle;
+				simmgr_shm->status.cardiac.heart_sound_volume = simmgr_shm->instructor.cardiac.heart_sound_volume;
+				simmgr_shm->instructor.cardiac.heart_sound_volume = -1;
 			}
-		}
-		simmgr_shm->instructor.cardiac.nibp_freq = -1;
-	}
-	if (strlen(simmgr_shm->instructor.cardiac.pwave) > 0)
-	{
-		sprintf_s(simmgr_shm->status.cardiac.pwave, STR_SIZE, "%s", simmgr_shm->instructor.cardiac.pwave);
-		sprintf_s(simmgr_shm->instructor.cardiac.pwave, STR_SIZE, "%s", "");
-	}
-	if (simmgr_shm->instructor.cardiac.pr_interval >= 0)
-	{
-		simmgr_shm->status.cardiac.pr_interval = simmgr_shm->instructor.cardiac.pr_interval;
-		simmgr_shm->instructor.cardiac.pr_interval = -1;
-	}
-	if (simmgr_shm->instructor.cardiac.qrs_interval >= 0)
-	{
-		simmgr_shm->status.cardiac.qrs_interval = simmgr_shm->instructor.cardiac.qrs_interval;
-		simmgr_shm->instructor.cardiac.qrs_interval = -1;
-	}
-	if (simmgr_shm->instructor.cardiac.qrs_interval >= 0)
-	{
-		simmgr_shm->status.cardiac.qrs_interval = simmgr_shm->instructor.cardiac.qrs_interval;
-		simmgr_shm->instructor.cardiac.qrs_interval = -1;
-	}
-	if (simmgr_shm->instructor.cardiac.bps_sys >= 0)
-	{
-		simmgr_shm->status.cardiac.bps_sys = setTrend(&sysTrend,
-			simmgr_shm->instructor.cardiac.bps_sys,
-			simmgr_shm->status.cardiac.bps_sys,
-			simmgr_shm->instructor.cardiac.transfer_time);
-		simmgr_shm->instructor.cardiac.bps_sys = -1;
-	}
-	if (simmgr_shm->instructor.cardiac.bps_dia >= 0)
-	{
-		simmgr_shm->status.cardiac.bps_dia = setTrend(&diaTrend,
-			simmgr_shm->instructor.cardiac.bps_dia,
-			simmgr_shm->status.cardiac.bps_dia,
-			simmgr_shm->instructor.cardiac.transfer_time);
-		simmgr_shm->instructor.cardiac.bps_dia = -1;
-	}
-	if (simmgr_shm->instructor.cardiac.pea >= 0)
-	{
-		simmgr_shm->status.cardiac.pea = simmgr_shm->instructor.cardiac.pea;
-		simmgr_shm->instructor.cardiac.pea = -1;
-	}
-	if (simmgr_shm->instructor.cardiac.right_dorsal_pulse_strength >= 0)
-	{
-		simmgr_shm->status.cardiac.right_dorsal_pulse_strength = simmgr_shm->instructor.cardiac.right_dorsal_pulse_strength;
-		simmgr_shm->instructor.cardiac.right_dorsal_pulse_strength = -1;
-	}
-	if (simmgr_shm->instructor.cardiac.right_femoral_pulse_strength >= 0)
-	{
-		simmgr_shm->status.cardiac.right_femoral_pulse_strength = simmgr_shm->instructor.cardiac.right_femoral_pulse_strength;
-		simmgr_shm->instructor.cardiac.right_femoral_pulse_strength = -1;
-	}
-	if (simmgr_shm->instructor.cardiac.left_dorsal_pulse_strength >= 0)
-	{
-		simmgr_shm->status.cardiac.left_dorsal_pulse_strength = simmgr_shm->instructor.cardiac.left_dorsal_pulse_strength;
-		simmgr_shm->instructor.cardiac.left_dorsal_pulse_strength = -1;
-	}
-	if (simmgr_shm->instructor.cardiac.left_femoral_pulse_strength >= 0)
-	{
-		simmgr_shm->status.cardiac.left_femoral_pulse_strength = simmgr_shm->instructor.cardiac.left_femoral_pulse_strength;
-		simmgr_shm->instructor.cardiac.left_femoral_pulse_strength = -1;
-	}
-	if (simmgr_shm->instructor.cardiac.vpc_freq >= 0)
-	{
-		simmgr_shm->status.cardiac.vpc_freq = simmgr_shm->instructor.cardiac.vpc_freq;
-		simmgr_shm->instructor.cardiac.vpc_freq = -1;
-	}
-	/*
-	if ( simmgr_shm->instructor.cardiac.vpc_delay >= 0 )
-	{
-		simmgr_shm->status.cardiac.vpc_delay = simmgr_shm->instructor.cardiac.vpc_delay;
-		simmgr_shm->instructor.cardiac.vpc_delay = -1;
-	}
-	*/
-	if (strlen(simmgr_shm->instructor.cardiac.vpc) > 0)
-	{
-		sprintf_s(simmgr_shm->status.cardiac.vpc, STR_SIZE, "%s", simmgr_shm->instructor.cardiac.vpc);
-		sprintf_s(simmgr_shm->instructor.cardiac.vpc, STR_SIZE, "%s", "");
-		switch (simmgr_shm->status.cardiac.vpc[0])
-		{
-		case '1':
-			simmgr_shm->status.cardiac.vpc_type = 1;
 			break;
-		case '2':
-			simmgr_shm->status.cardiac.vpc_type = 2;
+		case CARDIAC_F_HEART_SOUND_MUTE:
+			if (simmgr_shm->instructor.cardiac.heart_sound_mute >= 0)
+			{
+				simmgr_shm->status.cardiac.heart_sound_mute = simmgr_shm->instructor.cardiac.heart_sound_mute;
+				simmgr_shm->instructor.cardiac.heart_sound_mute = -1;
+			}
 			break;
-		default:
-			simmgr_shm->status.cardiac.vpc_type = 0;
-			resetVpc();
+		case CARDIAC_F_ECG_INDICATOR:
+			if (simmgr_shm->instructor.cardiac.ecg_indicator >= 0)
+			{
+				if (simmgr_shm->status.cardiac.ecg_indicator != simmgr_shm->instructor.cardiac.ecg_indicator)
+				{
+					simmgr_shm->status.cardiac.ecg_indicator = simmgr_shm->instructor.cardiac.ecg_indicator;
+					sprintf_s(buf, BUF_SIZE, "Probe: %s %s", "ECG", (simmgr_shm->status.cardiac.ecg_indicator == 1 ? "Attached" : "Removed"));
+					simlog_entry(buf);
+				}
+				simmgr_shm->instructor.cardiac.ecg_indicator = -1;
+			}
 			break;
-		}
-		switch (simmgr_shm->status.cardiac.vpc[2])
-		{
-		case '1':
-			simmgr_shm->status.cardiac.vpc_count = 1;
+		case CARDIAC_F_BP_CUFF:
+			if (simmgr_shm->instructor.cardiac.bp_cuff >= 0)
+			{
+				if (simmgr_shm->status.cardiac.bp_cuff != simmgr_shm->instructor.cardiac.bp_cuff)
+				{
+					simmgr_shm->status.cardiac.bp_cuff = simmgr_shm->instructor.cardiac.bp_cuff;
+					sprintf_s(buf, BUF_SIZE, "Probe: %s %s", "BP Cuff", (simmgr_shm->status.cardiac.bp_cuff == 1 ? "Attached" : "Removed"));
+					simlog_entry(buf);
+				}
+				simmgr_shm->instructor.cardiac.bp_cuff = -1;
+			}
 			break;
-		case '2':
-			simmgr_shm->status.cardiac.vpc_count = 2;
+		case CARDIAC_F_ARREST:
+			if (simmgr_shm->instructor.cardiac.arrest >= 0)
+			{
+				if (simmgr_shm->status.cardiac.arrest != simmgr_shm->instructor.cardiac.arrest)
+				{
+					simmgr_shm->status.cardiac.arrest = simmgr_shm->instructor.cardiac.arrest;
+					sprintf_s(buf, BUF_SIZE, "Setting: %s %s", "Arrest", (simmgr_shm->status.cardiac.arrest == 1 ? "Start" : "Stop"));
+					simlog_entry(buf);
+				}
+				simmgr_shm->instructor.cardiac.arrest = -1;
+			}
 			break;
-		case '3':
-			simmgr_shm->status.cardiac.vpc_count = 3;
+		case CARDIAC_F_TRANSFER_TIME:
+			// Used by the trends set above; cleared once they are set
+			simmgr_shm->instructor.cardiac.transfer_time = -1;
 			break;
 		default:
-			simmgr_shm->status.cardiac.vpc_count = 0;
-			simmgr_shm->status.cardiac.vpc_type = 0;
-			resetVpc();
 			break;
 		}
 	}
-	if (strlen(simmgr_shm->instructor.cardiac.vfib_amplitude) > 0)
-	{
-		sprintf_s(simmgr_shm->status.cardiac.vfib_amplitude, STR_SIZE, "%s", simmgr_shm->instructor.cardiac.vfib_amplitude);
-		sprintf_s(simmgr_shm->instructor.cardiac.vfib_amplitude, STR_SIZE, "%s", "");
-	}
-	if (strlen(simmgr_shm->instructor.cardiac.heart_sound) > 0)
-	{
-		sprintf_s(simmgr_shm->status.cardiac.heart_sound, STR_SIZE, "%s", simmgr_shm->instructor.cardiac.heart_sound);
-		sprintf_s(simmgr_shm->instructor.cardiac.heart_sound, STR_SIZE, "%s", "");
-	}
-	if (simmgr_shm->instructor.cardiac.heart_sound_volume >= 0)
-	{
-		simmgr_shm->status.cardiac.heart_sound_volume = simmgr_shm->instructor.cardiac.heart_sound_volume;
-		simmgr_shm->instructor.cardiac.heart_sound_volume = -1;
-	}
-	if (simmgr_shm->instructor.cardiac.heart_sound_mute >= 0)
-	{
-		simmgr_shm->status.cardiac.heart_sound_mute = simmgr_shm->instructor.cardiac.heart_sound_mute;
-		simmgr_shm->instructor.cardiac.heart_sound_mute = -1;
-	}
-
-	if (simmgr_shm->instructor.cardiac.ecg_indicator >= 0)
-	{
-		if (simmgr_shm->status.cardiac.ecg_indicator != simmgr_shm->instructor.cardiac.ecg_indicator)
-		{
-			simmgr_shm->status.cardiac.ecg_indicator = simmgr_shm->instructor.cardiac.ecg_indicator;
-			sprintf_s(buf, BUF_SIZE, "Probe: %s %s", "ECG", (simmgr_shm->status.cardiac.ecg_indicator == 1 ? "Attached" : "Removed"));
-			simlog_entry(buf);
-		}
-		simmgr_shm->instructor.cardiac.ecg_indicator = -1;
-	}
-	if (simmgr_shm->instructor.cardiac.bp_cuff >= 0)
-	{
-		if (simmgr_shm->status.cardiac.bp_cuff != simmgr_shm->instructor.cardiac.bp_cuff)
-		{
-			simmgr_shm->status.cardiac.bp_cuff = simmgr_shm->instructor.cardiac.bp_cuff;
-			sprintf_s(buf, BUF_SIZE, "Probe: %s %s", "BP Cuff", (simmgr_shm->status.cardiac.bp_cuff == 1 ? "Attached" : "Removed"));
-			simlog_entry(buf);
-		}
-		simmgr_shm->instructor.cardiac.bp_cuff = -1;
-	}
-	if (simmgr_shm->instructor.cardiac.arrest >= 0)
-	{
-		if (simmgr_shm->status.cardiac.arrest != simmgr_shm->instructor.cardiac.arrest)
-		{
-			simmgr_shm->status.cardiac.arrest = simmgr_shm->instructor.cardiac.arrest;
-			sprintf_s(buf, BUF_SIZE, "Setting: %s %s", "Arrest", (simmgr_shm->status.cardiac.arrest == 1 ? "Start" : "Stop"));
-			simlog_entry(buf);
-		}
-		simmgr_shm->instructor.cardiac.arrest = -1;
-	}
-	simmgr_shm->instructor.cardiac.transfer_time = -1;
+	releaseInstructorSections(II_MASK(II_CARDIAC));
 
 	// Respiration
-	if (strlen(simmgr_shm->instructor.respiration.left_lung_sound) > 0)
-	{
-		sprintf_s(simmgr_shm->status.respiration.left_lung_sound, STR_SIZE, "%s", simmgr_shm->instructor.respiration.left_lung_sound);
-		sprintf_s(simmgr_shm->instructor.respiration.left_lung_sound, STR_SIZE, "%s", "");
-	}
-	if (strlen(simmgr_shm->instructor.respiration.right_lung_sound) > 0)
-	{
-		sprintf_s(simmgr_shm->status.respiration.right_lung_sound, STR_SIZE, "%s", simmgr_shm->instructor.respiration.right_lung_sound);
-		sprintf_s(simmgr_shm->instructor.respiration.right_lung_sound, STR_SIZE, "%s", "");
-	}
-	/*
-	if ( simmgr_shm->instructor.respiration.inhalation_duration >= 0 )
-	{
-		simmgr_shm->status.respiration.inhalation_duration = simmgr_shm->instructor.respiration.inhalation_duration;
-		simmgr_shm->instructor.respiration.inhalation_duration = -1;
-	}
-	if ( simmgr_shm->instructor.respiration.exhalation_duration >= 0 )
-	{
-		simmgr_shm->status.respiration.exhalation_duration = simmgr_shm->instructor.respiration.exhalation_duration;
-		simmgr_shm->instructor.respiration.exhalation_duration = -1;
-	}
-	*/
-	if (simmgr_shm->instructor.respiration.left_lung_sound_volume >= 0)
-	{
-		simmgr_shm->status.respiration.left_lung_sound_volume = simmgr_shm->instructor.respiration.left_lung_sound_volume;
-		simmgr_shm->instructor.respiration.left_lung_sound_volume = -1;
-	}
-	if (simmgr_shm->instructor.respiration.left_lung_sound_mute >= 0)
-	{
-		simmgr_shm->status.respiration.left_lung_sound_mute = simmgr_shm->instructor.respiration.left_lung_sound_mute;
-		simmgr_shm->instructor.respiration.left_lung_sound_mute = -1;
-	}
-	if (simmgr_shm->instructor.respiration.right_lung_sound_volume >= 0)
-	{
-		simmgr_shm->status.respiration.right_lung_sound_volume = simmgr_shm->instructor.respiration.right_lung_sound_volume;
-		simmgr_shm->instructor.respiration.right_lung_sound_volume = -1;
-	}
-	if (simmgr_shm->instructor.respiration.right_lung_sound_mute >= 0)
-	{
-		simmgr_shm->status.respiration.right_lung_sound_mute = simmgr_shm->instructor.respiration.right_lung_sound_mute;
-		simmgr_shm->instructor.respiration.right_lung_sound_mute = -1;
-	}
-	if (simmgr_shm->instructor.respiration.rate >= 0)
+	takeInstructorSections(II_MASK(II_RESPIRATION));
+	dirty = simmgr_shm->instructor.dirty[II_RESPIRATION];
+	simmgr_shm->instructor.dirty[II_RESPIRATION] = 0;
+	while (dirty)
 	{
-		sprintf_s(msg_buf, BUF_SIZE,"Setting: Resp Rate = %d -> %d : %d", simmgr_shm->status.respiration.rate, simmgr_shm->instructor.respiration.rate, simmgr_shm->instructor.respiration.transfer_time);
-		log_message("", msg_buf);
-		simmgr_shm->status.respiration.rate = setTrend(&respirationTrend,
-			simmgr_shm->instructor.respiration.rate,
-			simmgr_shm->status.respiration.rate,
-			simmgr_shm->instructor.respiration.transfer_time);
-		if (simmgr_shm->instructor.respiration.transfer_time == 0)
+		field = instructorNextField(&dirty);
+		switch (field)
 		{
-			setRespirationPeriods(simmgr_shm->status.respiration.rate, simmgr_shm->instructor.respiration.rate);
-		}
-		simmgr_shm->instructor.respiration.rate = -1;
-	}
-	if (simmgr_shm->instructor.respiration.spo2 >= 0)
-	{
-		simmgr_shm->status.respiration.spo2 = setTrend(&spo2Trend,
-			simmgr_shm->instructor.respiration.spo2,
-			simmgr_shm->status.respiration.spo2,
-			simmgr_shm->instructor.respiration.transfer_time);
-		simmgr_shm->instructor.respiration.spo2 = -1;
-	}
-
-	if (simmgr_shm->instructor.respiration.etco2 >= 0)
-	{
-		simmgr_shm->status.respiration.etco2 = setTrend(&etco2Trend,
-			simmgr_shm->instructor.respiration.etco2,
-			simmgr_shm->status.respiration.etco2,
-			simmgr_shm->instructor.respiration.transfer_time);
-		simmgr_shm->instructor.respiration.etco2 = -1;
-	}
-	if (simmgr_shm->instructor.respiration.etco2_indicator >= 0)
-	{
-		if (simmgr_shm->status.respiration.etco2_indicator != simmgr_shm->instructor.respiration.etco2_indicator)
-		{
-			simmgr_shm->status.respiration.etco2_indicator = simmgr_shm->instructor.respiration.etco2_indicator;
-			sprintf_s(buf, BUF_SIZE, "Probe: %s %s", "ETCO2", (simmgr_shm->status.respiration.etco2_indicator == 1 ? "Attached" : "Removed"));
-			simlog_entry(buf);
-		}
+		case RESPIRATION_F_LEFT_LUNG_SOUND:
+			if (strlen(simmgr_shm->instructor.respiration.left_lung_sound) > 0)
+			{
+				sprintf_s(simmgr_shm->status.respiration.left_lung_sound, STR_SIZE, "%s", simmgr_shm->instructor.respiration.left_lung_sound);
+				sprintf_s(simmgr_shm->instructor.respiration.left_lung_sound, STR_SIZE, "%s", "");
+			}
+			break;
+		case RESPIRATION_F_RIGHT_LUNG_SOUND:
+			if (strlen(simmgr_shm->instructor.respiration.right_lung_sound) > 0)
+			{
+				sprintf_s(simmgr_shm->status.respiration.right_lung_sound, STR_SIZE, "%s", simmgr_shm->instructor.respiration.right_lung_sound);
+				sprintf_s(simmgr_shm->instructor.respiration.right_lung_sound, STR_SIZE, "%s", "");
+			}
+			break;
+			/*
+			if ( simmgr_shm->instructor.respiration.inhalation_duration >= 0 )
+			{
+				simmgr_shm->status.respiration.inhalation_duration = simmgr_shm->instructor.respiration.inhalation_duration;
+				simmgr_shm->instructor.respiration.inhalation_duration = -1;
+			}
+			if ( simmgr_shm->instructor.respiration.exhalation_duration >= 0 )
+			{
+				simmgr_shm->status.respiration.exhalation_duration = simmgr_shm->instructor.respiration.exhalation_duration;
+				simmgr_shm->instructor.respiration.exhalation_duration = -1;
+			}
+			*/
+		case RESPIRATION_F_LEFT_LUNG_SOUND_VOLUME:
+			if (simmgr_shm->instructor.respiration.left_lung_sound_volume >= 0)
+			{
+				simmgr_shm->status.respiration.left_lung_sound_volume = simmgr_shm->instructor.respiration.left_lung_sound_volume;
+				simmgr_shm->instructor.respiration.left_lung_sound_volume = -1;
+			}
+			break;
+		case RESPIRATION_F_LEFT_LUNG_SOUND_MUTE:
+			if (simmgr_shm->instructor.respiration.left_lung_sound_mute >= 0)
+			{
+				simmgr_shm->status.respiration.left_lung_sound_mute = simmgr_shm->instructor.respiration.left_lung_sound_mute;
+				simmgr_shm->instructor.respiration.left_lung_sound_mute = -1;
+			}
+			break;
+		case RESPIRATION_F_RIGHT_LUNG_SOUND_VOLUME:
+			if (simmgr_shm->instructor.respiration.right_lung_sound_volume >= 0)
+			{
+				simmgr_shm->status.respiration.right_lung_sound_volume = simmgr_shm->instructor.respiration.right_lung_sound_volume;
+				simmgr_shm->instructor.respiration.right_lung_sound_volume = -1;
+			}
+			break;
+		case RESPIRATION_F_RIGHT_LUNG_SOUND_MUTE:
+			if (simmgr_shm->instructor.respiration.right_lung_sound_mute >= 0)
+			{
+				simmgr_shm->status.respiration.right_lung_sound_mute = simmgr_shm->instructor.respiration.right_lung_sound_mute;
+				simmgr_shm->instructor.respiration.right_lung_sound_mute = -1;
+			}
+			break;
+		case RESPIRATION_F_RATE:
+			if (simmgr_shm->instructor.respiration.rate >= 0)
+			{
+				sprintf_s(msg_buf, BUF_SIZE,"Setting: Resp Rate = %d -> %d : %d", simmgr_shm->status.respiration.rate, simmgr_shm->instructor.respiration.rate, simmgr_shm->instructor.respiration.transfer_time);
+				log_message("", msg_buf);
+				simmgr_shm->status.respiration.rate = setTrend(TREND_RESPIRATION_RATE,
+					simmgr_shm->instructor.respiration.rate,
+					simmgr_shm->status.respiration.rate,
+					simmgr_shm->instructor.respiration.transfer_time);
+				// Periods for the rate now in effect. trend_task updates them as a trend moves.
+				setRespirationPeriods(simmgr_shm->status.respiration.rate, simmgr_shm->status.respiration.rate);
+				simmgr_shm->instructor.respiration.rate = -1;
+			}
+			break;
+		case RESPIRATION_F_SPO2:
+			if (simmgr_shm->instructor.respiration.spo2 >= 0)
+			{
+				simmgr_shm->status.respiration.spo2 = setTrend(TREND_SPO2,
+					simmgr_shm->instructor.respiration.spo2,
+					simmgr_shm->status.respiration.spo2,
+					simmgr_shm->instructor.respiration.transfer_time);
+				simmgr_shm->instructor.respiration.spo2 = -1;
+			}
+			break;
+		case RESPIRATION_F_ETCO2:
+			if (simmgr_shm->instructor.respiration.etco2 >= 0)
+			{
+				simmgr_shm->status.respiration.etco2 = setTrend(TREND_ETCO2,
+					simmgr_shm->instructor.respiration.etco2,
+					simmgr_shm->status.respiration.etco2,
+					simmgr_shm->instructor.respiration.transfer_time);
+				simmgr_shm->instructor.respiration.etco2 = -1;
+			}
+			break;
+		case RESPIRATION_F_ETCO2_INDICATOR:
+			if (simmgr_shm->instructor.respiration.etco2_indicator >= 0)
+			{
+				if (simmgr_shm->status.respiration.etco2_indicator != simmgr_shm->instructor.respiration.etco2_indicator)
+				{
+					simmgr_shm->status.respiration.etco2_indicator = simmgr_shm->instructor.respiration.etco2_indicator;
+					sprintf_s(buf, BUF_SIZE, "Probe: %s %s", "ETCO2", (simmgr_shm->status.respiration.etco2_indicator == 1 ? "Attached" : "Removed"));
+					simlog_entry(buf);
+				}
 
-		simmgr_shm->instructor.respiration.etco2_indicator = -1;
-	}
-	if (simmgr_shm->instructor.respiration.spo2_indicator >= 0)
-	{
-		if (simmgr_shm->status.respiration.spo2_indicator != simmgr_shm->instructor.respiration.spo2_indicator)
-		{
-			simmgr_shm->status.respiration.spo2_indicator = simmgr_shm->instructor.respiration.spo2_indicator;
-			sprintf_s(buf, BUF_SIZE, "Probe: %s %s", "SPO2", (simmgr_shm->status.respiration.spo2_indicator == 1 ? "Attached" : "Removed"));
-			simlog_entry(buf);
-		}
-		simmgr_shm->instructor.respiration.spo2_indicator = -1;
-	}
-	if (simmgr_shm->instructor.respiration.chest_movement >= 0)
-	{
-		if (simmgr_shm->status.respiration.chest_movement != simmgr_shm->instructor.respiration.chest_movement)
-		{
-			simmgr_shm->status.respiration.chest_movement = simmgr_shm->instructor.respiration.chest_movement;
+				simmgr_shm->instructor.respiration.etco2_indicator = -1;
+			}
+			break;
+		case RESPIRATION_F_SPO2_INDICATOR:
+			if (simmgr_shm->instructor.respiration.spo2_indicator >= 0)
+			{
+				if (simmgr_shm->status.respiration.spo2_indicator != simmgr_shm->instructor.respiration.spo2_indicator)
+				{
+					simmgr_shm->status.respiration.spo2_indicator = simmgr_shm->instructor.respiration.spo2_indicator;
+					sprintf_s(buf, BUF_SIZE, "Probe: %s %s", "SPO2", (simmgr_shm->status.respiration.spo2_indicator == 1 ? "Attached" : "Removed"));
+					simlog_entry(buf);
+				}
+				simmgr_shm->instructor.respiration.spo2_indicator = -1;
+			}
+			break;
+		case RESPIRATION_F_CHEST_MOVEMENT:
+			if (simmgr_shm->instructor.respiration.chest_movement >= 0)
+			{
+				if (simmgr_shm->status.respiration.chest_movement != simmgr_shm->instructor.respiration.chest_movement)
+				{
+					simmgr_shm->status.respiration.chest_movement = simmgr_shm->instructor.respiration.chest_movement;
+				}
+				simmgr_shm->instructor.respiration.chest_movement = -1;
+			}
+			break;
+		case RESPIRATION_F_MANUAL_BREATH:
+			if (simmgr_shm->instructor.respiration.manual_breath >= 0)
+			{
+				simmgr_shm->status.respiration.manual_count++;
+				simmgr_shm->instructor.respiration.manual_breath = -1;
+			}
+			break;
+		case RESPIRATION_F_TRANSFER_TIME:
+			// Used by the trends set above; cleared once they are set
+			simmgr_shm->instructor.respiration.transfer_time = -1;
+			break;
+		default:
+			break;
 		}
-		simmgr_shm->instructor.respiration.chest_movement = -1;
-	}
-	if (simmgr_shm->instructor.respiration.manual_breath >= 0)
-	{
-		simmgr_shm->status.respiration.manual_count++;
-		simmgr_shm->instructor.respiration.manual_breath = -1;
 	}
-	simmgr_shm->instructor.respiration.transfer_time = -1;
+	releaseInstructorSections(II_MASK(II_RESPIRATION));
 
 	// General
-	if (simmgr_shm->instructor.general.temperature >= 0)
-	{
-		simmgr_shm->status.general.temperature = setTrend(&tempTrend,
-			simmgr_shm->instructor.general.temperature,
-			simmgr_shm->status.general.temperature,
-			simmgr_shm->instructor.general.transfer_time);
-		simmgr_shm->instructor.general.temperature = -1;
-	}
-	if (strlen(simmgr_shm->instructor.general.temperature_units) > 0)
+	takeInstructorSections(II_MASK(II_GENERAL));
+	dirty = simmgr_shm->instructor.dirty[II_GENERAL];
+	simmgr_shm->instructor.dirty[II_GENERAL] = 0;
+	while (dirty)
 	{
-		if (simmgr_shm->instructor.general.temperature_units[0] != simmgr_shm->status.general.temperature_units[0])
+		field = instructorNextField(&dirty);
+		switch (field)
 		{
-			if (simmgr_shm->instructor.general.temperature_units[0] == 'F' ||
-				simmgr_shm->instructor.general.temperature_units[0] == 'C')
+		case GENERAL_F_TEMPERATURE:
+			if (simmgr_shm->instructor.general.temperature >= 0)
+			{
+				simmgr_shm->status.general.temperature = setTrend(TREND_TEMPERATURE,
+					simmgr_shm->instructor.general.temperature,
+					simmgr_shm->status.general.temperature,
+					simmgr_shm->instructor.general.transfer_time);
+				simmgr_shm->instructor.general.temperature = -1;
+			}
+			break;
+		case GENERAL_F_TEMPERATURE_UNITS:
+			if (strlen(simmgr_shm->instructor.general.temperature_units) > 0)
 			{
-				sprintf_s(simmgr_shm->status.general.temperature_units, STR_SIZE, "%s",
-					simmgr_shm->instructor.general.temperature_units);
+				if (simmgr_shm->instructor.general.temperature_units[0] != simmgr_shm->status.general.temperature_units[0])
+				{
+					if (simmgr_shm->instructor.general.temperature_units[0] == 'F' ||
+						simmgr_shm->instructor.general.temperature_units[0] == 'C')
+					{
+						sprintf_s(simmgr_shm->status.general.temperature_units, STR_SIZE, "%s",
+							simmgr_shm->instructor.general.temperature_units);
+					}
+					sprintf_s(simmgr_shm->instructor.general.temperature_units, STR_SIZE, "%s", "");
+				}
 			}
-			sprintf_s(simmgr_shm->instructor.general.temperature_units, STR_SIZE, "%s", "");
+			break;
+		case GENERAL_F_TEMPERATURE_ENABLE:
+			if (simmgr_shm->instructor.general.temperature_enable >= 0)
+			{
+				if (simmgr_shm->status.general.temperature_enable != simmgr_shm->instructor.general.temperature_enable)
+				{
+					simmgr_shm->status.general.temperature_enable = simmgr_shm->instructor.general.temperature_enable;
+					sprintf_s(buf, BUF_SIZE, "Probe: %s %s", "Temp", (simmgr_shm->status.general.temperature_enable == 1 ? "Attached" : "Removed"));
+					simlog_entry(buf);
+				}
+				simmgr_shm->instructor.general.temperature_enable = -1;
+			}
+			break;
+		case GENERAL_F_CLOCK_START:
+			if (strlen(simmgr_shm->instructor.general.clockStart) > 0)
+			{
+				struct tm tm;
+				time_t now;
+				now = std::time(nullptr);
+				localtime_s(&tm, &now);
+
+				sprintf_s(simmgr_shm->status.general.clockStart, STR_SIZE, "%s", simmgr_shm->instructor.general.clockStart);
+				sprintf_s(simmgr_shm->instructor.general.clockStart, STR_SIZE, "%s", "");
+				sprintf_s(simmgr_shm->status.general.clockStart, STR_SIZE, "%02d:%02d:%02d", tm.tm_hour, tm.tm_min, tm.tm_sec);
+				sprintf_s(buf, BUF_SIZE, "%s %02d %02d %02d", "time returned", tm.tm_hour, tm.tm_min, tm.tm_sec);
+				log_message("", buf);
+
+				simmgr_shm->status.general.clockStartSec = (tm.tm_hour * 60 * 60) + (tm.tm_min * 60) + tm.tm_sec;
+			}
+			break;
+		case GENERAL_F_TRANSFER_TIME:
+			// Used by the trends set above; cleared once they are set
+			simmgr_shm->instructor.general.transfer_time = -1;
+			break;
+		default:
+			break;
 		}
 	}
-	if (simmgr_shm->instructor.general.temperature_enable >= 0)
+	releaseInstructorSections(II_MASK(II_GENERAL));
+
+	// vocals
+	takeInstructorSections(II_MASK(II_MEDIA));
+	dirty = simmgr_shm->instructor.dirty[II_MEDIA];
+	simmgr_shm->instructor.dirty[II_MEDIA] = 0;
+	while (dirty)
 	{
-		if (simmgr_shm->status.general.temperature_enable != simmgr_shm->instructor.general.temperature_enable)
+		field = instructorNextField(&dirty);
+		switch (field)
 		{
-			simmgr_shm->status.general.temperature_enable = simmgr_shm->instructor.general.temperature_enable;
-			sprintf_s(buf, BUF_SIZE, "Probe: %s %s", "Temp", (simmgr_shm->status.general.temperature_enable == 1 ? "Attached" : "Removed"));
-			simlog_entry(buf);
+		case VOCALS_F_FILENAME:
+			if (strlen(simmgr_shm->instructor.vocals.filename) > 0)
+			{
+				sprintf_s(simmgr_shm->status.vocals.filename, STR_SIZE, "%s", simmgr_shm->instructor.vocals.filename);
+				sprintf_s(simmgr_shm->instructor.vocals.filename, STR_SIZE, "%s", "");
+			}
+			break;
+		case VOCALS_F_REPEAT:
+			if (simmgr_shm->instructor.vocals.repeat >= 0)
+			{
+				simmgr_shm->status.vocals.repeat = simmgr_shm->instructor.vocals.repeat;
+				simmgr_shm->instructor.vocals.repeat = -1;
+			}
+			break;
+		case VOCALS_F_VOLUME:
+			if (simmgr_shm->instructor.vocals.volume >= 0)
+			{
+				simmgr_shm->status.vocals.volume = simmgr_shm->instructor.vocals.volume;
+				simmgr_shm->instructor.vocals.volume = -1;
+			}
+			break;
+		case VOCALS_F_PLAY:
+			if (simmgr_shm->instructor.vocals.play >= 0)
+			{
+				simmgr_shm->status.vocals.play = simmgr_shm->instructor.vocals.play;
+				simmgr_shm->instructor.vocals.play = -1;
+			}
+			break;
+		case VOCALS_F_MUTE:
+			if (simmgr_shm->instructor.vocals.mute >= 0)
+			{
+				simmgr_shm->status.vocals.mute = simmgr_shm->instructor.vocals.mute;
+				simmgr_shm->instructor.vocals.mute = -1;
+			}
+			break;
+		// media
+		case MEDIA_F_FILENAME:
+			if (strlen(simmgr_shm->instructor.media.filename) > 0)
+			{
+				sprintf_s(simmgr_shm->status.media.filename, STR_SIZE, "%s", simmgr_shm->instructor.media.filename);
+				sprintf_s(simmgr_shm->instructor.media.filename, STR_SIZE, "%s", "");
+			}
+			break;
+		case MEDIA_F_PLAY:
+			if (simmgr_shm->instructor.media.play != -1)
+			{
+				simmgr_shm->status.media.play = simmgr_shm->instructor.media.play;
+				simmgr_shm->instructor.media.play = -1;
+			}
+			break;
+		default:
+			break;
 		}
-		simmgr_shm->instructor.general.temperature_enable = -1;
-	}
-	simmgr_shm->instructor.general.transfer_time = -1;
-	if (strlen(simmgr_shm->instructor.general.clockStart) > 0)
-	{
-		struct tm tm;
-		time_t now;
-		now = std::time(nullptr);
-		localtime_s(&tm, &now);
-
-		sprintf_s(simmgr_shm->status.general.clockStart, STR_SIZE, "%s", simmgr_shm->instructor.general.clockStart);
-		sprintf_s(simmgr_shm->instructor.general.clockStart, STR_SIZE, "%s", "");
-		sprintf_s(simmgr_shm->status.general.clockStart, STR_SIZE, "%02d:%02d:%02d", tm.tm_hour, tm.tm_min, tm.tm_sec);
-		sprintf_s(buf, BUF_SIZE, "%s %02d %02d %02d", "time returned", tm.tm_hour, tm.tm_min, tm.tm_sec);
-		log_message("", buf);
-
-		simmgr_shm->status.general.clockStartSec = (tm.tm_hour * 60 * 60) + (tm.tm_min * 60) + tm.tm_sec;
-	}
-	// vocals
-	if (strlen(simmgr_shm->instructor.vocals.filename) > 0)
-	{
-		sprintf_s(simmgr_shm->status.vocals.filename, STR_SIZE, "%s", simmgr_shm->instructor.vocals.filename);
-		sprintf_s(simmgr_shm->instructor.vocals.filename, STR_SIZE, "%s", "");
-	}
-	if (simmgr_shm->instructor.vocals.repeat >= 0)
-	{
-		simmgr_shm->status.vocals.repeat = simmgr_shm->instructor.vocals.repeat;
-		simmgr_shm->instructor.vocals.repeat = -1;
-	}
-	if (simmgr_shm->instructor.vocals.volume >= 0)
-	{
-		simmgr_shm->status.vocals.volume = simmgr_shm->instructor.vocals.volume;
-		simmgr_shm->instructor.vocals.volume = -1;
-	}
-	if (simmgr_shm->instructor.vocals.play >= 0)
-	{
-		simmgr_shm->status.vocals.play = simmgr_shm->instructor.vocals.play;
-		simmgr_shm->instructor.vocals.play = -1;
-	}
-	if (simmgr_shm->instructor.vocals.mute >= 0)
-	{
-		simmgr_shm->status.vocals.mute = simmgr_shm->instructor.vocals.mute;
-		simmgr_shm->instructor.vocals.mute = -1;
 	}
+	releaseInstructorSections(II_MASK(II_MEDIA));
 
-	// media
-	if (strlen(simmgr_shm->instructor.media.filename) > 0)
-	{
-		sprintf_s(simmgr_shm->status.media.filename, STR_SIZE, "%s", simmgr_shm->instructor.media.filename);
-		sprintf_s(simmgr_shm->instructor.media.filename, STR_SIZE, "%s", "");
-	}
-	if (simmgr_shm->instructor.media.play != -1)
-	{
-		simmgr_shm->status.media.play = simmgr_shm->instructor.media.play;
-		simmgr_shm->instructor.media.play = -1;
-	}
 	// telesim
-	if (simmgr_shm->instructor.telesim.enable >= 0)
-	{
-		if (simmgr_shm->status.telesim.enable != simmgr_shm->instructor.telesim.enable)
-		{
-			simmgr_shm->status.telesim.enable = simmgr_shm->instructor.telesim.enable;
-			sprintf_s(buf, BUF_SIZE, "TeleSim Mode: %s", (simmgr_shm->status.telesim.enable == 1 ? "Enabled" : "Disabled"));
-			simlog_entry(buf);
-		}
-		simmgr_shm->instructor.telesim.enable = -1;
-	}
-	for (v = 0; v < TSIM_WINDOWS; v++)
+	takeInstructorSections(II_MASK(II_TELESIM));
+	dirty = simmgr_shm->instructor.dirty[II_TELESIM];
+	simmgr_shm->instructor.dirty[II_TELESIM] = 0;
+	while (dirty)
 	{
-		if (strlen(simmgr_shm->instructor.telesim.vid[v].name) > 0)
-		{
-			sprintf_s(simmgr_shm->status.telesim.vid[v].name, STR_SIZE, "%s", simmgr_shm->instructor.telesim.vid[v].name);
-			sprintf_s(simmgr_shm->instructor.telesim.vid[v].name, STR_SIZE, "%s", "");
-		}
-		if (simmgr_shm->instructor.telesim.vid[v].next > 0 &&
-			simmgr_shm->instructor.telesim.vid[v].next != simmgr_shm->status.telesim.vid[v].next)
+		field = instructorNextField(&dirty);
+		switch (field)
 		{
-			sprintf_s(buf, BUF_SIZE, "TeleSim vid %d Next %d:%d", v, simmgr_shm->status.telesim.vid[v].next, simmgr_shm->instructor.telesim.vid[v].next);
-			simlog_entry(buf);
-			simmgr_shm->status.telesim.vid[v].command = simmgr_shm->instructor.telesim.vid[v].command;
-			simmgr_shm->status.telesim.vid[v].param = simmgr_shm->instructor.telesim.vid[v].param;
-			simmgr_shm->status.telesim.vid[v].next = simmgr_shm->instructor.telesim.vid[v].next;
+		case TELESIM_F_ENABLE:
+			if (simmgr_shm->instructor.telesim.enable >= 0)
+			{
+				if (simmgr_shm->status.telesim.enable != simmgr_shm->instructor.telesim.enable)
+				{
+					simmgr_shm->status.telesim.enable = simmgr_shm->instructor.telesim.enable;
+					sprintf_s(buf, BUF_SIZE, "TeleSim Mode: %s", (simmgr_shm->status.telesim.enable == 1 ? "Enabled" : "Disabled"));
+					simlog_entry(buf);
+				}
+				simmgr_shm->instructor.telesim.enable = -1;
+			}
+			break;
+		default:
+			if (field >= TELESIM_F_VID_NAME && field < TELESIM_F_VID_NAME + TSIM_WINDOWS)
+			{
+				v = field - TELESIM_F_VID_NAME;
+				if (strlen(simmgr_shm->instructor.telesim.vid[v].name) > 0)
+				{
+					sprintf_s(simmgr_shm->status.telesim.vid[v].name, STR_SIZE, "%s", simmgr_shm->instructor.telesim.vid[v].name);
+					sprintf_s(simmgr_shm->instructor.telesim.vid[v].name, STR_SIZE, "%s", "");
+				}
+			}
+			else if (field >= TELESIM_F_VID_NEXT && field < TELESIM_F_VID_NEXT + TSIM_WINDOWS)
+			{
+				v = field - TELESIM_F_VID_NEXT;
+				if (simmgr_shm->instructor.telesim.vid[v].next > 0 &&
+					simmgr_shm->instructor.telesim.vid[v].next != simmgr_shm->status.telesim.vid[v].next)
+				{
+					sprintf_s(buf, BUF_SIZE, "TeleSim vid %d Next %d:%d", v, simmgr_shm->status.telesim.vid[v].next, simmgr_shm->instructor.telesim.vid[v].next);
+					simlog_entry(buf);
+					simmgr_shm->status.telesim.vid[v].command = simmgr_shm->instructor.telesim.vid[v].command;
+					simmgr_shm->status.telesim.vid[v].param = simmgr_shm->instructor.telesim.vid[v].param;
+					simmgr_shm->status.telesim.vid[v].next = simmgr_shm->instructor.telesim.vid[v].next;
+				}
+			}
+			break;
 		}
 	}
+	releaseInstructorSections(II_MASK(II_TELESIM));
+
 	// CPR
-	if (simmgr_shm->instructor.cpr.compression >= 0)
-	{
-		simmgr_shm->status.cpr.compression = simmgr_shm->instructor.cpr.compression;
-		if (simmgr_shm->status.cpr.compression)
-		{
-			simmgr_shm->status.cpr.last = simmgr_shm->server.msec_time;
-			simmgr_shm->status.cpr.running = 1;
-		}
-		simmgr_shm->instructor.cpr.compression = -1;
-	}
-	// Defibbrilation
-	if (simmgr_shm->instructor.defibrillation.shock >= 0)
+	takeInstructorSections(II_MASK(II_CPR));
+	dirty = simmgr_shm->instructor.dirty[II_CPR];
+	simmgr_shm->instructor.dirty[II_CPR] = 0;
+	while (dirty)
 	{
-		if (simmgr_shm->instructor.defibrillation.shock > 0)
+		field = instructorNextField(&dirty);
+		switch (field)
 		{
-			simmgr_shm->status.defibrillation.last += 1;
+		case CPR_F_COMPRESSION:
+			if (simmgr_shm->instructor.cpr.compression >= 0)
+			{
+				simmgr_shm->status.cpr.compression = simmgr_shm->instructor.cpr.compression;
+				if (simmgr_shm->status.cpr.compression)
+				{
+					simmgr_shm->status.cpr.last = clock_coarse_msec();
+					simmgr_shm->status.cpr.running = 1;
+				}
+				simmgr_shm->instructor.cpr.compression = -1;
+			}
+			break;
+		// Defibbrilation
+		case DEFIB_F_SHOCK:
+			if (simmgr_shm->instructor.defibrillation.shock >= 0)
+			{
+				if (simmgr_shm->instructor.defibrillation.shock > 0)
+				{
+					simmgr_shm->status.defibrillation.last += 1;
+				}
+				simmgr_shm->instructor.defibrillation.shock = -1;
+			}
+			break;
+		case DEFIB_F_ENERGY:
+			if (simmgr_shm->instructor.defibrillation.energy >= 0)
+			{
+				simmgr_shm->status.defibrillation.energy = simmgr_shm->instructor.defibrillation.energy;
+				simmgr_shm->instructor.defibrillation.energy = -1;
+			}
+			break;
+		default:
+			break;
 		}
-		simmgr_shm->instructor.defibrillation.shock = -1;
-	}
-	if (simmgr_shm->instructor.defibrillation.energy >= 0)
-	{
-		simmgr_shm->status.defibrillation.energy = simmgr_shm->instructor.defibrillation.energy;
-		simmgr_shm->instructor.defibrillation.energy = -1;
 	}
-	// Release the MUTEX
-	releaseInstructorLock();
-	vs_iiLockTaken = 0;
-
-	// Process the trends
-	// We do this even if no scenario is running, to allow an instructor simple, manual control
-	simmgr_shm->status.cardiac.rate = trendProcess(&cardiacTrend);
-	simmgr_shm->status.cardiac.bps_sys = trendProcess(&sysTrend);
-	simmgr_shm->status.cardiac.bps_dia = trendProcess(&diaTrend);
-	oldRate = simmgr_shm->status.respiration.rate;
-	newRate = trendProcess(&respirationTrend);
-	setRespirationPeriods(oldRate, newRate);
-
-	// simmgr_shm->status.respiration.awRR = simmgr_shm->status.respiration.rate;
-	simmgr_shm->status.respiration.spo2 = trendProcess(&spo2Trend);
-	simmgr_shm->status.respiration.etco2 = trendProcess(&etco2Trend);
-	simmgr_shm->status.general.temperature = trendProcess(&tempTrend);
+	releaseInstructorSections(II_MASK(II_CPR));
+
+	// The trends are processed by trend_task, even if no scenario is running,
+	// to allow an instructor simple, manual control
 
 	// NIBP processing
-	now = std::time(nullptr);
+	now = clock_msec();
 	switch (nibp_state)
 	{
 	case NibpState::NibpIdle:	// Not started or BP Cuff detached
@@ -2000,7 +1974,7 @@ scan_commands(void)
 			if (simmgr_shm->status.cardiac.nibp_read == 1)
 			{
 				// Manual Start - Go to Running for the run delay time
-				nibp_run_complete_time = now + NIBP_RUN_TIME;
+				nibp_run_complete_time = now + (NIBP_RUN_TIME * 1000);
 				nibp_state = NibpState::NibpRunning;
 				snprintf(msg_buf, BUF_SIZE, "Action: NIBP Read Manual");
 				lockAndComment(msg_buf);
@@ -2008,7 +1982,7 @@ scan_commands(void)
 			else if (simmgr_shm->status.cardiac.nibp_freq != 0)
 			{
 				// Frequency set
-				nibp_next_time = now + ((LONGLONG)simmgr_shm->status.cardiac.nibp_freq * 60);
+				nibp_next_time = now + ((uint64_t)simmgr_shm->status.cardiac.nibp_freq * 60 * 1000);
 				nibp_state = NibpState::NibpWaiting;
 			}
 		}
@@ -2027,7 +2001,7 @@ scan_commands(void)
 			}
 			if (nibp_next_time <= now)
 			{
-				nibp_run_complete_time = now + NIBP_RUN_TIME;
+				nibp_run_complete_time = now + (NIBP_RUN_TIME * 1000);
 				nibp_state = NibpState::NibpRunning;
 
 				snprintf(msg_buf, BUF_SIZE, "NIBP Read Periodic");
@@ -2063,7 +2037,7 @@ scan_commands(void)
 				if (simmgr_shm->status.cardiac.nibp_freq != 0)
 				{
 					// Frequency set
-					nibp_next_time = now + ((LONGLONG)simmgr_shm->status.cardiac.nibp_freq * 60);
+					nibp_next_time = now + ((uint64_t)simmgr_shm->status.cardiac.nibp_freq * 60 * 1000);
 					nibp_state = NibpState::NibpWaiting;
 
 					sprintf_s(msg_buf, BUF_SIZE,"NibpState Change: Running to Waiting");
@@ -2096,6 +2070,11 @@ scan_commands(void)
 			updateScenarioState(ScenarioState::ScenarioStopped);
 		}
 	}
+	if (statusChanged(&before))
+	{
+		notify_signal(NOTIFY_STATUS);
+	}
+	notify_ack(NOTIFY_INSTRUCTOR, gen);
 
 	return (0);
 }
@@ -2134,7 +2113,7 @@ start_scenario(void)
 	resetAllParameters();
 	simmgr_shm->status.scenario.error_flag = 0;
 
-	if (simmgr_shm->status.scenario.record > 0)
+	if (simmgr_shm->status.scenario.record > 0 && !headless)
 	{
 		fileCountBefore = getVideoFileCount();
 		printf("File Count Before is %d\n", fileCountBefore);
@@ -2190,11 +2169,10 @@ start_scenario(void)
 	{
 		// start the new scenario
 		printf("Video started after wait of %0.2f seconds.\n", (OBS_START_SLEEP_TIME * (double)tryCount) / 1000);
-		scenario_start_time = time(nullptr);
+		scenario_start_msec = clock_msec();
 		sprintf_s(msg_buf, BUF_SIZE, "Start Scenario: %s", simmgr_shm->status.scenario.active);
 		simlog_entry(msg_buf);
 
-		sprintf_s(simmgr_shm->status.scenario.active, STR_SIZE, "%s", simmgr_shm->status.scenario.active);
 		std::strftime(timeBuf, 60, "%c", &simmgr_shm->status.scenario.tmStart);
 
 		sprintf_s(simmgr_shm->status.scenario.start, STR_SIZE, "%s", timeBuf);
@@ -2228,42 +2206,51 @@ start_scenario(void)
 void
 checkEvents(void)
 {
-	if ((simmgr_shm->lastEventLogged != simmgr_shm->eventListNextWrite) ||
-		(simmgr_shm->lastCommentLogged != simmgr_shm->commentListNext))
+	char entry[COMMENT_SIZE];
+	int index;
+	int next;
+
+	// Each entry is copied out under the lock and written to the simlog after
+	// it is released, so the file I/O does not block addEvent or addComment.
+	while (simmgr_shm->lastEventLogged != simmgr_shm->eventListNextWrite)
 	{
-		takeInstructorLock();
-		while (simmgr_shm->lastEventLogged != simmgr_shm->eventListNextWrite)
+		takeInstructorSections(II_MASK(II_EVENTS));
+		index = simmgr_shm->lastEventLogged;
+		next = simmgr_shm->eventListNextWrite;
+		sprintf_s(entry, sizeof(entry), "%s", simmgr_shm->eventList[index].eventName);
+		simmgr_shm->lastEventLogged++;
+		if (simmgr_shm->lastEventLogged >= EVENT_LIST_SIZE)
 		{
-			sprintf_s(msg_buf, BUF_SIZE, "Event: %d (%d) %s", simmgr_shm->lastEventLogged, 
-							simmgr_shm->eventListNextWrite,
-							simmgr_shm->eventList[simmgr_shm->lastEventLogged].eventName);
+			simmgr_shm->lastEventLogged = 0;
+		}
+		releaseInstructorSections(II_MASK(II_EVENTS));
 
-			simlog_entry(msg_buf);
-			simmgr_shm->lastEventLogged++;
-			if (simmgr_shm->lastEventLogged >= EVENT_LIST_SIZE)
-			{
-				simmgr_shm->lastEventLogged = 0;
-			}
+		sprintf_s(msg_buf, BUF_SIZE, "Event: %d (%d) %s", index, next, entry);
+		simlog_entry(msg_buf);
+	}
+	while (simmgr_shm->lastCommentLogged != simmgr_shm->commentListNext)
+	{
+		takeInstructorSections(II_MASK(II_EVENTS));
+		index = simmgr_shm->lastCommentLogged;
+		next = simmgr_shm->commentListNext;
+		sprintf_s(entry, sizeof(entry), "%s", simmgr_shm->commentList[index].comment);
+		simmgr_shm->lastCommentLogged++;
+		if (simmgr_shm->lastCommentLogged >= COMMENT_LIST_SIZE)
+		{
+			simmgr_shm->lastCommentLogged = 0;
 		}
-		while (simmgr_shm->lastCommentLogged != simmgr_shm->commentListNext)
+		releaseInstructorSections(II_MASK(II_EVENTS));
+
+		if (strlen(entry) == 0)
 		{
-			if (strlen(simmgr_shm->commentList[simmgr_shm->lastCommentLogged].comment) == 0)
-			{
-				sprintf_s(msg_buf, BUF_SIZE,"Null Comment: lastCommentLogged is %d simmgr_shm->commentListNext is %d State is %d\n",
-					simmgr_shm->lastCommentLogged, simmgr_shm->commentListNext, scenario_state);
-				log_message("Error", msg_buf);
-			}
-			else
-			{
-				simlog_entry(simmgr_shm->commentList[simmgr_shm->lastCommentLogged].comment);
-			}
-			simmgr_shm->lastCommentLogged++;
-			if (simmgr_shm->lastCommentLogged >= COMMENT_LIST_SIZE)
-			{
-				simmgr_shm->lastCommentLogged = 0;
-			}
+			sprintf_s(msg_buf, BUF_SIZE,"Null Comment: lastCommentLogged is %d simmgr_shm->commentListNext is %d State is %d\n",
+				index, next, scenario_state);
+			log_message("Error", msg_buf);
+		}
+		else
+		{
+			simlog_entry(entry);
 		}
-		releaseInstructorLock();
 	}
 }
 
@@ -2278,37 +2265,23 @@ strToLower(char* buf)
 }
 
 
+static void
+scan_commands_task(void)
+{
+	(void)scan_commands();
+}
+
+/*
+ * simmgrRun
+ *
+ * One pass of the main loop. The tasks registered in simmgrInitialize run on their
+ * own deadlines; scan_commands and checkEvents also run as soon as an instructor
+ * write or a new event is signalled.
+ */
 void
 simmgrRun(void)
 {
-	scenarioCount++;
-	switch (scenarioCount)
-	{
-	case SCENARIO_COMMCHECK:
-		comm_check();
-		break;
-	case SCENARIO_EVENTCHECK:
-		checkEvents();
-		break;
-	case SCENARIO_CPRCHECK:
-		cpr_check();
-		break;
-	case SCENARIO_SHOCKCHECK:
-		shock_check();
-		break;
-	case SCENARIO_AWRRCHECK:
-		//awrr_check();
-		break;
-	case SCENARIO_TIMECHECK:
-		time_update();
-		break;
-	case SCENARIO_LOOP_COUNT:
-		scenarioCount = 0;
-		(void)scan_commands();
-		break;
-	default:
-		break;
-	}
+	sched_run_once();
 }
 
 int
@@ -2368,6 +2341,7 @@ updateScenarioState(ScenarioState new_state)
 			}
 			sprintf_s(c_msgbuf, STR_SIZE, "State: %s ", simmgr_shm->status.scenario.state);
 			log_message("", c_msgbuf);
+			notify_signal(NOTIFY_SCENARIO);
 		}
 	}
 	return (rval);
@@ -0,0 +1,620 @@
+/*
+ * XMLPull.cpp
+ *
+ * Pull parser for the scenario XML files.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "XMLPull.h"
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static inline bool
+is_space(char c)
+{
+	return (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+}
+
+/*
+ * FUNCTION: XMLPull::open
+ *
+ * ARGUMENTS:
+ *		path	- File to parse
+ *
+ * RETURNS:
+ *		0 on success, -1 with error set if the file cannot be mapped
+ */
+int
+XMLPull::open(const char* path)
+{
+	close();
+	error[0] = 0;
+#ifdef _WIN32
+	LARGE_INTEGER size;
+	HANDLE hFile;
+	HANDLE hMap;
+
+	hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		snprintf(error, sizeof(error), "cannot open \"%s\" (error %lu)", path, GetLastError());
+		return (-1);
+	}
+	if (!GetFileSizeEx(hFile, &size))
+	{
+		snprintf(error, sizeof(error), "cannot size \"%s\" (error %lu)", path, GetLastError());
+		CloseHandle(hFile);
+		return (-1);
+	}
+	mapFile = hFile;
+	length = (size_t)size.QuadPart;
+	if (length > 0)
+	{
+		hMap = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (hMap)
+		{
+			mapHandle = hMap;
+			base = (const char*)MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0);
+		}
+		if (!base)
+		{
+			snprintf(error, sizeof(error), "cannot map \"%s\" (error %lu)", path, GetLastError());
+			close();
+			return (-1);
+		}
+	}
+#else
+	struct stat st;
+	void* map;
+	int fd;
+
+	fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		snprintf(error, sizeof(error), "cannot open \"%s\": %s", path, strerror(errno));
+		return (-1);
+	}
+	if (fstat(fd, &st) != 0)
+	{
+		snprintf(error, sizeof(error), "cannot stat \"%s\": %s", path, strerror(errno));
+		::close(fd);
+		return (-1);
+	}
+	length = (size_t)st.st_size;
+	if (length > 0)
+	{
+		map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED)
+		{
+			snprintf(error, sizeof(error), "cannot map \"%s\": %s", path, strerror(errno));
+			::close(fd);
+			length = 0;
+			return (-1);
+		}
+		base = (const char*)map;
+	}
+	::close(fd);
+#endif
+	pos = 0;
+	if (length >= 3 && memcmp(base, "\xEF\xBB\xBF", 3) == 0)
+	{
+		pos = 3;
+	}
+	pendingEnd = false;
+	tokenStart = pos;
+	linePos = 0;
+	lineCount = 1;
+	depth = -1;
+	type = XML_PULL_FILE_END;
+	open_names.clear();
+	open_names.reserve(16);
+	attrs.reserve(8);
+	return (0);
+}
+
+void
+XMLPull::close(void)
+{
+#ifdef _WIN32
+	if (base)
+	{
+		UnmapViewOfFile(base);
+	}
+	if (mapHandle)
+	{
+		CloseHandle((HANDLE)mapHandle);
+	}
+	if (mapFile)
+	{
+		CloseHandle((HANDLE)mapFile);
+	}
+	mapHandle = NULL;
+	mapFile = NULL;
+#else
+	if (base)
+	{
+		munmap((void*)base, length);
+	}
+#endif
+	base = NULL;
+	length = 0;
+	pos = 0;
+	tokenStart = 0;
+	linePos = 0;
+	lineCount = 1;
+	name = std::string_view();
+	text = std::string_view();
+	attrs.clear();
+	open_names.clear();
+}
+
+// The line and column are counted only for an error message
+int
+XMLPull::fail(const char* msg)
+{
+	const char* p = base;
+	const char* end = base + pos;
+	const char* nl;
+	const char* lineStart = base;
+	char where[48];
+	int lineNo = 1;
+
+	while (p && p < end && (nl = (const char*)memchr(p, '\n', (size_t)(end - p))) != NULL)
+	{
+		lineNo++;
+		lineStart = nl + 1;
+		p = lineStart;
+	}
+	snprintf(where, sizeof(where), "line %d, column %d: ", lineNo, (int)(end - lineStart) + 1);
+	snprintf(error, sizeof(error), "%s%.*s", where, (int)(sizeof(error) - sizeof(where)), msg);
+	type = XML_PULL_ERROR;
+	return (-1);
+}
+
+// Characters that end a name: space, '/', '<', '=' and '>'
+static const bool nameEnd[256] =
+{
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 0,
+};
+
+/*
+ * FUNCTION: XMLPull::line
+ *
+ * RETURNS:
+ *		Line of the current token, counting from 1, or 0 with no file open.
+ *		Lines are counted forward from the last call, so asking for each
+ *		token's line reads the file once.
+ */
+int
+XMLPull::line(void)
+{
+	const char* nl;
+
+	if (!base)
+	{
+		return (0);
+	}
+	if (tokenStart < linePos)
+	{
+		linePos = 0;
+		lineCount = 1;
+	}
+	while (linePos < tokenStart)
+	{
+		nl = (const char*)memchr(base + linePos, '\n', tokenStart - linePos);
+		if (!nl)
+		{
+			linePos = tokenStart;
+			break;
+		}
+		lineCount++;
+		linePos = (size_t)(nl - base) + 1;
+	}
+	return (lineCount);
+}
+
+// End of the name starting at from
+size_t
+XMLPull::scan_name(size_t from)
+{
+	while (from < length && !nameEnd[(uint8_t)base[from]])
+	{
+		from++;
+	}
+	return (from);
+}
+
+void
+XMLPull::skip_space(void)
+{
+	size_t p = pos;
+
+	while (p < length && is_space(base[p]))
+	{
+		p++;
+	}
+	pos = p;
+}
+
+/*
+ * FUNCTION: XMLPull::next
+ *
+ * RETURNS:
+ *		0 with a token, 1 at the end of the file, -1 on an error
+ */
+int
+XMLPull::next(void)
+{
+	std::string_view doc(base ? base : "", length);
+	size_t at;
+	size_t end;
+	size_t p;
+	char c;
+	char quote;
+	char msg[XML_PULL_ERROR_SIZE];
+
+	if (type == XML_PULL_ERROR)
+	{
+		return (-1);
+	}
+	if (pendingEnd)
+	{
+		pendingEnd = false;
+		type = XML_PULL_END_ELEMENT;
+		depth = (int)open_names.size() - 1;
+		open_names.pop_back();
+		return (0);
+	}
+	while (1)
+	{
+		tokenStart = pos;
+		if (pos >= length)
+		{
+			if (!open_names.empty())
+			{
+				snprintf(msg, sizeof(msg), "end of file in <%.*s>",
+					(int)open_names.back().size(), open_names.back().data());
+				return (fail(msg));
+			}
+			type = XML_PULL_FILE_END;
+			return (1);
+		}
+		if (base[pos] != '<')
+		{
+			at = pos;
+			end = doc.find('<', at);
+			if (end == std::string_view::npos)
+			{
+				end = length;
+			}
+			for (p = at; p < end && is_space(base[p]); p++)
+			{
+			}
+			if (p == end)
+			{
+				pos = end;
+				continue;
+			}
+			if (open_names.empty())
+			{
+				pos = p;
+				return (fail("text outside the root element"));
+			}
+			pos = end;
+			tokenStart = p;
+			type = XML_PULL_TEXT;
+			name = open_names.back();
+			depth = (int)open_names.size() - 1;
+			text = doc.substr(at, end - at);
+			cdata = false;
+			return (0);
+		}
+		c = (pos + 1 < length) ? base[pos + 1] : 0;
+		if (c == '!' && doc.compare(pos, 4, "<!--") == 0)
+		{
+			end = doc.find("-->", pos + 4);
+			if (end == std::string_view::npos)
+			{
+				return (fail("comment is not closed"));
+			}
+			pos = end + 3;
+			continue;
+		}
+		if (c == '!' && doc.compare(pos, 9, "<![CDATA[") == 0)
+		{
+			end = doc.find("]]>", pos + 9);
+			if (end == std::string_view::npos)
+			{
+				return (fail("CDATA is not closed"));
+			}
+			if (open_names.empty())
+			{
+				return (fail("CDATA outside the root element"));
+			}
+			at = pos + 9;
+			pos = end + 3;
+			type = XML_PULL_TEXT;
+			name = open_names.back();
+			depth = (int)open_names.size() - 1;
+			text = doc.substr(at, end - at);
+			cdata = true;
+			return (0);
+		}
+		if (c == '?')
+		{
+			end = doc.find("?>", pos + 2);
+			if (end == std::string_view::npos)
+			{
+				return (fail("processing instruction is not closed"));
+			}
+			pos = end + 2;
+			continue;
+		}
+		if (c == '!')
+		{
+			// DOCTYPE, with any internal subset
+			end = doc.find_first_of("[>", pos + 2);
+			if (end != std::string_view::npos && base[end] == '[')
+			{
+				end = doc.find("]>", end);
+				if (end != std::string_view::npos)
+				{
+					end++;
+				}
+			}
+			if (end == std::string_view::npos)
+			{
+				return (fail("declaration is not closed"));
+			}
+			pos = end + 1;
+			continue;
+		}
+		if (c == '/')
+		{
+			at = pos + 2;
+			end = scan_name(at);
+			name = doc.substr(at, end - at);
+			pos = end;
+			skip_space();
+			if (pos >= length || base[pos] != '>')
+			{
+				return (fail("end tag is not closed"));
+			}
+			if (open_names.empty() || open_names.back() != name)
+			{
+				pos = at - 2;
+				if (open_names.empty())
+				{
+					snprintf(msg, sizeof(msg), "</%.*s> with no open element", (int)name.size(), name.data());
+				}
+				else
+				{
+					snprintf(msg, sizeof(msg), "</%.*s> does not close <%.*s>", (int)name.size(), name.data(),
+						(int)open_names.back().size(), open_names.back().data());
+				}
+				return (fail(msg));
+			}
+			pos++;
+			type = XML_PULL_END_ELEMENT;
+			depth = (int)open_names.size() - 1;
+			hash = xml_hash(name);
+			open_names.pop_back();
+			return (0);
+		}
+
+		// Start tag
+		at = pos + 1;
+		end = scan_name(at);
+		if (end == at)
+		{
+			pos = at;
+			return (fail("element has no name"));
+		}
+		if (open_names.empty() && depth == 0)
+		{
+			return (fail("more than one root element"));
+		}
+		name = doc.substr(at, end - at);
+		pos = end;
+		attrs.clear();
+		while (1)
+		{
+			skip_space();
+			if (pos >= length)
+			{
+				return (fail("start tag is not closed"));
+			}
+			if (base[pos] == '>')
+			{
+				pos++;
+				break;
+			}
+			if (base[pos] == '/' && pos + 1 < length && base[pos + 1] == '>')
+			{
+				pos += 2;
+				pendingEnd = true;
+				break;
+			}
+			at = pos;
+			end = scan_name(at);
+			if (end == at)
+			{
+				return (fail("bad attribute"));
+			}
+			attrs.push_back({ doc.substr(at, end - at), std::string_view() });
+			pos = end;
+			skip_space();
+			if (pos >= length || base[pos] != '=')
+			{
+				return (fail("attribute has no value"));
+			}
+			pos++;
+			skip_space();
+			if (pos >= length || (base[pos] != '"' && base[pos] != '\''))
+			{
+				return (fail("attribute value is not quoted"));
+			}
+			quote = base[pos];
+			end = doc.find(quote, pos + 1);
+			if (end == std::string_view::npos)
+			{
+				return (fail("attribute value is not closed"));
+			}
+			attrs.back().value = doc.substr(pos + 1, end - pos - 1);
+			pos = end + 1;
+		}
+		open_names.push_back(name);
+		type = XML_PULL_ELEMENT;
+		depth = (int)open_names.size() - 1;
+		hash = xml_hash(name);
+		return (0);
+	}
+}
+
+static void
+put_utf8(std::string& out, unsigned long cp)
+{
+	if (cp < 0x80)
+	{
+		out += (char)cp;
+	}
+	else if (cp < 0x800)
+	{
+		out += (char)(0xC0 | (cp >> 6));
+		out += (char)(0x80 | (cp & 0x3F));
+	}
+	else if (cp < 0x10000)
+	{
+		out += (char)(0xE0 | (cp >> 12));
+		out += (char)(0x80 | ((cp >> 6) & 0x3F));
+		out += (char)(0x80 | (cp & 0x3F));
+	}
+	else
+	{
+		out += (char)(0xF0 | (cp >> 18));
+		out += (char)(0x80 | ((cp >> 12) & 0x3F));
+		out += (char)(0x80 | ((cp >> 6) & 0x3F));
+		out += (char)(0x80 | (cp & 0x3F));
+	}
+}
+
+/*
+ * FUNCTION: XMLPull::decode
+ *
+ * Replace the entity and character references in raw. An unknown reference is
+ * kept as it is.
+ *
+ * RETURNS:
+ *		raw itself if it has no references, else a view that is valid until the
+ *		next decode()
+ */
+std::string_view
+XMLPull::decode(std::string_view raw)
+{
+	static const struct { const char* ref; char c; } entities[] =
+	{
+		{ "lt;", '<' }, { "gt;", '>' }, { "amp;", '&' }, { "apos;", '\'' }, { "quot;", '"' },
+	};
+	size_t i;
+	size_t semi;
+	size_t k;
+	unsigned long cp;
+	std::string_view ref;
+	bool done;
+
+	if (raw.find('&') == std::string_view::npos)
+	{
+		return (raw);
+	}
+	decoded.clear();
+	for (i = 0; i < raw.size(); i++)
+	{
+		done = false;
+		if (raw[i] == '&')
+		{
+			semi = raw.find(';', i + 1);
+			if (semi != std::string_view::npos)
+			{
+				ref = raw.substr(i + 1, semi - i);
+				if (ref.size() > 2 && ref[0] == '#')
+				{
+					cp = 0;
+					if (ref[1] == 'x' || ref[1] == 'X')
+					{
+						std::from_chars(ref.data() + 2, ref.data() + ref.size() - 1, cp, 16);
+					}
+					else
+					{
+						std::from_chars(ref.data() + 1, ref.data() + ref.size() - 1, cp, 10);
+					}
+					if (cp > 0 && cp <= 0x10FFFF)
+					{
+						put_utf8(decoded, cp);
+						done = true;
+					}
+				}
+				else
+				{
+					for (k = 0; k < sizeof(entities) / sizeof(entities[0]); k++)
+					{
+						if (ref == entities[k].ref)
+						{
+							decoded += entities[k].c;
+							done = true;
+							break;
+						}
+					}
+				}
+				if (done)
+				{
+					i = semi;
+				}
+			}
+		}
+		if (!done)
+		{
+			decoded += raw[i];
+		}
+	}
+	return (std::string_view(decoded));
+}
+
+// The current text, with references replaced unless it is CDATA
+std::string_view
+XMLPull::value(void)
+{
+	if (type != XML_PULL_TEXT)
+	{
+		return (std::string_view());
+	}
+	return (cdata ? text : decode(text));
+}
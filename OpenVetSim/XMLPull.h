@@ -0,0 +1,131 @@
+#pragma once
+
+/*
+ * XMLPull.h
+ *
+ * Pull parser for the scenario XML files.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+constexpr auto XML_PULL_ELEMENT = 1;
+constexpr auto XML_PULL_TEXT = 2;
+constexpr auto XML_PULL_END_ELEMENT = 3;
+constexpr auto XML_PULL_FILE_END = 4;
+constexpr auto XML_PULL_ERROR = 5;
+
+#define XML_PULL_ERROR_SIZE	256
+
+// FNV-1a. Element names are hashed as they are read, so the scenario parser
+// dispatches on a precomputed integer and only confirms a match with strcmp.
+constexpr uint32_t
+xml_hash(const char* s)
+{
+	uint32_t h = 2166136261u;
+
+	while (*s)
+	{
+		h = (h ^ (uint8_t)*s++) * 16777619u;
+	}
+	return (h);
+}
+
+#define XML_HASH(s)	(std::integral_constant<uint32_t, xml_hash(s)>::value)
+
+static inline uint32_t
+xml_hash(std::string_view s)
+{
+	uint32_t h = 2166136261u;
+
+	for (char c : s)
+	{
+		h = (h ^ (uint8_t)c) * 16777619u;
+	}
+	return (h);
+}
+
+struct xml_attr
+{
+	std::string_view name;
+	std::string_view value;		// Raw; see XMLPull::decode()
+};
+
+/*
+ * The file is mapped read only and each token is a view into it, so nothing is
+ * copied unless a value holds an entity reference. Views are valid until close().
+ *
+ * next() returns one token:
+ *		XML_PULL_ELEMENT		name, hash, attrs. <a/> is followed by its END_ELEMENT.
+ *		XML_PULL_TEXT			name of the enclosing element, text. Whitespace only
+ *								text is skipped. A CDATA section is its own token.
+ *		XML_PULL_END_ELEMENT	name
+ *		XML_PULL_FILE_END
+ *		XML_PULL_ERROR			error holds "line L, column C: ..."
+ * depth is the element's level, the root being 0, for all three kinds of token.
+ * line() gives the line the token starts on.
+ * Comments, processing instructions and DOCTYPE are skipped.
+ */
+class XMLPull
+{
+private:
+	const char* base = NULL;
+	size_t length = 0;
+	size_t pos = 0;
+	bool pendingEnd = false;
+	size_t tokenStart = 0;
+	size_t linePos = 0;				// line() has counted lines up to here
+	int lineCount = 1;
+	std::vector<std::string_view> open_names;
+	std::string decoded;
+#ifdef _WIN32
+	void* mapFile = NULL;
+	void* mapHandle = NULL;
+#endif
+
+	int fail(const char* msg);
+	size_t scan_name(size_t from);
+	void skip_space(void);
+
+public:
+	int type = XML_PULL_FILE_END;
+	int depth = -1;
+	std::string_view name;
+	uint32_t hash = 0;
+	std::string_view text;
+	bool cdata = false;
+	std::vector<struct xml_attr> attrs;
+	char error[XML_PULL_ERROR_SIZE] = { 0, };
+
+	XMLPull(void) {};
+	~XMLPull(void)
+	{
+		close();
+	};
+	int open(const char* path);
+	void close(void);
+	int next(void);
+	std::string_view value(void);
+	std::string_view decode(std::string_view raw);
+	int line(void);
+};
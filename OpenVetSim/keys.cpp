@@ -262,6 +262,7 @@ int getKeys()
 	bool ret;
 	char errorstr[256];
 	errno_t et;
+	int curve;
 
 #ifdef _WIN32
 	HKEY theKey;
@@ -346,6 +347,36 @@ int getKeys()
 			localConfig.port_pulse = atoi((const char*)ini["Listeners"]["pulsePort"].c_str());
 		if (ini["Listeners"]["statusPort"].length() > 0)
 			localConfig.port_status = atoi((const char*)ini["Listeners"]["statusPort"].c_str());
+		if (ini["Scheduler"]["scanPeriod"].length() > 0)
+			localConfig.scan_period = atoi((const char*)ini["Scheduler"]["scanPeriod"].c_str());
+		if (ini["Scheduler"]["eventPeriod"].length() > 0)
+			localConfig.event_period = atoi((const char*)ini["Scheduler"]["eventPeriod"].c_str());
+		if (ini["Scheduler"]["cprPeriod"].length() > 0)
+			localConfig.cpr_period = atoi((const char*)ini["Scheduler"]["cprPeriod"].c_str());
+		if (ini["Scheduler"]["shockPeriod"].length() > 0)
+			localConfig.shock_period = atoi((const char*)ini["Scheduler"]["shockPeriod"].c_str());
+		if (ini["Scheduler"]["timePeriod"].length() > 0)
+			localConfig.time_period = atoi((const char*)ini["Scheduler"]["timePeriod"].c_str());
+		if (ini["Scheduler"]["commPeriod"].length() > 0)
+			localConfig.comm_period = atoi((const char*)ini["Scheduler"]["commPeriod"].c_str());
+		if (ini["Realtime"]["beatPriority"].length() > 0)
+			localConfig.beat_priority = atoi((const char*)ini["Realtime"]["beatPriority"].c_str());
+		if (ini["Realtime"]["beatCpu"].length() > 0)
+			localConfig.beat_cpu = atoi((const char*)ini["Realtime"]["beatCpu"].c_str());
+		if (ini["Realtime"]["broadcastPriority"].length() > 0)
+			localConfig.broadcast_priority = atoi((const char*)ini["Realtime"]["broadcastPriority"].c_str());
+		if (ini["Realtime"]["broadcastCpu"].length() > 0)
+			localConfig.broadcast_cpu = atoi((const char*)ini["Realtime"]["broadcastCpu"].c_str());
+		if (ini["Trace"]["window"].length() > 0)
+			localConfig.trace_window = atoi((const char*)ini["Trace"]["window"].c_str());
+		if (ini["Trend"]["curve"].length() > 0)
+		{
+			curve = trend_curve_parse(ini["Trend"]["curve"].c_str());
+			if (curve >= 0)
+				localConfig.trend_curve = curve;
+			else
+				printf("Unknown trend curve \"%s\", using linear\n", ini["Trend"]["curve"].c_str());
+		}
 		printf("Data from INI: Server %s:%d, Pulse %d, Status %d\n",
 			localConfig.php_server_addr,
 			localConfig.php_server_port,
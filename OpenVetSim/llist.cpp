@@ -27,19 +27,12 @@
 void
 insert_llist(struct snode* entry, struct snode* list)
 {
-	int limit = 100;
+	struct snode* tail;
 
-	// Scan to the first NULL entry (end of list)
-	while (list->next)
-	{
-		list = list->next;
-		if (limit-- == 0)
-		{
-			fprintf(stderr, "insert_llist: Limit exceeded\n");
-			exit(-1);
-		}
-	}
-	list->next = entry;
+	entry->next = NULL;
+	tail = list->last ? list->last : list;
+	tail->next = entry;
+	list->last = entry;
 }
 
 struct snode*
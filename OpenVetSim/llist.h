@@ -27,6 +27,7 @@
 struct snode
 {
 	struct snode* next;
+	struct snode* last;		// List head only: the tail, so inserts do not walk the list
 };
 
 void insert_llist(struct snode* entry, struct snode* list);
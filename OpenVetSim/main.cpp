@@ -156,6 +156,18 @@ initializeConfiguration(void)
 		"%s", DEFAULT_PHP_SERVER_ADDRESS);
 	sprintf_s(localConfig.log_name, sizeof(localConfig.log_name),
 		"%s", DEFAULT_LOG_NAME);
+	localConfig.scan_period     = DEFAULT_SCAN_PERIOD;
+	localConfig.event_period    = DEFAULT_EVENT_PERIOD;
+	localConfig.cpr_period      = DEFAULT_CPR_PERIOD;
+	localConfig.shock_period    = DEFAULT_SHOCK_PERIOD;
+	localConfig.time_period     = DEFAULT_TIME_PERIOD;
+	localConfig.comm_period     = DEFAULT_COMM_PERIOD;
+	localConfig.beat_priority      = DEFAULT_RT_PRIORITY;
+	localConfig.beat_cpu           = DEFAULT_RT_CPU;
+	localConfig.broadcast_priority = DEFAULT_RT_PRIORITY;
+	localConfig.broadcast_cpu      = DEFAULT_RT_CPU;
+	localConfig.trace_window       = DEFAULT_TRACE_WINDOW;
+	localConfig.trend_curve        = DEFAULT_TREND_CURVE;
 
 #ifdef _WIN32
 	// On Windows: honour OPENVETSIM_HTML_PATH if set (injected by the Electron
@@ -208,6 +220,38 @@ initializeConfiguration(void)
 	getKeys();
 }
 
+/*
+ * FUNCTION: runTool
+ *
+ * ARGUMENTS:
+ *		argc, argv	- The command line
+ *		status		- Receives the exit status
+ *
+ * Run --validate or --run. Scenario checks need no server, so may run beside one.
+ *
+ * RETURNS:
+ *		true if the command line was one of them
+ */
+static bool
+runTool(int argc, char* argv[], int* status)
+{
+	if (argc > 1 && strcmp(argv[1], "--validate") == 0)
+	{
+		setWVSVersion();
+		initializeConfiguration();
+		*status = scenario_validate_main(argv[0], argc - 2, &argv[2]);
+		return (true);
+	}
+	if (argc > 1 && strcmp(argv[1], "--run") == 0)
+	{
+		setWVSVersion();
+		initializeConfiguration();
+		*status = scenario_runner_main(argv[0], argc - 2, &argv[2]);
+		return (true);
+	}
+	return (false);
+}
+
 // ================================================================
 //  WINDOWS RELEASE BUILD — Win32 GUI entry point
 // ================================================================
@@ -243,6 +287,44 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
 	MSG  msg;
 	BOOL bRet;
 	WNDCLASS wc;
+	LPWSTR* wargv;
+	int wargc;
+	int len;
+	int status;
+	std::vector<std::string> args;
+	std::vector<char*> argp;
+
+	// --validate and --run, as for the console build. The GUI process has no console
+	// of its own, so write to the one it was started from unless redirected.
+	wargv = CommandLineToArgvW(GetCommandLineW(), &wargc);
+	if (wargv && wargc > 1 && (wcscmp(wargv[1], L"--validate") == 0 || wcscmp(wargv[1], L"--run") == 0))
+	{
+		if (GetStdHandle(STD_OUTPUT_HANDLE) == NULL && AttachConsole(ATTACH_PARENT_PROCESS))
+		{
+			(void)freopen("CONOUT$", "w", stdout);
+			(void)freopen("CONOUT$", "w", stderr);
+		}
+		for (int i = 0; i < wargc; i++)
+		{
+			len = WideCharToMultiByte(CP_UTF8, 0, wargv[i], -1, NULL, 0, NULL, NULL);
+			args.push_back(std::string(len > 0 ? len - 1 : 0, 0));
+			(void)WideCharToMultiByte(CP_UTF8, 0, wargv[i], -1, &args.back()[0], len, NULL, NULL);
+		}
+		for (auto& arg : args)
+		{
+			argp.push_back(&arg[0]);
+		}
+		argp.push_back(NULL);
+		LocalFree(wargv);
+		if (runTool(wargc, argp.data(), &status))
+		{
+			exit(status);
+		}
+	}
+	if (wargv)
+	{
+		LocalFree(wargv);
+	}
 
 	int sts = checkProcessRunning();
 	if (sts == 0)
@@ -362,6 +444,7 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 		hdc = BeginPaint(hWnd, &ps);
 		TextOut(hdc, 5, 5, leaving, (int)_tcslen(leaving));
 		EndPaint(hWnd, &ps);
+		(void)stop_tasks(TASK_JOIN_TIMEOUT);
 		stopPHPServer();
 		PostQuitMessage(0);
 		break;
@@ -410,6 +493,13 @@ using namespace std;
 
 int main(int argc, char* argv[])
 {
+	int status;
+
+	if (runTool(argc, argv, &status))
+	{
+		exit(status);
+	}
+
 	int sts = checkProcessRunning();
 	if (sts == 0)
 	{
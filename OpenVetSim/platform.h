@@ -64,6 +64,7 @@
 #include <winbase.h>
 #include <tlhelp32.h>
 #include <direct.h>
+#include <io.h>
 #include <conio.h>
 #include <tchar.h>
 #include <strsafe.h>
@@ -101,6 +102,24 @@ inline void sim_close_mutex(SIM_MUTEX m)
 // --- Sleep ---
 inline void sim_sleep_ms(unsigned int ms) { Sleep(ms); }
 
+// --- Flush a file's data to the disk ---
+inline int sim_fdatasync(FILE* fp) { return _commit(_fileno(fp)); }
+
+// --- Read at an offset, without moving the file position ---
+inline int64_t sim_pread(FILE* fp, void* buf, size_t len, uint64_t offset)
+{
+    OVERLAPPED ov = {};
+    DWORD got = 0;
+
+    ov.Offset = (DWORD)offset;
+    ov.OffsetHigh = (DWORD)(offset >> 32);
+    if (!ReadFile((HANDLE)_get_osfhandle(_fileno(fp)), buf, (DWORD)len, &got, &ov))
+    {
+        return (-1);
+    }
+    return ((int64_t)got);
+}
+
 // --- sim_clock_gettime_tv: on Windows, clock_gettime already uses timeval* ---
 // (Windows clock_gettime is our custom implementation in simutil.cpp)
 #define sim_clock_gettime_tv clock_gettime
@@ -175,6 +194,19 @@ inline void      sim_close_mutex(SIM_MUTEX m)  { delete m; }
 // --- Sleep ---
 inline void sim_sleep_ms(unsigned int ms) { usleep((useconds_t)ms * 1000u); }
 
+// --- Flush a file's data to the disk ---
+#if defined(__APPLE__)
+inline int sim_fdatasync(FILE* fp) { return fsync(fileno(fp)); }
+#else
+inline int sim_fdatasync(FILE* fp) { return fdatasync(fileno(fp)); }
+#endif
+
+// --- Read at an offset, without moving the file position ---
+inline int64_t sim_pread(FILE* fp, void* buf, size_t len, uint64_t offset)
+{
+    return ((int64_t)pread(fileno(fp), buf, len, (off_t)offset));
+}
+
 // --- sprintf_s → snprintf ---
 // Two overloads to handle both MSVC usage forms:
 //   (1) sprintf_s(buf, size, fmt, ...)  — explicit size (4+ args)
@@ -401,7 +433,7 @@ inline int _i64toa_s(int64_t val, char* buf, size_t sz, int /*radix*/)
 }
 
 // --- GetTickCount64: milliseconds since an arbitrary start point ---
-// Used for msec_time_update(); CLOCK_MONOTONIC never wraps during a session.
+// Elapsed times use clock_msec() from simclock.h; this is for Windows code only.
 inline uint64_t GetTickCount64()
 {
     struct timespec ts;
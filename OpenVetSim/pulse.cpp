@@ -122,6 +122,9 @@ int afibActive = 0;
 void pulseTimer(void);
 void pulseBroadcastLoop(void);
 
+#define STATUS_PORT_INTERVAL	5000	// msec between statusPort broadcasts to the controllers
+#define RATE_CHECK_BACKSTOP		500		// msec, longest wait in pulseProcessChild without a status change
+
 std::mutex breathSema;
 std::mutex pulseSema;
 
@@ -154,10 +157,9 @@ resetVpc(void)
 		From VPC3 to Sinus:		19
 */
 extern void setPulseState(int);
-extern void hrLogBeat(void);
 
 static void
-pulse_beat_handler(void)
+pulse_beat_handler(ULONGLONG when)
 {
 	//pulseSema.lock();
 	if (currentPulseRate > 0)
@@ -170,7 +172,8 @@ pulse_beat_handler(void)
 				{
 					// VPC Injection
 					simmgr_shm->status.cardiac.pulseCountVpc++;
-					hrLogBeat();
+					hrLogBeat(when);
+					notify_signal(NOTIFY_BEAT);
 					vpcState--;
 					switch (vpcState)
 					{
@@ -199,7 +202,8 @@ pulse_beat_handler(void)
 				{
 					// Normal Cycle
 					simmgr_shm->status.cardiac.pulseCount++;
-					hrLogBeat();
+					hrLogBeat(when);
+					notify_signal(NOTIFY_BEAT);
 					if (afibActive)
 					{
 						// Next beat phase is between 50% and 200% of standard. 
@@ -232,19 +236,22 @@ pulse_beat_handler(void)
 		else
 		{
 			simmgr_shm->status.cardiac.pulseCount++;
-			hrLogBeat();
+			hrLogBeat(when);
+			notify_signal(NOTIFY_BEAT);
 			setPulseState(2);
 		}
 	}
 	//pulseSema.unlock();
 }
 static void
-breath_beat_handler(void)
+breath_beat_handler(ULONGLONG when)
 {
 	breathSema.lock();
 	if (simmgr_shm->status.respiration.rate > 0)
 	{
 		simmgr_shm->status.respiration.breathCount++;
+		awrrLogBreath(when);
+		notify_signal(NOTIFY_BEAT);
 	}
 	breathSema.unlock();
 }
@@ -339,7 +346,7 @@ resetTimer(int rate, int isCardiac, int isFib)
 {
 	ULONGLONG wait_time_msec;
 	ULONGLONG remaining;
-	ULONGLONG now = simmgr_shm->server.msec_time;
+	ULONGLONG now = clock_coarse_msec();
 
 	wait_time_msec = getWaitTimeMsec(rate, isCardiac, isFib);
 
@@ -405,7 +412,7 @@ set_pulse_rate(int bpm)
 void
 restart_breath_timer(void)
 {
-	ULONGLONG now = simmgr_shm->server.msec_time;
+	ULONGLONG now = clock_coarse_msec();
 	ULONGLONG wait_time_msec;
 
 	// When rate is 0, getWaitTimeMsec would divide by zero (producing +inf or 0),
@@ -445,7 +452,7 @@ set_breath_rate(int bpm)
 		// the timer cannot accidentally fire during the 0->positive rate transition.
 		// breathInterval is set to 60 s so any stray reads get a sane value.
 		breathInterval = 60000;
-		nextBreathTime = simmgr_shm->server.msec_time + 3600000ULL;	// 1 hour away
+		nextBreathTime = clock_coarse_msec() + 3600000ULL;	// 1 hour away
 		return;
 	}
 
@@ -511,8 +518,8 @@ pulseTask(void )
 	//printf("Pulse Interval %llu Next %llu now %llu\n", pulseInterval, nextPulseTime, simmgr_shm->server.msec_time );
 	//printf("Calling start_task for pulseProcessChild\n");
 	(void)start_task("pulseProcessChild", pulseProcessChild);
-	(void)start_task("pulseTimer", pulseTimer);
-	(void)start_task("pulseBroadcastLoop", pulseBroadcastLoop);
+	(void)start_rt_task("pulseTimer", pulseTimer, localConfig.beat_priority, localConfig.beat_cpu);
+	(void)start_rt_task("pulseBroadcastLoop", pulseBroadcastLoop, localConfig.broadcast_priority, localConfig.broadcast_cpu);
 	
 	for (i = 0; i < MAX_LISTENERS; i++)
 	{
@@ -666,6 +673,23 @@ pulseTask(void )
 	exit(222);
 }
 
+// Number of connected pulse listeners, for the metrics
+int
+pulseListenerCount(void)
+{
+	int count = 0;
+	int i;
+
+	for (i = 0; i < MAX_LISTENERS; i++)
+	{
+		if (listeners[i].allocated)
+		{
+			count++;
+		}
+	}
+	return (count);
+}
+
 /*
  * FUNCTION: sendStatusPort
  *
@@ -769,34 +793,37 @@ pulseTimer(void)
 
 	ULONGLONG now;
 	ULONGLONG now2;
-	while (1)
+	while (task_running())
 	{
 		sim_sleep_ms(1);
-		now = simmgr_shm->server.msec_time;
+		now = clock_coarse_msec();
 		if (nextPulseTime <= now)
 		{
-			pulse_beat_handler();
+			pulse_beat_handler(nextPulseTime);
+			trace_instant("pulse beat");
 			nextPulseTime += pulseInterval;
-			now2 = simmgr_shm->server.msec_time;
+			now2 = clock_coarse_msec();
 			if (nextPulseTime <= (now2+1))
 			{
+				metric_inc(METRIC_PULSE_LATE);
 				nextPulseTime = now2;
 			}
 		}
-		now = simmgr_shm->server.msec_time;
+		now = clock_coarse_msec();
 		if (nextBreathTime <= now)
 		{
-			breath_beat_handler();
+			breath_beat_handler(nextBreathTime);
+			trace_instant("breath beat");
 			nextBreathTime += breathInterval;
-			now2 = simmgr_shm->server.msec_time;
+			now2 = clock_coarse_msec();
 			if (nextBreathTime <= (now2+1))
 			{
+				metric_inc(METRIC_BREATH_LATE);
 				nextBreathTime = now2 + breathInterval;
 			}
 		}
 	}
 	printf("pulseTimer Exit\n");
-	exit(205);
 }
 void
 pulseBroadcastLoop(void)
@@ -812,28 +839,39 @@ pulseBroadcastLoop(void)
 	_tprintf(TEXT("pulseBroadcastLoop: Current thread priority is 0x%x\n"), dwThreadPri);
 
 	int count;
-	int portUpdateLoops = 0;
+	ULONGLONG nextPortUpdate = clock_msec() + STATUS_PORT_INTERVAL;
+	ULONGLONG now;
 	char pbuf[64];
+	struct notify_seen seen;
 	unsigned int last_pulse = simmgr_shm->status.cardiac.pulseCount;
 	unsigned int last_pulseVpc = simmgr_shm->status.cardiac.pulseCountVpc;
 	unsigned int last_breath = simmgr_shm->status.respiration.breathCount;
 	unsigned int last_manual_breath = simmgr_shm->status.respiration.manual_count;
 
-	while (1)
+	notify_snapshot(&seen);
+	while (task_running())
 	{
-		sim_sleep_ms(10);
-		
-		if (portUpdateLoops++ > 500)
+		// Beats come from pulseTimer; manual breaths arrive as a status change
+		now = clock_msec();
+		if (nextPortUpdate > now)
+		{
+			(void)notify_wait(NOTIFY_MASK(NOTIFY_BEAT) | NOTIFY_MASK(NOTIFY_STATUS), &seen,
+				(unsigned int)(nextPortUpdate - now));
+		}
+		now = clock_msec();
+		if (nextPortUpdate <= now)
 		{
 			sprintf_s(pbuf, "statusPort:%d", PORT_STATUS);
 			broadcast_word(pbuf);
-			portUpdateLoops = 0;
+			nextPortUpdate = now + STATUS_PORT_INTERVAL;
 		}
 		
 		if (last_pulse != simmgr_shm->status.cardiac.pulseCount)
 		{
 			last_pulse = simmgr_shm->status.cardiac.pulseCount;
 			count = broadcast_word(pulseWord);
+			metric_inc(METRIC_PULSE_SENT);
+			trace_instant("pulse sent");
 			if (count)
 			{
 #ifdef DEBUG
@@ -845,6 +883,8 @@ pulseBroadcastLoop(void)
 		{
 			last_pulseVpc = simmgr_shm->status.cardiac.pulseCountVpc;
 			count = broadcast_word(pulseWordVPC);
+			metric_inc(METRIC_VPC_SENT);
+			trace_instant("vpc sent");
 			if (count)
 			{
 #ifdef DEBUG
@@ -856,6 +896,7 @@ pulseBroadcastLoop(void)
 		{
 			last_manual_breath = simmgr_shm->status.respiration.manual_count;
 			simmgr_shm->status.respiration.breathCount++;
+			awrrLogBreath(clock_coarse_msec());
 			printf("[BREATH-MANUAL] pulseBroadcastLoop manual_count change: breathCount=%u rate=%d manual_count=%u\n",
 				simmgr_shm->status.respiration.breathCount,
 				simmgr_shm->status.respiration.rate,
@@ -870,6 +911,8 @@ pulseBroadcastLoop(void)
 				last_manual_breath = simmgr_shm->status.respiration.manual_count;
 			}
 			count = broadcast_word(breathWord);
+			metric_inc(METRIC_BREATH_SENT);
+			trace_instant("breath sent");
 #ifdef DEBUG
 			if (count)
 			{
@@ -879,16 +922,19 @@ pulseBroadcastLoop(void)
 		}
 	}
 	printf("pulseBroadcastLoop exit\n");
-	exit(206);
 }
 void
 pulseProcessChild(void)
 {
 	int checkCount = 0;
+	struct notify_seen seen;
 
-	while (1)
+	notify_snapshot(&seen);
+	while (task_running())
 	{
-		sim_sleep_ms(50);		// 50 msec wait
+		// Rates are only changed by scan_commands and resetAllParameters, both of which
+		// signal NOTIFY_STATUS. The timeout is a backstop for any other writer.
+		(void)notify_wait(NOTIFY_MASK(NOTIFY_STATUS), &seen, RATE_CHECK_BACKSTOP);
 
 		if (strcmp(simmgr_shm->status.scenario.state, "Running") == 0)
 		{
@@ -963,7 +1009,7 @@ pulseProcessChild(void)
 				// scales reasonably with different ramp speeds.
 				// Fix-1 (resetTimer) will NOT pull this in because the remaining time
 				// stays well below breathInterval for the entire wait.
-				nextBreathTime = simmgr_shm->server.msec_time + (breathInterval / 7);
+				nextBreathTime = clock_coarse_msec() + (breathInterval / 7);
 			}
 			breathSema.unlock();
 
@@ -975,8 +1021,7 @@ pulseProcessChild(void)
 #endif
 		}
 	}
-	printf("pulseProcessChild Exit");
-	exit(204);
+	printf("pulseProcessChild Exit\n");
 }
 
 #ifdef _WIN32  // WinHTTP-based controller-version query (Windows built-in, no external deps)
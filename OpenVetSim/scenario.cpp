@@ -67,6 +67,8 @@
 #include "vetsim.h"
 #include "scenario.h"
 #include "llist.h"
+#include "simsched.h"
+#include <map>
 // #include "XMLRead.h"
 
 int current_scene_id = -1;
@@ -84,25 +86,26 @@ extern int closeFlag;
 //static void saveData(const xmlChar* xmlName, const xmlChar* xmlValue);
 //static int readScenario(const char* filename);
 static void scene_check(void);
-static struct scenario_scene* findScene(int scene_id);
+static unsigned int scenario_wait_msec(void);
+static struct compiled_scene* findScene(int scene_id);
 
 int validateScenes(void );
 static void startScene(int sceneId);
+static void scenario_reload(struct scenario_reload* reload);
 
-// loopStart and loopStop are used to measure the actual sleep time of the scenario loop,
-// to calculate the time in a scene and in the scenario
-struct timeval loopStart;
-struct timeval loopStop;
+// loopStart is used to measure the actual sleep time of the scenario loop,
+// to calculate the time in a scene and in the scenario. All times are clock_msec().
+uint64_t loopStart;
 
-// palpateStart and palpateStop are used to measure the duration of palpation,
-struct timeval palpateStart;
-struct timeval palpateNow;
+// palpateStart is used to measure the duration of palpation,
+uint64_t palpateStart;
 
 //int eventLast;	// Index of last processed event_callback
 
-struct timeval cprStart; // Time of first CPR detected
+uint64_t cprStart;		// Time CPR was last accumulated
 int cprActive = 0;				// Flag to indicate CPR is active
-int cprCumulative = 0;		// Cumulative time for CPR active in this scene
+int cprCumulative = 0;		// Cumulative time for CPR active in this scene, seconds
+uint64_t cprCumulativeMsec = 0;
 int shockActive = 0;	// Flag to indicate Defibrillation is active
 struct pulse pulseStatus = { 0, 0, 0, 0, 0, 0 };
 
@@ -251,15 +254,32 @@ int parse_header_state = PARSE_HEADER_STATE_NONE;
 
 struct scenario_data* scenario;
 struct scenario_scene* current_scene;
+struct compiled_scenario compiledScenario;
+struct compiled_scene* current_cscene;		// Compiled form of current_scene
+static bool scenarioCached;					// scenario belongs to the scenario cache
+static int scenarioHeadlessTask = -1;		// Scheduler task running the loop when headless
+static bool scenarioHeadlessActive = false;
+static uint64_t exprDeadline;				// When a trigger expression's pending "for" is due, or 0
 
-int
-scenario_main(void)
+/*
+ * scenario_begin
+ *
+ * Load the active scenario, from the cache when it is there, and apply its
+ * initialization and the entry scene. scenarioParseLock is held while the
+ * scenario is read and checked.
+ *
+ * Returns -1 if the scenario could not be read.
+ */
+static int
+scenario_begin(void)
 {
-	int sts;
-	char* sesid = NULL;
 	struct tm tmDest;
 	time_t start_time;
 	errno_t err = 0;
+	struct scenario_file_key fileKey;
+	std::unique_lock<std::mutex> parseHold(scenarioParseLock, std::defer_lock);
+	int errors;
+	int sts;
 
 	snprintf(s_msg, MAX_MSG_SIZE, "Scenario File \"%s\"", simmgr_shm->status.scenario.active);
 	if (!checkOnly)
@@ -271,8 +291,11 @@ scenario_main(void)
 		fprintf(stderr, "%s\n", s_msg);
 	}
 
+	parseHold.lock();
 	xml_current_level = 0;
 	current_scene_id = -1;
+	parseSceneId = -1;
+	parseError[0] = 0;
 	line_number = 0;
 
 	parse_state = PARSE_STATE_NONE;
@@ -282,6 +305,7 @@ scenario_main(void)
 
 	cprActive = 0;				// Flag to indicate CPR is active
 	cprCumulative = 0;		// Cumulative time for CPR active in this scene
+	cprCumulativeMsec = 0;
 	shockActive = 0;	// Flag to indicate Defibrillation is active
 	pulseStatus.left_femoral = false;
 	pulseStatus.right_femoral = false;
@@ -293,10 +317,6 @@ scenario_main(void)
 	simmgr_shm->status.scenario.elapsed_msec_scenario = 0;
 	simmgr_shm->status.scenario.elapsed_msec_scene = 0;
 
-	// Allocate and clear the base scenario structure
-	scenario = (struct scenario_data*)calloc(1, sizeof(struct scenario_data));
-	initializeParameterStruct(&scenario->initParams);
-
 	simmgr_shm->eventListNextWrite = 0;	// Start processing event at the next posted event
 	simmgr_shm->eventListNextRead = 0;
 
@@ -305,31 +325,60 @@ scenario_main(void)
 	err = localtime_s(&tmDest, &start_time);
 	simmgr_shm->status.general.clockStartSec = (tmDest.tm_hour * 60 * 60) + (tmDest.tm_min * 60) + tmDest.tm_sec;
 
-	// Initialize the library and check potential ABI mismatches 
-
-	if (readScenario(simmgr_shm->status.scenario.active) < 0)
+	scenarioCached = scenario_cache_get(simmgr_shm->status.scenario.active, &scenario, &compiledScenario, &current_scene_id);
+	if (scenarioCached)
 	{
-		printf("readScenario Fails\n");
-		snprintf(s_msg, MAX_MSG_SIZE, "scenario: readScenario Fails");
-		if (!checkOnly)
+		simmgr_shm->status.scenario.scene_id = current_scene_id;
+		printf("Scenario from cache\n");
+	}
+	else
+	{
+		// Allocate and clear the base scenario structure
+		scenario = (struct scenario_data*)calloc(1, sizeof(struct scenario_data));
+		(void)scenario_file_key(simmgr_shm->status.scenario.active, &fileKey);
+		parseScenario = scenario;
+
+		sts = readScenario(simmgr_shm->status.scenario.active);
+		current_scene_id = parseSceneId;
+		simmgr_shm->status.scenario.scene_id = current_scene_id;
+		if (parseError[0])
 		{
-			log_message("", s_msg);
+			sprintf_s(simmgr_shm->status.scenario.error_message, STR_SIZE, "%s", parseError);
 		}
-		if (verbose)
+		if (sts < 0)
 		{
-			fprintf(stderr, "%s\n", s_msg);
+			printf("readScenario Fails\n");
+			snprintf(s_msg, MAX_MSG_SIZE, "scenario: readScenario Fails");
+			if (!checkOnly)
+			{
+				log_message("", s_msg);
+			}
+			if (verbose)
+			{
+				fprintf(stderr, "%s\n", s_msg);
+			}
+			takeInstructorSections(II_MASK(II_SCENARIO));
+			sprintf_s(simmgr_shm->instructor.scenario.state, STR_SIZE, "%s", "stopped");
+			instructorMark(II_SCENARIO, SCENARIO_F_STATE);
+			simmgr_shm->instructor.scenario.error_flag = 1;
+			instructorMark(II_SCENARIO, SCENARIO_F_ERROR);
+			releaseInstructorSections(II_MASK(II_SCENARIO));
+			notify_signal(NOTIFY_INSTRUCTOR);
+			return (-1);
 		}
-		takeInstructorLock();
-		sprintf_s(simmgr_shm->instructor.scenario.state, STR_SIZE, "%s", "stopped");
-		simmgr_shm->instructor.scenario.error_flag = 1;
-		releaseInstructorLock();
-		return (-1);
-	}
-	if (errCount)
-	{
+		if (errCount)
+		{
 
+		}
+		printf("readScenario Success\n");
+		if (scenario_compile(scenario, &compiledScenario) < 0)
+		{
+			printf("%s", simmgr_shm->status.scenario.error_message);
+			appendToParseLog(simmgr_shm->status.scenario.error_message);
+			errCount++;
+		}
 	}
-	printf("readScenario Success\n");
+	parseScenario = scenario;
 	if (verbose || checkOnly)
 	{
 		printf("Showing scenes\n");
@@ -350,7 +399,8 @@ scenario_main(void)
 	}
 
 	// Get the name of the current scene
-	current_scene = findScene(current_scene_id);
+	current_cscene = findScene(current_scene_id);
+	current_scene = current_cscene ? current_cscene->scene : NULL;
 	if (!current_scene)
 	{
 		snprintf(s_msg, MAX_MSG_SIZE, "Scenario: Starting scene not found in XML file");
@@ -368,11 +418,14 @@ scenario_main(void)
 		{
 			printf("No Start Scene\n");
 			sprintf_s(simmgr_shm->status.scenario.scene_name, STR_SIZE, "%s", "No Start Scene");
-			takeInstructorLock();
+			takeInstructorSections(II_MASK(II_SCENARIO));
 			sprintf_s(simmgr_shm->instructor.scenario.state, STR_SIZE, "%s", "terminate");
+			instructorMark(II_SCENARIO, SCENARIO_F_STATE);
 			sprintf_s(simmgr_shm->instructor.scenario.error_message, STR_SIZE, "%s", "No Start Scene");
 			simmgr_shm->instructor.scenario.error_flag = 1;
-			releaseInstructorLock();
+			instructorMark(II_SCENARIO, SCENARIO_F_ERROR);
+			releaseInstructorSections(II_MASK(II_SCENARIO));
+			notify_signal(NOTIFY_INSTRUCTOR);
 		}
 		parseLog.append(L"Starting scene not found in XML file\n"); 
 		errCount++;
@@ -388,24 +441,37 @@ scenario_main(void)
 	if ( errCount )
 	{
 		sprintf_s(simmgr_shm->status.scenario.scene_name, STR_SIZE, "%s", "Errors in XML file. See the log for details.");
-		takeInstructorLock();
+		takeInstructorSections(II_MASK(II_SCENARIO));
 		sprintf_s(simmgr_shm->instructor.scenario.state, STR_SIZE, "%s", "terminate");
+		instructorMark(II_SCENARIO, SCENARIO_F_STATE);
 		sprintf_s(simmgr_shm->instructor.scenario.error_message, STR_SIZE, "%s", "Errors in XML file. See the log for details.");
 		simmgr_shm->instructor.scenario.error_flag = 1;
-		releaseInstructorLock();
+		instructorMark(II_SCENARIO, SCENARIO_F_ERROR);
+		releaseInstructorSections(II_MASK(II_SCENARIO));
+		notify_signal(NOTIFY_INSTRUCTOR);
 		printf("erCount is %d\n", errCount);
 		//displayParseLog();
 	}
+	else if (!scenarioCached)
+	{
+		scenarioCached = scenario_cache_put(simmgr_shm->status.scenario.active, &fileKey, scenario,
+			&compiledScenario, current_scene_id);
+	}
 	else if (checkOnly)
 	{
 		sprintf_s(simmgr_shm->status.scenario.scene_name, STR_SIZE, "%s errCount is %d", "Check Only", errCount);
-		takeInstructorLock();
+		takeInstructorSections(II_MASK(II_SCENARIO));
 		sprintf_s(simmgr_shm->instructor.scenario.state, STR_SIZE, "%s", "terminate");
+		instructorMark(II_SCENARIO, SCENARIO_F_STATE);
 		sprintf_s(simmgr_shm->instructor.scenario.error_message, STR_SIZE, "%s errCount is %d", "Check Only", errCount );
 		simmgr_shm->instructor.scenario.error_flag = 1;
+		instructorMark(II_SCENARIO, SCENARIO_F_ERROR);
 		printf("checkOnly is %d\n", checkOnly);
-		releaseInstructorLock(); 
+		releaseInstructorSections(II_MASK(II_SCENARIO)); 
+		notify_signal(NOTIFY_INSTRUCTOR);
 	}
+	errors = errCount;
+	parseHold.unlock();
 
 	if (verbose)
 	{
@@ -442,7 +508,7 @@ scenario_main(void)
 	
 
 	// Apply initialization parameters
-	processInit(&scenario->initParams);
+	processInit(&scenario->init);
 
 	if (current_scene_id >= 0)
 	{
@@ -464,77 +530,147 @@ scenario_main(void)
 	simmgr_shm->status.scenario.elapsed_msec_scenario = 0;
 	simmgr_shm->status.scenario.elapsed_msec_scene = 0;
 
-	extern std::time_t scenario_start_time;
-	scenario_start_time = time(nullptr);
+	extern uint64_t scenario_start_msec;
+	scenario_start_msec = clock_msec();
 
 	cprActive = 0;
 	cprCumulative = 0;
+	cprCumulativeMsec = 0;
 	shockActive = 0;
 
 	//if (validateScenes() != 0)
 	//{
 		//errno = -1;
 	//}
-	// Continue scenario execution
-	while (1)
+	if (!errors && !checkOnly)
 	{
-		sim_clock_gettime_tv(CLOCK_REALTIME, &loopStart);
+		scenario_watch_start(simmgr_shm->status.scenario.active);
+	}
+	return (0);
+}
 
-		// Sleep
-		sim_sleep_ms(SCENARIO_LOOP_DELAY);
-		if (simmgr_shm->status.defibrillation.shock == 1)
-		{
-			continue;
-		}
-		if (strcmp(simmgr_shm->status.scenario.state, "Terminate") == 0)	// Check for termination
+/*
+ * scenario_step
+ *
+ * One pass of the scenario loop: act on the scenario state and, while running,
+ * check the scene's triggers and timeout.
+ *
+ * Returns 1 when the scenario has stopped and the loop should end.
+ */
+static int
+scenario_step(void)
+{
+	int sts;
+	uint64_t checkStart;
+	struct scenario_reload* reload;
+
+	if (simmgr_shm->status.defibrillation.shock == 1)
+	{
+		return (0);
+	}
+	if ((proc_scenario_state == ScenarioState::ScenarioRunning || proc_scenario_state == ScenarioState::ScenarioPaused) &&
+		(reload = scenario_watch_take()) != NULL)
+	{
+		scenario_reload(reload);
+		scenario_watch_free(reload);
+	}
+	if (strcmp(simmgr_shm->status.scenario.state, "Terminate") == 0)	// Check for termination
+	{
+		if (proc_scenario_state != ScenarioState::ScenarioTerminate)
 		{
-			if (proc_scenario_state != ScenarioState::ScenarioTerminate)
-			{
-				// If the scenario needs to do any cleanup, this is the place.
-				printf("Scenario is Terminating\n");
-				snprintf(s_msg, MAX_MSG_SIZE, "Scenario: Terminate");
-				//log_message("", s_msg );
+			// If the scenario needs to do any cleanup, this is the place.
+			printf("Scenario is Terminating\n");
+			snprintf(s_msg, MAX_MSG_SIZE, "Scenario: Terminate");
+			//log_message("", s_msg );
 
-				sts = takeInstructorLock();
-				if (!sts)
-				{
-					addComment(s_msg);
-					proc_scenario_state = ScenarioState::ScenarioTerminate;
-					sprintf_s(simmgr_shm->instructor.scenario.state, STR_SIZE, "Stopped");
-					releaseInstructorLock();
-					printf("Scenario is Stopping\n");
-				}
-				else
-				{
-					printf("Failed to get the Instructor Lock\n");
-				}
+			sts = takeInstructorSections(II_MASK(II_SCENARIO) | II_MASK(II_EVENTS));
+			if (!sts)
+			{
+				addComment(s_msg);
+				proc_scenario_state = ScenarioState::ScenarioTerminate;
+				sprintf_s(simmgr_shm->instructor.scenario.state, STR_SIZE, "Stopped");
+				instructorMark(II_SCENARIO, SCENARIO_F_STATE);
+				releaseInstructorSections(II_MASK(II_SCENARIO) | II_MASK(II_EVENTS));
+				notify_signal(NOTIFY_INSTRUCTOR);
+				printf("Scenario is Stopping\n");
 			}
-		}
-		else if (strcmp(simmgr_shm->status.scenario.state, "Stopped") == 0)
-		{
-			if (proc_scenario_state != ScenarioState::ScenarioStopped)
+			else
 			{
-				snprintf(s_msg, MAX_MSG_SIZE, "Scenario: Stopped");
-				//log_message("", s_msg );
-				lockAndComment(s_msg);
-				proc_scenario_state = ScenarioState::ScenarioStopped;
-				printf("Scenario process is exiting\n");
-				free(scenario);
-				return(0);
+				printf("Failed to get the Instructor Lock\n");
 			}
 		}
-		else if (strcmp(simmgr_shm->status.scenario.state, "Running") == 0)
-		{
-			// Do periodic scenario check
-			scene_check();
-			proc_scenario_state = ScenarioState::ScenarioRunning;
-		}
-		else if (strcmp(simmgr_shm->status.scenario.state, "Paused") == 0)
+	}
+	else if (strcmp(simmgr_shm->status.scenario.state, "Stopped") == 0)
+	{
+		if (proc_scenario_state != ScenarioState::ScenarioStopped)
 		{
-			// Nothing
-			proc_scenario_state = ScenarioState::ScenarioPaused;
+			snprintf(s_msg, MAX_MSG_SIZE, "Scenario: Stopped");
+			//log_message("", s_msg );
+			lockAndComment(s_msg);
+			proc_scenario_state = ScenarioState::ScenarioStopped;
+			printf("Scenario process is exiting\n");
+			scenario_watch_stop();
+			current_cscene = NULL;
+			scenario_compile_free(&compiledScenario);
+			if (!scenarioCached)
+			{
+				scenario_free(scenario);
+			}
+			scenario = NULL;
+			return (1);
 		}
-		if (closeFlag)
+	}
+	else if (strcmp(simmgr_shm->status.scenario.state, "Running") == 0)
+	{
+		// Do periodic scenario check
+		checkStart = metric_usec();
+		scene_check();
+		metric_time(METRIC_TIME_TRIGGER, metric_usec() - checkStart);
+		trace_span("scene_check", checkStart);
+		proc_scenario_state = ScenarioState::ScenarioRunning;
+	}
+	else if (strcmp(simmgr_shm->status.scenario.state, "Paused") == 0)
+	{
+		// Nothing
+		proc_scenario_state = ScenarioState::ScenarioPaused;
+	}
+	return (closeFlag ? 1 : 0);
+}
+
+/*
+ * scenario_main
+ *
+ * The scenario task, started by start_scenario. Loads the scenario and then runs
+ * the scenario loop until the scenario stops. When headless, the loop is instead
+ * run by the scheduler (scenario_headless_task) and this returns once loaded.
+ */
+int
+scenario_main(void)
+{
+	struct notify_seen seen;
+
+	if (scenario_begin() < 0)
+	{
+		return (-1);
+	}
+	if (headless)
+	{
+		scenarioHeadlessActive = true;
+		loopStart = clock_msec();
+		sched_wake(scenarioHeadlessTask, loopStart);
+		return (0);
+	}
+
+	// Continue scenario execution
+	notify_snapshot(&seen);
+	while (1)
+	{
+		loopStart = clock_msec();
+
+		// Wait for a new event, a status or state change, or the next deadline
+		(void)notify_wait(NOTIFY_MASK(NOTIFY_EVENT) | NOTIFY_MASK(NOTIFY_STATUS) | NOTIFY_MASK(NOTIFY_SCENARIO),
+			&seen, scenario_wait_msec());
+		if (scenario_step())
 		{
 			break;
 		}
@@ -544,47 +680,96 @@ scenario_main(void)
 	return(0);
 }
 
+/*
+ * scenario_headless_task
+ *
+ * The scenario loop as a scheduler task, for the headless runner. It runs when an
+ * event, status or state change is signalled, and wakes itself for the deadlines
+ * scenario_main would have waited for.
+ */
+static void
+scenario_headless_task(void)
+{
+	if (!scenarioHeadlessActive)
+	{
+		return;
+	}
+	if (scenario_step())
+	{
+		scenarioHeadlessActive = false;
+		return;
+	}
+	loopStart = clock_msec();
+	sched_wake(scenarioHeadlessTask, loopStart + scenario_wait_msec());
+}
+
+void
+scenario_headless_init(void)
+{
+	scenarioHeadlessTask = sched_add("scenario", scenario_headless_task, 0,
+		NOTIFY_MASK(NOTIFY_EVENT) | NOTIFY_MASK(NOTIFY_STATUS) | NOTIFY_MASK(NOTIFY_SCENARIO));
+}
+
 /**
- * findScene
- * @scene_id
+ * scenario_wait_msec
  *
+ * Longest the scenario loop may block: until the scene timeout, the next second
+ * of CPR duration, the next palpation tick, or a trigger expression's "for" is
+ * due, whichever is first.
 */
-static struct scenario_scene*
-findScene(int scene_id)
+static unsigned int
+scenario_wait_msec(void)
 {
-	struct snode* snode;
-	struct scenario_scene* scene;
-	//int limit = 50;
-
-	snode = scenario->scene_list.next;
+	struct compiled_scene* cs = current_cscene;
+	uint64_t wait;
+	uint64_t limit;
+	uint64_t elapsed;
+	uint64_t now;
 
-	while (snode)
+	if (proc_scenario_state != ScenarioState::ScenarioRunning || !cs)
 	{
-		scene = (struct scenario_scene*)snode;
-		if (scene->id == scene_id)
-		{
-			return (scene);
-		}
-		/*
-		if ( limit-- == 0 )
-		{
-			printf("findScene Limit reached\n" );
-			sprintf(s_msg, "Scenario: findScene Limit reached" );
-			log_message("", s_msg );
-			lockAndComment(s_msg );
-			exit ( -2 );
-		}
-		*/
-		snode = get_next_llist(snode);
+		return (SCENARIO_IDLE_WAIT);
 	}
-	return (NULL);
+	wait = SCENARIO_RUN_WAIT;
+	if (cs->scene->timeout)
+	{
+		limit = (uint64_t)cs->scene->timeout * 1000;
+		elapsed = simmgr_shm->status.scenario.elapsed_msec_scene;
+		wait = (elapsed >= limit) ? 0 : std::min(wait, limit - elapsed);
+	}
+	if (cprActive)
+	{
+		wait = std::min(wait, 1000 - (cprCumulativeMsec % 1000));
+	}
+	if (pulseStatus.active)
+	{
+		wait = std::min(wait, (uint64_t)SCENARIO_PALPATE_TICK);
+	}
+	if (exprDeadline)
+	{
+		now = clock_msec();
+		wait = (exprDeadline <= now) ? 0 : std::min(wait, exprDeadline - now);
+	}
+	return ((unsigned int)wait);
+}
+
+/**
+ * findScene
+ * @scene_id
+ *
+*/
+static struct compiled_scene*
+findScene(int scene_id)
+{
+	return (scenario_find_scene(&compiledScenario, scene_id));
 }
 
 
 void
-logTriggerGroup(struct trigger_group* trig_group, int time)
+logTriggerGroup(struct compiled_group* group, int time)
 {
 	snprintf(s_msg, MAX_MSG_SIZE, "Group Trigger:" );
+	trace_instant("trigger matched");
 
 	lockAndComment(s_msg);
 }
@@ -601,6 +786,10 @@ logTrigger(struct scenario_trigger* trig, int time)
 			snprintf(s_msg, MAX_MSG_SIZE, "Trigger: Event %s", trig->param_element);
 			break;
 
+		case TRIGGER_TEST_EXPR:
+			snprintf(s_msg, MAX_MSG_SIZE, "Trigger: %s", trig->expr);
+			break;
+
 		case TRIGGER_TEST_INSIDE:
 			snprintf(s_msg, MAX_MSG_SIZE, "Trigger: %d < %s:%s < %d",
 				trig->value, trig->param_class, trig->param_element, trig->value2);
@@ -625,6 +814,7 @@ logTrigger(struct scenario_trigger* trig, int time)
 	{
 		snprintf(s_msg, MAX_MSG_SIZE, "Trigger: unknown");
 	}
+	trace_instant("trigger matched");
 
 	lockAndComment(s_msg);
 }
@@ -642,7 +832,7 @@ static void pulse_check(void)
 	{
 		pulseStatus.right_dorsal = true;
 		pulseStatus.active = 1;
-		sim_clock_gettime_tv(CLOCK_REALTIME, &palpateStart);
+		palpateStart = clock_msec();
 		snprintf(s_msg, MAX_MSG_SIZE, "Action: Start Pulse Palpation Right Dorsal ");
 		lockAndComment(s_msg);
 	}
@@ -659,7 +849,7 @@ static void pulse_check(void)
 	{
 		pulseStatus.left_dorsal = true;
 		pulseStatus.active = 1;
-		sim_clock_gettime_tv(CLOCK_REALTIME, &palpateStart);
+		palpateStart = clock_msec();
 		snprintf(s_msg, MAX_MSG_SIZE, "Action: Start Pulse Palpation Left Dorsal ");
 		lockAndComment(s_msg);
 	}
@@ -676,7 +866,7 @@ static void pulse_check(void)
 	{
 		pulseStatus.right_femoral = true;
 		pulseStatus.active = 1;
-		sim_clock_gettime_tv(CLOCK_REALTIME, &palpateStart);
+		palpateStart = clock_msec();
 		snprintf(s_msg, MAX_MSG_SIZE, "Action: Start Pulse Palpation Right Femoral ");
 		lockAndComment(s_msg);
 	}
@@ -693,7 +883,7 @@ static void pulse_check(void)
 	{
 		pulseStatus.left_femoral = true;
 		pulseStatus.active = 1;
-		sim_clock_gettime_tv(CLOCK_REALTIME, &palpateStart);
+		palpateStart = clock_msec();
 		snprintf(s_msg, MAX_MSG_SIZE, "Action: Start Pulse Palpation Left Femoral ");
 		lockAndComment(s_msg);
 	}
@@ -708,108 +898,131 @@ static void pulse_check(void)
 	simmgr_shm->status.pulse.active = pulseStatus.active;
 	if (pulseStatus.active)
 	{
-		int msec_diff;
-		int sec_diff;
-		sim_clock_gettime_tv(CLOCK_REALTIME, &palpateNow);
-		sec_diff = (palpateNow.tv_sec - palpateStart.tv_sec);
-		msec_diff = (((sec_diff * 1000000) + palpateNow.tv_usec) - palpateStart.tv_usec) / 1000;
-
-		simmgr_shm->status.pulse.duration = msec_diff;
+		simmgr_shm->status.pulse.duration = (int)(clock_msec() - palpateStart);
 	}
 }
 
+/*
+ * Parameter values at the last trigger pass. paramFresh is set on scene entry
+ * so that the next pass evaluates every trigger of the scene once.
+ */
+static int paramLast[PARAM_COUNT];
+static bool paramFresh = true;
+
 /**
-* triiger_check
-* 
-* Check for condition met for and event or trigger condition
+* params_changed
+*
+* Read the parameters the scene tests and return the PARAM_MASK of those that
+* changed since the last pass
 */
-int trigger_check(struct scenario_trigger* trig )
+static uint64_t
+params_changed(struct compiled_scene* cs)
 {
-	int met = 0;
+	uint64_t changed = 0;
+	int val;
+	int p;
 
-	if (trig->test == TRIGGER_TEST_EVENT)
+	for (p = 0; p < PARAM_COUNT; p++)
 	{
-		if (strcmp(trig->param_element, simmgr_shm->eventList[simmgr_shm->eventListNextRead].eventName) == 0)
+		if (cs->watch & PARAM_MASK(p))
 		{
-			met = 1;
-			printf("Event %s MET!\n", trig->param_element);
+			val = getValueFromHandle(p);
+			if (paramFresh || val != paramLast[p])
+			{
+				paramLast[p] = val;
+				changed |= PARAM_MASK(p);
+			}
 		}
-		//printf("Event %s %s %d %d %d %d Met %d\n",
-		//	trig->param_class,
-		//	trig->param_element,
-		//	trig->test,
-		//	trig->value,
-		//	trig->value2,
-		//	trig->scene, met );
 	}
-	else
+	return (changed);
+}
+
+/**
+* slot_changed
+*
+* Whether the triggers in slot p of the parameter index are to be checked
+*/
+static bool
+slot_changed(int p, uint64_t changed, bool fresh)
+{
+	if (p < PARAM_COUNT)
 	{
-		int val;
+		return ((changed & PARAM_MASK(p)) != 0);
+	}
+	return (p == SLOT_TIMED || fresh);
+}
 
-		val = getValueFromName(trig->param_class, trig->param_element);
-		switch (trig->test)
-		{
-		case TRIGGER_TEST_EQ:
-			if (val == trig->value)
-			{
-				printf("Event %s MET!\n", trig->param_element);
-				met = 1;
-			}
-			break;
-		case TRIGGER_TEST_LTE:
-			if (val <= trig->value)
-			{
-				printf("Event %s MET!\n", trig->param_element);
-				met = 1;
-			}
-			break;
-		case TRIGGER_TEST_LT:
-			if (val < trig->value)
-			{
-				printf("Event %s MET!\n", trig->param_element);
-				met = 1;
-			}
-			break;
-		case TRIGGER_TEST_GTE:
-			if (val >= trig->value)
-			{
-				printf("Event %s MET!\n", trig->param_element);
-				met = 1;
-			}
-			break;
-		case TRIGGER_TEST_GT:
-			if (val > trig->value)
-			{
-				printf("Event %s MET!\n", trig->param_element);
-				met = 1;
-			}
-			break;
-		case TRIGGER_TEST_INSIDE:
-			if ((val > trig->value) && (val < trig->value2))
-			{
-				printf("Event %s MET!\n", trig->param_element);
-				met = 1;
-			}
-			break;
-		case TRIGGER_TEST_OUTSIDE:
-			if ((val < trig->value) || (val > trig->value2))
-			{
-				printf("Event %s MET!\n", trig->param_element);
-				met = 1;
-			}
-			break;
-		}
-		//printf("Trig %s %s %d %d %d %d %d Met %d\n",
-		//	trig->param_class, trig->param_element,
-		//	trig->test,
-		//	trig->value,
-		//	trig->value2,
-		//	trig->scene,
-		//	trig->group,
-		//	met );
+/**
+* trigger_check
+* 
+* Check for condition met for a non-event trigger of the compiled scene
+*/
+static int
+trigger_check(struct compiled_scene* cs, int i)
+{
+	int val;
+	int met = 0;
+
+	val = (cs->param[i] == PARAM_NONE) ? -1 : paramLast[cs->param[i]];
+	switch (cs->test[i])
+	{
+	case TRIGGER_TEST_EQ:
+		met = (val == cs->value[i]);
+		break;
+	case TRIGGER_TEST_LTE:
+		met = (val <= cs->value[i]);
+		break;
+	case TRIGGER_TEST_LT:
+		met = (val < cs->value[i]);
+		break;
+	case TRIGGER_TEST_GTE:
+		met = (val >= cs->value[i]);
+		break;
+	case TRIGGER_TEST_GT:
+		met = (val > cs->value[i]);
+		break;
+	case TRIGGER_TEST_INSIDE:
+		met = ((val > cs->value[i]) && (val < cs->value2[i]));
+		break;
+	case TRIGGER_TEST_OUTSIDE:
+		met = ((val < cs->value[i]) || (val > cs->value2[i]));
+		break;
+	case TRIGGER_TEST_EXPR:
+		met = expr_eval(cs->expr_code.data() + cs->value[i], cs->expr_code.data() + cs->value2[i], paramLast,
+			clock_msec(), cs->expr_hold.data(), cs->expr_since.data(), &exprDeadline);
+		break;
+	}
+	if (met && verbose)
+	{
+		printf("Event %s MET!\n", cs->name[i]);
 	}
 	return (met);
 }
+
+/**
+* group_trigger_met
+*
+* Count a met group trigger. Returns the group when it is complete, else NULL.
+*/
+static struct compiled_group*
+group_trigger_met(struct compiled_scene* cs, int i)
+{
+	struct compiled_group* group;
+
+	group = &cs->groups[cs->target[i]];
+	cs->met[i] = 1;
+	group->met++;
+	if (verbose)
+	{
+		printf("Group %d Trigger %s Group Met %d of %d\n", group->group_id, cs->name[i], group->met, group->needed);
+	}
+	if (group->met >= group->needed)
+	{
+		return (group);
+	}
+	return (NULL);
+}
+
 /**
 * scene_check
 *
@@ -819,69 +1032,56 @@ int trigger_check(struct scenario_trigger* trig )
 static void
 scene_check(void)
 {
-	struct scenario_trigger* trig;
-	struct trigger_group* trig_group;
-	struct snode* snode;
-	struct snode* tsnode;
-	int met = 0;
-	int msec_diff;
-	int sec_diff;
+	struct compiled_scene* cs = current_cscene;
+	struct compiled_group* group;
+	int eventId;
+	uint64_t changed;
+	bool fresh;
+	int first;
+	int i;
+	int k;
+	int p;
+	uint64_t now;
+	uint64_t msec_diff;
+
+	if (!cs)
+	{
+		return;
+	}
 
 	// Event checks 
 	while (simmgr_shm->eventListNextWrite != simmgr_shm->eventListNextRead )
 	{
-		snode = current_scene->trigger_list.next;
-		
-		// Event Checks - Single Triggers
-		while (snode)
+		eventId = simmgr_shm->eventList[simmgr_shm->eventListNextRead].eventId;
+		auto match = cs->event_trig.find(eventId);
+
+		// Singles come before group triggers in the list, so a single still wins
+		if (match != cs->event_trig.end())
 		{
-			trig = (struct scenario_trigger*)snode;
-			if (trig->test == TRIGGER_TEST_EVENT)
+			for (int t : match->second)
 			{
-				if ( trigger_check(trig ) )
+				if (t < cs->single_count)
 				{
-					logTrigger(trig, 0);
-					startScene(trig->scene);
+					logTrigger(cs->source[t], 0);
+					startScene(cs->target[t]);
 					return;
 				}
-			}
-			snode = get_next_llist(snode);
-		}
-		// Event Checks - Group Triggers
-		tsnode = current_scene->group_list.next;
-		while (tsnode)
-		{
-			trig_group = (struct trigger_group*)tsnode;
-			printf("Checking Group %d Event Trigs\n", trig_group->group_id );
-			snode = trig_group->group_trigger_list.next;
-			while (snode)
-			{
-				trig = (struct scenario_trigger*)snode;
-				printf("\t\tTrigger %s %d %d\n", trig->param_element, trig->test, trig->met );
-				if (!trig->met)
+				if (!cs->met[t])
 				{
-					if (trig->test == TRIGGER_TEST_EVENT)
+					group = group_trigger_met(cs, t);
+					if (group)
 					{
-						printf("Checking Group %d Trig Event %s\n", trig_group->group_id, trig->param_element);
-						if (trigger_check(trig))
-						{
-							trig->met = 1;
-							trig_group->group_triggers_met++;
-							printf("Group %d Trig Event %s MET! Group Met is %d\n", trig_group->group_id, trig->param_element, trig_group->group_triggers_needed);
-							if (trig_group->group_triggers_met >= trig_group->group_triggers_needed)
-							{
-								logTriggerGroup(trig_group, 0);
-								startScene(trig_group->scene);
-								return;
-							}
-						}
+						logTriggerGroup(group, 0);
+						startScene(group->scene);
+						return;
 					}
 				}
-				snode = get_next_llist(snode);
 			}
-			tsnode = get_next_llist(tsnode);
 		}
-		printf("Processed Event %s\n", simmgr_shm->eventList[simmgr_shm->eventListNextRead].eventName);
+		if (verbose)
+		{
+			printf("Processed Event %s\n", simmgr_shm->eventList[simmgr_shm->eventListNextRead].eventName);
+		}
 		simmgr_shm->eventListNextRead++;
 		if (simmgr_shm->eventListNextRead >= EVENT_LIST_SIZE)
 		{
@@ -904,9 +1104,10 @@ scene_check(void)
 		}
 		else
 		{
-			sim_clock_gettime_tv(CLOCK_REALTIME, &loopStop);
-			cprCumulative += (loopStop.tv_sec - cprStart.tv_sec);
-			sim_clock_gettime_tv(CLOCK_REALTIME, &cprStart);
+			now = clock_msec();
+			cprCumulativeMsec += now - cprStart;
+			cprStart = now;
+			cprCumulative = (int)(cprCumulativeMsec / 1000);
 			simmgr_shm->status.cpr.duration = cprCumulative;
 		}
 	}
@@ -914,7 +1115,7 @@ scene_check(void)
 	{
 		if (simmgr_shm->status.cpr.compression)
 		{
-			sim_clock_gettime_tv(CLOCK_REALTIME, &cprStart);
+			cprStart = clock_msec();
 			cprActive = 1;
 			snprintf(s_msg, MAX_MSG_SIZE, "CPR: Starting Compressions");
 			lockAndComment(s_msg);
@@ -924,84 +1125,78 @@ scene_check(void)
 	// Pulse Palpation Checks
 	pulse_check();
 
-	// Trigger Checks - Single Triggers
-	snode = current_scene->trigger_list.next;
-	while (snode)
+	// Trigger Checks - only the triggers whose parameter changed. A trigger that
+	// was not met cannot become met until its parameter changes, unless it holds
+	// a "for", which counts time; those are in SLOT_TIMED and checked every pass.
+	changed = params_changed(cs);
+	fresh = paramFresh;
+	paramFresh = false;
+	exprDeadline = 0;
+
+	// Single Triggers - the first met in scene order wins
+	first = -1;
+	for (p = 0; p < PARAM_SLOTS && !closeFlag; p++)
 	{
-		if (closeFlag)
+		if (!slot_changed(p, changed, fresh))
 		{
-			break;
+			continue;
 		}
-		trig = (struct scenario_trigger*)snode;
-		if (trig->test != TRIGGER_TEST_EVENT)
+		for (k = cs->param_start[p]; k < cs->param_start[p + 1]; k++)
 		{
-			met = trigger_check(trig);
-
-			if (met)
+			i = cs->param_trig[k];
+			if (i >= cs->single_count || (first >= 0 && i > first))
+			{
+				break;
+			}
+			if (trigger_check(cs, i))
 			{
-				printf("Single Trigger Met\n");
-				logTrigger(trig, 0);
-				startScene(trig->scene);
-				return;
+				first = i;
+				break;
 			}
 		}
-		snode = get_next_llist(snode);
+	}
+	if (first >= 0)
+	{
+		logTrigger(cs->source[first], 0);
+		startScene(cs->target[first]);
+		return;
 	}
 
-	// Trigger Checks - Group Triggers
-	snode = current_scene->group_list.next;
-	while (snode)
+	// Group Triggers
+	for (p = 0; p < PARAM_SLOTS && !closeFlag; p++)
 	{
-		if (closeFlag)
+		if (!slot_changed(p, changed, fresh))
 		{
-			break;
+			continue;
 		}
-		trig_group = (struct trigger_group*)snode;
-		tsnode = trig_group->group_trigger_list.next;
-		while (tsnode)
+		for (k = cs->param_start[p]; k < cs->param_start[p + 1]; k++)
 		{
-			if (closeFlag)
-			{
-				break;
-			}
-			trig = (struct scenario_trigger*)tsnode;
-			if (!trig->met && trig->test != TRIGGER_TEST_EVENT)
+			i = cs->param_trig[k];
+			if (i >= cs->single_count && !cs->met[i] && trigger_check(cs, i))
 			{
-				met = trigger_check(trig);
-
-				if (met)
+				logTrigger(cs->source[i], 0);
+				group = group_trigger_met(cs, i);
+				if (group)
 				{
-					trig->met = 1;
-					trig_group->group_triggers_met++;
-					printf("Group %d Trigger %s Gropup Met %d\n", trig_group->group_id, trig->param_element, trig_group->group_triggers_met );
-					logTrigger(trig, 0);
-					if (trig_group->group_triggers_met >= trig_group->group_triggers_needed)
-					{
-						logTriggerGroup(trig_group, 0);
-						startScene(trig_group->scene);
-						return;
-					}
+					logTriggerGroup(group, 0);
+					startScene(group->scene);
+					return;
 				}
 			}
-			tsnode = get_next_llist(tsnode);
 		}
-		snode = get_next_llist(snode);
 	}
 
 	// Check timeout
-	sim_clock_gettime_tv(CLOCK_REALTIME, &loopStop);
-	sec_diff = (loopStop.tv_sec - loopStart.tv_sec);
-	//msec_diff = (((sec_diff * 1000000000) + loopStop.tv_nsec) - loopStart.tv_nsec) / 1000000;
-	msec_diff = (((sec_diff * 1000000) + loopStop.tv_usec) - loopStart.tv_usec) / 1000;
+	msec_diff = clock_msec() - loopStart;
 	simmgr_shm->status.scenario.elapsed_msec_scenario += msec_diff;
 	simmgr_shm->status.scenario.elapsed_msec_scene += msec_diff;
 
-	if (current_scene->timeout)
+	if (cs->scene->timeout)
 	{
-		if (simmgr_shm->status.scenario.elapsed_msec_scene >= ((ULONGLONG)current_scene->timeout * 1000))
+		if (simmgr_shm->status.scenario.elapsed_msec_scene >= ((ULONGLONG)cs->scene->timeout * 1000))
 		{
-			logTrigger((struct scenario_trigger*)0, current_scene->timeout);
-			startScene(current_scene->timeout_scene);
+			logTrigger((struct scenario_trigger*)0, cs->scene->timeout);
+			startScene(cs->scene->timeout_scene);
 		}
 	}
 }
@@ -1057,7 +1252,8 @@ showScene(struct scenario_scene* scene)
 static void
 startScene(int sceneId)
 {
-	struct scenario_scene* new_scene;
+	struct compiled_scene* new_scene;
+	size_t i;
 
 	new_scene = findScene(sceneId);
 	if (!new_scene)
@@ -1066,17 +1262,30 @@ startScene(int sceneId)
 		printf("Scene %d not found", sceneId);
 		snprintf(s_msg, MAX_MSG_SIZE, "Scenario: Scene %d not found. Terminating.", sceneId);
 		snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "Scenario: Scene %d not found. Terminating.", sceneId);
-		takeInstructorLock();
+		takeInstructorSections(II_MASK(II_SCENARIO) | II_MASK(II_EVENTS));
 		addComment(s_msg);
 		sprintf_s(simmgr_shm->instructor.scenario.state, NORMAL_STRING_SIZE, "%s", "Terminate");
+		instructorMark(II_SCENARIO, SCENARIO_F_STATE);
 		sprintf_s(simmgr_shm->status.scenario.scene_name, LONG_STRING_SIZE, "%s", "");
-		releaseInstructorLock();
+		releaseInstructorSections(II_MASK(II_SCENARIO) | II_MASK(II_EVENTS));
+		notify_signal(NOTIFY_INSTRUCTOR);
 		return;
 	}
-	showScene(new_scene);
-	current_scene = new_scene;
+	showScene(new_scene->scene);
+	current_cscene = new_scene;
+	paramFresh = true;
+	current_scene = new_scene->scene;
+	metric_inc(METRIC_SCENE_TRANSITIONS);
+	if (traceEnabled)
+	{
+		char sceneArg[TRACE_ARG_SIZE];
+
+		snprintf(sceneArg, TRACE_ARG_SIZE, "%d", sceneId);
+		trace_instant_arg("scene change", sceneArg);
+	}
 	simmgr_shm->status.scenario.elapsed_msec_scene = 0;
 	cprCumulative = 0;
+	cprCumulativeMsec = 0;
 	cprActive = 0;
 	simmgr_shm->status.cpr.duration = 0;
 
@@ -1092,10 +1301,12 @@ startScene(int sceneId)
 			printf("End scene %s\n", current_scene->name);
 		}
 		snprintf(s_msg, MAX_MSG_SIZE, "Scenario: End Scene %d %s", sceneId, current_scene->name);
-		takeInstructorLock();
+		takeInstructorSections(II_MASK(II_SCENARIO) | II_MASK(II_EVENTS));
 		addComment(s_msg);
 		sprintf_s(simmgr_shm->instructor.scenario.state, NORMAL_STRING_SIZE, "%s", "Terminate");
-		releaseInstructorLock();
+		instructorMark(II_SCENARIO, SCENARIO_F_STATE);
+		releaseInstructorSections(II_MASK(II_SCENARIO) | II_MASK(II_EVENTS));
+		notify_signal(NOTIFY_INSTRUCTOR);
 	}
 	else
 	{
@@ -1111,22 +1322,137 @@ startScene(int sceneId)
 		simmgr_shm->eventListNextRead = 0;
 		memset(simmgr_shm->eventList, 0, sizeof(simmgr_shm->eventList));
 
-		processInit(&current_scene->initParams);
+		processInit(&current_scene->init);
 		// Clear completion counts in any trigger groups
-		struct trigger_group * trigger_group;
-		struct scenario_trigger* trigger;
+		for (i = 0; i < new_scene->groups.size(); i++)
+		{
+			new_scene->groups[i].met = 0;
+		}
+		for (i = 0; i < new_scene->met.size(); i++)
+		{
+			new_scene->met[i] = 0;
+		}
+		new_scene->expr_since.assign(new_scene->expr_since.size(), EXPR_NOT_HELD);
+		exprDeadline = 0;
+	}
+}
 
-		trigger_group = (struct trigger_group* )current_scene->group_list.next;
-		while (trigger_group)
+/**
+* reload_progress
+*
+* Carry the met group triggers of the running scene over to its reloaded form.
+* A trigger is matched by its group's ID, the group's place among the groups with
+* that ID, and its own place in the group.
+*/
+static void
+reload_progress(struct compiled_scene* from, struct compiled_scene* to)
+{
+	std::map<std::pair<int, int>, std::vector<unsigned char>> metByGroup;
+	std::map<std::pair<int, int>, size_t> place;
+	std::map<int, int> seen;
+	std::vector<std::pair<int, int>> fromKey;
+	std::vector<std::pair<int, int>> toKey;
+	struct compiled_group* group;
+	size_t n;
+	size_t g;
+	int i;
+
+	for (g = 0; g < from->groups.size(); g++)
+	{
+		fromKey.push_back(std::make_pair(from->groups[g].group_id, seen[from->groups[g].group_id]++));
+	}
+	seen.clear();
+	for (g = 0; g < to->groups.size(); g++)
+	{
+		toKey.push_back(std::make_pair(to->groups[g].group_id, seen[to->groups[g].group_id]++));
+		to->groups[g].met = 0;
+	}
+	for (i = from->single_count; i < (int)from->test.size(); i++)
+	{
+		metByGroup[fromKey[from->target[i]]].push_back(from->met[i]);
+	}
+	for (i = to->single_count; i < (int)to->test.size(); i++)
+	{
+		group = &to->groups[to->target[i]];
+		n = place[toKey[to->target[i]]]++;
+		auto it = metByGroup.find(toKey[to->target[i]]);
+		to->met[i] = (it != metByGroup.end() && n < it->second.size()) ? it->second[n] : 0;
+		group->met += to->met[i];
+	}
+	to->expr_since.assign(to->expr_since.size(), EXPR_NOT_HELD);
+}
+
+/**
+* scenario_reload
+* @reload: main.xml as the watcher parsed it
+*
+* Replace the running scenario with its edited main.xml, if that parsed without
+* errors and still has the current scene. The parse was done aside, so this only
+* swaps the scenes in. The scene carries on rather than being entered again: its
+* init is not applied, its elapsed time and CPR count are kept, and met group
+* triggers stay met (see reload_progress). The hold times of trigger expressions
+* start again. Whatever of the parse is used is taken out of reload.
+*/
+static void
+scenario_reload(struct scenario_reload* reload)
+{
+	struct scenario_data* data = reload->data;
+	struct scenario_data* old = scenario;
+	struct compiled_scene* cs;
+	size_t g;
+	int sceneId;
+
+	if (!current_cscene)
+	{
+		return;
+	}
+	sceneId = current_cscene->scene->id;
+
+	if (!data)
+	{
+		snprintf(s_msg, MAX_MSG_SIZE, "Scenario: Reload rejected: %s", reload->error);
+		lockAndComment(s_msg);
+		return;
+	}
+	cs = scenario_find_scene(&reload->compiled, sceneId);
+	if (!cs)
+	{
+		snprintf(s_msg, MAX_MSG_SIZE, "Scenario: Reload rejected: scene %d is not in the new file", sceneId);
+		lockAndComment(s_msg);
+		return;
+	}
+	reload_progress(current_cscene, cs);
+
+	// Swap in the new scenes, then let go of the old ones
+	compiledScenario = std::move(reload->compiled);
+	current_cscene = findScene(sceneId);
+	current_scene = current_cscene->scene;
+	scenario = data;
+	reload->data = NULL;
+	if (scenarioCached)
+	{
+		(void)scenario_cache_drop(simmgr_shm->status.scenario.active, old);
+	}
+	else
+	{
+		scenario_free(old);
+	}
+	scenarioCached = scenario_cache_put(simmgr_shm->status.scenario.active, &reload->key, data, &compiledScenario, reload->start_scene_id);
+	paramFresh = true;
+	exprDeadline = 0;
+	sprintf_s(simmgr_shm->status.scenario.scene_name, LONG_STRING_SIZE, "%s", current_scene->name);
+
+	snprintf(s_msg, MAX_MSG_SIZE, "Scenario: Reloaded main.xml in scene %d: %s", sceneId, current_scene->name);
+	lockAndComment(s_msg);
+
+	// A group the edit has made complete is taken now
+	for (g = 0; g < current_cscene->groups.size(); g++)
+	{
+		if (current_cscene->groups[g].met >= current_cscene->groups[g].needed)
 		{
-			trigger_group->group_triggers_met = 0;
-			trigger = (struct scenario_trigger*)trigger_group->group_list.next;
-			while (trigger)
-			{
-				trigger->met = 0;
-				trigger = (struct scenario_trigger*)trigger->trigger_list.next;
-			}
-			trigger_group = (struct trigger_group*)trigger_group->group_list.next;
+			logTriggerGroup(&current_cscene->groups[g], 0);
+			startScene(current_cscene->groups[g].scene);
+			break;
 		}
 	}
 }
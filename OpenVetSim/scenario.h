@@ -26,8 +26,16 @@
 #define _SCENARIO_H
 
 #include "llist.h"
+#include <vector>
+#include <unordered_map>
+#include <string>
+#include <mutex>
 
-#define SCENARIO_LOOP_DELAY	250	// Sleep time (msec) for the Scenario loop
+// The scenario loop wakes on events, status and state changes. These bound the
+// wait for what changes with time alone.
+#define SCENARIO_RUN_WAIT		1000	// msec; elapsed times are shown in seconds
+#define SCENARIO_IDLE_WAIT		10000	// msec, when not running
+#define SCENARIO_PALPATE_TICK	50		// msec, while pulse.duration is counting
 #define LONG_STRING_SIZE	128
 #define NORMAL_STRING_SIZE	32
 #define SCENE_TITLE_MAX		32
@@ -79,7 +87,7 @@ struct scenario_data
 	char description[LONG_STRING_SIZE+2];
 
 	// Initialization Parameters for the scenario
-	struct instructor initParams;
+	struct init_overrides init;
 
 	struct snode scene_list;
 	struct snode event_list;
@@ -93,6 +101,7 @@ struct trigger_group
 	struct snode group_trigger_list;
 	int group_triggers_needed;
 	int group_triggers_met;
+	int line;	// In main.xml
 };
 struct scenario_scene
 {
@@ -101,7 +110,7 @@ struct scenario_scene
 	char name[LONG_STRING_SIZE+1];		// 
 
 	// Initialization Parameters for the scene
-	struct instructor initParams;
+	struct init_overrides init;
 
 	// Timeout in Seconds
 	int timeout;
@@ -113,6 +122,7 @@ struct scenario_scene
 	// List of trigger groups. Advcance to next_scene when the required number of triggers have been met.
 	struct snode group_list;
 
+	int line;	// In main.xml
 };
 
 
@@ -128,6 +138,8 @@ struct scenario_scene
 #define TRIGGER_TEST_INSIDE		5
 #define TRIGGER_TEST_OUTSIDE	6
 #define TRIGGER_TEST_EVENT		7	// Special - Wait for Event Injection from Instructor (or mannequin )
+#define TRIGGER_TEST_EXPR		8	// Compound expression, see scenario_expr.cpp
+#define TRIGGER_EXPR_LENGTH		256
 
 // Note: When Test is TRIGGER_TEST_EVENT, the param_element is the event_id
 
@@ -142,6 +154,8 @@ struct scenario_trigger
 	int 	scene;		// ID of next scene
 	int		group;		// Set to include in group
 	int		met;		// Set when an trigger is met. Used to check for Trigger Group Completions.
+	int		line;		// In main.xml
+	char	expr[TRIGGER_EXPR_LENGTH+2];	// TRIGGER_TEST_EXPR only
 };
 
 struct scenario_event
@@ -159,9 +173,187 @@ struct xml_level
 {
 	int num;
 	char name[PARAMETER_NAME_LENGTH];
+	uint32_t hash;		// xml_hash() of name
 };
 
+/*
+ * Compiled scenario. The parser builds linked lists; scenario_compile() then lays
+ * each scene's triggers out as parallel arrays, with the parameter names resolved
+ * to handles, and indexes the scenes by ID. The scenario loop only uses this form.
+ *
+ * A scene's single triggers come first, [0, single_count), then the group
+ * triggers with each group's triggers together.
+ *
+ * The non-event triggers are also indexed by the parameter they test, so the
+ * scenario loop only evaluates the triggers whose parameter has changed.
+ */
+#define SCENE_ID_RANGE_MAX	65536	// Largest span of scene IDs indexed by a vector; wider uses a map
+#define PARAM_MASK(param)	(1ull << (param))
+#define PARAM_SLOTS			(PARAM_COUNT + 2)	// Parameters, PARAM_NONE, then SLOT_TIMED
+#define SLOT_TIMED			(PARAM_COUNT + 1)	// Expressions with a "for", checked on every pass
+static_assert(PARAM_COUNT <= 64, "StatusParam must fit a PARAM_MASK");
+
+// Compiled trigger expression, a postfix program
+#define EXPR_CONST		0	// Push arg
+#define EXPR_PARAM		1	// Push the value of parameter handle arg
+#define EXPR_NEG		2
+#define EXPR_NOT		3
+#define EXPR_FOR		4	// True once the operand has held for hold[arg] msec
+#define EXPR_ADD		5	// Binary operators from here
+#define EXPR_SUB		6
+#define EXPR_MUL		7
+#define EXPR_DIV		8
+#define EXPR_MOD		9
+#define EXPR_LT			10
+#define EXPR_LTE		11
+#define EXPR_GT			12
+#define EXPR_GTE		13
+#define EXPR_EQ			14
+#define EXPR_NE			15
+#define EXPR_AND		16
+#define EXPR_OR			17
+#define EXPR_STACK_MAX	32
+#define EXPR_NEST_MAX	16	// Parentheses within parentheses
+#define EXPR_NOT_HELD	UINT64_MAX
+
+struct expr_op
+{
+	int op;
+	int arg;
+};
+
+int expr_compile(const char* text, std::vector<struct expr_op>* code, std::vector<uint64_t>* hold,
+	char* error, size_t error_size);
+int expr_eval(const struct expr_op* code, const struct expr_op* end, const int* params, uint64_t now,
+	const uint64_t* hold, uint64_t* since, uint64_t* deadline);
+
+struct compiled_group
+{
+	int group_id;
+	int needed;
+	int met;
+	int scene;		// ID of next scene
+};
+
+struct compiled_scene
+{
+	struct scenario_scene* scene;		// Name, init parameters and timeout
+
+	int single_count;
+	std::vector<int> param;				// StatusParam handle
+	std::vector<int> test;
+	std::vector<int> value;
+	std::vector<int> value2;
+	std::vector<int> target;			// Next scene (single) or index in groups (group)
+	std::vector<unsigned char> met;		// Group triggers only
+	std::vector<const char*> name;		// param_element; the event ID for an event trigger
+	std::vector<struct scenario_trigger*> source;	// For the log
+
+	// Expression programs. For TRIGGER_TEST_EXPR, value and value2 are the start
+	// and end of the trigger's program in expr_code.
+	std::vector<struct expr_op> expr_code;
+	std::vector<uint64_t> expr_hold;		// msec, per "for"
+	std::vector<uint64_t> expr_since;		// Reset on scene entry
+
+	// Trigger numbers by parameter, in trigger order: param_trig[param_start[p]] up to
+	// param_trig[param_start[p + 1]]. Slot PARAM_COUNT holds the PARAM_NONE triggers.
+	// An expression is listed under each parameter it reads, or, with a "for", in SLOT_TIMED.
+	std::vector<int> param_start;
+	std::vector<int> param_trig;
+	uint64_t watch;						// PARAM_MASK of the parameters tested
+
+	// Trigger numbers by event ID, in trigger order
+	std::unordered_map<int, std::vector<int>> event_trig;
+
+	std::vector<struct compiled_group> groups;
+};
+
+struct compiled_scenario
+{
+	int id_min;
+	bool sparse;						// IDs span SCENE_ID_RANGE_MAX or more: use scene_map
+	std::vector<int> scene_index;		// [id - id_min] is the index in scenes, or -1
+	std::unordered_map<int, int> scene_map;	// ID to index in scenes, when sparse
+	std::vector<struct compiled_scene> scenes;
+};
+
+// The parser fills parseScenario and sets parseSceneId and parseError, under
+// scenarioParseLock; the caller then takes them
+extern struct scenario_data* parseScenario;
+extern int parseSceneId;
+extern char parseError[];
+
 int readScenario(const char* name);
+void appendToParseLog(char* str);
 struct scenario_scene* showScenes(void);
+int scenario_compile(struct scenario_data* scen, struct compiled_scenario* out);
+void scenario_compile_free(struct compiled_scenario* cs);
+struct compiled_scene* scenario_find_scene(struct compiled_scenario* cs, int scene_id);
+
+// Scenario cache, keyed by main.xml path, size and modification time
+struct scenario_file_key
+{
+	std::string path;
+	uintmax_t size;
+	int64_t mtime;
+};
+
+extern std::mutex scenarioParseLock;		// The XML parser state, errCount and parseLog are global
+bool scenario_file_key(const char* name, struct scenario_file_key* key);
+bool scenario_cache_get(const char* name, struct scenario_data** data, struct compiled_scenario* compiled, int* start_scene_id);
+bool scenario_cache_put(const char* name, const struct scenario_file_key* key, struct scenario_data* data,
+	struct compiled_scenario* compiled, int start_scene_id);
+void scenario_free(struct scenario_data* scen);
+bool scenario_cache_drop(const char* name, struct scenario_data* data);
+bool scenario_parse(const char* name, struct scenario_data** data, struct compiled_scenario* compiled,
+	int* start_scene_id, char* error, size_t error_size);
+
+// Hot reload: the running scenario's main.xml is watched and parsed aside when it
+// changes, and an edit that parses without errors replaces the scenes in place
+#define SCENARIO_WATCH_POLL_MSEC	500
+
+struct scenario_reload
+{
+	struct scenario_file_key key;		// main.xml as parsed
+	struct scenario_data* data;			// NULL if the parse failed
+	struct compiled_scenario compiled;
+	int start_scene_id;
+	char error[STR_SIZE];				// Why the parse failed
+};
+
+void scenario_watch_start(const char* name);
+void scenario_watch_stop(void);
+struct scenario_reload* scenario_watch_take(void);
+void scenario_watch_free(struct scenario_reload* reload);
+
+// Scenario validation, "--validate". While scenarioCheck is set the parser reports
+// what it finds to it, with the main.xml line.
+#define ISSUE_ERROR		0
+#define ISSUE_WARNING	1
+
+struct scenario_issue
+{
+	int line;
+	int severity;
+	std::string text;
+};
+
+struct scenario_file_ref
+{
+	int line;
+	std::string dir;		// Under the scenario directory: images, media or vocals
+	std::string name;
+};
+
+struct scenario_check
+{
+	std::vector<struct scenario_issue> issues;
+	std::vector<struct scenario_file_ref> files;
+};
+
+extern struct scenario_check* scenarioCheck;
+void scenario_check_issue(int severity, int line, const char* format, ...);
+void resetParseState(void);
+int readScenarioFile(const char* filename);
 
 #endif // _SCENARIO_H
\ No newline at end of file
@@ -0,0 +1,365 @@
+/*
+ * scenario_cache.cpp
+ *
+ * Parsed and compiled scenarios, kept so a scenario starts without reading its XML again.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vetsim.h"
+#include "scenario.h"
+#include <filesystem>
+#include <string>
+
+/*
+ * An entry is used while main.xml has the size and modification time it had when
+ * it was parsed; otherwise it is dropped and the file parsed again. Only scenarios
+ * that parsed without errors are kept, so a scenario with errors still reports
+ * them each time it is started.
+ *
+ * Entries own their scenario_data. The scenario loop gets a copy of the compiled
+ * scenario, since it keeps trigger state there, and reads the scenes in place.
+ */
+struct cache_entry
+{
+	struct scenario_file_key key;
+	struct scenario_data* data;
+	struct compiled_scenario compiled;
+	int start_scene_id;
+};
+
+std::mutex scenarioParseLock;
+static std::mutex cacheLock;
+static std::unordered_map<std::string, struct cache_entry> cacheEntries;
+
+// Parser globals, from scenario.cpp and scenario_xml.cpp
+extern int errCount;
+extern std::wstring parseLog;
+
+/*
+ * FUNCTION: scenario_file_key
+ *
+ * ARGUMENTS:
+ *		name	- Scenario directory name
+ *		key		- Receives the path, size and modification time of its main.xml
+ *
+ * RETURNS:
+ *		true if the file exists
+ */
+bool
+scenario_file_key(const char* name, struct scenario_file_key* key)
+{
+	std::error_code ec;
+	char filename[1400];
+
+	snprintf(filename, sizeof(filename), "%s" PATH_SEP "scenarios" PATH_SEP "%s" PATH_SEP "main.xml",
+		localConfig.html_path, name);
+	key->path = filename;
+	key->size = std::filesystem::file_size(key->path, ec);
+	if (ec)
+	{
+		return (false);
+	}
+	key->mtime = (int64_t)std::filesystem::last_write_time(key->path, ec).time_since_epoch().count();
+	return (!ec);
+}
+
+static bool
+same_key(const struct scenario_file_key* a, const struct scenario_file_key* b)
+{
+	return (a->size == b->size && a->mtime == b->mtime && a->path == b->path);
+}
+
+static void
+free_triggers(struct snode* list)
+{
+	struct snode* snode;
+	struct snode* next;
+
+	for (snode = list->next; snode; snode = next)
+	{
+		next = get_next_llist(snode);
+		free(snode);
+	}
+}
+
+/*
+ * FUNCTION: scenario_free
+ *
+ * Free a scenario from readScenario(), with its scenes, triggers and events.
+ */
+void
+scenario_free(struct scenario_data* scen)
+{
+	struct snode* snode;
+	struct snode* gnode;
+	struct snode* next;
+	struct scenario_scene* scene;
+
+	if (!scen)
+	{
+		return;
+	}
+	for (snode = scen->scene_list.next; snode; snode = next)
+	{
+		next = get_next_llist(snode);
+		scene = (struct scenario_scene*)snode;
+		initFree(&scene->init);
+		free_triggers(&scene->trigger_list);
+		for (gnode = scene->group_list.next; gnode; gnode = get_next_llist(gnode))
+		{
+			free_triggers(&((struct trigger_group*)gnode)->group_trigger_list);
+		}
+		free_triggers(&scene->group_list);
+		free(scene);
+	}
+	free_triggers(&scen->event_list);
+	initFree(&scen->init);
+	free(scen);
+}
+
+/*
+ * FUNCTION: scenario_cache_get
+ *
+ * ARGUMENTS:
+ *		name			- Scenario directory name
+ *		data			- Receives the parsed scenario, still owned by the cache
+ *		compiled		- Receives a copy of the compiled scenario
+ *		start_scene_id	- Receives the initial scene ID
+ *
+ * RETURNS:
+ *		true on a hit. A stale entry is dropped.
+ */
+bool
+scenario_cache_get(const char* name, struct scenario_data** data, struct compiled_scenario* compiled, int* start_scene_id)
+{
+	struct scenario_file_key key;
+	std::lock_guard<std::mutex> lock(cacheLock);
+	auto it = cacheEntries.find(name);
+
+	if (it == cacheEntries.end())
+	{
+		return (false);
+	}
+	if (!scenario_file_key(name, &key) || !same_key(&key, &it->second.key))
+	{
+		scenario_free(it->second.data);
+		cacheEntries.erase(it);
+		return (false);
+	}
+	*data = it->second.data;
+	*compiled = it->second.compiled;
+	*start_scene_id = it->second.start_scene_id;
+	return (true);
+}
+
+/*
+ * FUNCTION: scenario_cache_put
+ *
+ * ARGUMENTS:
+ *		name			- Scenario directory name
+ *		key				- File key, taken before the file was parsed
+ *		data			- Parsed scenario. The cache takes it on success.
+ *		compiled		- Compiled scenario, copied
+ *		start_scene_id	- Initial scene ID
+ *
+ * RETURNS:
+ *		true if stored. An existing entry for the name is kept.
+ */
+bool
+scenario_cache_put(const char* name, const struct scenario_file_key* key, struct scenario_data* data,
+	struct compiled_scenario* compiled, int start_scene_id)
+{
+	std::lock_guard<std::mutex> lock(cacheLock);
+	auto added = cacheEntries.emplace(name, cache_entry());
+
+	if (!added.second)
+	{
+		return (false);
+	}
+	added.first->second.key = *key;
+	added.first->second.data = data;
+	added.first->second.compiled = *compiled;
+	added.first->second.start_scene_id = start_scene_id;
+	return (true);
+}
+
+/*
+ * FUNCTION: scenario_cache_drop
+ *
+ * ARGUMENTS:
+ *		name	- Scenario directory name
+ *		data	- Scenario the entry is expected to hold
+ *
+ * Drop the entry for name if it holds data, and free data. Used when a running
+ * scenario is reloaded and the data it was started from is no longer in use.
+ *
+ * RETURNS:
+ *		true if the entry was dropped
+ */
+bool
+scenario_cache_drop(const char* name, struct scenario_data* data)
+{
+	std::lock_guard<std::mutex> lock(cacheLock);
+	auto it = cacheEntries.find(name);
+
+	if (it == cacheEntries.end() || it->second.data != data)
+	{
+		return (false);
+	}
+	scenario_free(it->second.data);
+	cacheEntries.erase(it);
+	return (true);
+}
+
+/*
+ * FUNCTION: scenario_parse
+ *
+ * ARGUMENTS:
+ *		name			- Scenario directory name
+ *		data			- Receives the parsed scenario, which the caller then owns
+ *		compiled		- Receives the compiled scenario
+ *		start_scene_id	- Receives the initial scene ID
+ *		error			- Receives the reason on failure
+ *		error_size		- Size of error
+ *
+ * Parse and compile a scenario aside. Call with scenarioParseLock held. The parser
+ * fills its own globals, not the running scenario's or the status block, and
+ * errCount and parseLog are restored, so the parse does not disturb the running
+ * scenario or what the instructor sees.
+ *
+ * RETURNS:
+ *		true if the scenario parsed and compiled without errors and has its
+ *		initial scene
+ */
+bool
+scenario_parse(const char* name, struct scenario_data** data, struct compiled_scenario* compiled,
+	int* start_scene_id, char* error, size_t error_size)
+{
+	int savedErrCount = errCount;
+	std::wstring savedParseLog = parseLog;
+	bool ok = false;
+
+	resetParseState();
+	*data = (struct scenario_data*)calloc(1, sizeof(struct scenario_data));
+	parseScenario = *data;
+
+	if (readScenario(name) < 0 || errCount)
+	{
+		snprintf(error, error_size, "%s", parseError[0] ? parseError : "Errors in XML file");
+	}
+	else if (scenario_compile(*data, compiled) < 0)
+	{
+		snprintf(error, error_size, "Scenario could not be compiled");
+	}
+	else if (!scenario_find_scene(compiled, parseSceneId))
+	{
+		snprintf(error, error_size, "Starting scene not found in XML file");
+	}
+	else
+	{
+		*start_scene_id = parseSceneId;
+		ok = true;
+	}
+	if (!ok)
+	{
+		scenario_free(*data);
+		*data = NULL;
+		error[strcspn(error, "\n")] = 0;
+	}
+
+	parseScenario = NULL;
+	errCount = savedErrCount;
+	parseLog = savedParseLog;
+	return (ok);
+}
+
+// Call with scenarioParseLock held. Returns true if the scenario is in the cache.
+static bool
+preload_one(const char* name)
+{
+	struct scenario_file_key key;
+	struct compiled_scenario compiled;
+	struct scenario_data* data;
+	int startSceneId;
+	char error[STR_SIZE];
+
+	{
+		std::lock_guard<std::mutex> lock(cacheLock);
+
+		if (cacheEntries.count(name))
+		{
+			return (true);
+		}
+	}
+	if (!scenario_file_key(name, &key))
+	{
+		return (false);
+	}
+	if (!scenario_parse(name, &data, &compiled, &startSceneId, error, sizeof(error)))
+	{
+		return (false);
+	}
+	if (!scenario_cache_put(name, &key, data, &compiled, startSceneId))
+	{
+		scenario_free(data);
+		return (false);
+	}
+	return (true);
+}
+
+/*
+ * FUNCTION: scenario_cache_preload
+ *
+ * Task, started with the server. Parses each scenario in the scenarios directory
+ * into the cache, one at a time, so a scenario start waits for at most one.
+ */
+void
+scenario_cache_preload(void)
+{
+	std::error_code ec;
+	std::filesystem::path dir;
+	std::string name;
+	char msg[128];
+	int count = 0;
+	int cached = 0;
+
+	dir = std::filesystem::path(localConfig.html_path) / "scenarios";
+	for (const auto& entry : std::filesystem::directory_iterator(dir, ec))
+	{
+		if (!task_running())
+		{
+			break;
+		}
+		if (!entry.is_directory(ec) || !std::filesystem::exists(entry.path() / "main.xml", ec))
+		{
+			continue;
+		}
+		name = entry.path().filename().string();
+		{
+			std::lock_guard<std::mutex> lock(scenarioParseLock);
+
+			if (preload_one(name.c_str()))
+			{
+				cached++;
+			}
+		}
+		count++;
+	}
+	snprintf(msg, sizeof(msg), "Scenario cache: %d of %d scenarios preloaded", cached, count);
+	log_message("", msg);
+}
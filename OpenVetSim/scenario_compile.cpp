@@ -0,0 +1,312 @@
+/*
+ * scenario_compile.cpp
+ *
+ * Convert a parsed scenario into the arrays used by the scenario loop.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vetsim.h"
+#include "scenario.h"
+
+static void
+compile_trigger(struct compiled_scene* cs, struct scenario_trigger* trig, int target)
+{
+	int handle = PARAM_NONE;
+	int value = trig->value;
+	int value2 = trig->value2;
+	const char* name = trig->param_element;
+	char error[128];
+
+	if (trig->test == TRIGGER_TEST_EVENT)
+	{
+		cs->event_trig[internEvent(trig->param_element)].push_back((int)cs->test.size());
+	}
+	else if (trig->test == TRIGGER_TEST_EXPR)
+	{
+		// A program that does not compile is left empty, and is never met
+		value = (int)cs->expr_code.size();
+		if (expr_compile(trig->expr, &cs->expr_code, &cs->expr_hold, error, sizeof(error)) != 0)
+		{
+			printf("Scene %d: Trigger expression \"%s\": %s\n", cs->scene->id, trig->expr, error);
+		}
+		value2 = (int)cs->expr_code.size();
+		name = trig->expr;
+	}
+	else
+	{
+		handle = getParamHandle(trig->param_class, trig->param_element);
+		if (handle == PARAM_NONE)
+		{
+			// Not an error; as before, the parameter reads as -1
+			printf("Scene %d: Trigger parameter %s:%s is not known\n",
+				cs->scene->id, trig->param_class, trig->param_element);
+		}
+	}
+	cs->param.push_back(handle);
+	cs->test.push_back(trig->test);
+	cs->value.push_back(value);
+	cs->value2.push_back(value2);
+	cs->target.push_back(target);
+	cs->met.push_back(0);
+	cs->name.push_back(name);
+	cs->source.push_back(trig);
+}
+
+// The parameter index slots of trigger i. *reads receives the parameters it tests.
+static void
+compile_trigger_slots(struct compiled_scene* cs, int i, std::vector<int>* slots, uint64_t* reads)
+{
+	bool timed = false;
+	int k;
+	int p;
+
+	slots->clear();
+	*reads = 0;
+	if (cs->test[i] == TRIGGER_TEST_EVENT)
+	{
+		return;
+	}
+	if (cs->test[i] != TRIGGER_TEST_EXPR)
+	{
+		if (cs->param[i] == PARAM_NONE)
+		{
+			slots->push_back(PARAM_COUNT);
+		}
+		else
+		{
+			slots->push_back(cs->param[i]);
+			*reads = PARAM_MASK(cs->param[i]);
+		}
+		return;
+	}
+	for (k = cs->value[i]; k < cs->value2[i]; k++)
+	{
+		if (cs->expr_code[k].op == EXPR_PARAM)
+		{
+			*reads |= PARAM_MASK(cs->expr_code[k].arg);
+		}
+		else if (cs->expr_code[k].op == EXPR_FOR)
+		{
+			timed = true;
+		}
+	}
+	if (timed)
+	{
+		slots->push_back(SLOT_TIMED);
+	}
+	else if (*reads == 0)
+	{
+		slots->push_back(PARAM_COUNT);
+	}
+	else
+	{
+		for (p = 0; p < PARAM_COUNT; p++)
+		{
+			if (*reads & PARAM_MASK(p))
+			{
+				slots->push_back(p);
+			}
+		}
+	}
+}
+
+// Counting sort of the non-event triggers by parameter
+static void
+compile_param_index(struct compiled_scene* cs)
+{
+	int count = (int)cs->test.size();
+	int slot;
+	int i;
+	uint64_t reads;
+	std::vector<int> slots;
+	std::vector<int> next;
+
+	cs->watch = 0;
+	cs->param_start.assign(PARAM_SLOTS + 1, 0);
+	for (i = 0; i < count; i++)
+	{
+		compile_trigger_slots(cs, i, &slots, &reads);
+		for (int s : slots)
+		{
+			cs->param_start[s + 1]++;
+		}
+		cs->watch |= reads;
+	}
+	for (slot = 0; slot < PARAM_SLOTS; slot++)
+	{
+		cs->param_start[slot + 1] += cs->param_start[slot];
+	}
+	cs->param_trig.assign(cs->param_start[PARAM_SLOTS], 0);
+	next.assign(cs->param_start.begin(), cs->param_start.end() - 1);
+	for (i = 0; i < count; i++)
+	{
+		compile_trigger_slots(cs, i, &slots, &reads);
+		for (int s : slots)
+		{
+			cs->param_trig[next[s]++] = i;
+		}
+	}
+}
+
+static void
+compile_scene(struct compiled_scene* cs, struct scenario_scene* scene)
+{
+	struct snode* snode;
+	struct snode* tsnode;
+	struct trigger_group* trig_group;
+	struct compiled_group group;
+
+	cs->scene = scene;
+	for (snode = scene->trigger_list.next; snode; snode = get_next_llist(snode))
+	{
+		compile_trigger(cs, (struct scenario_trigger*)snode, ((struct scenario_trigger*)snode)->scene);
+	}
+	cs->single_count = (int)cs->test.size();
+
+	for (snode = scene->group_list.next; snode; snode = get_next_llist(snode))
+	{
+		trig_group = (struct trigger_group*)snode;
+		group.group_id = trig_group->group_id;
+		group.needed = trig_group->group_triggers_needed;
+		group.met = 0;
+		group.scene = trig_group->scene;
+		for (tsnode = trig_group->group_trigger_list.next; tsnode; tsnode = get_next_llist(tsnode))
+		{
+			compile_trigger(cs, (struct scenario_trigger*)tsnode, (int)cs->groups.size());
+		}
+		cs->groups.push_back(group);
+	}
+	cs->expr_since.assign(cs->expr_hold.size(), EXPR_NOT_HELD);
+	compile_param_index(cs);
+}
+
+/*
+ * FUNCTION: scenario_compile
+ *
+ * ARGUMENTS:
+ *		scen	- Scenario from readScenario()
+ *		out		- Receives the compiled scenario
+ *
+ * RETURNS:
+ *		0
+ *
+ * Where a scene ID is repeated the first scene is used, as findScene did. Scenes
+ * are indexed by ID in a vector, or in a map if the IDs span more than
+ * SCENE_ID_RANGE_MAX.
+ */
+int
+scenario_compile(struct scenario_data* scen, struct compiled_scenario* out)
+{
+	struct snode* snode;
+	struct scenario_scene* scene;
+	int id_min = 0;
+	int id_max = 0;
+	int count = 0;
+	int slot;
+
+	scenario_compile_free(out);
+	for (snode = scen->scene_list.next; snode; snode = get_next_llist(snode))
+	{
+		scene = (struct scenario_scene*)snode;
+		if (count == 0 || scene->id < id_min)
+		{
+			id_min = scene->id;
+		}
+		if (count == 0 || scene->id > id_max)
+		{
+			id_max = scene->id;
+		}
+		count++;
+	}
+	if (count == 0)
+	{
+		return (0);
+	}
+	out->sparse = ((int64_t)id_max - id_min >= SCENE_ID_RANGE_MAX);
+	out->id_min = id_min;
+	if (!out->sparse)
+	{
+		out->scene_index.assign(id_max - id_min + 1, -1);
+	}
+	out->scenes.reserve(count);
+
+	for (snode = scen->scene_list.next; snode; snode = get_next_llist(snode))
+	{
+		scene = (struct scenario_scene*)snode;
+		if (out->sparse)
+		{
+			if (!out->scene_map.emplace(scene->id, (int)out->scenes.size()).second)
+			{
+				continue;
+			}
+		}
+		else
+		{
+			slot = scene->id - id_min;
+			if (out->scene_index[slot] >= 0)
+			{
+				continue;
+			}
+			out->scene_index[slot] = (int)out->scenes.size();
+		}
+		out->scenes.emplace_back();
+		compile_scene(&out->scenes.back(), scene);
+	}
+	return (0);
+}
+
+void
+scenario_compile_free(struct compiled_scenario* cs)
+{
+	cs->id_min = 0;
+	cs->sparse = false;
+	cs->scene_index.clear();
+	cs->scene_map.clear();
+	cs->scenes.clear();
+}
+
+/*
+ * FUNCTION: scenario_find_scene
+ *
+ * RETURNS:
+ *		The compiled scene with the ID, or NULL
+ */
+struct compiled_scene*
+scenario_find_scene(struct compiled_scenario* cs, int scene_id)
+{
+	std::unordered_map<int, int>::iterator found;
+	int64_t slot;
+	int index;
+
+	if (cs->sparse)
+	{
+		found = cs->scene_map.find(scene_id);
+		return (found == cs->scene_map.end() ? NULL : &cs->scenes[found->second]);
+	}
+	slot = (int64_t)scene_id - cs->id_min;
+	if (slot < 0 || slot >= (int64_t)cs->scene_index.size())
+	{
+		return (NULL);
+	}
+	index = cs->scene_index[(size_t)slot];
+	if (index < 0)
+	{
+		return (NULL);
+	}
+	return (&cs->scenes[index]);
+}
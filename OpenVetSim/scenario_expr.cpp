@@ -0,0 +1,570 @@
+/*
+ * scenario_expr.cpp
+ *
+ * Compound trigger expressions. The text of an <expr> trigger is compiled once,
+ * when the scenario is compiled, to a short postfix program with the parameter
+ * names resolved to handles.
+ *
+ *	expr	:= and { ("or" | "||") and }
+ *	and		:= hold { ("and" | "&&") hold }
+ *	hold	:= not [ "for" NUMBER [ "s" | "sec" | "seconds" | "min" | "minutes" ] ]
+ *	not		:= ("not" | "!") not | compare
+ *	compare	:= sum [ ("<" | "<=" | ">" | ">=" | "==" | "=" | "!=") sum ]
+ *	sum		:= product { ("+" | "-") product }
+ *	product	:= unary { ("*" | "/" | "%") unary }
+ *	unary	:= ("-" | "+") unary | NUMBER | class:parameter | "(" expr ")"
+ *
+ * Parentheses nest at most EXPR_NEST_MAX deep.
+ *
+ * Values are integers, as the parameters are; a comparison gives 1 or 0 and any
+ * other value is true when not 0. "x for N" is true once x has been true for N
+ * seconds without a break. "for" binds tighter than "and", so
+ *
+ *	(cardiac:bps_dia + (cardiac:bps_sys - cardiac:bps_dia) / 3 < 60 and cardiac:rate > 140) for 30 or respiration:spo2 < 85
+ *
+ * needs the parentheses to hold the pair. In main.xml "<" is written "&lt;", or
+ * the expression is put in a CDATA section.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vetsim.h"
+#include "scenario.h"
+#include <climits>
+
+struct expr_parser
+{
+	const char* text;
+	const char* pos;
+	std::vector<struct expr_op>* code;
+	std::vector<uint64_t>* hold;
+	int depth;			// Stack depth after the code so far
+	int nest;			// Parentheses open at pos
+	int failed;
+	char* error;
+	size_t error_size;
+};
+
+static void expr_or(struct expr_parser* p);
+
+static void
+expr_fail(struct expr_parser* p, const char* what)
+{
+	if (!p->failed)
+	{
+		p->failed = 1;
+		if (*p->pos)
+		{
+			snprintf(p->error, p->error_size, "%s at column %d", what, (int)(p->pos - p->text) + 1);
+		}
+		else
+		{
+			snprintf(p->error, p->error_size, "%s at the end", what);
+		}
+	}
+}
+
+static void
+expr_emit(struct expr_parser* p, int op, int arg)
+{
+	struct expr_op eop;
+
+	switch (op)
+	{
+	case EXPR_CONST:
+	case EXPR_PARAM:
+		p->depth++;
+		break;
+	case EXPR_NEG:
+	case EXPR_NOT:
+	case EXPR_FOR:
+		break;
+	default:
+		p->depth--;
+		break;
+	}
+	if (p->depth > EXPR_STACK_MAX)
+	{
+		expr_fail(p, "expression is too deeply nested");
+	}
+	eop.op = op;
+	eop.arg = arg;
+	p->code->push_back(eop);
+}
+
+static void
+expr_space(struct expr_parser* p)
+{
+	while (isspace((unsigned char)*p->pos))
+	{
+		p->pos++;
+	}
+}
+
+static int
+expr_is_name(char c)
+{
+	return (isalnum((unsigned char)c) || c == '_');
+}
+
+// Match a keyword, which must not run on into a name
+static int
+expr_word(struct expr_parser* p, const char* word)
+{
+	size_t len = strlen(word);
+
+	expr_space(p);
+	if (strncmp(p->pos, word, len) == 0 && !expr_is_name(p->pos[len]) && p->pos[len] != ':')
+	{
+		p->pos += len;
+		return (1);
+	}
+	return (0);
+}
+
+// Match an operator. "<" does not match "<=" and "!" does not match "!=".
+static int
+expr_symbol(struct expr_parser* p, const char* sym)
+{
+	size_t len = strlen(sym);
+
+	expr_space(p);
+	if (strncmp(p->pos, sym, len) != 0)
+	{
+		return (0);
+	}
+	if (len == 1 && strchr("<>!=", sym[0]) && p->pos[1] == '=')
+	{
+		return (0);
+	}
+	p->pos += len;
+	return (1);
+}
+
+static void
+expr_primary(struct expr_parser* p)
+{
+	char name[2 * (TRIGGER_NAME_LENGTH + 1)];
+	const char* start;
+	const char* colon = NULL;
+	char* end;
+	long number;
+	size_t len;
+	int handle;
+
+	expr_space(p);
+	start = p->pos;
+	if (expr_symbol(p, "("))
+	{
+		if (++p->nest > EXPR_NEST_MAX)
+		{
+			p->pos = start;
+			expr_fail(p, "too many nested parentheses");
+			return;
+		}
+		expr_or(p);
+		if (!expr_symbol(p, ")"))
+		{
+			expr_fail(p, "expected \")\"");
+		}
+		p->nest--;
+	}
+	else if (isdigit((unsigned char)*p->pos))
+	{
+		number = strtol(p->pos, &end, 10);
+		if (number > INT_MAX)
+		{
+			expr_fail(p, "number is too large");
+		}
+		p->pos = end;
+		expr_emit(p, EXPR_CONST, (int)number);
+	}
+	else if (isalpha((unsigned char)*p->pos))
+	{
+		while (expr_is_name(*p->pos) || (*p->pos == ':' && !colon))
+		{
+			if (*p->pos == ':')
+			{
+				colon = p->pos;
+			}
+			p->pos++;
+		}
+		len = p->pos - start;
+		if (!colon || colon == p->pos - 1 || len >= sizeof(name))
+		{
+			p->pos = start;
+			expr_fail(p, "expected class:parameter");
+			return;
+		}
+		memcpy(name, start, len);
+		name[len] = 0;
+		name[colon - start] = 0;
+		handle = getParamHandle(name, &name[colon - start + 1]);
+		if (handle == PARAM_NONE)
+		{
+			char what[2 * sizeof(name) + sizeof("unknown parameter :")];
+
+			snprintf(what, sizeof(what), "unknown parameter %s:%s", name, &name[colon - start + 1]);
+			p->pos = start;
+			expr_fail(p, what);
+			return;
+		}
+		expr_emit(p, EXPR_PARAM, handle);
+	}
+	else
+	{
+		expr_fail(p, "expected a number, parameter or \"(\"");
+	}
+}
+
+static void
+expr_unary(struct expr_parser* p)
+{
+	if (expr_symbol(p, "-"))
+	{
+		expr_unary(p);
+		expr_emit(p, EXPR_NEG, 0);
+	}
+	else if (expr_symbol(p, "+"))
+	{
+		expr_unary(p);
+	}
+	else
+	{
+		expr_primary(p);
+	}
+}
+
+static void
+expr_product(struct expr_parser* p)
+{
+	int op;
+
+	expr_unary(p);
+	while (!p->failed)
+	{
+		if (expr_symbol(p, "*"))
+		{
+			op = EXPR_MUL;
+		}
+		else if (expr_symbol(p, "/"))
+		{
+			op = EXPR_DIV;
+		}
+		else if (expr_symbol(p, "%"))
+		{
+			op = EXPR_MOD;
+		}
+		else
+		{
+			break;
+		}
+		expr_unary(p);
+		expr_emit(p, op, 0);
+	}
+}
+
+static void
+expr_sum(struct expr_parser* p)
+{
+	int op;
+
+	expr_product(p);
+	while (!p->failed)
+	{
+		if (expr_symbol(p, "+"))
+		{
+			op = EXPR_ADD;
+		}
+		else if (expr_symbol(p, "-"))
+		{
+			op = EXPR_SUB;
+		}
+		else
+		{
+			break;
+		}
+		expr_product(p);
+		expr_emit(p, op, 0);
+	}
+}
+
+static void
+expr_compare(struct expr_parser* p)
+{
+	int op;
+
+	expr_sum(p);
+	if (expr_symbol(p, "<="))
+	{
+		op = EXPR_LTE;
+	}
+	else if (expr_symbol(p, "<"))
+	{
+		op = EXPR_LT;
+	}
+	else if (expr_symbol(p, ">="))
+	{
+		op = EXPR_GTE;
+	}
+	else if (expr_symbol(p, ">"))
+	{
+		op = EXPR_GT;
+	}
+	else if (expr_symbol(p, "==") || expr_symbol(p, "="))
+	{
+		op = EXPR_EQ;
+	}
+	else if (expr_symbol(p, "!="))
+	{
+		op = EXPR_NE;
+	}
+	else
+	{
+		return;
+	}
+	expr_sum(p);
+	expr_emit(p, op, 0);
+}
+
+static void
+expr_not(struct expr_parser* p)
+{
+	if (expr_word(p, "not") || expr_symbol(p, "!"))
+	{
+		expr_not(p);
+		expr_emit(p, EXPR_NOT, 0);
+	}
+	else
+	{
+		expr_compare(p);
+	}
+}
+
+static void
+expr_hold(struct expr_parser* p)
+{
+	double seconds;
+	char* end;
+
+	expr_not(p);
+	if (p->failed || !expr_word(p, "for"))
+	{
+		return;
+	}
+	expr_space(p);
+	seconds = strtod(p->pos, &end);
+	if (!isdigit((unsigned char)*p->pos) || seconds > 86400)
+	{
+		expr_fail(p, "expected seconds after \"for\"");
+		return;
+	}
+	p->pos = end;
+	if (expr_word(p, "min") || expr_word(p, "minutes") || expr_word(p, "minute"))
+	{
+		seconds *= 60;
+	}
+	else
+	{
+		(void)(expr_word(p, "s") || expr_word(p, "sec") || expr_word(p, "seconds") || expr_word(p, "second"));
+	}
+	expr_emit(p, EXPR_FOR, (int)p->hold->size());
+	p->hold->push_back((uint64_t)(seconds * 1000 + 0.5));
+}
+
+static void
+expr_and(struct expr_parser* p)
+{
+	expr_hold(p);
+	while (!p->failed && (expr_word(p, "and") || expr_symbol(p, "&&")))
+	{
+		expr_hold(p);
+		expr_emit(p, EXPR_AND, 0);
+	}
+}
+
+static void
+expr_or(struct expr_parser* p)
+{
+	expr_and(p);
+	while (!p->failed && (expr_word(p, "or") || expr_symbol(p, "||")))
+	{
+		expr_and(p);
+		expr_emit(p, EXPR_OR, 0);
+	}
+}
+
+/*
+ * FUNCTION: expr_compile
+ *
+ * ARGUMENTS:
+ *		text		- Expression
+ *		code		- The program is added to the end
+ *		hold		- The msec of each "for" are added to the end; EXPR_FOR's arg is the index
+ *		error		- Receives the reason on failure
+ *		error_size	- Size of error
+ *
+ * RETURNS:
+ *		0 on success. On failure -1, with code and hold as they were.
+ */
+int
+expr_compile(const char* text, std::vector<struct expr_op>* code, std::vector<uint64_t>* hold,
+	char* error, size_t error_size)
+{
+	struct expr_parser p;
+	size_t code_size = code->size();
+	size_t hold_size = hold->size();
+
+	p.text = text;
+	p.pos = text;
+	p.code = code;
+	p.hold = hold;
+	p.depth = 0;
+	p.nest = 0;
+	p.failed = 0;
+	p.error = error;
+	p.error_size = error_size;
+
+	expr_space(&p);
+	if (!*p.pos)
+	{
+		expr_fail(&p, "expression is empty");
+	}
+	else
+	{
+		expr_or(&p);
+		expr_space(&p);
+		if (*p.pos)
+		{
+			expr_fail(&p, "unexpected text");
+		}
+	}
+	if (p.failed)
+	{
+		code->resize(code_size);
+		hold->resize(hold_size);
+		return (-1);
+	}
+	return (0);
+}
+
+/*
+ * FUNCTION: expr_eval
+ *
+ * ARGUMENTS:
+ *		code		- Program from expr_compile()
+ *		end			- End of the program
+ *		params		- Parameter values, by handle
+ *		now			- clock_msec()
+ *		hold		- As from expr_compile()
+ *		since		- For each "for", when its operand became true, or EXPR_NOT_HELD
+ *		deadline	- Lowered to when a pending "for" is due; 0 means none is pending
+ *
+ * RETURNS:
+ *		1 if the expression is true
+ *
+ * Every operand is evaluated, without a short cut, so each "for" sees every change.
+ */
+int
+expr_eval(const struct expr_op* code, const struct expr_op* end, const int* params, uint64_t now,
+	const uint64_t* hold, uint64_t* since, uint64_t* deadline)
+{
+	int64_t stack[EXPR_STACK_MAX];
+	int64_t b;
+	int top = -1;
+	uint64_t due;
+
+	for (; code < end; code++)
+	{
+		b = (code->op >= EXPR_ADD) ? stack[top--] : 0;
+		switch (code->op)
+		{
+		case EXPR_CONST:
+			stack[++top] = code->arg;
+			break;
+		case EXPR_PARAM:
+			stack[++top] = params[code->arg];
+			break;
+		case EXPR_NEG:
+			stack[top] = -stack[top];
+			break;
+		case EXPR_NOT:
+			stack[top] = !stack[top];
+			break;
+		case EXPR_ADD:
+			stack[top] += b;
+			break;
+		case EXPR_SUB:
+			stack[top] -= b;
+			break;
+		case EXPR_MUL:
+			stack[top] *= b;
+			break;
+		case EXPR_DIV:
+			stack[top] = b ? stack[top] / b : 0;
+			break;
+		case EXPR_MOD:
+			stack[top] = b ? stack[top] % b : 0;
+			break;
+		case EXPR_LT:
+			stack[top] = (stack[top] < b);
+			break;
+		case EXPR_LTE:
+			stack[top] = (stack[top] <= b);
+			break;
+		case EXPR_GT:
+			stack[top] = (stack[top] > b);
+			break;
+		case EXPR_GTE:
+			stack[top] = (stack[top] >= b);
+			break;
+		case EXPR_EQ:
+			stack[top] = (stack[top] == b);
+			break;
+		case EXPR_NE:
+			stack[top] = (stack[top] != b);
+			break;
+		case EXPR_AND:
+			stack[top] = (stack[top] && b);
+			break;
+		case EXPR_OR:
+			stack[top] = (stack[top] || b);
+			break;
+		case EXPR_FOR:
+			if (!stack[top])
+			{
+				since[code->arg] = EXPR_NOT_HELD;
+				break;
+			}
+			if (since[code->arg] == EXPR_NOT_HELD)
+			{
+				since[code->arg] = now;
+			}
+			due = since[code->arg] + hold[code->arg];
+			if (now < due)
+			{
+				stack[top] = 0;
+				if (*deadline == 0 || due < *deadline)
+				{
+					*deadline = due;
+				}
+			}
+			break;
+		}
+	}
+	return (top >= 0 && stack[top] != 0);
+}
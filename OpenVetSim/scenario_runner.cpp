@@ -0,0 +1,745 @@
+/*
+ * scenario_runner.cpp
+ *
+ * Run scenarios headless against scripted timelines, and check the results:
+ *
+ *	WinVetSim --run [-j jobs] [-v] [-k] script | directory ...
+ *
+ * A directory stands for the *.run scripts in it. Each script runs in its own
+ * process, since the engine state is global, with up to jobs (default: one per
+ * core) at once. The process has no PHP server, status or pulse listeners and no
+ * OBS; the tasks run on one thread on a manual clock, so a run is deterministic
+ * and takes as long as the work, not the scenario time.
+ *
+ * Script lines, "#" starting a comment:
+ *
+ *	scenario <name>							First; the scenario under html/scenarios
+ *	<sec> set <class>:<param> <value>		As the instructor's set:<class>:<param>=<value>
+ *	<sec> event <event_id>
+ *	<sec> expect scene <id>
+ *	<sec> expect state <state>				Running, Paused, Terminate or Stopped
+ *	<sec> expect <class>:<param> [op] <value>	op is ==, !=, <, <=, > or >=; default ==
+ *	<sec> expect log <text>					A simlog line so far contains the text
+ *
+ * Times are seconds from the scenario start. Lines at the same time run in order.
+ * Set and event lines at the same time, with no expectation between them, are
+ * sent as one command, as the instructor page sends a value with its
+ * transfer_time, so scan_commands applies them together.
+ * A failed expectation is reported as "script:line: error: ..." and the exit
+ * status is 1 if any script fails.
+ *
+ * The beats are not generated, so cardiac:avg_rate and the breath counts stay 0.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vetsim.h"
+#include "simsched.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#define RUN_SETTLE_MAX	1000	// Scheduler passes before a step is taken to never settle
+
+#define STEP_SET			0
+#define STEP_EVENT			1
+#define STEP_EXPECT_SCENE	2
+#define STEP_EXPECT_STATE	3
+#define STEP_EXPECT_PARAM	4
+#define STEP_EXPECT_LOG		5
+
+#define OP_EQ	0
+#define OP_NE	1
+#define OP_LT	2
+#define OP_LE	3
+#define OP_GT	4
+#define OP_GE	5
+
+struct run_step
+{
+	uint64_t at;			// msec from the scenario start
+	int line;
+	int kind;
+	std::string arg;		// set:<class>:<param>=<value>, event ID, state or log text
+	std::string param_class;
+	std::string param_element;
+	int op;
+	int value;
+};
+
+struct run_job
+{
+	std::string path;
+	std::string dir;		// Scratch directory: simlog, engine output and the report
+	int status;
+	std::string report;
+};
+
+static const char* opNames[] = { "==", "!=", "<", "<=", ">", ">=" };
+
+extern char simlog_file[];
+extern std::string htmlReply;
+int simstatusHandleCommand(char* args);
+
+static const char* runScript;
+static int runFailures;
+
+static void
+run_error(int line, const char* format, ...)
+{
+	char text[512];
+	va_list args;
+
+	va_start(args, format);
+	vsnprintf(text, sizeof(text), format, args);
+	va_end(args);
+	if (line > 0)
+	{
+		fprintf(stderr, "%s:%d: error: %s\n", runScript, line, text);
+	}
+	else
+	{
+		fprintf(stderr, "%s: error: %s\n", runScript, text);
+	}
+	runFailures++;
+}
+
+static int
+parse_op(const std::string& word)
+{
+	int i;
+
+	for (i = 0; i < (int)(sizeof(opNames) / sizeof(opNames[0])); i++)
+	{
+		if (word == opNames[i])
+		{
+			return (i);
+		}
+	}
+	return (-1);
+}
+
+// Split <class>:<param>; false if there is no ':'
+static bool
+split_param(const std::string& word, std::string& param_class, std::string& param_element)
+{
+	size_t colon = word.find(':');
+
+	if (colon == std::string::npos || colon == 0 || colon + 1 == word.size())
+	{
+		return (false);
+	}
+	param_class = word.substr(0, colon);
+	param_element = word.substr(colon + 1);
+	return (true);
+}
+
+/*
+ * FUNCTION: parse_script
+ *
+ * Read the script into steps, sorted by time. Reports each bad line.
+ *
+ * RETURNS:
+ *		0 on success, -1 if the script cannot be run
+ */
+static int
+parse_script(const char* path, std::string& scenarioName, std::vector<struct run_step>& steps)
+{
+	std::ifstream in(path);
+	std::string text;
+	std::string word;
+	std::string rest;
+	struct run_step step;
+	double sec;
+	int line = 0;
+	int bad = 0;
+
+	if (!in)
+	{
+		run_error(0, "cannot open");
+		return (-1);
+	}
+	while (std::getline(in, text))
+	{
+		line++;
+		if (!text.empty() && text.back() == '\r')
+		{
+			text.pop_back();
+		}
+		if (text.find('#') != std::string::npos)
+		{
+			text.erase(text.find('#'));
+		}
+		std::istringstream ls(text);
+
+		if (!(ls >> word))
+		{
+			continue;
+		}
+		if (word == "scenario")
+		{
+			if (!(ls >> scenarioName))
+			{
+				run_error(line, "scenario needs a name");
+				bad++;
+			}
+			continue;
+		}
+		sec = strtod(word.c_str(), NULL);
+		if (!isdigit((unsigned char)word[0]) || sec < 0)
+		{
+			run_error(line, "expected a time in seconds, not \"%s\"", word.c_str());
+			bad++;
+			continue;
+		}
+		step = run_step();
+		step.at = (uint64_t)(sec * 1000 + 0.5);
+		step.line = line;
+		word.clear();
+		ls >> word;
+		if (word == "set")
+		{
+			std::string target;
+			std::string value;
+
+			ls >> target >> value;
+			if (!split_param(target, step.param_class, step.param_element) || value.empty())
+			{
+				run_error(line, "set needs <class>:<param> <value>");
+				bad++;
+				continue;
+			}
+			step.kind = STEP_SET;
+			step.arg = "set:" + target + "=" + value;
+		}
+		else if (word == "event")
+		{
+			if (!(ls >> step.arg))
+			{
+				run_error(line, "event needs an event ID");
+				bad++;
+				continue;
+			}
+			step.kind = STEP_EVENT;
+			step.arg = "set:event:event_id=" + step.arg;
+		}
+		else if (word == "expect")
+		{
+			word.clear();
+			ls >> word;
+			if (word == "scene")
+			{
+				step.kind = STEP_EXPECT_SCENE;
+				if (!(ls >> step.value))
+				{
+					run_error(line, "expect scene needs a scene ID");
+					bad++;
+					continue;
+				}
+			}
+			else if (word == "state")
+			{
+				step.kind = STEP_EXPECT_STATE;
+				if (!(ls >> step.arg))
+				{
+					run_error(line, "expect state needs a state");
+					bad++;
+					continue;
+				}
+			}
+			else if (word == "log")
+			{
+				step.kind = STEP_EXPECT_LOG;
+				std::getline(ls >> std::ws, step.arg);
+				if (step.arg.empty())
+				{
+					run_error(line, "expect log needs text");
+					bad++;
+					continue;
+				}
+			}
+			else if (split_param(word, step.param_class, step.param_element))
+			{
+				step.kind = STEP_EXPECT_PARAM;
+				if (getParamHandle(step.param_class.c_str(), step.param_element.c_str()) < 0)
+				{
+					run_error(line, "unknown parameter %s", word.c_str());
+					bad++;
+					continue;
+				}
+				rest.clear();
+				ls >> rest;
+				step.op = parse_op(rest);
+				if (step.op < 0)
+				{
+					step.op = OP_EQ;
+				}
+				else
+				{
+					rest.clear();
+					ls >> rest;
+				}
+				if (rest.empty() || !(isdigit((unsigned char)rest[0]) || rest[0] == '-'))
+				{
+					run_error(line, "expect %s needs a value", word.c_str());
+					bad++;
+					continue;
+				}
+				step.value = atoi(rest.c_str());
+			}
+			else
+			{
+				run_error(line, "unknown expectation \"%s\"", word.c_str());
+				bad++;
+				continue;
+			}
+		}
+		else
+		{
+			run_error(line, "unknown command \"%s\"", word.c_str());
+			bad++;
+			continue;
+		}
+		steps.push_back(step);
+	}
+	if (scenarioName.empty())
+	{
+		run_error(0, "no scenario line");
+		bad++;
+	}
+	std::stable_sort(steps.begin(), steps.end(),
+		[](const struct run_step& a, const struct run_step& b) { return (a.at < b.at); });
+	return (bad ? -1 : 0);
+}
+
+/*
+ * FUNCTION: settle
+ *
+ * Run the tasks that are triggered or due, and the ones they start or trigger in
+ * turn, until there are none at the current time.
+ *
+ * RETURNS:
+ *		0 on success, -1 if the tasks keep triggering each other
+ */
+static int
+settle(void)
+{
+	int pass;
+
+	for (pass = 0; pass < RUN_SETTLE_MAX; pass++)
+	{
+		if (task_run_inline() + sched_run_ready() == 0)
+		{
+			return (0);
+		}
+	}
+	return (-1);
+}
+
+// Move the clock to target, stopping at each task deadline on the way
+static int
+advance_to(uint64_t target)
+{
+	uint64_t now;
+	uint64_t next;
+
+	if (settle() != 0)
+	{
+		return (-1);
+	}
+	while ((now = clock_msec()) < target)
+	{
+		next = sched_next_run();
+		if (next == 0 || next > target)
+		{
+			next = target;
+		}
+		if (next > now)
+		{
+			clock_advance((next - now) * 1000000);
+		}
+		if (settle() != 0)
+		{
+			return (-1);
+		}
+	}
+	return (0);
+}
+
+// Count the occurrences of text in htmlReply
+static int
+reply_count(const char* text)
+{
+	size_t pos = 0;
+	int count = 0;
+
+	while ((pos = htmlReply.find(text, pos)) != std::string::npos)
+	{
+		count++;
+		pos++;
+	}
+	return (count);
+}
+
+// An instructor command, as the status server would take it. False if any set is refused.
+static bool
+run_command(const std::string& command)
+{
+	std::vector<char> args(command.begin(), command.end());
+	int statuses;
+	bool ok;
+
+	args.push_back(0);
+	(void)simstatusHandleCommand(args.data());
+	statuses = reply_count("\"status\":");
+	ok = (statuses > 0 && reply_count("\"status\":\"ok\"") == statuses);
+	htmlReply.clear();
+	return (ok);
+}
+
+static bool
+is_command(const struct run_step& step)
+{
+	return (step.kind == STEP_SET || step.kind == STEP_EVENT);
+}
+
+static bool
+log_contains(const std::string& text)
+{
+	std::ifstream in(simlog_file);
+	std::string line;
+
+	while (std::getline(in, line))
+	{
+		if (line.find(text) != std::string::npos)
+		{
+			return (true);
+		}
+	}
+	return (false);
+}
+
+static bool
+compare(int value, int op, int expected)
+{
+	switch (op)
+	{
+	case OP_NE:
+		return (value != expected);
+	case OP_LT:
+		return (value < expected);
+	case OP_LE:
+		return (value <= expected);
+	case OP_GT:
+		return (value > expected);
+	case OP_GE:
+		return (value >= expected);
+	case OP_EQ:
+	default:
+		return (value == expected);
+	}
+}
+
+static void
+do_step(struct run_step* step)
+{
+	int value;
+
+	switch (step->kind)
+	{
+	case STEP_EXPECT_SCENE:
+		if (simmgr_shm->status.scenario.scene_id != step->value)
+		{
+			run_error(step->line, "at %.3f s: expected scene %d, in scene %d (%s)", step->at / 1000.0,
+				step->value, simmgr_shm->status.scenario.scene_id, simmgr_shm->status.scenario.scene_name);
+		}
+		break;
+	case STEP_EXPECT_STATE:
+		if (_stricmp(simmgr_shm->status.scenario.state, step->arg.c_str()) != 0)
+		{
+			run_error(step->line, "at %.3f s: expected state %s, state is %s", step->at / 1000.0,
+				step->arg.c_str(), simmgr_shm->status.scenario.state);
+		}
+		break;
+	case STEP_EXPECT_PARAM:
+		value = getValueFromName((char*)step->param_class.c_str(), (char*)step->param_element.c_str());
+		if (!compare(value, step->op, step->value))
+		{
+			run_error(step->line, "at %.3f s: expected %s:%s %s %d, value is %d", step->at / 1000.0,
+				step->param_class.c_str(), step->param_element.c_str(), opNames[step->op], step->value, value);
+		}
+		break;
+	case STEP_EXPECT_LOG:
+		if (!log_contains(step->arg))
+		{
+			run_error(step->line, "at %.3f s: no log line contains \"%s\"", step->at / 1000.0, step->arg.c_str());
+		}
+		break;
+	}
+}
+
+/*
+ * FUNCTION: run_one
+ *
+ * ARGUMENTS:
+ *		script	- Script to run
+ *		dir		- Directory for the simlog
+ *
+ * Run one script in this process. Failures are written to stderr.
+ *
+ * RETURNS:
+ *		0 if every expectation was met, else 1
+ */
+static int
+run_one(const char* script, const char* dir)
+{
+	std::vector<struct run_step> steps;
+	std::string scenarioName;
+	std::string command;
+	std::error_code ec;
+	uint64_t start;
+	size_t next;
+	size_t i;
+
+	runScript = script;
+	runFailures = 0;
+	if (parse_script(script, scenarioName, steps) != 0)
+	{
+		return (1);
+	}
+
+	std::filesystem::create_directories(dir, ec);
+	headless = 1;
+	initSHM();
+	clock_set_manual(true);
+	simlog_set_dir(dir);
+	simmgrInitialize();
+	(void)settle();			// The scheduler takes its notify snapshot on the first pass
+
+	(void)run_command("set:scenario:active=" + scenarioName);
+	(void)run_command("set:scenario:state=running");
+	if (settle() != 0 || strcmp(simmgr_shm->status.scenario.state, "Running") != 0 ||
+		simmgr_shm->status.scenario.error_flag)
+	{
+		run_error(0, "scenario %s did not start: %s", scenarioName.c_str(), simmgr_shm->status.scenario.error_message);
+		return (1);
+	}
+
+	start = clock_msec();
+	for (i = 0; i < steps.size(); i = next)
+	{
+		if (advance_to(start + steps[i].at) != 0)
+		{
+			run_error(steps[i].line, "at %.3f s: the tasks did not settle", steps[i].at / 1000.0);
+			return (1);
+		}
+		next = i + 1;
+		if (!is_command(steps[i]))
+		{
+			do_step(&steps[i]);
+			continue;
+		}
+		command = steps[i].arg;
+		while (next < steps.size() && steps[next].at == steps[i].at && is_command(steps[next]))
+		{
+			command += "&" + steps[next].arg;
+			next++;
+		}
+		if (!run_command(command))
+		{
+			run_error(steps[i].line, "at %.3f s: %s was refused", steps[i].at / 1000.0, command.c_str());
+		}
+	}
+	return (runFailures ? 1 : 0);
+}
+
+// A script, or a directory of *.run scripts
+static int
+add_script(std::vector<std::string>& scripts, const char* arg)
+{
+	std::filesystem::path path(arg);
+	std::vector<std::string> found;
+	std::error_code ec;
+
+	if (std::filesystem::is_regular_file(path, ec))
+	{
+		scripts.push_back(path.string());
+		return (0);
+	}
+	if (!std::filesystem::is_directory(path, ec))
+	{
+		fprintf(stderr, "%s: not found\n", arg);
+		return (-1);
+	}
+	for (const auto& entry : std::filesystem::directory_iterator(path, ec))
+	{
+		if (entry.is_regular_file(ec) && entry.path().extension() == ".run")
+		{
+			found.push_back(entry.path().string());
+		}
+	}
+	if (found.empty())
+	{
+		fprintf(stderr, "%s: no *.run scripts\n", arg);
+		return (-1);
+	}
+	std::sort(found.begin(), found.end());
+	scripts.insert(scripts.end(), found.begin(), found.end());
+	return (0);
+}
+
+static std::string
+read_file(const std::string& path)
+{
+	std::ifstream in(path, std::ios::binary);
+	std::ostringstream text;
+
+	text << in.rdbuf();
+	return (text.str());
+}
+
+// Run a script in a child process, with its output and report in job->dir
+static void
+spawn_one(const char* program, struct run_job* job)
+{
+	std::string command;
+	std::error_code ec;
+
+	std::filesystem::create_directories(job->dir, ec);
+	command = "\"" + std::string(program) + "\" --run --one \"" + job->path + "\" \"" + job->dir + "\"" +
+		" > \"" + job->dir + PATH_SEP "output.txt\" 2> \"" + job->dir + PATH_SEP "report.txt\"";
+#ifdef _WIN32
+	command = "\"" + command + "\"";	// cmd /c strips the outer quotes
+#endif
+	job->status = std::system(command.c_str());
+	job->report = read_file(job->dir + PATH_SEP "report.txt");
+}
+
+/*
+ * FUNCTION: scenario_runner_main
+ *
+ * ARGUMENTS:
+ *		program		- argv[0], to start the child processes
+ *		argc, argv	- The arguments after --run
+ *
+ * RETURNS:
+ *		0 if every script passed, else 1
+ */
+int
+scenario_runner_main(const char* program, int argc, char* argv[])
+{
+	std::vector<std::string> scripts;
+	std::vector<struct run_job> jobs;
+	std::vector<std::thread> workers;
+	std::atomic<size_t> nextJob(0);
+	std::filesystem::path scratch;
+	std::error_code ec;
+	unsigned int threads = 0;
+	bool verboseRun = false;
+	bool keep = false;
+	int failed = 0;
+	int bad = 0;
+	int i;
+
+	if (argc >= 3 && strcmp(argv[0], "--one") == 0)
+	{
+		return (run_one(argv[1], argv[2]));
+	}
+	for (i = 0; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+		{
+			threads = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-v") == 0)
+		{
+			verboseRun = true;
+		}
+		else if (strcmp(argv[i], "-k") == 0)
+		{
+			keep = true;
+		}
+		else if (add_script(scripts, argv[i]) != 0)
+		{
+			bad = 1;
+		}
+	}
+	if (scripts.empty())
+	{
+		fprintf(stderr, "Usage: %s --run [-j jobs] [-v] [-k] script | directory ...\n", program);
+		return (1);
+	}
+
+	scratch = std::filesystem::temp_directory_path(ec) / ("vetsim-run-" + std::to_string(clock_real_nsec()));
+	jobs.resize(scripts.size());
+	for (i = 0; i < (int)scripts.size(); i++)
+	{
+		jobs[i].path = std::filesystem::absolute(scripts[i], ec).string();
+		jobs[i].dir = (scratch / std::to_string(i)).string();
+	}
+	if (threads == 0)
+	{
+		threads = std::thread::hardware_concurrency();
+	}
+	threads = std::max(1u, std::min(threads, (unsigned int)jobs.size()));
+	for (unsigned int t = 0; t < threads; t++)
+	{
+		workers.emplace_back([&jobs, &nextJob, program]() {
+			size_t j;
+
+			while ((j = nextJob.fetch_add(1)) < jobs.size())
+			{
+				spawn_one(program, &jobs[j]);
+			}
+			});
+	}
+	for (auto& w : workers)
+	{
+		w.join();
+	}
+
+	for (auto& job : jobs)
+	{
+		if (verboseRun)
+		{
+			printf("%s", read_file(job.dir + PATH_SEP "output.txt").c_str());
+		}
+		printf("%s", job.report.c_str());
+		if (job.status != 0)
+		{
+			if (job.report.empty())
+			{
+				printf("%s: error: run failed (status %d)\n", job.path.c_str(), job.status);
+			}
+			failed++;
+		}
+	}
+	printf("%d scripts run: %d passed, %d failed\n", (int)jobs.size(), (int)jobs.size() - failed, failed);
+	if (keep)
+	{
+		printf("Run output kept in %s\n", scratch.string().c_str());
+	}
+	else
+	{
+		std::filesystem::remove_all(scratch, ec);
+	}
+	return ((failed || bad) ? 1 : 0);
+}
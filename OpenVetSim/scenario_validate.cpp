@@ -0,0 +1,656 @@
+/*
+ * scenario_validate.cpp
+ *
+ * Check scenario files without running them:
+ *
+ *	WinVetSim --validate [-j jobs] [scenario directory | main.xml | library directory] ...
+ *
+ * A library directory is one holding scenario directories, as html/scenarios does,
+ * and is the default. Each file is reported as "path:line: error: ..." and the
+ * exit status is 1 if any has an error.
+ *
+ * The parser keeps its state in globals, so with more than one core the files
+ * are shared among child processes, one per core or -j, as --run's scripts are.
+ * Each child, "--validate --list file", checks the files named in the list one
+ * at a time and writes their reports to stderr, in order.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vetsim.h"
+#include "scenario.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
+
+struct scenario_check* scenarioCheck = NULL;
+
+struct validate_job
+{
+	std::string path;				// main.xml
+	struct scenario_check check;
+	int errors;
+	int warnings;
+	std::string report;				// The issue lines
+};
+
+// A child process and the files it checks
+struct validate_child
+{
+	std::vector<size_t> jobs;
+	std::string dir;				// Scratch directory: the list, its output and its report
+	int status;
+	std::string report;
+};
+
+static void
+add_issue(struct scenario_check* check, int severity, int line, const char* format, va_list args)
+{
+	char text[512];
+	size_t len;
+
+	vsnprintf(text, sizeof(text), format, args);
+	len = strlen(text);
+	while (len > 0 && (text[len - 1] == '\n' || text[len - 1] == '\r'))
+	{
+		text[--len] = 0;
+	}
+	check->issues.push_back({ line, severity, text });
+}
+
+/*
+ * FUNCTION: scenario_check_issue
+ *
+ * Report a problem from the parser, to scenarioCheck
+ */
+void
+scenario_check_issue(int severity, int line, const char* format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	add_issue(scenarioCheck, severity, line, format, args);
+	va_end(args);
+}
+
+static void
+issue(struct validate_job* job, int severity, int line, const char* format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	add_issue(&job->check, severity, line, format, args);
+	va_end(args);
+}
+
+// The parser state is global; a process checks one file at a time
+static struct scenario_data*
+parse_file(struct validate_job* job, int* initial_scene, int* sts)
+{
+	std::lock_guard<std::mutex> lock(scenarioParseLock);
+	struct scenario_data* data;
+
+	resetParseState();
+	data = (struct scenario_data*)calloc(1, sizeof(struct scenario_data));
+	parseScenario = data;
+	scenarioCheck = &job->check;
+	*sts = readScenarioFile(job->path.c_str());
+	scenarioCheck = NULL;
+	*initial_scene = parseSceneId;
+	parseScenario = NULL;
+	return (data);
+}
+
+static void
+check_value(struct validate_job* job, struct scenario_trigger* trig, int handle, int value)
+{
+	int min;
+	int max;
+
+	if (getParamLimits(handle, &min, &max) == 0 && (value < min || value > max))
+	{
+		issue(job, ISSUE_ERROR, trig->line, "trigger value %d for %s:%s is outside %d to %d",
+			value, trig->param_class, trig->param_element, min, max);
+	}
+}
+
+static void
+check_trigger(struct validate_job* job, struct scenario_trigger* trig, std::unordered_set<std::string>& events)
+{
+	int handle;
+
+	if (trig->test == TRIGGER_TEST_EVENT)
+	{
+		if (!events.count(trig->param_element))
+		{
+			issue(job, ISSUE_WARNING, trig->line, "event %s is not in <events>", trig->param_element);
+		}
+		return;
+	}
+	if (trig->test == TRIGGER_TEST_EXPR)
+	{
+		std::vector<struct expr_op> code;
+		std::vector<uint64_t> hold;
+		char error[128];
+
+		if (expr_compile(trig->expr, &code, &hold, error, sizeof(error)) != 0)
+		{
+			issue(job, ISSUE_ERROR, trig->line, "trigger expression: %s", error);
+		}
+		return;
+	}
+	if (trig->param_class[0] == 0)
+	{
+		issue(job, ISSUE_ERROR, trig->line, "trigger has no parameter or event");
+		return;
+	}
+	handle = getParamHandle(trig->param_class, trig->param_element);
+	if (handle == PARAM_NONE)
+	{
+		issue(job, ISSUE_ERROR, trig->line, "unknown trigger parameter %s:%s", trig->param_class, trig->param_element);
+		return;
+	}
+	check_value(job, trig, handle, trig->value);
+	if (trig->test == TRIGGER_TEST_INSIDE || trig->test == TRIGGER_TEST_OUTSIDE)
+	{
+		check_value(job, trig, handle, trig->value2);
+	}
+}
+
+static void
+check_target(struct validate_job* job, std::unordered_map<int, struct scenario_scene*>& scenes, int line,
+	const char* what, int target)
+{
+	if (!scenes.count(target))
+	{
+		issue(job, ISSUE_ERROR, line, "%s goes to scene %d, which is not defined", what, target);
+	}
+}
+
+static void
+check_scenes(struct validate_job* job, struct scenario_data* data, int initial)
+{
+	std::unordered_map<int, struct scenario_scene*> scenes;
+	std::unordered_set<std::string> events;
+	std::unordered_set<int> reached;
+	std::vector<int> todo;
+	std::vector<int> next;
+	struct snode* snode;
+	struct snode* tsnode;
+	struct scenario_scene* scene;
+	struct scenario_trigger* trig;
+	struct trigger_group* group;
+	int exits;
+	int count;
+	int id;
+
+	for (snode = data->event_list.next; snode; snode = get_next_llist(snode))
+	{
+		events.insert(((struct scenario_event*)snode)->event_id);
+	}
+	for (snode = data->scene_list.next; snode; snode = get_next_llist(snode))
+	{
+		scene = (struct scenario_scene*)snode;
+		if (scene->id < 0)
+		{
+			issue(job, ISSUE_ERROR, scene->line, "scene ID %d is invalid", scene->id);
+		}
+		auto added = scenes.emplace(scene->id, scene);
+		if (!added.second)
+		{
+			issue(job, ISSUE_ERROR, scene->line, "scene ID %d is already used at line %d",
+				scene->id, added.first->second->line);
+		}
+	}
+	if (scenes.empty())
+	{
+		issue(job, ISSUE_ERROR, 0, "no scenes");
+		return;
+	}
+	if (initial < 0)
+	{
+		issue(job, ISSUE_ERROR, 0, "no initial scene; set <init><scene>");
+	}
+	else if (!scenes.count(initial))
+	{
+		issue(job, ISSUE_ERROR, 0, "initial scene %d is not defined", initial);
+	}
+
+	for (auto& entry : scenes)
+	{
+		scene = entry.second;
+		exits = 0;
+		if (scene->timeout > 0)
+		{
+			check_target(job, scenes, scene->line, "timeout", scene->timeout_scene);
+			exits++;
+		}
+		for (tsnode = scene->trigger_list.next; tsnode; tsnode = get_next_llist(tsnode))
+		{
+			trig = (struct scenario_trigger*)tsnode;
+			check_trigger(job, trig, events);
+			check_target(job, scenes, trig->line, "trigger", trig->scene);
+			exits++;
+		}
+		for (snode = scene->group_list.next; snode; snode = get_next_llist(snode))
+		{
+			group = (struct trigger_group*)snode;
+			count = 0;
+			for (tsnode = group->group_trigger_list.next; tsnode; tsnode = get_next_llist(tsnode))
+			{
+				check_trigger(job, (struct scenario_trigger*)tsnode, events);
+				count++;
+			}
+			if (group->group_triggers_needed > count)
+			{
+				issue(job, ISSUE_ERROR, group->line, "trigger group %d needs %d of %d triggers",
+					group->group_id, group->group_triggers_needed, count);
+			}
+			check_target(job, scenes, group->line, "trigger group", group->scene);
+			exits++;
+		}
+		if (scene->id > 0 && exits == 0 && scenes.size() > 1)
+		{
+			// A one scene scenario is left to the instructor; otherwise this is a dead end
+			issue(job, ISSUE_WARNING, scene->line, "scene %d has no triggers or timeout", scene->id);
+		}
+		else if (scene->id == 0 && exits != 0)
+		{
+			issue(job, ISSUE_WARNING, scene->line, "end scene %d has triggers or a timeout, which are not used", scene->id);
+		}
+	}
+
+	// Scenes the initial scene leads to
+	if (!scenes.count(initial))
+	{
+		return;
+	}
+	todo.push_back(initial);
+	reached.insert(initial);
+	while (!todo.empty())
+	{
+		scene = scenes[todo.back()];
+		todo.pop_back();
+		next.clear();
+		if (scene->timeout > 0)
+		{
+			next.push_back(scene->timeout_scene);
+		}
+		for (tsnode = scene->trigger_list.next; tsnode; tsnode = get_next_llist(tsnode))
+		{
+			next.push_back(((struct scenario_trigger*)tsnode)->scene);
+		}
+		for (snode = scene->group_list.next; snode; snode = get_next_llist(snode))
+		{
+			next.push_back(((struct trigger_group*)snode)->scene);
+		}
+		for (int target : next)
+		{
+			if (scenes.count(target) && reached.insert(target).second)
+			{
+				todo.push_back(target);
+			}
+		}
+	}
+	for (auto& entry : scenes)
+	{
+		id = entry.first;
+		if (!reached.count(id))
+		{
+			issue(job, ISSUE_WARNING, entry.second->line, "scene %d is not reached from the initial scene %d", id, initial);
+		}
+	}
+}
+
+static void
+check_files(struct validate_job* job)
+{
+	std::filesystem::path dir = std::filesystem::path(job->path).parent_path();
+	std::unordered_set<std::string> seen;
+	std::error_code ec;
+	std::string rel;
+
+	for (auto& ref : job->check.files)
+	{
+		rel = ref.dir + "/" + ref.name;
+		if (!seen.insert(rel).second)
+		{
+			continue;
+		}
+		if (!std::filesystem::is_regular_file(dir / ref.dir / ref.name, ec))
+		{
+			issue(job, ISSUE_WARNING, ref.line, "file %s is not in the scenario directory", rel.c_str());
+		}
+	}
+}
+
+static void
+validate_one(struct validate_job* job)
+{
+	struct scenario_data* data;
+	int initial;
+	int sts;
+
+	data = parse_file(job, &initial, &sts);
+	// A file that is not well formed stops the parse, so the rest would mislead
+	if (sts == 0)
+	{
+		check_scenes(job, data, initial);
+		check_files(job);
+	}
+	scenario_free(data);
+
+	std::stable_sort(job->check.issues.begin(), job->check.issues.end(),
+		[](const struct scenario_issue& a, const struct scenario_issue& b) { return (a.line < b.line); });
+	job->errors = 0;
+	job->warnings = 0;
+	for (auto& is : job->check.issues)
+	{
+		if (is.severity == ISSUE_ERROR)
+		{
+			job->errors++;
+		}
+		else
+		{
+			job->warnings++;
+		}
+	}
+}
+
+// A main.xml, a scenario directory, or a directory of scenario directories
+static int
+add_path(std::vector<std::string>& files, const char* arg)
+{
+	std::filesystem::path path(arg);
+	std::vector<std::string> found;
+	std::error_code ec;
+
+	if (std::filesystem::is_regular_file(path, ec))
+	{
+		files.push_back(path.string());
+		return (0);
+	}
+	if (!std::filesystem::is_directory(path, ec))
+	{
+		fprintf(stderr, "%s: not found\n", arg);
+		return (-1);
+	}
+	if (std::filesystem::is_regular_file(path / "main.xml", ec))
+	{
+		files.push_back((path / "main.xml").string());
+		return (0);
+	}
+	for (const auto& entry : std::filesystem::directory_iterator(path, ec))
+	{
+		if (entry.is_directory(ec) && std::filesystem::is_regular_file(entry.path() / "main.xml", ec))
+		{
+			found.push_back((entry.path() / "main.xml").string());
+		}
+	}
+	if (found.empty())
+	{
+		fprintf(stderr, "%s: no scenarios\n", arg);
+		return (-1);
+	}
+	std::sort(found.begin(), found.end());
+	files.insert(files.end(), found.begin(), found.end());
+	return (0);
+}
+
+// The issues as "path:line: error: text" lines
+static std::string
+format_issues(struct validate_job* job)
+{
+	std::string out;
+	char line[32];
+
+	for (auto& is : job->check.issues)
+	{
+		out += job->path;
+		if (is.line > 0)
+		{
+			snprintf(line, sizeof(line), ":%d", is.line);
+			out += line;
+		}
+		out += (is.severity == ISSUE_ERROR ? ": error: " : ": warning: ");
+		out += is.text;
+		out += "\n";
+	}
+	return (out);
+}
+
+static std::string
+read_file(const std::string& path)
+{
+	std::ifstream in(path, std::ios::binary);
+	std::ostringstream text;
+
+	text << in.rdbuf();
+	return (text.str());
+}
+
+// Check the child's files in a child process, with the list, its output and its
+// report in child->dir
+static void
+spawn_child(const char* program, struct validate_child* child, std::vector<struct validate_job>& jobs)
+{
+	std::string list;
+	std::string command;
+	std::error_code ec;
+
+	std::filesystem::create_directories(child->dir, ec);
+	list = child->dir + PATH_SEP "files.txt";
+	{
+		std::ofstream out(list, std::ios::binary);
+
+		for (size_t j : child->jobs)
+		{
+			out << jobs[j].path << "\n";
+		}
+	}
+	command = "\"" + std::string(program) + "\" --validate --list \"" + list + "\"" +
+		" > \"" + child->dir + PATH_SEP "output.txt\" 2> \"" + child->dir + PATH_SEP "report.txt\"";
+#ifdef _WIN32
+	command = "\"" + command + "\"";	// cmd /c strips the outer quotes
+#endif
+	child->status = std::system(command.c_str());
+	child->report = read_file(child->dir + PATH_SEP "report.txt");
+}
+
+// Hand a child's report lines to its files and count them by severity. The
+// files are reported in list order and each line starts with "path:".
+static void
+split_report(struct validate_child* child, std::vector<struct validate_job>& jobs)
+{
+	std::istringstream in(child->report);
+	struct validate_job* job;
+	std::string line;
+	size_t k = 0;
+	size_t pos;
+	int errors = 0;
+
+	while (std::getline(in, line))
+	{
+		while (k + 1 < child->jobs.size() && line.compare(0, jobs[child->jobs[k]].path.size() + 1,
+			jobs[child->jobs[k]].path + ":") != 0)
+		{
+			k++;
+		}
+		job = &jobs[child->jobs[k]];
+		job->report += line + "\n";
+		pos = line.find(": ", job->path.size());
+		if (pos != std::string::npos && line.compare(pos, 9, ": error: ") == 0)
+		{
+			job->errors++;
+		}
+		else if (pos != std::string::npos && line.compare(pos, 11, ": warning: ") == 0)
+		{
+			job->warnings++;
+		}
+	}
+	for (size_t j : child->jobs)
+	{
+		errors += jobs[j].errors;
+	}
+	job = &jobs[child->jobs[0]];
+	if (child->status != 0 && errors == 0)
+	{
+		job->report += job->path + ": error: check failed (status " + std::to_string(child->status) + ")\n";
+		job->errors++;
+	}
+}
+
+// The child's side of --list: check each file named in the list
+static int
+validate_list(const char* list)
+{
+	std::ifstream in(list);
+	struct validate_job job;
+	std::string path;
+	int failed = 0;
+
+	while (std::getline(in, path))
+	{
+		if (path.empty())
+		{
+			continue;
+		}
+		job = validate_job();
+		job.path = path;
+		validate_one(&job);
+		fprintf(stderr, "%s", format_issues(&job).c_str());
+		fflush(stderr);
+		if (job.errors)
+		{
+			failed = 1;
+		}
+	}
+	return (failed);
+}
+
+/*
+ * FUNCTION: scenario_validate_main
+ *
+ * ARGUMENTS:
+ *		program		- argv[0], to start the child processes
+ *		argc, argv	- The arguments after --validate
+ *
+ * RETURNS:
+ *		0 if no file has an error, else 1
+ */
+int
+scenario_validate_main(const char* program, int argc, char* argv[])
+{
+	std::vector<std::string> files;
+	std::vector<struct validate_job> jobs;
+	std::vector<struct validate_child> children;
+	std::vector<std::thread> workers;
+	std::filesystem::path scratch;
+	std::error_code ec;
+	char library[sizeof(localConfig.html_path) + 16];
+	unsigned int count = 0;
+	int failed = 0;
+	int errors = 0;
+	int warnings = 0;
+	int i;
+
+	initSHM();
+	if (argc >= 2 && strcmp(argv[0], "--list") == 0)
+	{
+		return (validate_list(argv[1]));
+	}
+	if (argc < 1 || (argc == 2 && strcmp(argv[0], "-j") == 0))
+	{
+		snprintf(library, sizeof(library), "%s" PATH_SEP "scenarios", localConfig.html_path);
+		failed = (add_path(files, library) != 0);
+	}
+	for (i = 0; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+		{
+			count = (unsigned int)atoi(argv[++i]);
+		}
+		else if (add_path(files, argv[i]) != 0)
+		{
+			failed = 1;
+		}
+	}
+	if (files.empty())
+	{
+		return (1);
+	}
+
+	jobs.resize(files.size());
+	for (i = 0; i < (int)files.size(); i++)
+	{
+		jobs[i].path = files[i];
+	}
+	if (count == 0)
+	{
+		count = std::thread::hardware_concurrency();
+	}
+	count = std::min(count, (unsigned int)jobs.size());
+	if (count <= 1)
+	{
+		for (auto& job : jobs)
+		{
+			validate_one(&job);
+			job.report = format_issues(&job);
+		}
+	}
+	else
+	{
+		scratch = std::filesystem::temp_directory_path(ec) / ("vetsim-validate-" + std::to_string(clock_real_nsec()));
+		children.resize(count);
+		for (i = 0; i < (int)jobs.size(); i++)
+		{
+			children[i % count].jobs.push_back(i);
+		}
+		for (i = 0; i < (int)count; i++)
+		{
+			children[i].dir = (scratch / std::to_string(i)).string();
+			workers.emplace_back([&children, &jobs, program, i]() { spawn_child(program, &children[i], jobs); });
+		}
+		for (auto& w : workers)
+		{
+			w.join();
+		}
+		for (auto& child : children)
+		{
+			split_report(&child, jobs);
+		}
+		std::filesystem::remove_all(scratch, ec);
+	}
+
+	for (auto& job : jobs)
+	{
+		printf("%s", job.report.c_str());
+		errors += job.errors;
+		warnings += job.warnings;
+		if (job.errors)
+		{
+			failed = 1;
+		}
+	}
+	printf("%d scenarios checked: %d errors, %d warnings\n", (int)jobs.size(), errors, warnings);
+	return (failed ? 1 : 0);
+}
@@ -0,0 +1,265 @@
+/*
+ * scenario_watch.cpp
+ *
+ * Watch the running scenario's main.xml, so an edit can be reloaded into the
+ * running scenario. On Linux the scenario directory is watched with inotify;
+ * elsewhere, or if inotify is not available, the file is polled.
+ *
+ * When the file's size or modification time changes, the watcher task parses and
+ * compiles it aside, under scenarioParseLock, and leaves the result for the
+ * scenario loop with NOTIFY_SCENARIO. The loop only swaps it in, so it does not
+ * stop to parse. When headless there is no watcher task and the loop compares
+ * the file on each pass, and parses it itself.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vetsim.h"
+#include "scenario.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+static std::atomic<int> watchGen(0);			// Bumped to stop the watcher task
+static bool watchActive = false;
+static std::string watchName;
+static struct scenario_file_key watchKey;		// As last parsed, when headless
+static std::mutex watchLock;					// Guards watchReload and bumps of watchGen
+static struct scenario_reload* watchReload = NULL;	// Parsed, for the scenario loop to take
+
+static bool
+watch_current(int gen)
+{
+	return (watchGen.load() == gen && task_running());
+}
+
+// If main.xml no longer matches key, parse it and leave the result for the
+// scenario loop, in place of any it has not taken. Returns true if it did.
+static bool
+watch_parse(const std::string& name, struct scenario_file_key* key, int gen)
+{
+	struct scenario_reload* reload;
+	struct scenario_file_key now;
+
+	if (!scenario_file_key(name.c_str(), &now) || (now.size == key->size && now.mtime == key->mtime))
+	{
+		return (false);
+	}
+	*key = now;
+	reload = new scenario_reload;
+	reload->key = now;
+	{
+		std::lock_guard<std::mutex> parseHold(scenarioParseLock);
+
+		(void)scenario_parse(name.c_str(), &reload->data, &reload->compiled, &reload->start_scene_id,
+			reload->error, sizeof(reload->error));
+	}
+	{
+		std::lock_guard<std::mutex> lock(watchLock);
+
+		if (watchGen.load() != gen)
+		{
+			scenario_watch_free(reload);
+			return (false);
+		}
+		std::swap(reload, watchReload);
+	}
+	scenario_watch_free(reload);
+	notify_signal(NOTIFY_SCENARIO);
+	return (true);
+}
+
+// Poll the file's size and modification time
+static void
+watch_poll(std::string name, struct scenario_file_key key, int gen)
+{
+	while (watch_current(gen))
+	{
+		sim_sleep_ms(SCENARIO_WATCH_POLL_MSEC);
+		(void)watch_parse(name, &key, gen);
+	}
+}
+
+#ifdef __linux__
+// Watch the directory rather than the file, since an editor may save by writing
+// a new file and renaming it over main.xml.
+static void
+watch_inotify(std::string name, struct scenario_file_key key, int gen)
+{
+	alignas(struct inotify_event) char buf[4096];
+	struct inotify_event* ev;
+	struct pollfd pfd;
+	std::string dir;
+	ssize_t len;
+	ssize_t off;
+	bool hit;
+	int fd;
+
+	dir = key.path.substr(0, key.path.find_last_of('/'));
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd >= 0 && inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		close(fd);
+		fd = -1;
+	}
+	if (fd < 0)
+	{
+		watch_poll(name, key, gen);
+		return;
+	}
+	while (watch_current(gen))
+	{
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, SCENARIO_WATCH_POLL_MSEC) <= 0)
+		{
+			continue;
+		}
+		hit = false;
+		while ((len = read(fd, buf, sizeof(buf))) > 0)
+		{
+			for (off = 0; off < len; off += sizeof(struct inotify_event) + ev->len)
+			{
+				ev = (struct inotify_event*)(buf + off);
+				if (ev->len && strcmp(ev->name, "main.xml") == 0)
+				{
+					hit = true;
+				}
+			}
+		}
+		if (hit)
+		{
+			(void)watch_parse(name, &key, gen);
+		}
+	}
+	close(fd);
+}
+#endif
+
+/*
+ * FUNCTION: scenario_watch_start
+ *
+ * ARGUMENTS:
+ *		name	- Scenario directory name
+ *
+ * Start watching the scenario's main.xml, as it is now. Stops any earlier watch.
+ */
+void
+scenario_watch_start(const char* name)
+{
+	int gen;
+
+	scenario_watch_stop();
+	watchName = name;
+	if (!scenario_file_key(name, &watchKey))
+	{
+		return;
+	}
+	watchActive = true;
+	if (headless)
+	{
+		return;
+	}
+	gen = watchGen.load();
+#ifdef __linux__
+	(void)start_task("scenarioWatch", [name = watchName, key = watchKey, gen]() { watch_inotify(name, key, gen); });
+#else
+	(void)start_task("scenarioWatch", [name = watchName, key = watchKey, gen]() { watch_poll(name, key, gen); });
+#endif
+}
+
+/*
+ * FUNCTION: scenario_watch_stop
+ *
+ * Stop watching, and drop a parse the scenario loop has not taken. The watcher
+ * task exits within SCENARIO_WATCH_POLL_MSEC.
+ */
+void
+scenario_watch_stop(void)
+{
+	struct scenario_reload* reload = NULL;
+
+	if (!watchActive)
+	{
+		return;
+	}
+	watchActive = false;
+	{
+		std::lock_guard<std::mutex> lock(watchLock);
+
+		watchGen++;
+		std::swap(reload, watchReload);
+	}
+	scenario_watch_free(reload);
+}
+
+/*
+ * FUNCTION: scenario_watch_take
+ *
+ * The parse of an edited main.xml, if there is one the scenario loop has not
+ * taken yet. Called from the scenario loop. When headless the file is compared,
+ * and parsed if it has changed, here.
+ *
+ * RETURNS:
+ *		The parse, which the caller then owns and releases with
+ *		scenario_watch_free, or NULL
+ */
+struct scenario_reload*
+scenario_watch_take(void)
+{
+	struct scenario_reload* reload = NULL;
+
+	if (!watchActive)
+	{
+		return (NULL);
+	}
+	if (headless)
+	{
+		(void)watch_parse(watchName, &watchKey, watchGen.load());
+	}
+	std::lock_guard<std::mutex> lock(watchLock);
+
+	std::swap(reload, watchReload);
+	return (reload);
+}
+
+/*
+ * FUNCTION: scenario_watch_free
+ *
+ * ARGUMENTS:
+ *		reload	- A parse from scenario_watch_take, or NULL
+ *
+ * Free the parse and whatever of it the caller has not taken over.
+ */
+void
+scenario_watch_free(struct scenario_reload* reload)
+{
+	if (!reload)
+	{
+		return;
+	}
+	scenario_free(reload->data);
+	scenario_compile_free(&reload->compiled);
+	delete reload;
+}
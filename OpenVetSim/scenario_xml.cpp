@@ -30,12 +30,18 @@
 #include "vetsim.h"
 #include "scenario.h"
 #include "llist.h"
-#include "XMLRead.h"
+#include "XMLPull.h"
 
-XMLRead xmlr;
+XMLPull xmlp;
 
-extern int current_scene_id;
-struct xml_level xmlLevels[10];
+#define XML_MAX_LEVELS	10
+#define XML_VALUE_SIZE	16536
+#define PARSE_ERROR_SIZE	(XML_PULL_ERROR_SIZE + 32)	// An XMLPull error and its prefix
+
+// The hash rules out all but the matching name, which strcmp then confirms
+#define XML_NAME_IS(lvl, s)	(xmlLevels[lvl].hash == XML_HASH(s) && strcmp(xmlLevels[lvl].name, s) == 0)
+
+struct xml_level xmlLevels[XML_MAX_LEVELS];
 extern int xml_current_level;
 
 extern const char* xml_filename;
@@ -77,23 +83,30 @@ const char* parse_header_states[] =
 
 const char* trigger_tests[] =
 {
-	"EQ", "LTE", "LT", "GTE", "GT", "INSIDE", "OUTSIDE", "EVENT"
+	"EQ", "LTE", "LT", "GTE", "GT", "INSIDE", "OUTSIDE", "EVENT", "EXPR"
 };
 
 const char* trigger_tests_sym[] =
 {
-	"==", "<=", "<", ">=", ">", "", "", ""
+	"==", "<=", "<", ">=", ">", "", "", "", ""
 };
 
 char current_event_catagory[NORMAL_STRING_SIZE + 2];
 char current_event_title[NORMAL_STRING_SIZE + 2];
 
 extern struct scenario_scene* current_scene;
-extern struct scenario_data* scenario;
+// The parser's output, under scenarioParseLock: the scenario it fills, its initial
+// scene and the last error. These are apart from the running scenario's globals,
+// so a file may be parsed while a scenario runs.
+struct scenario_data* parseScenario;
+int parseSceneId = -1;
+char parseError[PARSE_ERROR_SIZE];
+
 struct scenario_scene* new_scene;
 struct scenario_trigger* new_trigger;
 struct trigger_group* new_trigger_group;
 struct scenario_event* new_event;
+static struct instructor initScratch;	// The <init> being parsed, for initPack()
 
 /**
  *  appendToParseLog
@@ -105,11 +118,11 @@ void
 appendToParseLog(char* str)
 {
 	::std::wstring wideStr;
-	int convertResult = MultiByteToWideChar(CP_UTF8, 0, simmgr_shm->status.scenario.error_message, (int)strlen(simmgr_shm->status.scenario.error_message), NULL, 0);
+	int convertResult = MultiByteToWideChar(CP_UTF8, 0, str, (int)strlen(str), NULL, 0);
 	if (convertResult > 0)
 	{
 		wideStr.resize(convertResult + 10);
-		convertResult = MultiByteToWideChar(CP_UTF8, 0, simmgr_shm->status.scenario.error_message, (int)strlen(simmgr_shm->status.scenario.error_message), &wideStr[0], (int)wideStr.size());
+		convertResult = MultiByteToWideChar(CP_UTF8, 0, str, (int)strlen(str), &wideStr[0], (int)wideStr.size());
 		parseLog.append(wideStr);
 	}
 }
@@ -129,7 +142,7 @@ scanForDuplicateScene(int sceneId)
 	struct scenario_scene* scene;
 	int match = 0;
 
-	snode = scenario->scene_list.next;
+	snode = parseScenario->scene_list.next;
 
 	while (snode)
 	{
@@ -144,16 +157,16 @@ scanForDuplicateScene(int sceneId)
 	if (match < 1)
 	{
 		printf("ERROR: Scene ID %d not found\n", sceneId);
-		snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: Scene ID %d not found\n", sceneId);
-		appendToParseLog(simmgr_shm->status.scenario.error_message);
+		snprintf(parseError, sizeof(parseError), "ERROR: Scene ID %d not found\n", sceneId);
+		appendToParseLog(parseError);
 
 		errCount++;
 	}
 	else if (match > 1)
 	{
 		printf("ERROR: duplicate check, Scene ID %d found %d times\n", sceneId, match);
-		snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: DUPLICATE Scene ID %d found %d times\n", sceneId, match);
-		appendToParseLog(simmgr_shm->status.scenario.error_message);
+		snprintf(parseError, sizeof(parseError), "ERROR: DUPLICATE Scene ID %d found %d times\n", sceneId, match);
+		appendToParseLog(parseError);
 		errCount++;
 	}
 	return (match);
@@ -172,7 +185,7 @@ scanForDuplicateEvent(char* eventId)
 	struct scenario_event* event;
 	int match = 0;
 
-	snode = scenario->event_list.next;
+	snode = parseScenario->event_list.next;
 
 	while (snode)
 	{
@@ -186,15 +199,15 @@ scanForDuplicateEvent(char* eventId)
 	if (match < 1)
 	{
 		printf("ERROR: Event ID %s not found\n", eventId);
-		snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: Event ID %s not found\n", eventId);
-		appendToParseLog(simmgr_shm->status.scenario.error_message);
+		snprintf(parseError, sizeof(parseError), "ERROR: Event ID %s not found\n", eventId);
+		appendToParseLog(parseError);
 		errCount++;
 	}
 	else if (match > 1)
 	{
 		printf("ERROR: duplicate check, Event ID %s found %d times\n", eventId, match);
-		snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: duplicate check, Event ID %s found %d times\n", eventId, match);
-		appendToParseLog(simmgr_shm->status.scenario.error_message);
+		snprintf(parseError, sizeof(parseError), "ERROR: duplicate check, Event ID %s found %d times\n", eventId, match);
+		appendToParseLog(parseError);
 		errCount++;
 	}
 	return (match);
@@ -220,7 +233,7 @@ showScenes()
 	int tcount;
 	int timeout = 0;
 
-	snode = scenario->scene_list.next;
+	snode = parseScenario->scene_list.next;
 
 	while (snode)
 	{
@@ -230,9 +243,9 @@ showScenes()
 		//{
 		//	printf("ERROR: Scene ID %d is invalid\n",
 		//		scene->id);
-		//	snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: Scene ID %d is invalid\n",
+		//	snprintf(parseError, sizeof(parseError), "ERROR: Scene ID %d is invalid\n",
 		//		scene->id);
-		//	appendToParseLog(simmgr_shm->status.scenario.error_message);
+		//	appendToParseLog(parseError);
 		//	errCount++;
 		//}
 		duplicates = scanForDuplicateScene(scene->id);
@@ -240,9 +253,9 @@ showScenes()
 		{
 			printf("ERROR: Scene ID %d has %d duplicate entries\n",
 				scene->id, duplicates);
-			snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: Scene ID %d has %d entries\n",
+			snprintf(parseError, sizeof(parseError), "ERROR: Scene ID %d has %d entries\n",
 				scene->id, duplicates);
-			appendToParseLog(simmgr_shm->status.scenario.error_message);
+			appendToParseLog(parseError);
 			errCount++;
 		}
 		tcount = 0;
@@ -306,25 +319,25 @@ showScenes()
 		{
 			printf("ERROR: Scene ID %d has no trigger/timeout events\n",
 				scene->id);
-			snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: Scene ID %d has no trigger/timeout events\n",
+			snprintf(parseError, sizeof(parseError), "ERROR: Scene ID %d has no trigger/timeout events\n",
 				scene->id );
-			appendToParseLog(simmgr_shm->status.scenario.error_message);
+			appendToParseLog(parseError);
 			errCount++;
 		}
 		if ((scene->id == 0) && (tcount != 0) && (timeout != 0))
 		{
 			printf("ERROR: End Scene ID %d has %d triggers %d timeouts. Should be none.\n",
 				scene->id, tcount, timeout);
-			snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: End Scene ID %d has %d triggers %d timeouts. Should be none.\n",
+			snprintf(parseError, sizeof(parseError), "ERROR: End Scene ID %d has %d triggers %d timeouts. Should be none.\n",
 				scene->id, tcount, timeout);
-			appendToParseLog(simmgr_shm->status.scenario.error_message);
+			appendToParseLog(parseError);
 			errCount++;
 		}
 		*/
 		snode = get_next_llist(snode);
 	}
 	printf("Events:\n");
-	e_snode = scenario->event_list.next;
+	e_snode = parseScenario->event_list.next;
 	while (e_snode)
 	{
 		event = (struct scenario_event*)e_snode;
@@ -335,9 +348,9 @@ showScenes()
 		{
 			printf("ERROR: Event ID %s has %d entries\n",
 				event->event_id, duplicates);
-			snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: Event ID %s has %d entries\n",
+			snprintf(parseError, sizeof(parseError), "ERROR: Event ID %s has %d entries\n",
 				event->event_id, duplicates);
-			appendToParseLog(simmgr_shm->status.scenario.error_message);
+			appendToParseLog(parseError);
 			errCount++;
 		}
 		e_snode = get_next_llist(e_snode);
@@ -363,21 +376,21 @@ validateScenes()
 	int tcount;
 	int timeout = 0;
 
-	snode = scenario->scene_list.next;
+	snode = parseScenario->scene_list.next;
 
 	while (snode)
 	{
 		scene = (struct scenario_scene*)snode;
 		if (scene->id < 0)
 		{
-			snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "Scenario ERROR: Scene ID % d is invalid\n",
+			snprintf(parseError, sizeof(parseError), "Scenario ERROR: Scene ID % d is invalid\n",
 				scene->id);
 			return (-1);
 		}
 		duplicates = scanForDuplicateScene(scene->id);
 		if (duplicates != 1)
 		{
-			snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "Scenario ERROR: Scene ID %d has duplicates in XML file\n",
+			snprintf(parseError, sizeof(parseError), "Scenario ERROR: Scene ID %d has duplicates in XML file\n",
 				scene->id);
 			return (-1);
 		}
@@ -409,24 +422,24 @@ validateScenes()
 		{
 			printf("ERROR: Scene ID %d has no trigger/timeout events\n",
 				scene->id);
-			snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: Event ID %d has no trigger/timeout events\n",
+			snprintf(parseError, sizeof(parseError), "ERROR: Event ID %d has no trigger/timeout events\n",
 				scene->id);
-			appendToParseLog(simmgr_shm->status.scenario.error_message);
+			appendToParseLog(parseError);
 			errCount++;
 		}
 		if ((scene->id == 0) && (tcount != 0) && (timeout != 0))
 		{
 			printf("ERROR: End Scene ID %d has %d triggers %d timeouts. Should be none.\n",
 				scene->id, tcount, timeout);
-			snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: End Scene ID %d has %d triggers %d timeouts. Should be none.\n",
+			snprintf(parseError, sizeof(parseError), "ERROR: End Scene ID %d has %d triggers %d timeouts. Should be none.\n",
 				scene->id, tcount, timeout);
-			appendToParseLog(simmgr_shm->status.scenario.error_message);
+			appendToParseLog(parseError);
 			errCount++;
 		}
 		snode = get_next_llist(snode);
 	}
 	printf("Events:\n");
-	e_snode = scenario->event_list.next;
+	e_snode = parseScenario->event_list.next;
 	while (e_snode)
 	{
 		event = (struct scenario_event*)e_snode;
@@ -444,9 +457,95 @@ validateScenes()
 	return (NULL);
 }
 
+/*
+ * For --validate: check a parameter that the scenario init or a scene init sets,
+ * and note the files named for images, media and vocals. sts is from the parse
+ * function, 1 for an unknown element.
+ */
+static void
+checkValue(int sts, const char* value)
+{
+	const char* section;
+	const char* elem;
+	int initLevel;
+	int handle;
+	int min;
+	int max;
+	int v;
+
+	if (xml_current_level < 1)
+	{
+		return;
+	}
+	section = xmlLevels[xml_current_level - 1].name;
+	elem = xmlLevels[xml_current_level].name;
+	initLevel = 0;
+	if (parse_state == PARSE_STATE_INIT && parse_init_state != PARSE_INIT_STATE_NONE &&
+		parse_init_state != PARSE_INIT_STATE_SCENE && parse_init_state != PARSE_INIT_STATE_TELESIM)
+	{
+		initLevel = 3;
+	}
+	else if (parse_state == PARSE_STATE_SCENE && parse_scene_state >= PARSE_SCENE_STATE_INIT_CARDIAC &&
+		parse_scene_state <= PARSE_SCENE_STATE_INIT_CPR)
+	{
+		initLevel = 4;
+	}
+
+	if (initLevel && xml_current_level == initLevel)
+	{
+		if (sts > 0)
+		{
+			scenario_check_issue(ISSUE_WARNING, xmlp.line(), "unknown parameter %s:%s is ignored", section, elem);
+			return;
+		}
+		handle = getParamHandle(section, elem);
+		if (handle != PARAM_NONE && getParamLimits(handle, &min, &max) == 0)
+		{
+			v = atoi(value);
+			if (v < min || v > max)
+			{
+				scenario_check_issue(ISSUE_ERROR, xmlp.line(), "%s:%s is %d, outside %d to %d", section, elem, v, min, max);
+			}
+		}
+		if (strcmp(elem, "filename") == 0 && value[0] &&
+			(strcmp(section, "vocals") == 0 || strcmp(section, "media") == 0))
+		{
+			scenarioCheck->files.push_back({ xmlp.line(), section, value });
+		}
+	}
+	else if (parse_state == PARSE_STATE_NONE && xml_current_level == 3 && XML_NAME_IS(3, "filename") && value[0])
+	{
+		// The file lists in <vocals> and <media>, and the <profile> avatar
+		if (XML_NAME_IS(1, "vocals") || XML_NAME_IS(1, "media"))
+		{
+			scenarioCheck->files.push_back({ xmlp.line(), xmlLevels[1].name, value });
+		}
+		else if (XML_NAME_IS(1, "profile") && XML_NAME_IS(2, "avatar"))
+		{
+			scenarioCheck->files.push_back({ xmlp.line(), "images", value });
+		}
+	}
+}
+
+/**
+ * saveTriggerExpr:
+ * @value: Expression text
+ *
+ * Set the new trigger to a compound expression. It is compiled with the scenario.
+*/
+static void
+saveTriggerExpr(const char* value)
+{
+	if (strlen(value) > TRIGGER_EXPR_LENGTH && scenarioCheck)
+	{
+		scenario_check_issue(ISSUE_ERROR, xmlp.line(), "trigger expression is longer than %d characters", TRIGGER_EXPR_LENGTH);
+	}
+	snprintf(new_trigger->expr, TRIGGER_EXPR_LENGTH + 1, "%s", value);
+	new_trigger->test = TRIGGER_TEST_EXPR;
+}
+
 /**
  * saveData:
- * @xmlName: name of the entry
  * @xmlValue: Text data to convert and save in structure
  *
  * Take the current Text entry and save as appropriate in the currently
@@ -454,9 +553,8 @@ validateScenes()
 */
 
 static void
-saveData(const char* xmlName, const char* xmlValue)
+saveData(const char* xmlValue)
 {
-	char* name = (char*)xmlName;
 	char* value = (char*)xmlValue;
 	int sts = 0;
 	int i;
@@ -487,70 +585,68 @@ saveData(const char* xmlName, const char* xmlValue)
 		case PARSE_INIT_STATE_CARDIAC:
 			if (xml_current_level == 3)
 			{
-				sts = cardiac_parse(xmlLevels[xml_current_level].name, value, &scenario->initParams.cardiac);
+				sts = cardiac_parse(xmlLevels[xml_current_level].name, value, &initScratch.cardiac, &initScratch.dirty[II_CARDIAC]);
 			}
 			break;
 		case PARSE_INIT_STATE_RESPIRATION:
 			if (xml_current_level == 3)
 			{
-				sts = respiration_parse(xmlLevels[xml_current_level].name, value, &scenario->initParams.respiration);
+				sts = respiration_parse(xmlLevels[xml_current_level].name, value, &initScratch.respiration, &initScratch.dirty[II_RESPIRATION]);
 			}
 			break;
 		case PARSE_INIT_STATE_GENERAL:
 			if (xml_current_level == 3)
 			{
-				sts = general_parse(xmlLevels[xml_current_level].name, value, &scenario->initParams.general);
+				sts = general_parse(xmlLevels[xml_current_level].name, value, &initScratch.general, &initScratch.dirty[II_GENERAL]);
 			}
 			break;
 		case PARSE_INIT_STATE_TELESIM:
 			if (xml_current_level == 3)
 			{
-				sts = telesim_parse(xmlLevels[xml_current_level].name, value, &scenario->initParams.telesim);
+				sts = telesim_parse(xmlLevels[xml_current_level].name, value, &initScratch.telesim, &initScratch.dirty[II_TELESIM]);
 			}
 			else if (xml_current_level == 4)
 			{
 				sprintf_s(complex, 1024, "%s:%s", xmlLevels[3].name, value);
-				sts = telesim_parse(xmlLevels[xml_current_level].name, complex, &scenario->initParams.telesim);
+				sts = telesim_parse(xmlLevels[xml_current_level].name, complex, &initScratch.telesim, &initScratch.dirty[II_TELESIM]);
 			}
 			break;
 		case PARSE_INIT_STATE_VOCALS:
 			if (xml_current_level == 3)
 			{
-				sts = vocals_parse(xmlLevels[xml_current_level].name, value, &scenario->initParams.vocals);
+				sts = vocals_parse(xmlLevels[xml_current_level].name, value, &initScratch.vocals, &initScratch.dirty[II_MEDIA]);
 			}
 			break;
 		case PARSE_INIT_STATE_MEDIA:
 			if (xml_current_level == 3)
 			{
-				sts = media_parse(xmlLevels[xml_current_level].name, value, &scenario->initParams.media);
+				sts = media_parse(xmlLevels[xml_current_level].name, value, &initScratch.media, &initScratch.dirty[II_MEDIA]);
 			}
 			break;
 		case PARSE_INIT_STATE_CPR:
 			if (xml_current_level == 3)
 			{
-				sts = cpr_parse(xmlLevels[xml_current_level].name, value, &scenario->initParams.cpr);
+				sts = cpr_parse(xmlLevels[xml_current_level].name, value, &initScratch.cpr, &initScratch.dirty[II_CPR]);
 			}
 			break;
 		case PARSE_INIT_STATE_SCENE:
 			if ((xml_current_level == 2) &&
-				(strcmp(xmlLevels[xml_current_level].name, "initial_scene") == 0))
+				(XML_NAME_IS(xml_current_level, "initial_scene")))
 			{
-				simmgr_shm->status.scenario.scene_id = atoi(value);
-				current_scene_id = simmgr_shm->status.scenario.scene_id;
+				parseSceneId = atoi(value);
 				if (verbose)
 				{
-					printf("Set Initial Scene to ID %d\n", current_scene_id);
+					printf("Set Initial Scene to ID %d\n", parseSceneId);
 				}
 				sts = 0;
 			}
 			else if ((xml_current_level == 2) &&
-				(strcmp(xmlLevels[xml_current_level].name, "scene") == 0))
+				(XML_NAME_IS(xml_current_level, "scene")))
 			{
-				simmgr_shm->status.scenario.scene_id = atoi(value);
-				current_scene_id = simmgr_shm->status.scenario.scene_id;
+				parseSceneId = atoi(value);
 				if (verbose)
 				{
-					printf("Set Scene to ID %d\n", current_scene_id);
+					printf("Set Scene to ID %d\n", parseSceneId);
 				}
 				sts = 0;
 			}
@@ -573,7 +669,7 @@ saveData(const char* xmlName, const char* xmlValue)
 
 			if (xml_current_level == 2)
 			{
-				if (strcmp(xmlLevels[2].name, "id") == 0)
+				if (XML_NAME_IS(2, "id"))
 				{
 					new_scene->id = atoi(value);
 					if (verbose)
@@ -581,18 +677,22 @@ saveData(const char* xmlName, const char* xmlValue)
 						printf("Set Scene ID to %d\n", new_scene->id);
 					}
 				}
-				else if (strcmp(xmlLevels[2].name, "triggers_needed") == 0)
+				else if (XML_NAME_IS(2, "triggers_needed"))
 				{
-					snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "ERROR: In Scene %d, 'triggers_needed' found.\n",
+					snprintf(parseError, sizeof(parseError), "ERROR: In Scene %d, 'triggers_needed' found.\n",
 						new_scene->id);
-					appendToParseLog(simmgr_shm->status.scenario.error_message);
+					appendToParseLog(parseError);
 					appendToParseLog((char*)"See 'https://vetsim.net/groupTriggers.php'\n");
 					errCount++;
+					if (scenarioCheck)
+					{
+						scenario_check_issue(ISSUE_ERROR, xmlp.line(), "'triggers_needed' is replaced by trigger groups");
+					}
 					printf("Error Triggers Needed found.");
 					//new_scene->triggers_needed = atoi(value);
 					//printf("Set Triggers Needed to %d\n", new_scene->triggers_needed);
 				}
-				else if (strcmp(xmlLevels[2].name, "title") == 0)
+				else if (XML_NAME_IS(2, "title"))
 				{
 					// Truncate the scene Title to prevent overflow on II screen
 					if (strlen(value) > SCENE_TITLE_MAX)
@@ -612,11 +712,11 @@ saveData(const char* xmlName, const char* xmlValue)
 		case PARSE_SCENE_STATE_TIMEOUT:
 			if (xml_current_level == 3)
 			{
-				if (strcmp(xmlLevels[3].name, "timeout_value") == 0)
+				if (XML_NAME_IS(3, "timeout_value"))
 				{
 					new_scene->timeout = atoi(value);
 				}
-				else if (strcmp(xmlLevels[3].name, "scene_id") == 0)
+				else if (XML_NAME_IS(3, "scene_id"))
 				{
 					new_scene->timeout_scene = atoi(value);
 				}
@@ -627,49 +727,49 @@ saveData(const char* xmlName, const char* xmlValue)
 		case PARSE_SCENE_STATE_INIT_CARDIAC:
 			if (xml_current_level == 4)
 			{
-				sts = cardiac_parse(xmlLevels[4].name, value, &new_scene->initParams.cardiac);
+				sts = cardiac_parse(xmlLevels[4].name, value, &initScratch.cardiac, &initScratch.dirty[II_CARDIAC]);
 			}
 			break;
 		case PARSE_SCENE_STATE_INIT_RESPIRATION:
 			if (xml_current_level == 4)
 			{
-				sts = respiration_parse(xmlLevels[4].name, value, &new_scene->initParams.respiration);
+				sts = respiration_parse(xmlLevels[4].name, value, &initScratch.respiration, &initScratch.dirty[II_RESPIRATION]);
 			}
 			break;
 		case PARSE_SCENE_STATE_INIT_GENERAL:
 			if (xml_current_level == 4)
 			{
-				sts = general_parse(xmlLevels[4].name, value, &new_scene->initParams.general);
+				sts = general_parse(xmlLevels[4].name, value, &initScratch.general, &initScratch.dirty[II_GENERAL]);
 			}
 			break;
 		case PARSE_SCENE_STATE_INIT_TELESIM:
 			if (xml_current_level == 5)
 			{
 				sprintf_s(complex, 1024, "%s:%s", xmlLevels[4].name, value);
-				sts = telesim_parse(xmlLevels[xml_current_level].name, complex, &new_scene->initParams.telesim);
+				sts = telesim_parse(xmlLevels[xml_current_level].name, complex, &initScratch.telesim, &initScratch.dirty[II_TELESIM]);
 			}
 			else if (xml_current_level == 4)
 			{
 				sprintf_s(complex, 1024, "%s:%s", xmlLevels[3].name, value);
-				sts = telesim_parse(xmlLevels[xml_current_level].name, complex, &new_scene->initParams.telesim);
+				sts = telesim_parse(xmlLevels[xml_current_level].name, complex, &initScratch.telesim, &initScratch.dirty[II_TELESIM]);
 			}
 			break;
 		case PARSE_SCENE_STATE_INIT_VOCALS:
 			if (xml_current_level == 4)
 			{
-				sts = vocals_parse(xmlLevels[4].name, value, &new_scene->initParams.vocals);
+				sts = vocals_parse(xmlLevels[4].name, value, &initScratch.vocals, &initScratch.dirty[II_MEDIA]);
 			}
 			break;
 		case PARSE_SCENE_STATE_INIT_MEDIA:
 			if (xml_current_level == 4)
 			{
-				sts = media_parse(xmlLevels[4].name, value, &new_scene->initParams.media);
+				sts = media_parse(xmlLevels[4].name, value, &initScratch.media, &initScratch.dirty[II_MEDIA]);
 			}
 			break;
 		case PARSE_SCENE_STATE_INIT_CPR:
 			if (xml_current_level == 4)
 			{
-				sts = cpr_parse(xmlLevels[4].name, value, &new_scene->initParams.cpr);
+				sts = cpr_parse(xmlLevels[4].name, value, &initScratch.cpr, &initScratch.dirty[II_CPR]);
 			}
 			break;
 		case PARSE_SCENE_STATE_TRIGS:
@@ -677,15 +777,15 @@ saveData(const char* xmlName, const char* xmlValue)
 		case PARSE_SCENE_STATE_TRIG_GROUP:
 			if (xml_current_level == 4)
 			{
-				if (strcmp(xmlLevels[4].name, "scene_id") == 0)
+				if (XML_NAME_IS(4, "scene_id"))
 				{
 					new_trigger_group->scene = atoi(value);
 				}
-				else if (strcmp(xmlLevels[4].name, "triggers_required") == 0)
+				else if (XML_NAME_IS(4, "triggers_required"))
 				{
 					new_trigger_group->group_triggers_needed = atoi(value);
 				}
-				else if (strcmp(xmlLevels[4].name, "group_id") == 0)
+				else if (XML_NAME_IS(4, "group_id"))
 				{
 					new_trigger_group->group_id = atoi(value);
 				}
@@ -694,7 +794,7 @@ saveData(const char* xmlName, const char* xmlValue)
 		case PARSE_SCENE_STATE_TRIG:
 			if (xml_current_level == 4)
 			{
-				if (strcmp(xmlLevels[4].name, "test") == 0)
+				if (XML_NAME_IS(4, "test"))
 				{
 					for (i = 0; i <= TRIGGER_TEST_OUTSIDE; i++)
 					{
@@ -704,17 +804,25 @@ saveData(const char* xmlName, const char* xmlValue)
 							break;
 						}
 					}
+					if (i > TRIGGER_TEST_OUTSIDE && scenarioCheck)
+					{
+						scenario_check_issue(ISSUE_ERROR, xmlp.line(), "unknown trigger test \"%s\"", value);
+					}
 				}
-				else if (strcmp(xmlLevels[4].name, "scene_id") == 0)
+				else if (XML_NAME_IS(4, "scene_id"))
 				{
 					new_trigger->scene = atoi(value);
 				}
-				else if (strcmp(xmlLevels[4].name, "event_id") == 0)
+				else if (XML_NAME_IS(4, "event_id"))
 				{
 					sprintf_s(new_trigger->param_element, 32, "%s", value);
 					new_trigger->test = TRIGGER_TEST_EVENT;
 				}
-				//else if (strcmp(xmlLevels[4].name, "group") == 0)
+				else if (XML_NAME_IS(4, "expr"))
+				{
+					saveTriggerExpr(value);
+				}
+				//else if (XML_NAME_IS(4, "group"))
 				//{
 				//	new_trigger->group = atoi(value);
 				//}
@@ -752,7 +860,7 @@ saveData(const char* xmlName, const char* xmlValue)
 		case PARSE_SCENE_STATE_TRIG_GROUP_TRIG:
 			if (xml_current_level == 5)
 			{
-				if (strcmp(xmlLevels[5].name, "test") == 0)
+				if (XML_NAME_IS(5, "test"))
 				{
 					for (i = 0; i <= TRIGGER_TEST_OUTSIDE; i++)
 					{
@@ -762,17 +870,25 @@ saveData(const char* xmlName, const char* xmlValue)
 							break;
 						}
 					}
+					if (i > TRIGGER_TEST_OUTSIDE && scenarioCheck)
+					{
+						scenario_check_issue(ISSUE_ERROR, xmlp.line(), "unknown trigger test \"%s\"", value);
+					}
 				}
-				else if (strcmp(xmlLevels[5].name, "scene_id") == 0)
+				else if (XML_NAME_IS(5, "scene_id"))
 				{
 					new_trigger->scene = atoi(value);
 				}
-				else if (strcmp(xmlLevels[5].name, "event_id") == 0)
+				else if (XML_NAME_IS(5, "event_id"))
 				{
 					sprintf_s(new_trigger->param_element, 32, "%s", value);
 					new_trigger->test = TRIGGER_TEST_EVENT;
 				}
-				else if (strcmp(xmlLevels[5].name, "group_id") == 0)
+				else if (XML_NAME_IS(5, "expr"))
+				{
+					saveTriggerExpr(value);
+				}
+				else if (XML_NAME_IS(5, "group_id"))
 				{
 					new_trigger->group = atoi(value);
 				}
@@ -822,12 +938,12 @@ saveData(const char* xmlName, const char* xmlValue)
 	case PARSE_STATE_EVENTS:
 		if (xml_current_level == 3)
 		{
-			if (strcmp(xmlLevels[3].name, "name") == 0)
+			if (XML_NAME_IS(3, "name"))
 			{
 				// Set the current Category Name
 				sprintf_s(current_event_catagory, NORMAL_STRING_SIZE, "%s", value);
 			}
-			else if (strcmp(xmlLevels[3].name, "title") == 0)
+			else if (XML_NAME_IS(3, "title"))
 			{
 				// Set the current Category Name
 				sprintf_s(current_event_title, NORMAL_STRING_SIZE, "%s", value);
@@ -835,11 +951,11 @@ saveData(const char* xmlName, const char* xmlValue)
 		}
 		else if (xml_current_level == 4)
 		{
-			if (strcmp(xmlLevels[4].name, "title") == 0)
+			if (XML_NAME_IS(4, "title"))
 			{
 				sprintf_s(new_event->event_title, 32, "%s", value);
 			}
-			else if (strcmp(xmlLevels[4].name, "id") == 0)
+			else if (XML_NAME_IS(4, "id"))
 			{
 				sprintf_s(new_event->event_id, 32, "%s", value);
 			}
@@ -848,55 +964,54 @@ saveData(const char* xmlName, const char* xmlValue)
 	case PARSE_STATE_HEADER:
 		if (xml_current_level == 2)
 		{
-			if (strcmp(xmlLevels[2].name, "author") == 0)
+			if (XML_NAME_IS(2, "author"))
 			{
-				snprintf(scenario->author, LONG_STRING_SIZE, "%s", value);
+				snprintf(parseScenario->author, LONG_STRING_SIZE, "%s", value);
 			}
-			else if (strcmp(xmlLevels[2].name, "date_created") == 0)
+			else if (XML_NAME_IS(2, "date_created"))
 			{
-				snprintf(scenario->date_created, NORMAL_STRING_SIZE, "%s", value);
+				snprintf(parseScenario->date_created, NORMAL_STRING_SIZE, "%s", value);
 			}
-			else if (strcmp(xmlLevels[2].name, "description") == 0)
+			else if (XML_NAME_IS(2, "description"))
 			{
-				snprintf(scenario->description, LONG_STRING_SIZE, "%s", value);
+				snprintf(parseScenario->description, LONG_STRING_SIZE, "%s", value);
 			}
 		}
 		else if (xml_current_level == 3)
 		{
-			if (strcmp(xmlLevels[3].name, "title") == 0)
+			if (XML_NAME_IS(3, "title"))
 			{
-				snprintf(scenario->title, LONG_STRING_SIZE, "%s", value);
+				snprintf(parseScenario->title, LONG_STRING_SIZE, "%s", value);
 			}
 		}
 		[[fallthrough]];
 	default:
-		if (strcmp(xmlLevels[1].name, "header") == 0)
+		if (XML_NAME_IS(1, "header"))
 		{
 			if (xml_current_level == 2)
 			{
-				name = xmlLevels[2].name;
-				if (strcmp(name, "author") == 0)
+				if (XML_NAME_IS(xml_current_level, "author"))
 				{
-					sprintf_s(scenario->author, 128, "%s", value);
+					sprintf_s(parseScenario->author, 128, "%s", value);
 					if (verbose)
 					{
-						printf("Author: %s\n", scenario->author);
+						printf("Author: %s\n", parseScenario->author);
 					}
 				}
-				else if (strcmp(name, "date_of_creation") == 0)
+				else if (XML_NAME_IS(xml_current_level, "date_of_creation"))
 				{
-					snprintf(scenario->date_created, NORMAL_STRING_SIZE, "%s", value);
+					snprintf(parseScenario->date_created, NORMAL_STRING_SIZE, "%s", value);
 					if (verbose)
 					{
-						printf("Created: %s\n", scenario->date_created);
+						printf("Created: %s\n", parseScenario->date_created);
 					}
 				}
-				else if (strcmp(name, "description") == 0)
+				else if (XML_NAME_IS(xml_current_level, "description"))
 				{
-					snprintf(scenario->description, LONG_STRING_SIZE, "%s", value);
+					snprintf(parseScenario->description, LONG_STRING_SIZE, "%s", value);
 					if (verbose)
 					{
-						printf("Description: %s\n", scenario->description);
+						printf("Description: %s\n", parseScenario->description);
 					}
 				}
 				else
@@ -909,13 +1024,12 @@ saveData(const char* xmlName, const char* xmlValue)
 			}
 			else if (xml_current_level == 3)
 			{
-				name = xmlLevels[3].name;
-				if (strcmp(name, "name") == 0)
+				if (XML_NAME_IS(xml_current_level, "name"))
 				{
-					snprintf(scenario->title, LONG_STRING_SIZE, "%s", value);
+					snprintf(parseScenario->title, LONG_STRING_SIZE, "%s", value);
 					if (verbose)
 					{
-						printf("Title: %s\n", scenario->title);
+						printf("Title: %s\n", parseScenario->title);
 					}
 				}
 			}
@@ -929,6 +1043,10 @@ saveData(const char* xmlName, const char* xmlValue)
 		}
 		break;
 	}
+	if (scenarioCheck)
+	{
+		checkValue(sts, value);
+	}
 	if (sts && verbose)
 	{
 		printf("saveData STS %d: Lvl %d: %s, Value  %s, \n", sts, xml_current_level, xmlLevels[xml_current_level].name, value);
@@ -977,18 +1095,20 @@ startParseState(int lvl, char* name)
 		break;
 
 	case 1:	// profile, media, events have no action
-		if (strcmp(name, "init") == 0)
+		if (XML_NAME_IS(lvl, "init"))
 		{
 			parse_state = PARSE_STATE_INIT;
+			initializeParameterStruct(&initScratch);
 		}
-		else if ((strcmp(name, "scene") == 0) || (strcmp(name, "initial_scene") == 0))
+		else if ((XML_NAME_IS(lvl, "scene")) || (XML_NAME_IS(lvl, "initial_scene")))
 		{
 			// Allocate a scene
 			new_scene = (struct scenario_scene*)calloc(1, sizeof(struct scenario_scene));
 			if (new_scene)
 			{
-				initializeParameterStruct(&new_scene->initParams);
-				insert_llist(&new_scene->scene_list, &scenario->scene_list);
+				new_scene->line = xmlp.line();
+				initializeParameterStruct(&initScratch);
+				insert_llist(&new_scene->scene_list, &parseScenario->scene_list);
 				parse_state = PARSE_STATE_SCENE;
 				if (verbose)
 				{
@@ -1000,13 +1120,13 @@ startParseState(int lvl, char* name)
 				printf("Failed to calloc new_scene\n");
 			}
 		}
-		else if (strcmp(name, "events") == 0)
+		else if (XML_NAME_IS(lvl, "events"))
 		{
 			parse_state = PARSE_STATE_EVENTS;
 			sprintf_s(current_event_catagory, NORMAL_STRING_SIZE, "%s", "");
 			sprintf_s(current_event_title, NORMAL_STRING_SIZE, "%s", "");
 		}
-		else if (strcmp(name, "header") == 0)
+		else if (XML_NAME_IS(lvl, "header"))
 		{
 			parse_state = PARSE_STATE_HEADER;
 			sprintf_s(current_event_catagory, NORMAL_STRING_SIZE, "%s", "");
@@ -1018,39 +1138,39 @@ startParseState(int lvl, char* name)
 		switch (parse_state)
 		{
 		case PARSE_STATE_INIT:
-			if (strcmp(name, "cardiac") == 0)
+			if (XML_NAME_IS(lvl, "cardiac"))
 			{
 				parse_init_state = PARSE_INIT_STATE_CARDIAC;
 			}
-			else if (strcmp(name, "respiration") == 0)
+			else if (XML_NAME_IS(lvl, "respiration"))
 			{
 				parse_init_state = PARSE_INIT_STATE_RESPIRATION;
 			}
-			else if (strcmp(name, "general") == 0)
+			else if (XML_NAME_IS(lvl, "general"))
 			{
 				parse_init_state = PARSE_INIT_STATE_GENERAL;
 			}
-			else if (strcmp(name, "vocals") == 0)
+			else if (XML_NAME_IS(lvl, "vocals"))
 			{
 				parse_init_state = PARSE_INIT_STATE_VOCALS;
 			}
-			else if (strcmp(name, "media") == 0)
+			else if (XML_NAME_IS(lvl, "media"))
 			{
 				parse_init_state = PARSE_INIT_STATE_MEDIA;
 			}
-			else if (strcmp(name, "cpr") == 0)
+			else if (XML_NAME_IS(lvl, "cpr"))
 			{
 				parse_init_state = PARSE_INIT_STATE_CPR;
 			}
-			else if (strcmp(name, "scene") == 0)
+			else if (XML_NAME_IS(lvl, "scene"))
 			{
 				parse_init_state = PARSE_INIT_STATE_SCENE;
 			}
-			else if (strcmp(name, "initial_scene") == 0)
+			else if (XML_NAME_IS(lvl, "initial_scene"))
 			{
 				parse_init_state = PARSE_INIT_STATE_SCENE;
 			}
-			else if (strcmp(name, "telesim") == 0)
+			else if (XML_NAME_IS(lvl, "telesim"))
 			{
 				parse_init_state = PARSE_INIT_STATE_TELESIM;
 			}
@@ -1061,6 +1181,7 @@ startParseState(int lvl, char* name)
 			break;
 
 		case PARSE_STATE_SCENE:
+			// Prefix matches, so these stay string compares
 			if (strncmp(name, "init", 4) == 0)
 			{
 				parse_scene_state = PARSE_SCENE_STATE_INIT;
@@ -1069,14 +1190,20 @@ startParseState(int lvl, char* name)
 			{
 				parse_scene_state = PARSE_SCENE_STATE_TIMEOUT;
 			}
-			else if (strcmp(name, "triggers_needed") == 0)
+			else if (XML_NAME_IS(lvl, "triggers_needed"))
 			{
 				parse_scene_state = PARSE_SCENE_STATE_NONE;
-				printf("Name %s - \n", name);
+				if (verbose)
+				{
+					printf("Name %s - \n", name);
+				}
 			}
 			else if (strncmp(name, "trigger_group", 13) == 0)
 			{
-				printf("PARSE_SCENE_STATE_TRIG_GROUP\n");
+				if (verbose)
+				{
+					printf("PARSE_SCENE_STATE_TRIG_GROUP\n");
+				}
 				parse_scene_state = PARSE_SCENE_STATE_TRIG_GROUP;
 			}
 			else if (strncmp(name, "triggers", 8) == 0)
@@ -1090,19 +1217,19 @@ startParseState(int lvl, char* name)
 			break;
 
 		case PARSE_STATE_HEADER:
-			if (strcmp(name, "author") == 0)
+			if (XML_NAME_IS(lvl, "author"))
 			{
 				parse_header_state = PARSE_HEADER_STATE_AUTHOR;
 			}
-			else if (strcmp(name, "title") == 0)
+			else if (XML_NAME_IS(lvl, "title"))
 			{
 				parse_header_state = PARSE_HEADER_STATE_TITLE;
 			}
-			else if (strcmp(name, "date_of_creation") == 0)
+			else if (XML_NAME_IS(lvl, "date_of_creation"))
 			{
 				parse_header_state = PARSE_HEADER_STATE_DATE_OF_CREATION;
 			}
-			else if (strcmp(name, "description") == 0)
+			else if (XML_NAME_IS(lvl, "description"))
 			{
 				parse_header_state = PARSE_HEADER_STATE_DESCRIPTION;
 			}
@@ -1117,31 +1244,31 @@ startParseState(int lvl, char* name)
 		switch (parse_state)
 		{
 		case PARSE_STATE_SCENE:
-			if (strcmp(name, "cardiac") == 0)
+			if (XML_NAME_IS(lvl, "cardiac"))
 			{
 				parse_scene_state = PARSE_SCENE_STATE_INIT_CARDIAC;
 			}
-			else if (strcmp(name, "respiration") == 0)
+			else if (XML_NAME_IS(lvl, "respiration"))
 			{
 				parse_scene_state = PARSE_SCENE_STATE_INIT_RESPIRATION;
 			}
-			else if (strcmp(name, "general") == 0)
+			else if (XML_NAME_IS(lvl, "general"))
 			{
 				parse_scene_state = PARSE_SCENE_STATE_INIT_GENERAL;
 			}
-			else if (strcmp(name, "vocals") == 0)
+			else if (XML_NAME_IS(lvl, "vocals"))
 			{
 				parse_scene_state = PARSE_SCENE_STATE_INIT_VOCALS;
 			}
-			else if (strcmp(name, "media") == 0)
+			else if (XML_NAME_IS(lvl, "media"))
 			{
 				parse_scene_state = PARSE_SCENE_STATE_INIT_MEDIA;
 			}
-			else if (strcmp(name, "cpr") == 0)
+			else if (XML_NAME_IS(lvl, "cpr"))
 			{
 				parse_scene_state = PARSE_SCENE_STATE_INIT_CPR;
 			}
-			else if (strcmp(name, "telesim") == 0)
+			else if (XML_NAME_IS(lvl, "telesim"))
 			{
 				parse_scene_state = PARSE_SCENE_STATE_INIT_TELESIM;
 			}
@@ -1149,12 +1276,16 @@ startParseState(int lvl, char* name)
 			if (parse_scene_state == PARSE_SCENE_STATE_TRIGS)
 			{
 
-				if (strcmp(name, "trigger_group") == 0)
+				if (XML_NAME_IS(lvl, "trigger_group"))
 				{
-					printf("PARSE_SCENE_STATE_TRIG_GROUP\n");
+					if (verbose)
+					{
+						printf("PARSE_SCENE_STATE_TRIG_GROUP\n");
+					}
 					new_trigger_group = (struct trigger_group*)calloc(1, sizeof(struct trigger_group));
 					if (new_trigger_group)
 					{
+						new_trigger_group->line = xmlp.line();
 						insert_llist(&new_trigger_group->group_list, &new_scene->group_list);
 						if (verbose)
 						{
@@ -1163,11 +1294,12 @@ startParseState(int lvl, char* name)
 					}
 					parse_scene_state = PARSE_SCENE_STATE_TRIG_GROUP;
 				}
-				else if (strcmp(name, "trigger") == 0)
+				else if (XML_NAME_IS(lvl, "trigger"))
 				{
 					new_trigger = (struct scenario_trigger*)calloc(1, sizeof(struct scenario_trigger));
 					if (new_trigger)
 					{
+						new_trigger->line = xmlp.line();
 						insert_llist(&new_trigger->trigger_list, &new_scene->trigger_list);
 
 						parse_scene_state = PARSE_SCENE_STATE_TRIG;
@@ -1185,7 +1317,7 @@ startParseState(int lvl, char* name)
 			break;
 
 		case PARSE_STATE_EVENTS:
-			if (strcmp(name, "event") == 0)
+			if (XML_NAME_IS(lvl, "event"))
 			{
 				if (verbose)
 				{
@@ -1194,7 +1326,7 @@ startParseState(int lvl, char* name)
 				new_event = (struct scenario_event*)calloc(1, sizeof(struct scenario_event));
 				if (new_event)
 				{
-					insert_llist(&new_event->event_list, &scenario->event_list);
+					insert_llist(&new_event->event_list, &parseScenario->event_list);
 
 					sprintf_s(new_event->event_catagory_name, NORMAL_STRING_SIZE, "%s", current_event_catagory);
 					sprintf_s(new_event->event_catagory_title, NORMAL_STRING_SIZE, "%s", current_event_title);
@@ -1224,11 +1356,12 @@ startParseState(int lvl, char* name)
 			case PARSE_STATE_SCENE:
 				if (parse_scene_state == PARSE_SCENE_STATE_TRIG_GROUP)
 				{
-					if (strcmp(name, "trigger") == 0)
+					if (XML_NAME_IS(lvl, "trigger"))
 					{
 						new_trigger = (struct scenario_trigger*)calloc(1, sizeof(struct scenario_trigger));
 						if (new_trigger)
 						{
+							new_trigger->line = xmlp.line();
 							insert_llist(&new_trigger->trigger_list, &new_trigger_group->group_trigger_list);
 
 							parse_scene_state = PARSE_SCENE_STATE_TRIG_GROUP_TRIG;
@@ -1242,7 +1375,7 @@ startParseState(int lvl, char* name)
 							printf("Failed to callog new_trigger\n");
 						}
 					}
-					//if (strcmp(name, "triggers_needed") == 0)
+					//if (XML_NAME_IS(lvl, "triggers_needed"))
 					//{
 					//	new_trigger_group->group_triggers_needed = atoi(value);
 					//	printf("Trigger Group %d: Set Triggers Needed to %d\n", new_scene->triggers_needed);
@@ -1289,6 +1422,14 @@ endParseState(int lvl)
 		break;
 
 	case 1:	// Section End
+		if (parse_state == PARSE_STATE_INIT)
+		{
+			initPack(&initScratch, &parseScenario->init);
+		}
+		else if (parse_state == PARSE_STATE_SCENE && new_scene)
+		{
+			initPack(&initScratch, &new_scene->init);
+		}
 		parse_state = PARSE_STATE_NONE;
 		break;
 
@@ -1310,14 +1451,20 @@ endParseState(int lvl)
 		{
 			new_trigger = (struct scenario_trigger*)0;
 			parse_scene_state = PARSE_SCENE_STATE_TRIGS;
-			printf("**** Trigger Complete ****\n");
+			if (verbose)
+			{
+				printf("**** Trigger Complete ****\n");
+			}
 		}
 		else if ((parse_scene_state == PARSE_SCENE_STATE_TRIG_GROUP) &&
 			(new_trigger_group))
 		{
 			new_trigger_group = (struct trigger_group*)0;
 			parse_scene_state = PARSE_SCENE_STATE_TRIGS;
-			printf("**** Trigger Group Complete ****\n");
+			if (verbose)
+			{
+				printf("**** Trigger Group Complete ****\n");
+			}
 		}
 		break;
 	case 4:
@@ -1326,7 +1473,10 @@ endParseState(int lvl)
 		{
 			new_trigger = (struct scenario_trigger*)0;
 			parse_scene_state = PARSE_SCENE_STATE_TRIG_GROUP;
-			printf("**** Trigger In Group Complete ****\n");
+			if (verbose)
+			{
+				printf("**** Trigger In Group Complete ****\n");
+			}
 		}
 		break;
 	case 5:
@@ -1337,84 +1487,81 @@ endParseState(int lvl)
 }
 /**
  * processNode:
- * @reader: the xmlReader
  *
- * Dump information about the current node
+ * Handle the current token from xmlp. As with the parser this replaced, only the
+ * text directly after a start tag is a value.
  */
 
-void
+static char xmlValue[XML_VALUE_SIZE];
+static bool xmlValueOpen;
+
+static void
 processNode(void)
 {
 	int lvl;
-	char* name;
-	char* value;
-
-	name = &xmlr.name[0];
-	value = &xmlr.value[0];
+	std::string_view text;
+	size_t len;
 
-	switch (xmlr.type)
+	switch (xmlp.type)
 	{
-	case XML_TYPE_ELEMENT:
-		xml_current_level = xmlr.depth;
-		xmlLevels[xml_current_level].num = xml_current_level;
-		if (strlen(name) >= PARAMETER_NAME_LENGTH)
+	case XML_PULL_ELEMENT:
+		xml_current_level = xmlp.depth;
+		xmlValueOpen = false;
+		if (xml_current_level >= XML_MAX_LEVELS)
 		{
-			fprintf(stderr, "XML Parse Error: %s: Name %s exceeds Max Length of %d\n",
-				xml_filename, name, PARAMETER_NAME_LENGTH - 1);
+			fprintf(stderr, "XML Parse Error: %s: %.*s is nested deeper than %d\n",
+				xml_filename, (int)xmlp.name.size(), xmlp.name.data(), XML_MAX_LEVELS);
+			break;
 		}
-		else
+		xmlLevels[xml_current_level].num = xml_current_level;
+		if (xmlp.name.size() >= PARAMETER_NAME_LENGTH)
 		{
-			sprintf_s(xmlLevels[xml_current_level].name, 128, "%s", name);
+			fprintf(stderr, "XML Parse Error: %s: Name %.*s exceeds Max Length of %d\n",
+				xml_filename, (int)xmlp.name.size(), xmlp.name.data(), PARAMETER_NAME_LENGTH - 1);
+			xmlLevels[xml_current_level].name[0] = 0;
+			xmlLevels[xml_current_level].hash = 0;
+			break;
 		}
-		// printf("Start %d %s\n", xml_current_level, name );
-		startParseState(xml_current_level, (char*)name);
+		memcpy(xmlLevels[xml_current_level].name, xmlp.name.data(), xmlp.name.size());
+		xmlLevels[xml_current_level].name[xmlp.name.size()] = 0;
+		xmlLevels[xml_current_level].hash = xmlp.hash;
+		xmlValueOpen = true;
+		startParseState(xml_current_level, xmlLevels[xml_current_level].name);
 		break;
 
-	case XML_TYPE_TEXT:
-		cleanString((char*)value);
+	case XML_PULL_TEXT:
+		if (!xmlValueOpen)
+		{
+			break;
+		}
+		xmlValueOpen = false;
+		text = xmlp.value();
+		len = text.size() < XML_VALUE_SIZE - 1 ? text.size() : XML_VALUE_SIZE - 1;
+		memcpy(xmlValue, text.data(), len);
+		xmlValue[len] = 0;
+		cleanString(xmlValue);
 		if (verbose)
 		{
 			for (lvl = 0; lvl <= xml_current_level; lvl++)
 			{
 				printf("[%d]%s:", lvl, xmlLevels[lvl].name);
 			}
-			printf(" %s\n", value);
+			printf(" %s\n", xmlValue);
 		}
-		saveData(name, value);
+		saveData(xmlValue);
 		break;
 
-	case XML_TYPE_END_ELEMENT:
-		// printf("End %d\n", xml_current_level );
-		endParseState(xml_current_level);
-		xml_current_level--;
+	case XML_PULL_END_ELEMENT:
+		xmlValueOpen = false;
+		if (xmlp.depth < XML_MAX_LEVELS)
+		{
+			endParseState(xmlp.depth);
+		}
+		xml_current_level = xmlp.depth - 1;
 		break;
 
-	case XML_TYPE_NONE:
-	case XML_TYPE_FILE_END:
 	default:
-		if (verbose)
-		{
-			printf("Node: %d %d %s",
-				xmlr.depth,
-				xmlr.type,
-				name);
-
-			if (value == NULL)
-			{
-				printf("\n");
-			}
-			else
-			{
-				if (strlen(value) > 60)
-				{
-					printf(" %.80s...\n", value);
-				}
-				else
-				{
-					printf(" %s\n", value);
-				}
-			}
-		}
+		break;
 	}
 }
 
@@ -1428,23 +1575,84 @@ processNode(void)
 int
 readScenario(const char* name)
 {
-	int sts;
 	char filename[1400];
 	extern char sessionsPath[];
 
 	sprintf_s(sessionsPath, 1088, "%s" PATH_SEP "scenarios", localConfig.html_path);
 	sprintf_s(filename, 1400, "%s" PATH_SEP "%s" PATH_SEP "main.xml", sessionsPath, name);
-	sts = xmlr.open(filename);
+	return (readScenarioFile(filename));
+}
+
+/*
+ * FUNCTION: readScenarioFile
+ *
+ * ARGUMENTS:
+ *		filename	- Path of a main.xml
+ *
+ * Parse into parseScenario. Call resetParseState() first.
+ *
+ * RETURNS:
+ *		0 on success, -1 if the file cannot be read or is not well formed XML
+ */
+int
+readScenarioFile(const char* filename)
+{
+	int sts;
+
+	xml_filename = filename;
+	sts = xmlp.open(filename);
 	if (sts)
 	{
-		printf("Failure on read of XML File \"%s\"\n", filename);
-		snprintf(simmgr_shm->status.scenario.error_message, STR_SIZE, "Failure on read of XML File \"%s\"\n", filename);
+		snprintf(parseError, sizeof(parseError), "Failure on read of XML File \"%s\"\n", filename);
+		if (scenarioCheck)
+		{
+			scenario_check_issue(ISSUE_ERROR, 0, "%s", xmlp.error);
+		}
+		else
+		{
+			printf("Failure on read of XML File \"%s\": %s\n", filename, xmlp.error);
+		}
 		return (-1);
 	}
-	while (xmlr.getEntry() == 0)
+	while ((sts = xmlp.next()) == 0)
 	{
 		processNode();
 	}
+	if (sts < 0)
+	{
+		if (scenarioCheck)
+		{
+			scenario_check_issue(ISSUE_ERROR, 0, "%s", xmlp.error);
+		}
+		else
+		{
+			printf("XML error in %s: %s\n", filename, xmlp.error);
+		}
+		snprintf(parseError, sizeof(parseError), "ERROR: main.xml %s\n", xmlp.error);
+		appendToParseLog(parseError);
+		errCount++;
+	}
+	xmlp.close();
+	xml_filename = NULL;
 
-	return (0);
-}
\ No newline at end of file
+	return (sts < 0 ? -1 : 0);
+}
+
+/*
+ * FUNCTION: resetParseState
+ *
+ * Set the parser state for a new file
+ */
+void
+resetParseState(void)
+{
+	xml_current_level = 0;
+	parseSceneId = -1;
+	parseError[0] = 0;
+	line_number = 0;
+	errCount = 0;
+	parse_state = PARSE_STATE_NONE;
+	parse_init_state = PARSE_INIT_STATE_NONE;
+	parse_scene_state = PARSE_SCENE_STATE_NONE;
+	parse_header_state = PARSE_HEADER_STATE_NONE;
+}
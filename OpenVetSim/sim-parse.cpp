@@ -23,106 +23,133 @@
 #include "vetsim.h"
 
 #include "scenario.h"
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 
 int
-cardiac_parse(const char* elem, const char* value, struct cardiac* card)
+cardiac_parse(const char* elem, const char* value, struct cardiac* card, unsigned int* dirty)
 {
 	int sts = 0;
 
-	if ((!elem) || (!value) || (!card))
+	if ((!elem) || (!value) || (!card) || (!dirty))
 	{
 		return (-11);
 	}
 	if (strcmp(elem, ("rhythm")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_RHYTHM);
 		sprintf_s(card->rhythm, STR_SIZE, "%s", value);
 	}
 	else if (strcmp(elem, ("vpc")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_VPC);
 		sprintf_s(card->vpc, STR_SIZE, "%s", value);
 	}
 	else if (strcmp(elem, ("pea")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_PEA);
 		card->pea = atoi(value);
 	}
 	else if (strcmp(elem, ("vpc_freq")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_VPC_FREQ);
 		card->vpc_freq = atoi(value);
 	}
 	else if (strcmp(elem, ("vpc_delay")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_VPC_DELAY);
 		card->vpc_delay = atoi(value);
 	}
 	else if (strcmp(elem, ("vfib_amplitude")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_VFIB_AMPLITUDE);
 		sprintf_s(card->vfib_amplitude, STR_SIZE, "%s", value);
 	}
 	else if (strcmp(elem, ("pwave")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_PWAVE);
 		sprintf_s(card->pwave, STR_SIZE, "%s", value);
 	}
 	else if (strcmp(elem, ("rate")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_RATE);
 		card->rate = atoi(value);
 	}
 	else if (strcmp(elem, ("transfer_time")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_TRANSFER_TIME);
 		card->transfer_time = atoi(value);
 	}
 	else if (strcmp(elem, ("pr_interval")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_PR_INTERVAL);
 		card->pr_interval = atoi(value);
 	}
 	else if (strcmp(elem, ("qrs_interval")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_QRS_INTERVAL);
 		card->qrs_interval = atoi(value);
 	}
 	else if (strcmp(elem, ("bps_sys")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_BPS_SYS);
 		card->bps_sys = atoi(value);
 	}
 	else if (strcmp(elem, ("bps_dia")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_BPS_DIA);
 		card->bps_dia = atoi(value);
 	}
 	else if (strcmp(elem, ("nibp_rate")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_NIBP_RATE);
 		card->nibp_rate = atoi(value);
 	}
 	else if (strcmp(elem, "nibp_read") == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_NIBP_READ);
 		card->nibp_read = atoi(value);
 	}
 	else if (strcmp(elem, "nibp_linked_hr") == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_NIBP_LINKED_HR);
 		card->nibp_linked_hr = atoi(value);
 	}
 	else if (strcmp(elem, "nibp_freq") == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_NIBP_FREQ);
 		card->nibp_freq = atoi(value);
 	}
 	else if (strcmp(elem, ("ecg_indicator")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_ECG_INDICATOR);
 		card->ecg_indicator = atoi(value);
 	}
 	else if (strcmp(elem, ("bp_cuff")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_BP_CUFF);
 		card->bp_cuff = atoi(value);
 	}
 	else if (strcmp(elem, ("heart_sound")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_HEART_SOUND);
 		sprintf_s(card->heart_sound, STR_SIZE, "%s", value);
 	}
 	else if (strcmp(elem, ("heart_sound_volume")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_HEART_SOUND_VOLUME);
 		card->heart_sound_volume = atoi(value);
 	}
 	else if (strcmp(elem, ("heart_sound_mute")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_HEART_SOUND_MUTE);
 		card->heart_sound_mute = atoi(value);
 	}
 	else if (strcmp(elem, ("right_dorsal_pulse_strength")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_RIGHT_DORSAL_PULSE);
 		if ((strcmp(value, "none")) == 0)
 		{
 			card->right_dorsal_pulse_strength = 0;
@@ -146,6 +173,7 @@ cardiac_parse(const char* elem, const char* value, struct cardiac* card)
 	}
 	else if (strcmp(elem, ("left_dorsal_pulse_strength")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_LEFT_DORSAL_PULSE);
 		if ((strcmp(value, "none")) == 0)
 		{
 			card->left_dorsal_pulse_strength = 0;
@@ -169,6 +197,7 @@ cardiac_parse(const char* elem, const char* value, struct cardiac* card)
 	}
 	else if (strcmp(elem, ("right_femoral_pulse_strength")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_RIGHT_FEMORAL_PULSE);
 		if ((strcmp(value, "none")) == 0)
 		{
 			card->right_femoral_pulse_strength = 0;
@@ -192,6 +221,7 @@ cardiac_parse(const char* elem, const char* value, struct cardiac* card)
 	}
 	else if (strcmp(elem, ("left_femoral_pulse_strength")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_LEFT_FEMORAL_PULSE);
 		if ((strcmp(value, "none")) == 0)
 		{
 			card->left_femoral_pulse_strength = 0;
@@ -215,6 +245,7 @@ cardiac_parse(const char* elem, const char* value, struct cardiac* card)
 	}
 	else if (strcmp(elem, ("arrest")) == 0)
 	{
+		*dirty |= II_FIELD(CARDIAC_F_ARREST);
 		card->arrest = atoi(value);
 	}
 	else
@@ -225,20 +256,22 @@ cardiac_parse(const char* elem, const char* value, struct cardiac* card)
 }
 
 int
-respiration_parse(const char* elem, const char* value, struct respiration* resp)
+respiration_parse(const char* elem, const char* value, struct respiration* resp, unsigned int* dirty)
 {
 	int sts = 0;
 
-	if ((!elem) || (!value) || (!resp))
+	if ((!elem) || (!value) || (!resp) || (!dirty))
 	{
 		return (-12);
 	}
 	if (strcmp(elem, "left_lung_sound") == 0)
 	{
+		*dirty |= II_FIELD(RESPIRATION_F_LEFT_LUNG_SOUND);
 		sprintf_s(resp->left_lung_sound, STR_SIZE, "%s", value);
 	}
 	else if (strcmp(elem, "right_lung_sound") == 0)
 	{
+		*dirty |= II_FIELD(RESPIRATION_F_RIGHT_LUNG_SOUND);
 		sprintf_s(resp->right_lung_sound, STR_SIZE, "%s", value);
 	}
 	/* These are set by sim-mgr, not instructor
@@ -253,58 +286,72 @@ respiration_parse(const char* elem, const char* value, struct respiration* resp)
 	*/
 	else if (strcmp(elem, "left_lung_sound_volume") == 0)
 	{
+		*dirty |= II_FIELD(RESPIRATION_F_LEFT_LUNG_SOUND_VOLUME);
 		resp->left_lung_sound_volume = atoi(value);
 	}
 	else if (strcmp(elem, "left_lung_sound_mute") == 0)
 	{
+		*dirty |= II_FIELD(RESPIRATION_F_LEFT_LUNG_SOUND_MUTE);
 		resp->left_lung_sound_mute = atoi(value);
 	}
 	else if (strcmp(elem, "right_lung_sound_volume") == 0)
 	{
+		*dirty |= II_FIELD(RESPIRATION_F_RIGHT_LUNG_SOUND_VOLUME);
 		resp->right_lung_sound_volume = atoi(value);
 	}
 	else if (strcmp(elem, "right_lung_sound_volume") == 0)
 	{
+		*dirty |= II_FIELD(RESPIRATION_F_RIGHT_LUNG_SOUND_VOLUME);
 		resp->right_lung_sound_volume = atoi(value);
 	}
 	else if (strcmp(elem, "right_lung_sound_mute") == 0)
 	{
+		*dirty |= II_FIELD(RESPIRATION_F_RIGHT_LUNG_SOUND_MUTE);
 		resp->right_lung_sound_mute = atoi(value);
 	}
 	else if (strcmp(elem, "rate") == 0)
 	{
+		*dirty |= II_FIELD(RESPIRATION_F_RATE);
 		resp->rate = atoi(value);
 	}
 	else if (strcmp(elem, "spo2") == 0)
 	{
+		*dirty |= II_FIELD(RESPIRATION_F_SPO2);
 		resp->spo2 = atoi(value);
 	}
 	else if (strcmp(elem, "etco2") == 0)
 	{
+		*dirty |= II_FIELD(RESPIRATION_F_ETCO2);
 		resp->etco2 = atoi(value);
 	}
 	else if (strcmp(elem, "transfer_time") == 0)
 	{
+		*dirty |= II_FIELD(RESPIRATION_F_TRANSFER_TIME);
 		resp->transfer_time = atoi(value);
 	}
 	else if (strcmp(elem, "etco2_indicator") == 0)
 	{
+		*dirty |= II_FIELD(RESPIRATION_F_ETCO2_INDICATOR);
 		resp->etco2_indicator = atoi(value);
 	}
 	else if (strcmp(elem, "spo2_indicator") == 0)
 	{
+		*dirty |= II_FIELD(RESPIRATION_F_SPO2_INDICATOR);
 		resp->spo2_indicator = atoi(value);
 	}
 	else if (strcmp(elem, "chest_movement") == 0)
 	{
+		*dirty |= II_FIELD(RESPIRATION_F_CHEST_MOVEMENT);
 		resp->chest_movement = atoi(value);
 	}
 	else if (strcmp(elem, "manual_count") == 0)
 	{
+		*dirty |= II_FIELD(RESPIRATION_F_MANUAL_COUNT);
 		resp->manual_count = atoi(value);
 	}
 	else if (strcmp(elem, "manual_breath") == 0)
 	{
+		*dirty |= II_FIELD(RESPIRATION_F_MANUAL_BREATH);
 		char buf[512];
 		sprintf_s(buf, 512, "%s %s %s", "manual_breath", elem, value);
 		log_message("", buf);
@@ -331,7 +378,7 @@ getVidIndex(const char* value)
 }
 
 int
-telesim_parse(const char* elem, const char* value, struct telesim* ts)
+telesim_parse(const char* elem, const char* value, struct telesim* ts, unsigned int* dirty)
 {
 	int sts = 0;
 	int index;
@@ -342,7 +389,7 @@ telesim_parse(const char* elem, const char* value, struct telesim* ts)
 	//sprintf_s(buf, 512, "%s %s %s", "telesim", elem, value);
 	//log_message("", buf);
 
-	if ((!elem) || (!value) || (!ts))
+	if ((!elem) || (!value) || (!ts) || (!dirty))
 	{
 		return (-13);
 	}
@@ -350,6 +397,7 @@ telesim_parse(const char* elem, const char* value, struct telesim* ts)
 	if (strncmp(elem, "enable", 6) == 0)
 	{
 		ts->enable = atoi(value);
+		*dirty |= II_FIELD(TELESIM_F_ENABLE);
 	}
 	else if (strncmp(elem, "name", 4) == 0)
 	{
@@ -359,7 +407,7 @@ telesim_parse(const char* elem, const char* value, struct telesim* ts)
 		{
 			sts = 1;
 		}
-		else if (index > TSIM_WINDOWS)
+		else if (index >= TSIM_WINDOWS)
 		{
 			sts = 1;
 		}
@@ -371,6 +419,7 @@ telesim_parse(const char* elem, const char* value, struct telesim* ts)
 		{
 			arg = &ptr[1];
 			snprintf(ts->vid[index].name, STR_SIZE, "%s", arg);
+			*dirty |= II_FIELD(TELESIM_F_VID_NAME + index);
 		}
 	}
 	else if (strncmp(elem, "command", 7) == 0)
@@ -381,7 +430,7 @@ telesim_parse(const char* elem, const char* value, struct telesim* ts)
 		{
 			sts = 1;
 		}
-		else if (index > TSIM_WINDOWS)
+		else if (index >= TSIM_WINDOWS)
 		{
 			sts = 1;
 		}
@@ -404,7 +453,7 @@ telesim_parse(const char* elem, const char* value, struct telesim* ts)
 		{
 			sts = 1;
 		}
-		else if (index > TSIM_WINDOWS)
+		else if (index >= TSIM_WINDOWS)
 		{
 			sts = 1;
 		}
@@ -426,7 +475,7 @@ telesim_parse(const char* elem, const char* value, struct telesim* ts)
 		{
 			sts = 1;
 		}
-		else if (index > TSIM_WINDOWS)
+		else if (index >= TSIM_WINDOWS)
 		{
 			sts = 1;
 		}
@@ -438,6 +487,7 @@ telesim_parse(const char* elem, const char* value, struct telesim* ts)
 		{
 			arg = &ptr[1];
 			ts->vid[index].next = atoi(arg);
+			*dirty |= II_FIELD(TELESIM_F_VID_NEXT + index);
 		}
 	}
 	else
@@ -446,20 +496,22 @@ telesim_parse(const char* elem, const char* value, struct telesim* ts)
 	return (sts);
 }
 int
-general_parse(const char* elem, const char* value, struct general* gen)
+general_parse(const char* elem, const char* value, struct general* gen, unsigned int* dirty)
 {
 	int sts = 0;
 
-	if ((!elem) || (!value) || (!gen))
+	if ((!elem) || (!value) || (!gen) || (!dirty))
 	{
 		return (-13);
 	}
 	if (strcmp(elem, "temperature_enable") == 0)
 	{
+		*dirty |= II_FIELD(GENERAL_F_TEMPERATURE_ENABLE);
 		gen->temperature_enable = atoi(value);
 	}
 	else if (strcmp(elem, "temperature_units") == 0)
 	{
+		*dirty |= II_FIELD(GENERAL_F_TEMPERATURE_UNITS);
 		if (value[0] == 'F' || value[0] == 'f')
 		{
 			gen->temperature_units[0] = 'F';
@@ -473,14 +525,17 @@ general_parse(const char* elem, const char* value, struct general* gen)
  	}
 	else if (strcmp(elem, "temperature") == 0)
 	{
+		*dirty |= II_FIELD(GENERAL_F_TEMPERATURE);
 		gen->temperature = atoi(value);
 	}
 	else if (strcmp(elem, "transfer_time") == 0)
 	{
+		*dirty |= II_FIELD(GENERAL_F_TRANSFER_TIME);
 		gen->transfer_time = atoi(value);
 	}
 	else if (strcmp(elem, "clock_start") == 0)
 	{
+		*dirty |= II_FIELD(GENERAL_F_CLOCK_START);
 		sprintf_s(gen->clockStart, 64, "%s", value);
 	}
 	else
@@ -491,32 +546,37 @@ general_parse(const char* elem, const char* value, struct general* gen)
 }
 
 int
-vocals_parse(const char* elem, const char* value, struct vocals* voc)
+vocals_parse(const char* elem, const char* value, struct vocals* voc, unsigned int* dirty)
 {
 	int sts = 0;
 
-	if ((!elem) || (!value) || (!voc))
+	if ((!elem) || (!value) || (!voc) || (!dirty))
 	{
 		return (-14);
 	}
 	if (strcmp(elem, "filename") == 0)
 	{
+		*dirty |= II_FIELD(VOCALS_F_FILENAME);
 		sprintf_s(voc->filename, FILENAME_SIZE, "%s", value);
 	}
 	else if (strcmp(elem, "repeat") == 0)
 	{
+		*dirty |= II_FIELD(VOCALS_F_REPEAT);
 		voc->repeat = atoi(value);
 	}
 	else if (strcmp(elem, "volume") == 0)
 	{
+		*dirty |= II_FIELD(VOCALS_F_VOLUME);
 		voc->volume = atoi(value);
 	}
 	else if (strcmp(elem, "play") == 0)
 	{
+		*dirty |= II_FIELD(VOCALS_F_PLAY);
 		voc->play = atoi(value);
 	}
 	else if (strcmp(elem, "mute") == 0)
 	{
+		*dirty |= II_FIELD(VOCALS_F_MUTE);
 		voc->mute = atoi(value);
 	}
 	else
@@ -526,20 +586,22 @@ vocals_parse(const char* elem, const char* value, struct vocals* voc)
 	return (sts);
 }
 int
-media_parse(const char* elem, const char* value, struct media* med)
+media_parse(const char* elem, const char* value, struct media* med, unsigned int* dirty)
 {
 	int sts = 0;
 
-	if ((!elem) || (!value) || (!med))
+	if ((!elem) || (!value) || (!med) || (!dirty))
 	{
 		return (-14);
 	}
 	if (strcmp(elem, "filename") == 0)
 	{
+		*dirty |= II_FIELD(MEDIA_F_FILENAME);
 		sprintf_s(med->filename, FILENAME_SIZE, "%s", value);
 	}
 	else if (strcmp(elem, "play") == 0)
 	{
+		*dirty |= II_FIELD(MEDIA_F_PLAY);
 		med->play = atoi(value);
 	}
 	else
@@ -549,20 +611,22 @@ media_parse(const char* elem, const char* value, struct media* med)
 	return (sts);
 }
 int
-cpr_parse(const char* elem, const char* value, struct cpr* cpr)
+cpr_parse(const char* elem, const char* value, struct cpr* cpr, unsigned int* dirty)
 {
 	int sts = 0;
 
-	if ((!elem) || (!value) || (!cpr))
+	if ((!elem) || (!value) || (!cpr) || (!dirty))
 	{
 		return (-15);
 	}
 	if (strcmp(elem, "duration") == 0)
 	{
+		*dirty |= II_FIELD(CPR_F_DURATION);
 		cpr->duration = atoi(value);
 	}
 	else if (strcmp(elem, "compression") == 0)
 	{
+		*dirty |= II_FIELD(CPR_F_COMPRESSION);
 		cpr->compression = atoi(value);
 	}
 	else
@@ -652,45 +716,424 @@ initializeParameterStruct(struct instructor* initParams)
 	initParams->telesim.vid[1].next = -1;
 }
 
+/*
+ * Instructor fields a scenario or scene <init> can set, with the members that
+ * scan_commands reads for each. Text members are packed without their unused tail.
+ */
+struct init_member
+{
+	int section;
+	int field;
+	size_t offset;
+	size_t size;
+	int text;
+};
+
+#define INIT_MEMBER(section, field, member, text) \
+	{ section, field, offsetof(struct instructor, member), sizeof(((struct instructor*)0)->member), text }
+
+static_assert(TSIM_WINDOWS == 2, "initMembers lists two telesim windows");
+static_assert(sizeof(struct instructor) <= 0xffff, "init_record offsets are 16 bits");
+
+static const struct init_member initMembers[] =
+{
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_RHYTHM, cardiac.rhythm, 1),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_RATE, cardiac.rate, 0),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_NIBP_RATE, cardiac.nibp_rate, 0),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_NIBP_READ, cardiac.nibp_read, 0),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_NIBP_LINKED_HR, cardiac.nibp_linked_hr, 0),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_NIBP_FREQ, cardiac.nibp_freq, 0),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_PWAVE, cardiac.pwave, 1),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_PR_INTERVAL, cardiac.pr_interval, 0),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_QRS_INTERVAL, cardiac.qrs_interval, 0),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_BPS_SYS, cardiac.bps_sys, 0),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_BPS_DIA, cardiac.bps_dia, 0),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_PEA, cardiac.pea, 0),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_RIGHT_DORSAL_PULSE, cardiac.right_dorsal_pulse_strength, 0),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_RIGHT_FEMORAL_PULSE, cardiac.right_femoral_pulse_strength, 0),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_LEFT_DORSAL_PULSE, cardiac.left_dorsal_pulse_strength, 0),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_LEFT_FEMORAL_PULSE, cardiac.left_femoral_pulse_strength, 0),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_VPC_FREQ, cardiac.vpc_freq, 0),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_VPC_DELAY, cardiac.vpc_delay, 0),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_VPC, cardiac.vpc, 1),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_VFIB_AMPLITUDE, cardiac.vfib_amplitude, 1),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_HEART_SOUND, cardiac.heart_sound, 1),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_HEART_SOUND_VOLUME, cardiac.heart_sound_volume, 0),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_HEART_SOUND_MUTE, cardiac.heart_sound_mute, 0),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_ECG_INDICATOR, cardiac.ecg_indicator, 0),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_BP_CUFF, cardiac.bp_cuff, 0),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_ARREST, cardiac.arrest, 0),
+	INIT_MEMBER(II_CARDIAC, CARDIAC_F_TRANSFER_TIME, cardiac.transfer_time, 0),
+
+	INIT_MEMBER(II_RESPIRATION, RESPIRATION_F_LEFT_LUNG_SOUND, respiration.left_lung_sound, 1),
+	INIT_MEMBER(II_RESPIRATION, RESPIRATION_F_RIGHT_LUNG_SOUND, respiration.right_lung_sound, 1),
+	INIT_MEMBER(II_RESPIRATION, RESPIRATION_F_LEFT_LUNG_SOUND_VOLUME, respiration.left_lung_sound_volume, 0),
+	INIT_MEMBER(II_RESPIRATION, RESPIRATION_F_LEFT_LUNG_SOUND_MUTE, respiration.left_lung_sound_mute, 0),
+	INIT_MEMBER(II_RESPIRATION, RESPIRATION_F_RIGHT_LUNG_SOUND_VOLUME, respiration.right_lung_sound_volume, 0),
+	INIT_MEMBER(II_RESPIRATION, RESPIRATION_F_RIGHT_LUNG_SOUND_MUTE, respiration.right_lung_sound_mute, 0),
+	INIT_MEMBER(II_RESPIRATION, RESPIRATION_F_RATE, respiration.rate, 0),
+	INIT_MEMBER(II_RESPIRATION, RESPIRATION_F_SPO2, respiration.spo2, 0),
+	INIT_MEMBER(II_RESPIRATION, RESPIRATION_F_ETCO2, respiration.etco2, 0),
+	INIT_MEMBER(II_RESPIRATION, RESPIRATION_F_ETCO2_INDICATOR, respiration.etco2_indicator, 0),
+	INIT_MEMBER(II_RESPIRATION, RESPIRATION_F_SPO2_INDICATOR, respiration.spo2_indicator, 0),
+	INIT_MEMBER(II_RESPIRATION, RESPIRATION_F_CHEST_MOVEMENT, respiration.chest_movement, 0),
+	INIT_MEMBER(II_RESPIRATION, RESPIRATION_F_MANUAL_COUNT, respiration.manual_count, 0),
+	INIT_MEMBER(II_RESPIRATION, RESPIRATION_F_MANUAL_BREATH, respiration.manual_breath, 0),
+	INIT_MEMBER(II_RESPIRATION, RESPIRATION_F_TRANSFER_TIME, respiration.transfer_time, 0),
+
+	INIT_MEMBER(II_GENERAL, GENERAL_F_TEMPERATURE, general.temperature, 0),
+	INIT_MEMBER(II_GENERAL, GENERAL_F_TEMPERATURE_UNITS, general.temperature_units, 1),
+	INIT_MEMBER(II_GENERAL, GENERAL_F_TEMPERATURE_ENABLE, general.temperature_enable, 0),
+	INIT_MEMBER(II_GENERAL, GENERAL_F_CLOCK_START, general.clockStart, 1),
+	INIT_MEMBER(II_GENERAL, GENERAL_F_TRANSFER_TIME, general.transfer_time, 0),
+
+	INIT_MEMBER(II_MEDIA, VOCALS_F_FILENAME, vocals.filename, 1),
+	INIT_MEMBER(II_MEDIA, VOCALS_F_REPEAT, vocals.repeat, 0),
+	INIT_MEMBER(II_MEDIA, VOCALS_F_VOLUME, vocals.volume, 0),
+	INIT_MEMBER(II_MEDIA, VOCALS_F_PLAY, vocals.play, 0),
+	INIT_MEMBER(II_MEDIA, VOCALS_F_MUTE, vocals.mute, 0),
+	INIT_MEMBER(II_MEDIA, MEDIA_F_FILENAME, media.filename, 1),
+	INIT_MEMBER(II_MEDIA, MEDIA_F_PLAY, media.play, 0),
+
+	INIT_MEMBER(II_CPR, CPR_F_COMPRESSION, cpr.compression, 0),
+	INIT_MEMBER(II_CPR, CPR_F_RELEASE, cpr.release, 0),
+	INIT_MEMBER(II_CPR, CPR_F_DURATION, cpr.duration, 0),
+
+	INIT_MEMBER(II_TELESIM, TELESIM_F_ENABLE, telesim.enable, 0),
+	INIT_MEMBER(II_TELESIM, TELESIM_F_VID_NAME + 0, telesim.vid[0].name, 1),
+	INIT_MEMBER(II_TELESIM, TELESIM_F_VID_NAME + 1, telesim.vid[1].name, 1),
+	INIT_MEMBER(II_TELESIM, TELESIM_F_VID_NEXT + 0, telesim.vid[0].command, 0),
+	INIT_MEMBER(II_TELESIM, TELESIM_F_VID_NEXT + 0, telesim.vid[0].param, 0),
+	INIT_MEMBER(II_TELESIM, TELESIM_F_VID_NEXT + 0, telesim.vid[0].next, 0),
+	INIT_MEMBER(II_TELESIM, TELESIM_F_VID_NEXT + 1, telesim.vid[1].command, 0),
+	INIT_MEMBER(II_TELESIM, TELESIM_F_VID_NEXT + 1, telesim.vid[1].param, 0),
+	INIT_MEMBER(II_TELESIM, TELESIM_F_VID_NEXT + 1, telesim.vid[1].next, 0),
+};
+
+#define INIT_NEXT_RANDOM	0x01	// vid[v].next, set to rand() on each processInit
+
+// Packed in init_overrides.data, each followed by size bytes of the member
+struct init_record
+{
+	uint16_t offset;		// In struct instructor
+	uint16_t size;
+	uint8_t section;
+	uint8_t field;
+	uint8_t flags;
+	uint8_t pad;
+};
+
+/*
+ * FUNCTION: initPack
+ *
+ * ARGUMENTS:
+ *		init	- Parsed <init>, from initializeParameterStruct() and the *_parse() calls
+ *		out		- Receives the fields init sets. Anything it held is freed.
+ */
+void
+initPack(struct instructor* init, struct init_overrides* out)
+{
+	std::vector<unsigned char> data;
+	struct init_record rec;
+	unsigned int dirty[II_SECTION_COUNT];
+	unsigned int randomNext = 0;
+	const struct init_member* m;
+	const unsigned char* src;
+	size_t size;
+	int v;
+
+	initFree(out);
+	memcpy(dirty, init->dirty, sizeof(dirty));
+
+	// A telesim window with a name, command or param is sent with a new "next", as
+	// scan_commands only passes a command on when "next" changes
+	for (v = 0; v < TSIM_WINDOWS; v++)
+	{
+		if (strlen(init->telesim.vid[v].name) > 0 ||
+			init->telesim.vid[v].command != -1 ||
+			init->telesim.vid[v].param != -1)
+		{
+			dirty[II_TELESIM] |= II_FIELD(TELESIM_F_VID_NEXT + v);
+			randomNext |= II_FIELD(TELESIM_F_VID_NEXT + v);
+		}
+	}
+
+	for (m = initMembers; m < initMembers + sizeof(initMembers) / sizeof(initMembers[0]); m++)
+	{
+		if (!(dirty[m->section] & II_FIELD(m->field)))
+		{
+			continue;
+		}
+		src = (const unsigned char*)init + m->offset;
+		size = m->text ? strnlen((const char*)src, m->size - 1) + 1 : m->size;
+		rec.offset = (uint16_t)m->offset;
+		rec.size = (uint16_t)size;
+		rec.section = (uint8_t)m->section;
+		rec.field = (uint8_t)m->field;
+		rec.flags = 0;
+		rec.pad = 0;
+		if ((randomNext & II_FIELD(m->field)) && m->section == II_TELESIM &&
+			(m->offset == offsetof(struct instructor, telesim.vid[0].next) ||
+			 m->offset == offsetof(struct instructor, telesim.vid[1].next)))
+		{
+			rec.flags = INIT_NEXT_RANDOM;
+		}
+		data.insert(data.end(), (const unsigned char*)&rec, (const unsigned char*)&rec + sizeof(rec));
+		data.insert(data.end(), src, src + size);
+		out->sections |= II_MASK(m->section);
+		out->count++;
+	}
+	if (!data.empty())
+	{
+		out->data = (unsigned char*)malloc(data.size());
+		if (!out->data)
+		{
+			out->count = 0;
+			out->sections = 0;
+			return;
+		}
+		memcpy(out->data, data.data(), data.size());
+		out->size = (unsigned int)data.size();
+	}
+}
+
+void
+initFree(struct init_overrides* ov)
+{
+	free(ov->data);
+	ov->data = NULL;
+	ov->size = 0;
+	ov->count = 0;
+	ov->sections = 0;
+}
+
 /**
 * processInit
-* @initParams: Pointer to a "struct instructor"
+* @init: Overrides from initPack()
 *
-* Transfer the instructions from the initParams to the instructor portion of
-* the shared data space, to activate all the controls.
+* Write the fields of a scenario or scene <init> into the instructor portion of
+* the shared data space and mark them, to activate those controls. Returns once
+* scan_commands has applied them.
 */
 void
-processInit(struct instructor* initParams)
+processInit(struct init_overrides* init)
 {
-	takeInstructorLock();
-
-	// Copy initParams to shared instructor interface (not the sema or scenario sections)
+	struct init_record rec;
+	const unsigned char* p;
+	const unsigned char* end;
+	unsigned char* base = (unsigned char*)&simmgr_shm->instructor;
+	uint64_t gen;
+	uint64_t start = metric_usec();
+	int next;
 
-	memcpy(&simmgr_shm->instructor.cardiac, &initParams->cardiac, sizeof(struct cardiac));
-	memcpy(&simmgr_shm->instructor.respiration, &initParams->respiration, sizeof(struct respiration));
-	memcpy(&simmgr_shm->instructor.general, &initParams->general, sizeof(struct general));
-	memcpy(&simmgr_shm->instructor.vocals, &initParams->vocals, sizeof(struct vocals));
-	memcpy(&simmgr_shm->instructor.media, &initParams->media, sizeof(struct media));
-	memcpy(&simmgr_shm->instructor.cpr, &initParams->cpr, sizeof(struct cpr));
+	if (init->count == 0)
+	{
+		return;
+	}
+	takeInstructorSections(init->sections);
+	p = init->data;
+	end = init->data + init->size;
+	while (p + sizeof(rec) <= end)
+	{
+		memcpy(&rec, p, sizeof(rec));
+		p += sizeof(rec);
+		if (rec.flags & INIT_NEXT_RANDOM)
+		{
+			next = rand();
+			memcpy(base + rec.offset, &next, sizeof(next));
+		}
+		else
+		{
+			memcpy(base + rec.offset, p, rec.size);
+		}
+		p += rec.size;
+		simmgr_shm->instructor.dirty[rec.section] |= II_FIELD(rec.field);
+	}
+	releaseInstructorSections(init->sections);
+	notify_signal(NOTIFY_INSTRUCTOR);
+	gen = notify_generation(NOTIFY_INSTRUCTOR);
 
-	if (strlen(initParams->telesim.vid[0].name) > 0 ||
-		initParams->telesim.vid[0].command != -1 ||
-		initParams->telesim.vid[0].param != -1)
+	if (headless)
+	{
+		// The caller is the scheduler thread, so pick up the changes now
+		(void)scan_commands();
+	}
+	else if (!notify_wait_ack(NOTIFY_INSTRUCTOR, gen, INIT_ACK_TIMEOUT))
 	{
-		initParams->telesim.vid[0].next = rand();
+		// Not fatal; scan_commands applies the changes when it next runs
+		log_message("", "processInit: scan_commands has not applied the scene parameters");
 	}
-	if (strlen(initParams->telesim.vid[1].name) > 0 ||
-		initParams->telesim.vid[1].command != -1 ||
-		initParams->telesim.vid[1].param != -1)
+	metric_time(METRIC_TIME_SCENE_INIT, metric_usec() - start);
+}
+
+struct param_name
+{
+	const char* param_class;
+	const char* param_element;
+	int handle;
+};
+
+static const struct param_name paramNames[] =
+{
+	{ "cardiac", "vpc_freq", PARAM_CARDIAC_VPC_FREQ },
+	{ "cardiac", "vpc_delay", PARAM_CARDIAC_VPC_DELAY },
+	{ "cardiac", "pea", PARAM_CARDIAC_PEA },
+	{ "cardiac", "rate", PARAM_CARDIAC_RATE },
+	{ "cardiac", "avg_rate", PARAM_CARDIAC_AVG_RATE },
+	{ "cardiac", "nibp_rate", PARAM_CARDIAC_NIBP_RATE },
+	{ "cardiac", "nibp_read", PARAM_CARDIAC_NIBP_READ },
+	{ "cardiac", "nibp_linked_hr", PARAM_CARDIAC_NIBP_LINKED_HR },
+	{ "cardiac", "nibp_freq", PARAM_CARDIAC_NIBP_FREQ },
+	{ "cardiac", "pr_interval", PARAM_CARDIAC_PR_INTERVAL },
+	{ "cardiac", "qrs_interval", PARAM_CARDIAC_QRS_INTERVAL },
+	{ "cardiac", "bps_sys", PARAM_CARDIAC_BPS_SYS },
+	{ "cardiac", "bps_dia", PARAM_CARDIAC_BPS_DIA },
+	{ "cardiac", "ecg_indicator", PARAM_CARDIAC_ECG_INDICATOR },
+	{ "cardiac", "bp_cuff", PARAM_CARDIAC_BP_CUFF },
+	{ "cardiac", "cpr_time", PARAM_CARDIAC_BP_CUFF },		// Historical; reads bp_cuff
+	{ "cardiac", "arrest", PARAM_CARDIAC_ARREST },
+	{ "respiration", "spo2", PARAM_RESPIRATION_SPO2 },
+	{ "respiration", "awRR", PARAM_RESPIRATION_AWRR },
+	{ "respiration", "awrr", PARAM_RESPIRATION_AWRR },
+	{ "respiration", "rate", PARAM_RESPIRATION_RATE },
+	{ "respiration", "etco2_indicator", PARAM_RESPIRATION_ETCO2_INDICATOR },
+	{ "respiration", "spo2_indicator", PARAM_RESPIRATION_SPO2_INDICATOR },
+	{ "respiration", "chest_movement", PARAM_RESPIRATION_CHEST_MOVEMENT },
+	{ "respiration", "manual_count", PARAM_RESPIRATION_MANUAL_COUNT },
+	{ "respiration", "etco2", PARAM_RESPIRATION_ETCO2 },
+	{ "general", "temperature_enable", PARAM_GENERAL_TEMPERATURE_ENABLE },
+	{ "general", "temperature", PARAM_GENERAL_TEMPERATURE },
+	{ "telesim", "enable", PARAM_TELESIM_ENABLE },
+	{ "cpr", "duration", PARAM_CPR_DURATION },
+	{ "pulse", "left_femoral", PARAM_PULSE_LEFT_FEMORAL },
+	{ "pulse", "right_femoral", PARAM_PULSE_RIGHT_FEMORAL },
+	{ "pulse", "duration", PARAM_PULSE_DURATION },
+	{ "pulse", "active", PARAM_PULSE_ACTIVE },
+	{ NULL, NULL, PARAM_NONE }
+};
+
+/*
+ * FUNCTION: getParamHandle
+ *
+ * ARGUMENTS:
+ *		param_class		- eg: cardiac, respiration
+ *		param_element	- eg: rate
+ *
+ * RETURNS:
+ *		The StatusParam, or PARAM_NONE if the parameter cannot be tested
+ */
+int
+getParamHandle(const char* param_class, const char* param_element)
+{
+	const struct param_name* pn;
+
+	for (pn = paramNames; pn->param_class; pn++)
 	{
-		initParams->telesim.vid[1].next = rand();
+		if (strcmp(param_class, pn->param_class) == 0 && strcmp(param_element, pn->param_element) == 0)
+		{
+			return (pn->handle);
+		}
 	}
-	memcpy(&simmgr_shm->instructor.telesim, &initParams->telesim, sizeof(struct telesim));
-	releaseInstructorLock();
+	return (PARAM_NONE);
+}
+
+/*
+ * Values a parameter can take, from the limits of the Instructor Interface
+ * controls. Temperature is in tenths of a degree, F or C. Parameters not listed
+ * are not limited.
+ */
+struct param_limit
+{
+	int handle;
+	int min;
+	int max;
+};
+
+static const struct param_limit paramLimits[] =
+{
+	{ PARAM_CARDIAC_PEA, 0, 1 },
+	{ PARAM_CARDIAC_RATE, 0, 300 },
+	{ PARAM_CARDIAC_AVG_RATE, 0, 300 },
+	{ PARAM_CARDIAC_NIBP_RATE, 0, 300 },
+	{ PARAM_CARDIAC_BPS_SYS, 0, 300 },
+	{ PARAM_CARDIAC_BPS_DIA, 0, 290 },
+	{ PARAM_CARDIAC_ARREST, 0, 1 },
+	{ PARAM_RESPIRATION_SPO2, 0, 100 },
+	{ PARAM_RESPIRATION_AWRR, 0, 60 },
+	{ PARAM_RESPIRATION_RATE, 0, 60 },
+	{ PARAM_RESPIRATION_ETCO2, 0, 100 },
+	{ PARAM_GENERAL_TEMPERATURE_ENABLE, 0, 1 },
+	{ PARAM_GENERAL_TEMPERATURE, 200, 1100 },
+	{ PARAM_TELESIM_ENABLE, 0, 1 },
+	{ PARAM_PULSE_ACTIVE, 0, 1 },
+	{ PARAM_NONE, 0, 0 }
+};
+
+/*
+ * FUNCTION: getParamLimits
+ *
+ * RETURNS:
+ *		0 with min and max set if the parameter is limited, else -1
+ */
+int
+getParamLimits(int handle, int* min, int* max)
+{
+	const struct param_limit* pl;
 
-	// Delay to allow simmgr to pick up the changes
-	sim_sleep_ms(500);
+	for (pl = paramLimits; pl->handle != PARAM_NONE; pl++)
+	{
+		if (pl->handle == handle)
+		{
+			*min = pl->min;
+			*max = pl->max;
+			return (0);
+		}
+	}
+	return (-1);
+}
 
+/*
+ * getValueFromHandle is used by the scenario processor. PARAM_NONE reads as -1.
+ */
+int
+getValueFromHandle(int handle)
+{
+	switch (handle)
+	{
+	case PARAM_CARDIAC_VPC_FREQ:			return (simmgr_shm->status.cardiac.vpc_freq);
+	case PARAM_CARDIAC_VPC_DELAY:			return (simmgr_shm->status.cardiac.vpc_delay);
+	case PARAM_CARDIAC_PEA:					return (simmgr_shm->status.cardiac.pea);
+	case PARAM_CARDIAC_RATE:				return (simmgr_shm->status.cardiac.rate);
+	case PARAM_CARDIAC_AVG_RATE:			return (simmgr_shm->status.cardiac.avg_rate);
+	case PARAM_CARDIAC_NIBP_RATE:			return (simmgr_shm->status.cardiac.nibp_rate);
+	case PARAM_CARDIAC_NIBP_READ:			return (simmgr_shm->status.cardiac.nibp_read);
+	case PARAM_CARDIAC_NIBP_LINKED_HR:		return (simmgr_shm->status.cardiac.nibp_linked_hr);
+	case PARAM_CARDIAC_NIBP_FREQ:			return (simmgr_shm->status.cardiac.nibp_freq);
+	case PARAM_CARDIAC_PR_INTERVAL:			return (simmgr_shm->status.cardiac.pr_interval);
+	case PARAM_CARDIAC_QRS_INTERVAL:		return (simmgr_shm->status.cardiac.qrs_interval);
+	case PARAM_CARDIAC_BPS_SYS:				return (simmgr_shm->status.cardiac.bps_sys);
+	case PARAM_CARDIAC_BPS_DIA:				return (simmgr_shm->status.cardiac.bps_dia);
+	case PARAM_CARDIAC_ECG_INDICATOR:		return (simmgr_shm->status.cardiac.ecg_indicator);
+	case PARAM_CARDIAC_BP_CUFF:				return (simmgr_shm->status.cardiac.bp_cuff);
+	case PARAM_CARDIAC_ARREST:				return (simmgr_shm->status.cardiac.arrest);
+	case PARAM_RESPIRATION_SPO2:			return (simmgr_shm->status.respiration.spo2);
+	case PARAM_RESPIRATION_AWRR:			return (simmgr_shm->status.respiration.awRR);
+	case PARAM_RESPIRATION_RATE:			return (simmgr_shm->status.respiration.rate);
+	case PARAM_RESPIRATION_ETCO2_INDICATOR:	return (simmgr_shm->status.respiration.etco2_indicator);
+	case PARAM_RESPIRATION_SPO2_INDICATOR:	return (simmgr_shm->status.respiration.spo2_indicator);
+	case PARAM_RESPIRATION_CHEST_MOVEMENT:	return (simmgr_shm->status.respiration.chest_movement);
+	case PARAM_RESPIRATION_MANUAL_COUNT:	return (simmgr_shm->status.respiration.manual_count);
+	case PARAM_RESPIRATION_ETCO2:			return (simmgr_shm->status.respiration.etco2);
+	case PARAM_GENERAL_TEMPERATURE_ENABLE:	return (simmgr_shm->status.general.temperature_enable);
+	case PARAM_GENERAL_TEMPERATURE:			return (simmgr_shm->status.general.temperature);
+	case PARAM_TELESIM_ENABLE:				return (simmgr_shm->status.telesim.enable);
+	case PARAM_CPR_DURATION:				return (simmgr_shm->status.cpr.duration);
+	case PARAM_PULSE_LEFT_FEMORAL:			return (simmgr_shm->status.pulse.left_femoral);
+	case PARAM_PULSE_RIGHT_FEMORAL:			return (simmgr_shm->status.pulse.right_femoral);
+	case PARAM_PULSE_DURATION:				return (simmgr_shm->status.pulse.duration);
+	case PARAM_PULSE_ACTIVE:				return (simmgr_shm->status.pulse.active);
+	default:								return (-1);
+	}
 }
 
 /*
@@ -699,91 +1142,36 @@ processInit(struct instructor* initParams)
 int
 getValueFromName(char* param_class, char* param_element)
 {
-	int rval = -1;
-
-	if (strcmp(param_class, "cardiac") == 0)
-	{
-		if (strcmp(param_element, "vpc_freq") == 0)
-			rval = simmgr_shm->status.cardiac.vpc_freq;
-		else if (strcmp(param_element, "vpc_delay") == 0)
-			rval = simmgr_shm->status.cardiac.vpc_delay;
-		else if (strcmp(param_element, "pea") == 0)
-			rval = simmgr_shm->status.cardiac.pea;
-		else if (strcmp(param_element, "rate") == 0)
-			rval = simmgr_shm->status.cardiac.rate;
-		else if (strcmp(param_element, "avg_rate") == 0)
-			rval = simmgr_shm->status.cardiac.avg_rate;
-		else if (strcmp(param_element, "nibp_rate") == 0)
-			rval = simmgr_shm->status.cardiac.nibp_rate;
-		else if (strcmp(param_element, "nibp_read") == 0)
-			rval = simmgr_shm->status.cardiac.nibp_read;
-		else if (strcmp(param_element, "nibp_linked_hr") == 0)
-			rval = simmgr_shm->status.cardiac.nibp_linked_hr;
-		else if (strcmp(param_element, "nibp_freq") == 0)
-			rval = simmgr_shm->status.cardiac.nibp_freq;
-		else if (strcmp(param_element, "pr_interval") == 0)
-			rval = simmgr_shm->status.cardiac.pr_interval;
-		else if (strcmp(param_element, "qrs_interval") == 0)
-			rval = simmgr_shm->status.cardiac.qrs_interval;
-		else if (strcmp(param_element, "bps_sys") == 0)
-			rval = simmgr_shm->status.cardiac.bps_sys;
-		else if (strcmp(param_element, "bps_dia") == 0)
-			rval = simmgr_shm->status.cardiac.bps_dia;
-		else if (strcmp(param_element, "ecg_indicator") == 0)
-			rval = simmgr_shm->status.cardiac.ecg_indicator;
-		else if (strcmp(param_element, "bp_cuff") == 0)
-			rval = simmgr_shm->status.cardiac.bp_cuff;
-		else if (strcmp(param_element, "cpr_time") == 0)
-			rval = simmgr_shm->status.cardiac.bp_cuff;
-		else if (strcmp(param_element, "arrest") == 0)
-			rval = simmgr_shm->status.cardiac.arrest;
-	}
-	else if (strcmp(param_class, "respiration") == 0)
-	{
-		if (strcmp(param_element, "spo2") == 0)
-			rval = simmgr_shm->status.respiration.spo2;
-		else if ( (strcmp(param_element, "awRR") == 0) || (strcmp(param_element, "awrr") == 0) )
-			rval = simmgr_shm->status.respiration.awRR;
-		else if (strcmp(param_element, "rate") == 0)
-			rval = simmgr_shm->status.respiration.rate;
-		else if (strcmp(param_element, "etco2_indicator") == 0)
-			rval = simmgr_shm->status.respiration.etco2_indicator;
-		else if (strcmp(param_element, "spo2_indicator") == 0)
-			rval = simmgr_shm->status.respiration.spo2_indicator;
-		else if (strcmp(param_element, "chest_movement") == 0)
-			rval = simmgr_shm->status.respiration.chest_movement;
-		else if (strcmp(param_element, "manual_count") == 0)
-			rval = simmgr_shm->status.respiration.manual_count;
-		else if (strcmp(param_element, "etco2") == 0)
-			rval = simmgr_shm->status.respiration.etco2;
-	}
-	else if (strcmp(param_class, "general") == 0)
-	{
-		if (strcmp(param_element, "temperature_enable") == 0)
-			rval = simmgr_shm->status.general.temperature_enable;
-		else if (strcmp(param_element, "temperature") == 0)
-			rval = simmgr_shm->status.general.temperature;
-	}
-	else if (strcmp(param_class, "telesim") == 0)
-	{
-		if (strcmp(param_element, "enable") == 0)
-			rval = simmgr_shm->status.telesim.enable;
-	}
-	else if (strcmp(param_class, "cpr") == 0)
-	{
-		if (strcmp(param_element, "duration") == 0)
-			rval = simmgr_shm->status.cpr.duration;
-	}
-	else if (strcmp(param_class, "pulse") == 0)
-	{
-		if (strcmp(param_element, "left_femoral") == 0)
-			rval = simmgr_shm->status.pulse.left_femoral;
-		if (strcmp(param_element, "right_femoral") == 0)
-			rval = simmgr_shm->status.pulse.right_femoral;
-		if (strcmp(param_element, "duration") == 0)
-			rval = simmgr_shm->status.pulse.duration;
-		if (strcmp(param_element, "active") == 0)
-			rval = simmgr_shm->status.pulse.active;
-	}
-	return (rval);
+	return (getValueFromHandle(getParamHandle(param_class, param_element)));
+}
+
+/*
+ * Event IDs are interned to integers as scenarios are compiled, so the scenario
+ * processor matches a posted event with one lookup. IDs are kept for the life of
+ * the process; a name only gets one when a scenario tests it.
+ */
+static std::unordered_map<std::string, int> eventIds;
+static std::mutex eventIdLock;
+
+int
+internEvent(const char* name)
+{
+	std::lock_guard<std::mutex> lock(eventIdLock);
+
+	return (eventIds.emplace(name, (int)eventIds.size()).first->second);
+}
+
+/*
+ * FUNCTION: getEventHandle
+ *
+ * RETURNS:
+ *		The ID from internEvent(), or EVENT_ID_NONE if no scenario tests the event
+ */
+int
+getEventHandle(const char* name)
+{
+	std::lock_guard<std::mutex> lock(eventIdLock);
+	auto it = eventIds.find(name);
+
+	return (it == eventIds.end() ? EVENT_ID_NONE : it->second);
 }
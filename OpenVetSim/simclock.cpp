@@ -0,0 +1,171 @@
+/*
+ * simclock.cpp
+ *
+ * Monotonic simulation clock, shared by every subsystem that measures elapsed time.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "simclock.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+/*
+ * While the clock runs at the OS rate it is the OS clock, with no lock. Once the
+ * rate is changed or the clock is stopped, the time is
+ *		clockBase + (real - clockBaseReal) * clockRate
+ * and each change moves the base to the current time, so the time is continuous.
+ * clockLast keeps it from going backwards when a reading races a change.
+ */
+static std::atomic<bool> clockAdjusted(false);
+static std::mutex clockMutex;
+static uint64_t clockBase = 0;
+static uint64_t clockBaseReal = 0;
+static double clockRate = 1.0;
+static bool clockManual = false;
+static std::atomic<uint64_t> clockLast(0);
+static std::atomic<uint64_t> clockCoarse(0);
+
+uint64_t
+clock_real_nsec(void)
+{
+	return ((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Call with clockMutex held
+static uint64_t
+clock_adjusted_nsec(uint64_t real)
+{
+	if (clockManual)
+	{
+		return (clockBase);
+	}
+	return (clockBase + (uint64_t)((double)(real - clockBaseReal) * clockRate));
+}
+
+uint64_t
+clock_nsec(void)
+{
+	uint64_t now;
+	uint64_t last;
+
+	if (!clockAdjusted.load(std::memory_order_acquire))
+	{
+		return (clock_real_nsec());
+	}
+	{
+		std::lock_guard<std::mutex> lock(clockMutex);
+		now = clock_adjusted_nsec(clock_real_nsec());
+	}
+	last = clockLast.load(std::memory_order_relaxed);
+	while (now > last && !clockLast.compare_exchange_weak(last, now, std::memory_order_relaxed))
+	{
+	}
+	return (now > last ? now : last);
+}
+
+// Call with clockMutex held. Moves the base to now before the rate or mode changes.
+static void
+clock_rebase(void)
+{
+	uint64_t real;
+
+	real = clock_real_nsec();
+	if (clockAdjusted.load(std::memory_order_relaxed))
+	{
+		clockBase = clock_adjusted_nsec(real);
+	}
+	else
+	{
+		clockBase = real;
+	}
+	clockBaseReal = real;
+	clockLast.store(clockBase, std::memory_order_relaxed);
+}
+
+/*
+ * FUNCTION: clock_set_rate
+ *
+ * ARGUMENTS:
+ *		rate	- Simulation seconds per real second. 1.0 is real time.
+ */
+void
+clock_set_rate(double rate)
+{
+	std::lock_guard<std::mutex> lock(clockMutex);
+
+	if (rate <= 0)
+	{
+		return;
+	}
+	clock_rebase();
+	clockRate = rate;
+	clockAdjusted.store(true, std::memory_order_release);
+}
+
+/*
+ * FUNCTION: clock_set_manual
+ *
+ * ARGUMENTS:
+ *		manual	- true to stop the clock; it then moves only with clock_advance()
+ */
+void
+clock_set_manual(bool manual)
+{
+	std::lock_guard<std::mutex> lock(clockMutex);
+
+	clock_rebase();
+	clockManual = manual;
+	clockAdjusted.store(true, std::memory_order_release);
+}
+
+void
+clock_advance(uint64_t nsec)
+{
+	std::lock_guard<std::mutex> lock(clockMutex);
+
+	if (clockManual)
+	{
+		clockBase += nsec;
+	}
+}
+
+/*
+ * FUNCTION: clock_tick
+ *
+ * Refresh the coarse time.
+ *
+ * RETURNS:
+ *		The current msec time
+ */
+uint64_t
+clock_tick(void)
+{
+	uint64_t msec;
+
+	msec = clock_msec();
+	clockCoarse.store(msec, std::memory_order_relaxed);
+	return (msec);
+}
+
+uint64_t
+clock_coarse_msec(void)
+{
+	return (clockCoarse.load(std::memory_order_relaxed));
+}
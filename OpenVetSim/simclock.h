@@ -0,0 +1,60 @@
+#pragma once
+
+/*
+ * simclock.h
+ *
+ * Monotonic simulation clock, shared by every subsystem that measures elapsed time.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+
+/*
+ * clock_nsec() is the simulation time in nsec. It counts from the same point as
+ * the OS monotonic clock, so it never steps when the wall clock is set (NTP, DST)
+ * and a value taken before a session is still comparable after it.
+ *
+ * Elapsed times (scene time, palpation and CPR durations, timers, trends) all use
+ * it. Wall clock time is only for showing the date and time and naming files.
+ *
+ * By default it runs with the OS clock. clock_set_rate() runs it faster or slower,
+ * and clock_set_manual() stops it so that only clock_advance() moves it, for a
+ * deterministic run. Either way it never goes backwards.
+ *
+ * clock_coarse_msec() is the msec time at the last clock_tick(), for hot paths
+ * that only need the resolution of the tick (5 msec, from hrcheck_handler).
+ */
+uint64_t clock_nsec(void);
+uint64_t clock_real_nsec(void);			// OS monotonic clock, for profiling only
+uint64_t clock_tick(void);
+uint64_t clock_coarse_msec(void);
+void clock_set_rate(double rate);
+void clock_set_manual(bool manual);
+void clock_advance(uint64_t nsec);
+
+static inline uint64_t
+clock_usec(void)
+{
+	return (clock_nsec() / 1000);
+}
+
+static inline uint64_t
+clock_msec(void)
+{
+	return (clock_nsec() / 1000000);
+}
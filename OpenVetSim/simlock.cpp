@@ -0,0 +1,255 @@
+/*
+ * simlock.cpp
+ *
+ * Instructor interface locks, one per section, with per call site wait and hold times.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vetsim.h"
+#include <atomic>
+
+#define LOCK_MAX_DEPTH		4		// Nested takes per thread that are timed
+
+struct lock_site
+{
+	const char* file;
+	int line;
+	std::atomic<uint64_t> takes;
+	std::atomic<uint64_t> contended;
+	std::atomic<uint64_t> wait_usec;
+	std::atomic<uint64_t> wait_max_usec;
+	std::atomic<uint64_t> hold_usec;
+	std::atomic<uint64_t> hold_max_usec;
+};
+
+struct lock_held
+{
+	int site;
+	unsigned int sections;
+	uint64_t start;
+};
+
+static std::mutex iiSection[II_SECTION_COUNT];
+
+static struct lock_site lockSites[LOCK_MAX_SITES];
+static std::atomic<int> lockSiteCount(0);
+static std::mutex lockSiteMutex;		// Adding a site only
+
+static thread_local struct lock_held lockHeld[LOCK_MAX_DEPTH];
+static thread_local int lockDepth = 0;
+
+static const char* sectionNames[II_SECTION_COUNT] =
+{
+	"scenario", "cardiac", "respiration", "general", "media", "cpr", "telesim", "event"
+};
+
+static void
+lock_max(std::atomic<uint64_t>* max, uint64_t value)
+{
+	uint64_t cur = max->load(std::memory_order_relaxed);
+
+	while (value > cur && !max->compare_exchange_weak(cur, value, std::memory_order_relaxed))
+	{
+	}
+}
+
+static int
+lock_find_site(const char* file, int line)
+{
+	int count;
+	int i;
+
+	count = lockSiteCount.load(std::memory_order_acquire);
+	for (i = 0; i < count; i++)
+	{
+		if (lockSites[i].line == line && lockSites[i].file == file)
+		{
+			return (i);
+		}
+	}
+	std::lock_guard<std::mutex> lock(lockSiteMutex);
+	count = lockSiteCount.load(std::memory_order_relaxed);
+	for (; i < count; i++)
+	{
+		if (lockSites[i].line == line && lockSites[i].file == file)
+		{
+			return (i);
+		}
+	}
+	if (count >= LOCK_MAX_SITES)
+	{
+		return (-1);
+	}
+	lockSites[count].file = file;
+	lockSites[count].line = line;
+	lockSiteCount.store(count + 1, std::memory_order_release);
+	return (count);
+}
+
+/*
+ * FUNCTION: takeInstructorLockAt
+ *
+ * ARGUMENTS:
+ *		sections	- II_MASK() of the sections to lock, or II_ALL
+ *		file, line	- Call site, from the takeInstructorSections/takeInstructorLock macros
+ *
+ * RETURNS:
+ *		0 - The locks are always taken
+ */
+int
+takeInstructorLockAt(unsigned int sections, const char* file, int line)
+{
+	uint64_t start = 0;
+	uint64_t now;
+	bool waited = false;
+	int site;
+	int i;
+
+	for (i = 0; i < II_SECTION_COUNT; i++)
+	{
+		if (sections & II_MASK(i))
+		{
+			if (!iiSection[i].try_lock())
+			{
+				if (!waited)
+				{
+					start = metric_usec();
+					waited = true;
+				}
+				iiSection[i].lock();
+			}
+		}
+	}
+	now = metric_usec();
+
+	site = lock_find_site(file, line);
+	if (site >= 0)
+	{
+		lockSites[site].takes.fetch_add(1, std::memory_order_relaxed);
+		if (waited)
+		{
+			lockSites[site].contended.fetch_add(1, std::memory_order_relaxed);
+			lockSites[site].wait_usec.fetch_add(now - start, std::memory_order_relaxed);
+			lock_max(&lockSites[site].wait_max_usec, now - start);
+		}
+	}
+	if (lockDepth < LOCK_MAX_DEPTH)
+	{
+		lockHeld[lockDepth].site = site;
+		lockHeld[lockDepth].sections = sections;
+		lockHeld[lockDepth].start = now;
+	}
+	lockDepth++;
+	return (0);
+}
+
+void
+releaseInstructorLockAt(unsigned int sections)
+{
+	struct lock_held* held;
+	uint64_t hold;
+	int i;
+
+	if (lockDepth > 0)
+	{
+		lockDepth--;
+		if (lockDepth < LOCK_MAX_DEPTH)
+		{
+			held = &lockHeld[lockDepth];
+			if (held->site >= 0 && held->sections == sections)
+			{
+				hold = metric_usec() - held->start;
+				lockSites[held->site].hold_usec.fetch_add(hold, std::memory_order_relaxed);
+				lock_max(&lockSites[held->site].hold_max_usec, hold);
+			}
+		}
+	}
+	for (i = II_SECTION_COUNT - 1; i >= 0; i--)
+	{
+		if (sections & II_MASK(i))
+		{
+			iiSection[i].unlock();
+		}
+	}
+}
+
+/*
+ * FUNCTION: instructorSection
+ *
+ * ARGUMENTS:
+ *		name	- Section name from a set: command, such as "cardiac"
+ *
+ * RETURNS:
+ *		The section, or -1 if the name is not known
+ */
+int
+instructorSection(const char* name)
+{
+	int i;
+
+	for (i = 0; i < II_SECTION_COUNT; i++)
+	{
+		if (strcmp(name, sectionNames[i]) == 0)
+		{
+			return (i);
+		}
+	}
+	if (strcmp(name, "vocals") == 0)
+	{
+		return (II_MEDIA);
+	}
+	if (strcmp(name, "pulse") == 0 || strcmp(name, "auscultation") == 0)
+	{
+		return (II_GENERAL);
+	}
+	return (-1);
+}
+
+int
+lock_site_count(void)
+{
+	return (lockSiteCount.load(std::memory_order_acquire));
+}
+
+int
+lock_get_site(int index, struct lock_site_info* info)
+{
+	const char* file;
+	const char* cp;
+
+	if (index < 0 || index >= lock_site_count())
+	{
+		return (-1);
+	}
+	file = lockSites[index].file;
+	for (cp = file; *cp; cp++)
+	{
+		if (*cp == '/' || *cp == '\\')
+		{
+			file = cp + 1;
+		}
+	}
+	snprintf(info->site, LOCK_SITE_SIZE, "%s:%d", file, lockSites[index].line);
+	info->takes = lockSites[index].takes.load(std::memory_order_relaxed);
+	info->contended = lockSites[index].contended.load(std::memory_order_relaxed);
+	info->wait_usec = lockSites[index].wait_usec.load(std::memory_order_relaxed);
+	info->wait_max_usec = lockSites[index].wait_max_usec.load(std::memory_order_relaxed);
+	info->hold_usec = lockSites[index].hold_usec.load(std::memory_order_relaxed);
+	info->hold_max_usec = lockSites[index].hold_max_usec.load(std::memory_order_relaxed);
+	return (0);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+/*
+ * simlock.h
+ *
+ * Instructor interface locks, one per section, with per call site wait and hold times,
+ * and the per section change sets.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#ifdef _WIN32
+#include <intrin.h>
+#endif
+
+/*
+ * Each section of struct instructor has its own mutex, and the event and
+ * comment rings have another. A writer takes only the sections it touches, so
+ * a set:cardiac from the HTTP server does not wait for scan_commands to finish
+ * with the respiration block, and checkEvents does not hold up either.
+ *
+ * Sections are always taken in ascending order and released together, so
+ * taking several at once cannot deadlock. takeInstructorLock() takes them all.
+ */
+enum InstructorSection
+{
+	II_SCENARIO = 0,
+	II_CARDIAC,
+	II_RESPIRATION,
+	II_GENERAL,			// general, plus the status pulse and auscultation set by the HTTP server
+	II_MEDIA,			// vocals and media
+	II_CPR,				// cpr and defibrillation
+	II_TELESIM,
+	II_EVENTS,			// event and comment rings
+	II_SECTION_COUNT
+};
+
+#define II_MASK(section)	(1u << (section))
+#define II_ALL				((1u << II_SECTION_COUNT) - 1)
+#define II_INIT_SECTIONS	(II_ALL & ~(II_MASK(II_SCENARIO) | II_MASK(II_EVENTS)))	// Written by processInit
+
+// Change set bits. Mark a field while holding its section's lock.
+#define II_FIELD(field)					(1u << (field))
+#define instructorMark(section, field)	(simmgr_shm->instructor.dirty[(section)] |= II_FIELD(field))
+
+/*
+ * Remove the lowest set bit from a change set and return its field number.
+ * The set must not be empty.
+ */
+static inline int
+instructorNextField(unsigned int* dirty)
+{
+	int field;
+
+#ifdef _WIN32
+	unsigned long index;
+	_BitScanForward(&index, *dirty);
+	field = (int)index;
+#else
+	field = __builtin_ctz(*dirty);
+#endif
+	*dirty &= *dirty - 1;
+	return (field);
+}
+
+#define LOCK_MAX_SITES		64
+#define LOCK_SITE_SIZE		48
+
+// Call sites are recorded by file and line, so use the macros rather than the functions
+#define takeInstructorSections(mask)	takeInstructorLockAt((mask), __FILE__, __LINE__)
+#define releaseInstructorSections(mask)	releaseInstructorLockAt(mask)
+#define takeInstructorLock()			takeInstructorLockAt(II_ALL, __FILE__, __LINE__)
+#define releaseInstructorLock()			releaseInstructorLockAt(II_ALL)
+
+struct lock_site_info
+{
+	char site[LOCK_SITE_SIZE];		// "file.cpp:line"
+	uint64_t takes;
+	uint64_t contended;				// Takes that had to wait
+	uint64_t wait_usec;
+	uint64_t wait_max_usec;
+	uint64_t hold_usec;
+	uint64_t hold_max_usec;
+};
+
+int takeInstructorLockAt(unsigned int sections, const char* file, int line);
+void releaseInstructorLockAt(unsigned int sections);
+int instructorSection(const char* name);
+int lock_site_count(void);
+int lock_get_site(int index, struct lock_site_info* info);
@@ -24,6 +24,19 @@
  *
  * The log file is created in the user's temporary directory
  * The filename is created from the scenario name and start time
+ *
+ * The file is kept open for the scenario. simlog_write formats the line and puts
+ * it on a bounded queue; the simlogWriter task writes the queued lines behind,
+ * every SIMLOG_FLUSH_MSEC, and syncs the file to the disk every SIMLOG_SYNC_MSEC
+ * and when the scenario ends. logfile.lines_written counts the lines that have
+ * reached the file, so a reader of the file never sees a line count ahead of it.
+ * When headless there is no writer task and each line is written at once.
+ *
+ * The writer also keeps an index of where each line of the file starts, so a
+ * line or a range of lines is read with one pread at its offset rather than by
+ * reading the file from the start. The index and a read handle are kept until
+ * the next scenario's file is opened, so the log of a finished scenario can still
+ * be read. The index is in memory only; it is rebuilt as the file is written.
  */
 #include "vetsim.h"
 
@@ -33,54 +46,299 @@ using namespace std;
 #define MAX_TIME_STR	24
 #define MAX_LINE_LEN	512
 
-/*
- * FUNCTION:
- *		simlog_create
- *
- * ARGUMENTS:
- *
- *
- * RETURNS:
- *		On success, returns 0. On fail, returns -1.
- */
 char simlog_file[SIMLOG_NAME_LENGTH] = { 0, };
+static char simlog_dir[SIMLOG_NAME_LENGTH] = { 0, };
 int simlog_initialized = 0;
-FILE* simlog_fd;
-int simlog_line;	// Last line written
-int lock_held = 0;
+FILE* simlog_fd;	// Open for reading
+int simlog_line;	// Last line queued
 
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
 #include <filesystem>
+#include <condition_variable>
+#include <deque>
+#include <algorithm>
 
 namespace fs = std::filesystem;
 
+// Queued work for the writer, in order: a new file, lines, and the end of the file
+#define SIMLOG_OP_OPEN	0
+#define SIMLOG_OP_LINE	1
+#define SIMLOG_OP_CLOSE	2
+
+#ifdef _WIN32
+#define NEWLINE_SIZE	2		// Text mode writes "\r\n"
+#else
+#define NEWLINE_SIZE	1
+#endif
+
+struct simlog_item
+{
+	int op;
+	FILE* fp;				// SIMLOG_OP_OPEN
+	std::string text;		// SIMLOG_OP_LINE, with its newline; the path for SIMLOG_OP_OPEN
+};
+
+static std::mutex simlogQueueLock;
+static std::condition_variable simlogQueued;		// Signalled for the writer
+static std::condition_variable simlogRoom;			// Signalled for callers waiting on a full queue
+static std::deque<struct simlog_item> simlogQueue;
+static std::mutex simlogDrainLock;					// One drain at a time
+static bool simlogWriterStarted = false;
+static FILE* simlogOut = NULL;						// Held with simlogDrainLock
+static std::vector<char> simlogBuffer;
+static int simlogWritten;
+static uint64_t simlogSynced;						// clock_msec() of the last sync
+static uint64_t simlogBytes;						// Written to the file
+
+// Line index: simlogOffsets[n] is where line n + 1 starts. Lines are readable once
+// they have been flushed.
+static std::mutex simlogIndexLock;
+static std::vector<uint64_t> simlogOffsets;
+static int simlogReadable;
+static uint64_t simlogReadableBytes;
+static FILE* simlogIn = NULL;
+
+// A new file: drop the old index and open the file for reading
+static void
+simlog_index_open(const char* path)
+{
+	std::lock_guard<std::mutex> lock(simlogIndexLock);
+
+	if (simlogIn)
+	{
+		fclose(simlogIn);
+		simlogIn = NULL;
+	}
+	if (fopen_s(&simlogIn, path, "rb") || !simlogIn)
+	{
+		simlogIn = NULL;
+	}
+	simlogOffsets.clear();
+	simlogReadable = 0;
+	simlogReadableBytes = 0;
+}
+
+// The lines starting at the offsets in pending have been flushed
+static void
+simlog_index_publish(std::vector<uint64_t>& pending)
+{
+	std::lock_guard<std::mutex> lock(simlogIndexLock);
+
+	simlogOffsets.insert(simlogOffsets.end(), pending.begin(), pending.end());
+	simlogReadable = (int)simlogOffsets.size();
+	simlogReadableBytes = simlogBytes;
+	pending.clear();
+}
+
+/*
+ * FUNCTION: simlog_drain
+ *
+ * Write out the queued work. Called by the writer task, or by the caller itself
+ * when there is no writer.
+ */
+static void
+simlog_drain(void)
+{
+	std::lock_guard<std::mutex> drain(simlogDrainLock);
+	std::deque<struct simlog_item> batch;
+	std::vector<uint64_t> pending;
+	uint64_t now;
+	size_t start;
+	size_t pos;
+
+	{
+		std::lock_guard<std::mutex> lock(simlogQueueLock);
+		batch.swap(simlogQueue);
+	}
+	simlogRoom.notify_all();
+
+	for (auto& item : batch)
+	{
+		switch (item.op)
+		{
+		case SIMLOG_OP_OPEN:
+			if (simlogOut)
+			{
+				// The last scenario's file was not ended
+				fflush(simlogOut);
+				(void)sim_fdatasync(simlogOut);
+				fclose(simlogOut);
+			}
+			pending.clear();
+			simlog_index_open(item.text.c_str());
+			simlogOut = item.fp;
+			simlogWritten = 0;
+			simlogBytes = 0;
+			simlogBuffer.resize(SIMLOG_BUFFER_SIZE);
+			setvbuf(simlogOut, simlogBuffer.data(), _IOFBF, SIMLOG_BUFFER_SIZE);
+			simlogSynced = clock_msec();
+			break;
+		case SIMLOG_OP_LINE:
+			if (simlogOut)
+			{
+				fputs(item.text.c_str(), simlogOut);
+				simlogWritten++;
+
+				// A message may hold newlines of its own; index the lines of the file
+				pending.push_back(simlogBytes);
+				for (start = 0, pos = item.text.find('\n'); pos != std::string::npos; pos = item.text.find('\n', start))
+				{
+					simlogBytes += pos - start + NEWLINE_SIZE;
+					start = pos + 1;
+					if (start < item.text.size())
+					{
+						pending.push_back(simlogBytes);
+					}
+				}
+				simlogBytes += item.text.size() - start;
+			}
+			break;
+		case SIMLOG_OP_CLOSE:
+			if (simlogOut)
+			{
+				fflush(simlogOut);
+				simlog_index_publish(pending);
+				(void)sim_fdatasync(simlogOut);
+				fclose(simlogOut);
+				simlogOut = NULL;
+				simmgr_shm->logfile.lines_written = simlogWritten;
+			}
+			break;
+		}
+	}
+	if (simlogOut)
+	{
+		fflush(simlogOut);
+		simlog_index_publish(pending);
+		simmgr_shm->logfile.lines_written = simlogWritten;
+		now = clock_msec();
+		if (now - simlogSynced >= SIMLOG_SYNC_MSEC)
+		{
+			(void)sim_fdatasync(simlogOut);
+			simlogSynced = now;
+		}
+	}
+}
+
+/*
+ * FUNCTION: simlog_writer
+ *
+ * The simlogWriter task. Writes the queue out every SIMLOG_FLUSH_MSEC, or sooner
+ * when it is half full.
+ */
+static void
+simlog_writer(void)
+{
+	while (task_running())
+	{
+		{
+			std::unique_lock<std::mutex> lock(simlogQueueLock);
+			simlogQueued.wait_for(lock, std::chrono::milliseconds(SIMLOG_FLUSH_MSEC),
+				[]() { return (simlogQueue.size() >= SIMLOG_QUEUE_SIZE / 2 || !task_running()); });
+		}
+		simlog_drain();
+	}
+	{
+		std::lock_guard<std::mutex> lock(simlogQueueLock);
+		simlogWriterStarted = false;
+	}
+	simlog_drain();
+}
+
+/*
+ * FUNCTION: simlog_queue
+ *
+ * Queue work for the writer. When the queue is full the caller waits for the
+ * writer to take it; without the writer the caller writes it out.
+ */
+static void
+simlog_queue(int op, FILE* fp, const char* text)
+{
+	bool writer;
+
+	{
+		std::unique_lock<std::mutex> lock(simlogQueueLock);
+
+		if (!simlogWriterStarted && !headless && task_running())
+		{
+			simlogWriterStarted = true;
+			(void)start_task("simlogWriter", simlog_writer);
+		}
+		writer = simlogWriterStarted;
+		if (writer && simlogQueue.size() >= SIMLOG_QUEUE_SIZE)
+		{
+			simlogQueued.notify_one();
+			simlogRoom.wait(lock, []() { return (simlogQueue.size() < SIMLOG_QUEUE_SIZE || !simlogWriterStarted); });
+		}
+		simlogQueue.push_back(simlog_item());
+		simlogQueue.back().op = op;
+		simlogQueue.back().fp = fp;
+		if (text)
+		{
+			simlogQueue.back().text = text;
+		}
+		writer = simlogWriterStarted;
+	}
+	if (!writer)
+	{
+		simlog_drain();
+	}
+	else if (op == SIMLOG_OP_CLOSE)
+	{
+		simlogQueued.notify_one();
+	}
+}
 
+/*
+ * FUNCTION:
+ *		simlog_create
+ *
+ * ARGUMENTS:
+ *
+ *
+ * RETURNS:
+ *		On success, returns 0. On fail, returns -1.
+ */
 int
 simlog_create()
 {
 	char timeStr[MAX_TIME_STR];
 	char msgBuf[MAX_LINE_LEN];
+	char errBuffer[256];
+	FILE* fp = NULL;
 	int rval = 0;
 
-	fs::current_path(localConfig.html_path);
-	fs::create_directory("simlogs");
-	fs::create_directory("simlogs/video");
-
 	// Format from status.scenario.start: "2021-02-22_09.31.53"
 	strftime(timeStr, MAX_TIME_STR, "%Y-%m-%d_%H.%M.%S", &simmgr_shm->status.scenario.tmStart);
-	sprintf_s(simlog_file, SIMLOG_NAME_LENGTH, "%s/simlogs/%s_%s.log", localConfig.html_path, timeStr, simmgr_shm->status.scenario.active);
+	if (strlen(simlog_dir) > 0)
+	{
+		sprintf_s(simlog_file, SIMLOG_NAME_LENGTH, "%s/%s_%s.log", simlog_dir, timeStr, simmgr_shm->status.scenario.active);
+	}
+	else
+	{
+		fs::current_path(localConfig.html_path);
+		fs::create_directory("simlogs");
+		fs::create_directory("simlogs/video");
+		sprintf_s(simlog_file, SIMLOG_NAME_LENGTH, "%s/simlogs/%s_%s.log", localConfig.html_path, timeStr, simmgr_shm->status.scenario.active);
+	}
 	printf("simlog_file is %s\n", simlog_file);
-	(void)simlog_open(SIMLOG_MODE_CREATE);
-	if (simlog_fd)
+	if (fopen_s(&fp, simlog_file, "w") || !fp)
+	{
+		strerror_s(errBuffer, 256, errno);
+		snprintf(msgBuf, MAX_LINE_LEN, "simlog_create failed to open for write: %s : %s", simlog_file, errBuffer);
+		log_message("", msgBuf);
+		fp = NULL;
+	}
+	if (fp)
 	{
 		printf("simlog_open succeeds\n");
 		simlog_line = 0;
+		simmgr_shm->logfile.lines_written = 0;
+		simlog_queue(SIMLOG_OP_OPEN, fp, simlog_file);
 		simmgr_shm->logfile.active = 1;
-		snprintf(msgBuf, MAX_LINE_LEN, "Scenario: '%s' Date: %s", simmgr_shm->status.scenario.active, simmgr_shm->status.scenario.start);
 		simlog_write((char*)"Start");
-		simlog_close();
 		sprintf_s(simmgr_shm->logfile.filename, FILENAME_SIZE, "%s_%s.log", timeStr, simmgr_shm->status.scenario.active);
 		sprintf_s(simmgr_shm->logfile.vfilename, FILENAME_SIZE, "%s_%s.mp4", timeStr, simmgr_shm->status.scenario.active);
 	}
@@ -95,11 +353,22 @@ simlog_create()
 	return (rval);
 }
 
+/*
+ * FUNCTION:
+ *		simlog_set_dir
+ *
+ * ARGUMENTS:
+ *		dir	- Directory for the logs in place of html/simlogs, or "" for the default
+ */
 void
-simlog_entry(char* msg)
+simlog_set_dir(const char* dir)
 {
-	int sts;
+	sprintf_s(simlog_dir, SIMLOG_NAME_LENGTH, "%s", dir);
+}
 
+void
+simlog_entry(char* msg)
+{
 	if (strlen(msg) == 0)
 	{
 		log_message("", "simlog_entry with null message");
@@ -108,12 +377,7 @@ simlog_entry(char* msg)
 	{
 		if ((strlen(simlog_file) > 0) && (simmgr_shm->logfile.active))
 		{
-			sts = simlog_open(SIMLOG_MODE_WRITE);
-			if (sts == 0)
-			{
-				(void)simlog_write(msg);
-				(void)simlog_close();
-			}
+			(void)simlog_write(msg);
 		}
 	}
 }
@@ -121,10 +385,7 @@ simlog_entry(char* msg)
 int
 simlog_open(int rw)
 {
-	int sts;
 	char buffer[512];
-	char errBuffer[256];
-	int trycount;
 
 	if (simlog_fd)
 	{
@@ -132,90 +393,43 @@ simlog_open(int rw)
 		printf("simlog_open called with simlog_fd already set\n");
 		return (-1);
 	}
-	if (lock_held)
+	if (rw != SIMLOG_MODE_READ)
 	{
-		log_message("", "simlog_open called with lock_held set");
-		printf("simlog_open called with lock_held set\n");
+		log_message("", "simlog_open is for reading; lines are written with simlog_write");
 		return (-2);
 	}
-	if (rw == SIMLOG_MODE_WRITE || rw == SIMLOG_MODE_CREATE)
-	{
-		// Take the lock
-		trycount = 0;
-		while (trycount++ < 50)
-		{
-			sim_lock_mutex(simmgr_shm->logfile.sema);
-			sts = 0;
-			if (sts == 0)
-			{
-				break;
-			}
-			else
-			{
-				printf("simlog_open failed to take sema 0x%08xL\n", sts);
-				return (-3);
-			}
-		}
-		if (trycount >= 50)
-		{
-			// Could not get lock soon enough. Try again next time.
-			log_message("", "simlog_open failed to take logfile mutex");
-			printf("simlog_open failed to take logfile mutex\n");
-			return (-1);
-		}
-		lock_held = 1;
-		if (rw == SIMLOG_MODE_CREATE)
-		{
-			sts = fopen_s(&simlog_fd, simlog_file, "w");
-		}
-		else
-		{
-			sts = fopen_s(&simlog_fd, simlog_file, "a");
-		}
-		if (sts || !simlog_fd)
-		{
-			strerror_s(errBuffer, 256, errno);
-			sprintf_s(buffer, 512, "simlog_open failed to open for write: %s : %s",
-				simlog_file, errBuffer);
-			log_message("", buffer);
-			printf("simlog_open failed to open for write: %s : %s\n",
-				simlog_file, errBuffer);
-			sim_unlock_mutex(simmgr_shm->logfile.sema);
-			lock_held = 0;
-		}
-	}
-	else
+	simlog_flush();
+	if (fopen_s(&simlog_fd, simlog_file, "r") || !simlog_fd)
 	{
-		sts = fopen_s(&simlog_fd, simlog_file, "r");
-		if (sts || !simlog_fd)
-		{
-			sprintf_s(buffer, 512, "simlog_open failed to open for read: %s", simlog_file); 
-			printf("simlog_open failed to open for read:%s : %s\n",
-				simlog_file, errBuffer);
-			log_message("", buffer);
-		}
-	}
-	if (!simlog_fd)
-	{
-		printf("simlog_open failed\n");
+		simlog_fd = NULL;
+		sprintf_s(buffer, 512, "simlog_open failed to open for read: %s", simlog_file);
+		printf("%s\n", buffer);
+		log_message("", buffer);
 		return (-1);
 	}
 	return (0);
 }
 
+/*
+ * FUNCTION:
+ *		simlog_write
+ *
+ * ARGUMENTS:
+ *		msg	- Line to add, stamped with the run times
+ *
+ * RETURNS:
+ *		The line number, or -1 if the line was not queued
+ */
 int
 simlog_write(char* msg)
 {
-	if (!simlog_fd)
+	char line[MAX_LINE_LEN + 3 * STR_SIZE + 8];
+
+	if (!simmgr_shm->logfile.active)
 	{
 		log_message("", "simlog_write called with closed file");
 		return (-1);
 	}
-	if (!lock_held)
-	{
-		log_message("", "simlog_write called without lock held");
-		return (-1);
-	}
 	if (strlen(msg) > MAX_LINE_LEN)
 	{
 		log_message("", "simlog_write overlength string");
@@ -226,17 +440,29 @@ simlog_write(char* msg)
 		log_message("", "simlog_write empty string");
 		return (-1);
 	}
-	fprintf(simlog_fd, "%s %s %s %s\n",
+	snprintf(line, sizeof(line), "%s %s %s %s\n",
 		simmgr_shm->status.scenario.runtimeAbsolute,
 		simmgr_shm->status.scenario.runtimeScenario,
 		simmgr_shm->status.scenario.runtimeScene,
 		msg);
-		
+	simlog_queue(SIMLOG_OP_LINE, NULL, line);
+
 	simlog_line++;
-	simmgr_shm->logfile.lines_written = simlog_line;
 	return (simlog_line);
 }
 
+/*
+ * FUNCTION:
+ *		simlog_flush
+ *
+ * Write out the queued lines now, for a reader of the file
+ */
+void
+simlog_flush(void)
+{
+	simlog_drain();
+}
+
 size_t
 simlog_read(char* rbuf)
 {
@@ -251,64 +477,92 @@ simlog_read(char* rbuf)
 	return (strlen(rbuf));
 }
 
+/*
+ * FUNCTION:
+ *		simlog_read_lines
+ *
+ * ARGUMENTS:
+ *		first	- First line, from 1
+ *		count	- Number of lines
+ *		out		- The lines are appended, each with its newline
+ *
+ * Read a range of lines of the session log with one read at the first line's
+ * offset, however long the log is. Lines still queued for the writer are not
+ * yet readable.
+ *
+ * RETURNS:
+ *		The number of lines read
+ */
+int
+simlog_read_lines(int first, int count, std::string& out)
+{
+	std::lock_guard<std::mutex> lock(simlogIndexLock);
+	std::vector<char> buf;
+	uint64_t start;
+	uint64_t end;
+	int last;
+
+	if (!simlogIn || first < 1 || count < 1 || first > simlogReadable)
+	{
+		return (0);
+	}
+	last = (count > simlogReadable - first) ? simlogReadable : first + count - 1;
+	start = simlogOffsets[first - 1];
+	end = (last < simlogReadable) ? simlogOffsets[last] : simlogReadableBytes;
+	buf.resize((size_t)(end - start));
+	if (sim_pread(simlogIn, buf.data(), buf.size(), start) != (int64_t)buf.size())
+	{
+		return (0);
+	}
+#ifdef _WIN32
+	buf.erase(std::remove(buf.begin(), buf.end(), '\r'), buf.end());
+#endif
+	out.append(buf.data(), buf.size());
+	return (last - first + 1);
+}
+
+// Lines of the session log that can be read
+int
+simlog_line_count(void)
+{
+	std::lock_guard<std::mutex> lock(simlogIndexLock);
+
+	return (simlogReadable);
+}
+
 size_t
 simlog_read_line(char* rbuf, int lineno)
 {
-	int line;
-	char* sts;
+	std::string line;
 
 	sprintf_s(rbuf, MAX_LINE_LEN, "%s", "");
 
-	if (!simlog_fd)
+	if (simlog_read_lines(lineno, 1, line) != 1)
 	{
-		log_message("", "simlog_read_line called with closed file");
 		return (-1);
 	}
-
-	fseek(simlog_fd, 0, SEEK_SET);
-	for (line = 1; line <= lineno; line++)
-	{
-		sts = fgets(rbuf, MAX_LINE_LEN, simlog_fd);
-		if (!sts)
-		{
-			return (-1);
-		}
-	}
-
+	sprintf_s(rbuf, MAX_LINE_LEN, "%s", line.c_str());
 	return (strlen(rbuf));
 }
 
 void
 simlog_close()
 {
-	// Close the file
+	// Close the file opened for reading
 	if (simlog_fd)
 	{
 		fclose(simlog_fd);
 		simlog_fd = NULL;
 	}
-
-	// Release the MUTEX
-	if (lock_held)
-	{
-		sim_unlock_mutex(simmgr_shm->logfile.sema);
-		lock_held = 0;
-	}
 }
 
 void
 simlog_end()
 {
-	int sts;
-
-	if ((simlog_fd == NULL) && (simmgr_shm->logfile.active))
+	if (simmgr_shm->logfile.active)
 	{
-		sts = simlog_open(SIMLOG_MODE_WRITE);
-		if (sts == 0)
-		{
-			simlog_write((char*)"End");
-			simlog_close();
-		}
+		simlog_write((char*)"End");
+		simlog_queue(SIMLOG_OP_CLOSE, NULL, NULL);
 	}
 	simmgr_shm->logfile.active = 0;
 }
@@ -0,0 +1,366 @@
+/*
+ * simmetrics.cpp
+ *
+ * Engine counters, served in Prometheus text format on the status port at /metrics.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vetsim.h"
+#include "simmetrics.h"
+#include "simsched.h"
+#include <atomic>
+
+struct metric_timer
+{
+	std::atomic<uint64_t> count;
+	std::atomic<uint64_t> total_usec;
+	std::atomic<uint64_t> max_usec;
+};
+
+struct metric_command
+{
+	char name[METRIC_LABEL_SIZE];
+	uint64_t count;
+	uint64_t total_usec;
+	uint64_t max_usec;
+};
+
+static std::atomic<uint64_t> metricCounters[METRIC_COUNTER_COUNT];
+static struct metric_timer metricTimers[METRIC_TIMER_COUNT];
+
+// Requests are handled and reported on the simstatus thread; the mutex is for any other caller
+static std::mutex metricCommandMutex;
+static struct metric_command metricCommands[METRIC_MAX_COMMANDS + 1];
+static int metricCommandCount = 0;
+
+static const char* counterNames[METRIC_COUNTER_COUNT][3] =
+{
+	// name, labels, help
+	{ "vetsim_beats_sent_total", "type=\"pulse\"", "Beat words sent to the pulse listeners" },
+	{ "vetsim_beats_sent_total", "type=\"vpc\"", NULL },
+	{ "vetsim_beats_sent_total", "type=\"breath\"", NULL },
+	{ "vetsim_beat_timer_late_total", "type=\"pulse\"", "Beats that were already due when pulseTimer checked" },
+	{ "vetsim_beat_timer_late_total", "type=\"breath\"", NULL },
+	{ "vetsim_scene_transitions_total", NULL, "Scenario scene changes" },
+	{ "vetsim_log_dropped_total", NULL, "Log messages dropped because the thread's log ring was full" },
+};
+
+static const char* timerNames[METRIC_TIMER_COUNT][2] =
+{
+	{ "vetsim_trigger_eval_seconds", "Scenario trigger evaluation time per scene check" },
+	{ "vetsim_log_write_seconds", "Log writer time per batch written" },
+	{ "vetsim_scene_init_seconds", "Scene parameter handoff time, until scan_commands has applied them" },
+};
+
+void
+metric_inc(int counter)
+{
+	if (counter >= 0 && counter < METRIC_COUNTER_COUNT)
+	{
+		metricCounters[counter].fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void
+metric_time(int timer, uint64_t usec)
+{
+	struct metric_timer* t;
+	uint64_t max;
+
+	if (timer < 0 || timer >= METRIC_TIMER_COUNT)
+	{
+		return;
+	}
+	t = &metricTimers[timer];
+	t->count.fetch_add(1, std::memory_order_relaxed);
+	t->total_usec.fetch_add(usec, std::memory_order_relaxed);
+	max = t->max_usec.load(std::memory_order_relaxed);
+	while (usec > max && !t->max_usec.compare_exchange_weak(max, usec, std::memory_order_relaxed))
+	{
+	}
+}
+
+// Monotonic time in usec, for timing a section with metric_time(). Real time even when
+// the simulation clock is scaled or stopped.
+uint64_t
+metric_usec(void)
+{
+	return (clock_real_nsec() / 1000);
+}
+
+/*
+ * FUNCTION: metric_request
+ *
+ * ARGUMENTS:
+ *		command	- Request label, such as "qstat" or "set"
+ *		usec	- Time to build the reply
+ */
+void
+metric_request(const char* command, uint64_t usec)
+{
+	std::lock_guard<std::mutex> lock(metricCommandMutex);
+	struct metric_command* cmd = NULL;
+	int i;
+
+	for (i = 0; i < metricCommandCount; i++)
+	{
+		if (strcmp(metricCommands[i].name, command) == 0)
+		{
+			cmd = &metricCommands[i];
+			break;
+		}
+	}
+	if (!cmd)
+	{
+		if (metricCommandCount < METRIC_MAX_COMMANDS)
+		{
+			cmd = &metricCommands[metricCommandCount++];
+			snprintf(cmd->name, METRIC_LABEL_SIZE, "%s", command);
+		}
+		else
+		{
+			cmd = &metricCommands[METRIC_MAX_COMMANDS];
+			snprintf(cmd->name, METRIC_LABEL_SIZE, "%s", "other");
+		}
+	}
+	cmd->count++;
+	cmd->total_usec += usec;
+	if (usec > cmd->max_usec)
+	{
+		cmd->max_usec = usec;
+	}
+}
+
+static void
+metric_line(std::string& out, const char* name, const char* labels, double value)
+{
+	char buf[256];
+
+	if (labels && labels[0])
+	{
+		snprintf(buf, sizeof(buf), "%s{%s} %.9g\n", name, labels, value);
+	}
+	else
+	{
+		snprintf(buf, sizeof(buf), "%s %.9g\n", name, value);
+	}
+	out += buf;
+}
+
+static void
+metric_header(std::string& out, const char* name, const char* type, const char* help)
+{
+	out += "# HELP ";
+	out += name;
+	out += " ";
+	out += help;
+	out += "\n# TYPE ";
+	out += name;
+	out += " ";
+	out += type;
+	out += "\n";
+}
+
+static int
+ringDepth(int write, int read, int size)
+{
+	return ((write - read + size) % size);
+}
+
+/*
+ * FUNCTION: metrics_write
+ *
+ * ARGUMENTS:
+ *		out	- Receives the metrics in Prometheus text format, version 0.0.4
+ */
+void
+metrics_write(std::string& out)
+{
+	const struct sched_task* task;
+	struct task_info info;
+	struct lock_site_info site;
+	char labels[128];
+	char name[128];
+	int count;
+	int i;
+
+	for (i = 0; i < METRIC_COUNTER_COUNT; i++)
+	{
+		if (counterNames[i][2])
+		{
+			metric_header(out, counterNames[i][0], "counter", counterNames[i][2]);
+		}
+		metric_line(out, counterNames[i][0], counterNames[i][1],
+			(double)metricCounters[i].load(std::memory_order_relaxed));
+	}
+
+	for (i = 0; i < METRIC_TIMER_COUNT; i++)
+	{
+		metric_header(out, timerNames[i][0], "summary", timerNames[i][1]);
+		snprintf(name, sizeof(name), "%s_sum", timerNames[i][0]);
+		metric_line(out, name, NULL, (double)metricTimers[i].total_usec.load(std::memory_order_relaxed) / 1e6);
+		snprintf(name, sizeof(name), "%s_count", timerNames[i][0]);
+		metric_line(out, name, NULL, (double)metricTimers[i].count.load(std::memory_order_relaxed));
+		snprintf(name, sizeof(name), "%s_max", timerNames[i][0]);
+		metric_header(out, name, "gauge", "Longest single run");
+		metric_line(out, name, NULL, (double)metricTimers[i].max_usec.load(std::memory_order_relaxed) / 1e6);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(metricCommandMutex);
+
+		metric_header(out, "vetsim_requests_total", "counter", "Status port requests by command");
+		for (i = 0; i <= METRIC_MAX_COMMANDS; i++)
+		{
+			if (metricCommands[i].count)
+			{
+				snprintf(labels, sizeof(labels), "command=\"%.*s\"", METRIC_LABEL_SIZE, metricCommands[i].name);
+				metric_line(out, "vetsim_requests_total", labels, (double)metricCommands[i].count);
+			}
+		}
+		metric_header(out, "vetsim_request_seconds_total", "counter", "Time spent building status port replies");
+		for (i = 0; i <= METRIC_MAX_COMMANDS; i++)
+		{
+			if (metricCommands[i].count)
+			{
+				snprintf(labels, sizeof(labels), "command=\"%.*s\"", METRIC_LABEL_SIZE, metricCommands[i].name);
+				metric_line(out, "vetsim_request_seconds_total", labels, (double)metricCommands[i].total_usec / 1e6);
+			}
+		}
+		metric_header(out, "vetsim_request_seconds_max", "gauge", "Longest status port reply");
+		for (i = 0; i <= METRIC_MAX_COMMANDS; i++)
+		{
+			if (metricCommands[i].count)
+			{
+				snprintf(labels, sizeof(labels), "command=\"%.*s\"", METRIC_LABEL_SIZE, metricCommands[i].name);
+				metric_line(out, "vetsim_request_seconds_max", labels, (double)metricCommands[i].max_usec / 1e6);
+			}
+		}
+	}
+
+	metric_header(out, "vetsim_pulse_listeners", "gauge", "Connected pulse port listeners");
+	metric_line(out, "vetsim_pulse_listeners", NULL, (double)pulseListenerCount());
+
+	metric_header(out, "vetsim_queue_depth", "gauge", "Entries not yet processed in the event and comment rings");
+	metric_line(out, "vetsim_queue_depth", "ring=\"event\",reader=\"scenario\"",
+		(double)ringDepth(simmgr_shm->eventListNextWrite, simmgr_shm->eventListNextRead, EVENT_LIST_SIZE));
+	metric_line(out, "vetsim_queue_depth", "ring=\"event\",reader=\"log\"",
+		(double)ringDepth(simmgr_shm->eventListNextWrite, simmgr_shm->lastEventLogged, EVENT_LIST_SIZE));
+	metric_line(out, "vetsim_queue_depth", "ring=\"comment\",reader=\"log\"",
+		(double)ringDepth(simmgr_shm->commentListNext, simmgr_shm->lastCommentLogged, COMMENT_LIST_SIZE));
+
+	// Main loop tasks, including scan_commands
+	count = sched_task_count();
+	metric_header(out, "vetsim_task_runs_total", "counter", "Main loop task runs");
+	for (i = 0; i < count; i++)
+	{
+		task = sched_get_task(i);
+		snprintf(labels, sizeof(labels), "task=\"%s\"", task->name);
+		metric_line(out, "vetsim_task_runs_total", labels, (double)task->runs.load(std::memory_order_relaxed));
+	}
+	metric_header(out, "vetsim_task_seconds_total", "counter", "Main loop task run time");
+	for (i = 0; i < count; i++)
+	{
+		task = sched_get_task(i);
+		snprintf(labels, sizeof(labels), "task=\"%s\"", task->name);
+		metric_line(out, "vetsim_task_seconds_total", labels, (double)task->total_usec.load(std::memory_order_relaxed) / 1e6);
+	}
+	metric_header(out, "vetsim_task_seconds_max", "gauge", "Longest main loop task run");
+	for (i = 0; i < count; i++)
+	{
+		task = sched_get_task(i);
+		snprintf(labels, sizeof(labels), "task=\"%s\"", task->name);
+		metric_line(out, "vetsim_task_seconds_max", labels, (double)task->max_usec.load(std::memory_order_relaxed) / 1e6);
+	}
+	metric_header(out, "vetsim_task_overruns_total", "counter", "Main loop task runs that started a full period late");
+	for (i = 0; i < count; i++)
+	{
+		task = sched_get_task(i);
+		snprintf(labels, sizeof(labels), "task=\"%s\"", task->name);
+		metric_line(out, "vetsim_task_overruns_total", labels, (double)task->overruns.load(std::memory_order_relaxed));
+	}
+
+	// Instructor lock, per call site
+	count = lock_site_count();
+	metric_header(out, "vetsim_instructor_lock_takes_total", "counter", "Instructor lock acquisitions");
+	for (i = 0; i < count; i++)
+	{
+		if (lock_get_site(i, &site) == 0)
+		{
+			snprintf(labels, sizeof(labels), "site=\"%s\"", site.site);
+			metric_line(out, "vetsim_instructor_lock_takes_total", labels, (double)site.takes);
+		}
+	}
+	metric_header(out, "vetsim_instructor_lock_contended_total", "counter", "Instructor lock acquisitions that had to wait");
+	for (i = 0; i < count; i++)
+	{
+		if (lock_get_site(i, &site) == 0)
+		{
+			snprintf(labels, sizeof(labels), "site=\"%s\"", site.site);
+			metric_line(out, "vetsim_instructor_lock_contended_total", labels, (double)site.contended);
+		}
+	}
+	metric_header(out, "vetsim_instructor_lock_wait_seconds_total", "counter", "Time spent waiting for the instructor lock");
+	for (i = 0; i < count; i++)
+	{
+		if (lock_get_site(i, &site) == 0)
+		{
+			snprintf(labels, sizeof(labels), "site=\"%s\"", site.site);
+			metric_line(out, "vetsim_instructor_lock_wait_seconds_total", labels, (double)site.wait_usec / 1e6);
+		}
+	}
+	metric_header(out, "vetsim_instructor_lock_wait_seconds_max", "gauge", "Longest wait for the instructor lock");
+	for (i = 0; i < count; i++)
+	{
+		if (lock_get_site(i, &site) == 0)
+		{
+			snprintf(labels, sizeof(labels), "site=\"%s\"", site.site);
+			metric_line(out, "vetsim_instructor_lock_wait_seconds_max", labels, (double)site.wait_max_usec / 1e6);
+		}
+	}
+	metric_header(out, "vetsim_instructor_lock_hold_seconds_total", "counter", "Time the instructor lock was held");
+	for (i = 0; i < count; i++)
+	{
+		if (lock_get_site(i, &site) == 0)
+		{
+			snprintf(labels, sizeof(labels), "site=\"%s\"", site.site);
+			metric_line(out, "vetsim_instructor_lock_hold_seconds_total", labels, (double)site.hold_usec / 1e6);
+		}
+	}
+	metric_header(out, "vetsim_instructor_lock_hold_seconds_max", "gauge", "Longest hold of the instructor lock");
+	for (i = 0; i < count; i++)
+	{
+		if (lock_get_site(i, &site) == 0)
+		{
+			snprintf(labels, sizeof(labels), "site=\"%s\"", site.site);
+			metric_line(out, "vetsim_instructor_lock_hold_seconds_max", labels, (double)site.hold_max_usec / 1e6);
+		}
+	}
+
+	// Threads
+	count = task_count();
+	metric_header(out, "vetsim_thread_cpu_seconds_total", "counter", "CPU time used by each thread");
+	for (i = 0; i < count; i++)
+	{
+		if (task_get_info(i, &info) == 0 && info.running && info.cpu_msec >= 0)
+		{
+			snprintf(labels, sizeof(labels), "thread=\"%s\"", info.name);
+			metric_line(out, "vetsim_thread_cpu_seconds_total", labels, info.cpu_msec / 1000.0);
+		}
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+/*
+ * simmetrics.h
+ *
+ * Engine counters, served in Prometheus text format on the status port at /metrics.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#include <string>
+
+#define METRIC_MAX_COMMANDS		24		// Distinct request labels; the rest count as "other"
+#define METRIC_LABEL_SIZE		24
+
+/*
+ * Each counter and timer is a relaxed atomic that is normally written by one
+ * thread only, so an update costs about as much as a plain increment.
+ */
+enum MetricCounter
+{
+	METRIC_PULSE_SENT = 0,		// Beat words sent to the listeners
+	METRIC_VPC_SENT,
+	METRIC_BREATH_SENT,
+	METRIC_PULSE_LATE,			// pulseTimer found the next beat already due and resynced
+	METRIC_BREATH_LATE,
+	METRIC_SCENE_TRANSITIONS,
+	METRIC_LOG_DROPPED,			// log_message found the thread's log ring full
+	METRIC_COUNTER_COUNT
+};
+
+enum MetricTimer
+{
+	METRIC_TIME_TRIGGER = 0,	// scene_check: event, trigger and timeout evaluation
+	METRIC_TIME_LOG,			// Log writer batch write
+	METRIC_TIME_SCENE_INIT,		// processInit, until scan_commands has applied the parameters
+	METRIC_TIMER_COUNT
+};
+
+void metric_inc(int counter);
+void metric_time(int timer, uint64_t usec);
+uint64_t metric_usec(void);
+void metric_request(const char* command, uint64_t usec);
+void metrics_write(std::string& out);
@@ -0,0 +1,225 @@
+/*
+ * simnotify.cpp
+ *
+ * Change notification between the SimMgr threads.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "simnotify.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// A waiter for a topic's acknowledgement, above the topic bits
+#define NOTIFY_ACK_MASK(topic)	(NOTIFY_MASK(topic) << NOTIFY_TOPIC_COUNT)
+
+// A blocked thread; each thread waits in one place at a time, so one is enough
+struct notify_waiter
+{
+	std::condition_variable cond;
+	unsigned int mask;			// NOTIFY_MASK() and NOTIFY_ACK_MASK() bits that wake it
+};
+
+static std::mutex notifyMutex;
+static std::vector<struct notify_waiter*> notifyWaiters;	// Blocked now; under notifyMutex
+static thread_local struct notify_waiter notifyWaiter;
+static std::atomic<uint64_t> notifyGen[NOTIFY_TOPIC_COUNT];
+static std::atomic<uint64_t> notifyAck[NOTIFY_TOPIC_COUNT];
+
+// Wake the blocked threads waiting on any of the bits. Call with notifyMutex held.
+static void
+notify_wake(unsigned int bits)
+{
+	for (auto waiter : notifyWaiters)
+	{
+		if (waiter->mask & bits)
+		{
+			waiter->cond.notify_one();
+		}
+	}
+}
+
+// Block until pred() holds or the timeout expires. pred() is checked again only
+// when the thread is woken for one of the bits.
+static bool
+notify_block(std::unique_lock<std::mutex>& lock, unsigned int bits, unsigned int timeout_msec, std::function<bool(void)> pred)
+{
+	bool met;
+
+	notifyWaiter.mask = bits;
+	notifyWaiters.push_back(&notifyWaiter);
+	met = notifyWaiter.cond.wait_for(lock, std::chrono::milliseconds(timeout_msec), pred);
+	notifyWaiters.erase(std::find(notifyWaiters.begin(), notifyWaiters.end(), &notifyWaiter));
+	return (met);
+}
+
+/*
+ * FUNCTION: notify_signal
+ *
+ * Advance the generation of a topic and wake the waiters whose mask has it.
+ * The increment is done under the mutex so a waiter cannot test the counters
+ * and then miss the wakeup before it blocks.
+ */
+void
+notify_signal(int topic)
+{
+	if (topic < 0 || topic >= NOTIFY_TOPIC_COUNT)
+	{
+		return;
+	}
+	std::lock_guard<std::mutex> lock(notifyMutex);
+	notifyGen[topic].fetch_add(1, std::memory_order_release);
+	notify_wake(NOTIFY_MASK(topic));
+}
+
+uint64_t
+notify_generation(int topic)
+{
+	if (topic < 0 || topic >= NOTIFY_TOPIC_COUNT)
+	{
+		return (0);
+	}
+	return (notifyGen[topic].load(std::memory_order_acquire));
+}
+
+/*
+ * FUNCTION: notify_snapshot
+ *
+ * Record the current generation of every topic, so the next notify_wait()
+ * only reports changes made from here on.
+ */
+void
+notify_snapshot(struct notify_seen* seen)
+{
+	int i;
+
+	for (i = 0; i < NOTIFY_TOPIC_COUNT; i++)
+	{
+		seen->gen[i] = notifyGen[i].load(std::memory_order_acquire);
+	}
+}
+
+static unsigned int
+notify_changed(unsigned int mask, struct notify_seen* seen)
+{
+	unsigned int changed = 0;
+	uint64_t gen;
+	int i;
+
+	for (i = 0; i < NOTIFY_TOPIC_COUNT; i++)
+	{
+		if (mask & NOTIFY_MASK(i))
+		{
+			gen = notifyGen[i].load(std::memory_order_acquire);
+			if (gen != seen->gen[i])
+			{
+				seen->gen[i] = gen;
+				changed |= NOTIFY_MASK(i);
+			}
+		}
+	}
+	return (changed);
+}
+
+/*
+ * FUNCTION: notify_wait
+ *
+ * ARGUMENTS:
+ *		mask			- NOTIFY_MASK() of the topics of interest
+ *		seen			- Generations already handled by the caller; updated on return
+ *		timeout_msec	- Longest time to block
+ *
+ * RETURNS:
+ *		Mask of the topics that changed, or 0 on timeout
+ */
+unsigned int
+notify_wait(unsigned int mask, struct notify_seen* seen, unsigned int timeout_msec)
+{
+	unsigned int changed;
+
+	changed = notify_changed(mask, seen);
+	if (changed || timeout_msec == 0)
+	{
+		return (changed);
+	}
+
+	std::unique_lock<std::mutex> lock(notifyMutex);
+	(void)notify_block(lock, mask, timeout_msec,
+		[&changed, mask, seen]() { changed = notify_changed(mask, seen); return (changed != 0); });
+	return (changed);
+}
+
+/*
+ * FUNCTION: notify_ack
+ *
+ * ARGUMENTS:
+ *		topic	- Topic handled
+ *		gen		- notify_generation(topic) from before the work was taken
+ *
+ * Record that every signal up to gen has been handled and wake the threads
+ * waiting for the topic's acknowledgement.
+ */
+void
+notify_ack(int topic, uint64_t gen)
+{
+	uint64_t prev;
+
+	if (topic < 0 || topic >= NOTIFY_TOPIC_COUNT)
+	{
+		return;
+	}
+	std::lock_guard<std::mutex> lock(notifyMutex);
+	prev = notifyAck[topic].load(std::memory_order_relaxed);
+	if (gen <= prev)
+	{
+		return;
+	}
+	notifyAck[topic].store(gen, std::memory_order_release);
+	notify_wake(NOTIFY_ACK_MASK(topic));
+}
+
+/*
+ * FUNCTION: notify_wait_ack
+ *
+ * ARGUMENTS:
+ *		topic			- Topic signalled
+ *		gen				- notify_generation(topic) after the caller's notify_signal()
+ *		timeout_msec	- Longest time to block
+ *
+ * RETURNS:
+ *		true once gen has been acknowledged, false on timeout
+ */
+bool
+notify_wait_ack(int topic, uint64_t gen, unsigned int timeout_msec)
+{
+	if (topic < 0 || topic >= NOTIFY_TOPIC_COUNT)
+	{
+		return (false);
+	}
+	if (notifyAck[topic].load(std::memory_order_acquire) >= gen)
+	{
+		return (true);
+	}
+	std::unique_lock<std::mutex> lock(notifyMutex);
+	return (notify_block(lock, NOTIFY_ACK_MASK(topic), timeout_msec,
+		[topic, gen]() { return (notifyAck[topic].load(std::memory_order_acquire) >= gen); }));
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+/*
+ * simnotify.h
+ *
+ * Change notification between the SimMgr threads.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+
+/*
+ * Each topic has a generation counter that is bumped by notify_signal().
+ * A waiter keeps the generations it has already seen in a notify_seen and
+ * blocks in notify_wait() until one of the topics in its mask moves on,
+ * or the timeout expires. A signal that arrives while the waiter is busy
+ * is not lost; the next notify_wait() returns immediately.
+ */
+enum NotifyTopic
+{
+	NOTIFY_INSTRUCTOR = 0,	// Write into the instructor block (set:, processInit)
+	NOTIFY_STATUS,			// status block changed (scan_commands, reset)
+	NOTIFY_BEAT,			// pulse, VPC or breath count incremented
+	NOTIFY_EVENT,			// event or comment added to the lists
+	NOTIFY_SCENARIO,		// scenario state change
+	NOTIFY_TOPIC_COUNT
+};
+
+#define NOTIFY_MASK(topic)	(1u << (topic))
+
+struct notify_seen
+{
+	uint64_t gen[NOTIFY_TOPIC_COUNT];
+};
+
+void notify_signal(int topic);
+uint64_t notify_generation(int topic);
+void notify_snapshot(struct notify_seen* seen);
+unsigned int notify_wait(unsigned int mask, struct notify_seen* seen, unsigned int timeout_msec);
+
+/*
+ * Acknowledgement. The consumer of a topic reads notify_generation() before it
+ * takes the work and calls notify_ack() with it when done. A producer that must
+ * know its write has been handled takes the generation after its notify_signal()
+ * and waits for that in notify_wait_ack().
+ */
+void notify_ack(int topic, uint64_t gen);
+bool notify_wait_ack(int topic, uint64_t gen, unsigned int timeout_msec);
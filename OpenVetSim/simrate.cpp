@@ -0,0 +1,125 @@
+/*
+ * simrate.cpp
+ *
+ * Sliding window rate estimators for the heart rate and airway respiration rate.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "simrate.h"
+
+#define RATE_INDEX(n)	((n) & (RATE_LOG_LEN - 1))
+
+void
+rate_init(struct rate_window* w, uint64_t max_age, uint64_t idle, uint64_t min_gap)
+{
+	std::lock_guard<std::mutex> lock(w->lock);
+
+	w->max_age = max_age;
+	w->idle = idle;
+	w->min_gap = min_gap;
+	w->head = 0;
+	w->tail = 0;
+}
+
+void
+rate_reset(struct rate_window* w)
+{
+	std::lock_guard<std::mutex> lock(w->lock);
+
+	w->head = 0;
+	w->tail = 0;
+}
+
+/*
+ * FUNCTION: rate_beat
+ *
+ * ARGUMENTS:
+ *		w		- Window
+ *		when	- msec time the beat was due
+ */
+void
+rate_beat(struct rate_window* w, uint64_t when)
+{
+	std::lock_guard<std::mutex> lock(w->lock);
+
+	if (w->head != w->tail)
+	{
+		if (when < w->time[RATE_INDEX(w->head - 1)] + w->min_gap)
+		{
+			return;
+		}
+	}
+	if (w->head - w->tail == RATE_LOG_LEN)
+	{
+		w->tail++;
+	}
+	w->time[RATE_INDEX(w->head)] = when;
+	w->head++;
+}
+
+/*
+ * FUNCTION: rate_get
+ *
+ * ARGUMENTS:
+ *		w				- Window
+ *		now				- Current msec time
+ *		min_intervals	- Fewest intervals that give a rate
+ *		max_intervals	- Most recent intervals to average, less than RATE_LOG_LEN
+ *
+ * RETURNS:
+ *		Rate per minute, or 0 when there are too few beats or none within the idle time
+ */
+float
+rate_get(struct rate_window* w, uint64_t now, int min_intervals, int max_intervals)
+{
+	std::lock_guard<std::mutex> lock(w->lock);
+	uint64_t newest;
+	uint64_t first;
+	unsigned int n;
+
+	// Each beat expires once, so this is constant time over a run of reads
+	while (w->tail != w->head && now > w->time[RATE_INDEX(w->tail)] + w->max_age)
+	{
+		w->tail++;
+	}
+	n = w->head - w->tail;
+	if (n == 0)
+	{
+		return (0);
+	}
+	newest = w->time[RATE_INDEX(w->head - 1)];
+	if (now > newest + w->idle)
+	{
+		return (0);
+	}
+	n -= 1;
+	if (n > (unsigned int)max_intervals)
+	{
+		n = max_intervals;
+	}
+	if ((int)n < min_intervals || n == 0)
+	{
+		return (0);
+	}
+	first = w->time[RATE_INDEX(w->head - 1 - n)];
+	if (newest <= first)
+	{
+		return (0);
+	}
+	return (((float)n * 60000) / (float)(newest - first));
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+/*
+ * simrate.h
+ *
+ * Sliding window rate estimators for the heart rate and airway respiration rate.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#include <mutex>
+
+#define RATE_LOG_LEN		64		// Power of two; more than the largest interval limit
+
+/*
+ * A window holds the times of the most recent beats (or breaths), stamped by the
+ * beat handlers with the time the beat was due rather than the time a poll saw it.
+ * Beats older than max_age expire as the window is read, and a beat less than
+ * min_gap after the previous one is taken as the same beat.
+ *
+ * The rate over the newest n intervals is n / (newest - time n beats back), so
+ * each push and each read is constant time whatever the interval limit.
+ */
+struct rate_window
+{
+	uint64_t time[RATE_LOG_LEN];	// msec
+	unsigned int head;				// Beats pushed
+	unsigned int tail;				// Oldest beat not yet expired
+	uint64_t max_age;				// msec
+	uint64_t idle;					// msec without a beat before the rate is 0
+	uint64_t min_gap;				// msec
+	std::mutex lock;				// Beat threads push, timers read
+};
+
+void rate_init(struct rate_window* w, uint64_t max_age, uint64_t idle, uint64_t min_gap);
+void rate_reset(struct rate_window* w);
+void rate_beat(struct rate_window* w, uint64_t when);
+float rate_get(struct rate_window* w, uint64_t now, int min_intervals, int max_intervals);
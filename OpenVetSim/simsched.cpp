@@ -0,0 +1,276 @@
+/*
+ * simsched.cpp
+ *
+ * Deadline scheduler for the SimMgr periodic tasks.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * The tasks are registered once at startup and all run on the thread that
+ * calls sched_run_once(), so they never run concurrently with each other.
+ * The statistics are relaxed atomics written only by that thread; readers get
+ * a snapshot that may be one run out of date.
+ */
+
+#include "vetsim.h"
+#include "simsched.h"
+
+static struct sched_task schedTasks[SCHED_MAX_TASKS];
+static int schedTaskCount = 0;
+static struct notify_seen schedSeen;
+static unsigned int schedTriggerMask = 0;
+static bool schedStarted = false;
+
+/*
+ * FUNCTION: sched_add
+ *
+ * ARGUMENTS:
+ *		name			- Name for logs and metrics
+ *		func			- Task function
+ *		period_msec		- Run interval, or 0 for trigger-only
+ *		trigger_mask	- NOTIFY_MASK() topics that run the task at once
+ *
+ * RETURNS:
+ *		Task index, or -1 if the table is full
+ */
+int
+sched_add(const char* name, void (*func)(void), unsigned int period_msec, unsigned int trigger_mask)
+{
+	struct sched_task* task;
+	char buf[LONG_STR_SIZE];
+
+	if (schedTaskCount >= SCHED_MAX_TASKS)
+	{
+		sprintf_s(buf, LONG_STR_SIZE, "sched_add: No room for task %s", name);
+		log_message("", buf);
+		return (-1);
+	}
+	task = &schedTasks[schedTaskCount];
+	task->name = name;
+	task->func = func;
+	task->period_msec = period_msec;
+	task->trigger_mask = trigger_mask;
+	task->next_run = period_msec ? clock_msec() + period_msec : 0;
+	task->runs.store(0, std::memory_order_relaxed);
+	task->triggered_runs.store(0, std::memory_order_relaxed);
+	task->overruns.store(0, std::memory_order_relaxed);
+	task->last_usec.store(0, std::memory_order_relaxed);
+	task->max_usec.store(0, std::memory_order_relaxed);
+	task->total_usec.store(0, std::memory_order_relaxed);
+	schedTriggerMask |= trigger_mask;
+
+	return (schedTaskCount++);
+}
+
+/*
+ * FUNCTION: sched_wake
+ *
+ * ARGUMENTS:
+ *		index	- Task index from sched_add
+ *		when	- clock_msec() time to run the task, or 0 to cancel
+ *
+ * Set the one-shot deadline of a task with no period. For a periodic task, an
+ * earlier time brings the next run forward. Call from the scheduler thread.
+ */
+void
+sched_wake(int index, uint64_t when)
+{
+	struct sched_task* task;
+
+	if (index < 0 || index >= schedTaskCount)
+	{
+		return;
+	}
+	task = &schedTasks[index];
+	if (task->period_msec == 0)
+	{
+		task->next_run = when;
+	}
+	else if (when && when < task->next_run)
+	{
+		task->next_run = when;
+	}
+}
+
+static void
+sched_run_task(struct sched_task* task)
+{
+	uint64_t start;
+	uint64_t usec;
+
+	start = metric_usec();
+	task->func();
+	usec = metric_usec() - start;
+	trace_span(task->name, start);
+
+	task->runs.fetch_add(1, std::memory_order_relaxed);
+	task->last_usec.store(usec, std::memory_order_relaxed);
+	task->total_usec.fetch_add(usec, std::memory_order_relaxed);
+	if (usec > task->max_usec.load(std::memory_order_relaxed))
+	{
+		task->max_usec.store(usec, std::memory_order_relaxed);
+	}
+}
+
+// Run every task triggered by the changed topics, then every task that is due.
+// Returns the number of runs.
+static int
+sched_dispatch(unsigned int changed)
+{
+	struct sched_task* task;
+	uint64_t now;
+	int runs = 0;
+	int i;
+
+	if (changed)
+	{
+		for (i = 0; i < schedTaskCount; i++)
+		{
+			task = &schedTasks[i];
+			if (task->trigger_mask & changed)
+			{
+				task->triggered_runs.fetch_add(1, std::memory_order_relaxed);
+				sched_run_task(task);
+				runs++;
+			}
+		}
+	}
+
+	for (i = 0; i < schedTaskCount; i++)
+	{
+		task = &schedTasks[i];
+		now = clock_msec();
+		if (task->period_msec == 0)
+		{
+			if (task->next_run && task->next_run <= now)
+			{
+				task->next_run = 0;			// The task may wake itself again
+				sched_run_task(task);
+				runs++;
+			}
+			continue;
+		}
+		if (task->next_run <= now)
+		{
+			sched_run_task(task);
+			runs++;
+			task->next_run += task->period_msec;
+			if (task->next_run <= now)
+			{
+				task->overruns.fetch_add(1, std::memory_order_relaxed);
+				task->next_run = now + task->period_msec;
+			}
+		}
+	}
+	return (runs);
+}
+
+/*
+ * FUNCTION: sched_run_once
+ *
+ * Block until the earliest deadline or a trigger topic is signalled (at most
+ * SCHED_MAX_WAIT msec), then run every triggered task followed by every task
+ * whose deadline has passed.
+ */
+void
+sched_run_once(void)
+{
+	uint64_t now;
+	uint64_t wake;
+	unsigned int changed;
+
+	if (!schedStarted)
+	{
+		notify_snapshot(&schedSeen);
+		schedStarted = true;
+	}
+
+	now = clock_msec();
+	wake = sched_next_run();
+	if (wake == 0 || wake > now + SCHED_MAX_WAIT)
+	{
+		wake = now + SCHED_MAX_WAIT;
+	}
+	changed = 0;
+	if (wake > now)
+	{
+		changed = notify_wait(schedTriggerMask, &schedSeen, (unsigned int)(wake - now));
+	}
+	(void)sched_dispatch(changed);
+}
+
+/*
+ * FUNCTION: sched_run_ready
+ *
+ * As sched_run_once, but without blocking. For the headless runner, which moves
+ * the clock itself.
+ *
+ * RETURNS:
+ *		Number of task runs; 0 when nothing was triggered or due
+ */
+int
+sched_run_ready(void)
+{
+	unsigned int changed;
+
+	if (!schedStarted)
+	{
+		notify_snapshot(&schedSeen);
+		schedStarted = true;
+	}
+	changed = notify_wait(schedTriggerMask, &schedSeen, 0);
+	return (sched_dispatch(changed));
+}
+
+/*
+ * FUNCTION: sched_next_run
+ *
+ * RETURNS:
+ *		The earliest task deadline, in clock_msec() time, or 0 if there is none
+ */
+uint64_t
+sched_next_run(void)
+{
+	uint64_t next = 0;
+	int i;
+
+	for (i = 0; i < schedTaskCount; i++)
+	{
+		if (schedTasks[i].next_run && (next == 0 || schedTasks[i].next_run < next))
+		{
+			next = schedTasks[i].next_run;
+		}
+	}
+	return (next);
+}
+
+int
+sched_task_count(void)
+{
+	return (schedTaskCount);
+}
+
+const struct sched_task*
+sched_get_task(int index)
+{
+	if (index < 0 || index >= schedTaskCount)
+	{
+		return (NULL);
+	}
+	return (&schedTasks[index]);
+}
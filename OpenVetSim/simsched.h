@@ -0,0 +1,63 @@
+#pragma once
+
+/*
+ * simsched.h
+ *
+ * Deadline scheduler for the SimMgr periodic tasks.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <cstdint>
+
+#define SCHED_MAX_TASKS		16
+#define SCHED_MAX_WAIT		50		// msec; longest block, so the console key check still runs
+
+/*
+ * A task runs when its deadline passes (period_msec > 0) and immediately when
+ * one of the notify topics in trigger_mask is signalled. Each run is timed.
+ * A periodic run that starts a full period late counts as an overrun; the
+ * missed runs are dropped and the deadline restarts from the current time.
+ *
+ * A task with no period can instead be given a one-shot deadline with
+ * sched_wake(), for work whose next due time it computes itself.
+ */
+struct sched_task
+{
+	const char* name;
+	void (*func)(void);
+	unsigned int period_msec;		// 0 for trigger-only tasks
+	unsigned int trigger_mask;		// NOTIFY_MASK() topics that run the task at once
+	uint64_t next_run;				// msec deadline (clock_msec); 0 for none when there is no period
+
+	// Written by the scheduler thread only; relaxed, for the metrics reader
+	std::atomic<uint64_t> runs;
+	std::atomic<uint64_t> triggered_runs;
+	std::atomic<uint64_t> overruns;
+	std::atomic<uint64_t> last_usec;
+	std::atomic<uint64_t> max_usec;
+	std::atomic<uint64_t> total_usec;
+};
+
+int sched_add(const char* name, void (*func)(void), unsigned int period_msec, unsigned int trigger_mask);
+void sched_wake(int index, uint64_t when);
+void sched_run_once(void);
+int sched_run_ready(void);
+uint64_t sched_next_run(void);
+int sched_task_count(void);
+const struct sched_task* sched_get_task(int index);
@@ -63,15 +63,6 @@ std::vector<std::string> explode(std::string const& s, char delim)
 	return result;
 }
 
-void
-releaseLock(int taken)
-{
-	if (taken)
-	{
-		releaseInstructorLock();
-	}
-}
-
 int debug = 0;
 
 #define BUF_SIZE	2048
@@ -83,6 +74,10 @@ char recvbuf[DEFAULT_BUFLEN];
 char firstLine[DEFAULT_BUFLEN];
 int simstatusHandleCommand(char *args);
 void sendNotFound(char* path);
+void sendMetrics(void);
+void sendTrace(char* args);
+void sendSimlog(char* args);
+static void requestLabel(const char* args, char* label, size_t size);
 
 void
 simstatusMain(void)
@@ -96,6 +91,8 @@ simstatusMain(void)
 	struct sockaddr client_addr;
 	socklen_t socklen;
 	WSADATA w;
+	uint64_t reqStart;
+	char reqLabel[METRIC_LABEL_SIZE];
 
 	printf("simstatus is on port %d\n", portno);
 
@@ -267,18 +264,39 @@ simstatusMain(void)
 				//cout << "------------" << endl;
 				if (path)
 				{
+					reqStart = metric_usec();
 					if (strcmp(path, "simstatus.cgi") == 0)
 					{
+						requestLabel(args, reqLabel, sizeof(reqLabel));
 						simstatusHandleCommand(args );
 					}
 					else if (strcmp(path, "cgi-bin/simstatus.cgi") == 0)
 					{
+						requestLabel(args, reqLabel, sizeof(reqLabel));
 						simstatusHandleCommand(args );
 					}
+					else if (strcmp(path, "metrics") == 0)
+					{
+						sprintf_s(reqLabel, sizeof(reqLabel), "%s", "metrics");
+						sendMetrics();
+					}
+					else if (strcmp(path, "trace") == 0)
+					{
+						sprintf_s(reqLabel, sizeof(reqLabel), "%s", "trace");
+						sendTrace(args);
+					}
+					else if (strcmp(path, "simlog") == 0)
+					{
+						sprintf_s(reqLabel, sizeof(reqLabel), "%s", "simlog");
+						sendSimlog(args);
+					}
 					else
 					{
+						sprintf_s(reqLabel, sizeof(reqLabel), "%s", "notfound");
 						sendNotFound(path);
 					}
+					metric_request(reqLabel, metric_usec() - reqStart);
+					trace_span_arg("http", reqStart, reqLabel);
 				}
 				// Send reply
 				//cout << "Returning\n------------\n" << htmlReply << "\n------------\n" << endl;
@@ -355,6 +373,168 @@ sendNotFound(char *path)
 	htmlReply += "< / style>\n";
 	htmlReply += "< / head><body><h1>Not Found< / h1><p>The requested resource <code class = 'url'> / " + str + "< / code> was not found on this server.< / p>< / body> < / html>\n";
 }
+
+/*
+ * FUNCTION: sendMetrics
+ *
+ * Reply with the engine metrics in Prometheus text format.
+ */
+void
+sendMetrics(void)
+{
+	htmlReply += "HTTP/1.1 200 OK\r\n";
+	htmlReply += "Server:vetsim / 1.0\r\n";
+	htmlReply += "Access-Control-Allow-Origin: *\r\n";
+	htmlReply += "Content-Type: text/plain; version=0.0.4\r\n";
+	htmlReply += "Connection: close\r\n\r\n";
+	metrics_write(htmlReply);
+}
+
+/*
+ * FUNCTION: sendTrace
+ *
+ * ARGUMENTS:
+ *		args	- "start=<seconds>" to begin tracing (0 runs until stopped),
+ *				  "stop=1" to end it. With no args, reply with the trace so far.
+ */
+void
+sendTrace(char* args)
+{
+	char buf[64];
+
+	htmlReply += "HTTP/1.1 200 OK\r\n";
+	htmlReply += "Server:vetsim / 1.0\r\n";
+	htmlReply += "Access-Control-Allow-Origin: *\r\n";
+	htmlReply += "Content-Type:  application/json\r\n";
+	htmlReply += "Connection: close\r\n\r\n";
+	if (args && strncmp(args, "start=", 6) == 0)
+	{
+		trace_start((unsigned int)atoi(&args[6]));
+		sprintf_s(buf, sizeof(buf), "{\"trace\":\"started\",\"seconds\":%d}\n", atoi(&args[6]));
+		htmlReply += buf;
+	}
+	else if (args && strncmp(args, "stop=", 5) == 0)
+	{
+		trace_stop();
+		htmlReply += "{\"trace\":\"stopped\"}\n";
+	}
+	else
+	{
+		trace_write(htmlReply);
+	}
+}
+
+/*
+ * FUNCTION: sendSimlog
+ *
+ * ARGUMENTS:
+ *		args	- "first=<line>&count=<lines>" for a range, lines counting from 1,
+ *				  or "tail=<lines>" for the last lines. At most SIMLOG_RANGE_MAX.
+ *
+ * Reply with lines of the session log, as text. X-Simlog-Lines has the number of
+ * lines in the log, for the next request.
+ */
+void
+sendSimlog(char* args)
+{
+	char buf[64];
+	char* token;
+	char* next = NULL;
+	int lines;
+	int first = 1;
+	int count = SIMLOG_RANGE_MAX;
+	int tail = -1;
+
+	if (args)
+	{
+		for (token = strtok_s(args, "&", &next); token; token = strtok_s(NULL, "&", &next))
+		{
+			if (strncmp(token, "first=", 6) == 0)
+			{
+				first = atoi(&token[6]);
+			}
+			else if (strncmp(token, "count=", 6) == 0)
+			{
+				count = atoi(&token[6]);
+			}
+			else if (strncmp(token, "tail=", 5) == 0)
+			{
+				tail = atoi(&token[5]);
+			}
+		}
+	}
+	lines = simlog_line_count();
+	if (tail >= 0)
+	{
+		count = tail;
+		first = lines - tail + 1;
+		if (first < 1)
+		{
+			first = 1;
+		}
+	}
+	if (count > SIMLOG_RANGE_MAX)
+	{
+		count = SIMLOG_RANGE_MAX;
+	}
+	htmlReply += "HTTP/1.1 200 OK\r\n";
+	htmlReply += "Server:vetsim / 1.0\r\n";
+	htmlReply += "Access-Control-Allow-Origin: *\r\n";
+	htmlReply += "Access-Control-Expose-Headers: X-Simlog-Lines\r\n";
+	htmlReply += "Content-Type: text/plain\r\n";
+	sprintf_s(buf, sizeof(buf), "X-Simlog-Lines: %d\r\n", lines);
+	htmlReply += buf;
+	htmlReply += "Connection: close\r\n\r\n";
+	(void)simlog_read_lines(first, count, htmlReply);
+}
+
+/*
+ * FUNCTION: requestLabel
+ *
+ * ARGUMENTS:
+ *		args	- Request arguments, "key=value&key=value"
+ *		label	- Receives the first key that is not a session key, up to any ':'
+ *		size	- Size of label
+ *
+ * The label is limited to letters, digits and '_' so it is safe in the metrics output.
+ */
+static void
+requestLabel(const char* args, char* label, size_t size)
+{
+	const char* key;
+	size_t len;
+
+	snprintf(label, size, "%s", "status");
+	if (args == NULL)
+	{
+		return;
+	}
+	key = args;
+	while (*key)
+	{
+		if (strncmp(key, "PHPSESSID=", 10) != 0 &&
+			strncmp(key, "simIIUserID=", 12) != 0 &&
+			strncmp(key, "userID=", 7) != 0)
+		{
+			for (len = 0; len < size - 1 && (isalnum((unsigned char)key[len]) || key[len] == '_'); len++)
+			{
+				label[len] = key[len];
+			}
+			if (len > 0)
+			{
+				label[len] = 0;
+			}
+			return;
+		}
+		key = strchr(key, '&');
+		if (key == NULL)
+		{
+			return;
+		}
+		key++;
+	}
+}
+
 struct argument
 {
 	string key;
@@ -363,6 +543,32 @@ struct argument
 
 char defaultArgs[] = "status=1";
 
+/*
+ * FUNCTION: setSections
+ *
+ * ARGUMENTS:
+ *		name	- Class from a set: command, such as "cardiac"
+ *
+ * RETURNS:
+ *		II_MASK() of the sections the command writes. addEvent also sets the shock for "aed".
+ */
+static unsigned int
+setSections(const char* name)
+{
+	int section;
+
+	section = instructorSection(name);
+	if (section == II_EVENTS)
+	{
+		return (II_MASK(II_EVENTS) | II_MASK(II_CPR));
+	}
+	if (section >= 0)
+	{
+		return (II_MASK(section));
+	}
+	return (0);
+}
+
 int
 simstatusHandleCommand(char *args)
 {
@@ -374,7 +580,7 @@ simstatusHandleCommand(char *args)
 	char sesid[512] = { 0, };
 	int userid = -1;
 	argument arg;
-	int ss_iiLockTaken = 0;
+	unsigned int sections;
 
 	std::string key;
 	std::string value;
@@ -469,6 +675,7 @@ simstatusHandleCommand(char *args)
 				makejson(key, value);
 				htmlReply += ",\n";
 				closeFlag = 1;
+				notify_signal(NOTIFY_SCENARIO);
 			}
 			else
 			{
@@ -479,28 +686,26 @@ simstatusHandleCommand(char *args)
 	}
 
 	sprintf_s(cmd, sizeof(cmd), "none");
-	// If any "set" commands are in the GET/POST list, then take the Instructor Interface lock
+
+	// Lock every section the set: commands write, once for the whole request, so
+	// scan_commands sees a value and its transfer_time together.
+	sections = 0;
 	for (itr = argList.begin(); itr != argList.end(); ++itr)
 	{
-		arg = itr->second;
-		key = arg.key;
-		value = arg.value;
-
+		key = itr->second.key;
 		if (key.compare(0, 4, "set:") == 0)
 		{
-			if (takeInstructorLock() != 0)
+			v = explode(key, ':');
+			if (v.size() > 1)
 			{
-				makejson("status", "Fail");
-				htmlReply += ",\n    ";
-				makejson("error", "Could not get Instructor Mutex");
-				htmlReply += "\n}\n";
-				return (0);
+				sections |= setSections(v[1].c_str());
 			}
-
-			ss_iiLockTaken = 1;
-			break;
 		}
 	}
+	if (sections)
+	{
+		takeInstructorSections(sections);
+	}
 
 	i = 0;
 	// Parse the submitted GET/POST elements
@@ -613,21 +818,24 @@ simstatusHandleCommand(char *args)
 			if (v[1].compare("cardiac") == 0)
 			{
 				printf("Calling Cardiac Parse, \"%s\", \"%s\"\n", v[2].c_str(), value.c_str());
-				sts = cardiac_parse(v[2].c_str(), value.c_str(), &simmgr_shm->instructor.cardiac);
+				sts = cardiac_parse(v[2].c_str(), value.c_str(), &simmgr_shm->instructor.cardiac, &simmgr_shm->instructor.dirty[II_CARDIAC]);
 			}
 			else if (v[1].compare("scenario") == 0)
 			{
 				if (v[2].compare("active") == 0)
 				{
 					sprintf_s(simmgr_shm->instructor.scenario.active, STR_SIZE, "%s", value.c_str());
+					instructorMark(II_SCENARIO, SCENARIO_F_ACTIVE);
 				}
 				else if (v[2].compare("state") == 0)
 				{
 					sprintf_s(simmgr_shm->instructor.scenario.state, STR_SIZE, "%s", value.c_str());
+					instructorMark(II_SCENARIO, SCENARIO_F_STATE);
 				}
 				else if (v[2].compare("record") == 0)
 				{
 					simmgr_shm->instructor.scenario.record = atoi(value.c_str());
+					instructorMark(II_SCENARIO, SCENARIO_F_RECORD);
 				}
 				else
 				{
@@ -636,23 +844,23 @@ simstatusHandleCommand(char *args)
 			}
 			else if (v[1].compare("respiration") == 0)
 			{
-				sts = respiration_parse(v[2].c_str(), value.c_str(), &simmgr_shm->instructor.respiration);
+				sts = respiration_parse(v[2].c_str(), value.c_str(), &simmgr_shm->instructor.respiration, &simmgr_shm->instructor.dirty[II_RESPIRATION]);
 			}
 			else if (v[1].compare("general") == 0)
 			{
-				sts = general_parse(v[2].c_str(), value.c_str(), &simmgr_shm->instructor.general);
+				sts = general_parse(v[2].c_str(), value.c_str(), &simmgr_shm->instructor.general, &simmgr_shm->instructor.dirty[II_GENERAL]);
 			}
 			else if (v[1].compare("telesim") == 0)
 			{
-				sts = telesim_parse(v[2].c_str(), value.c_str(), &simmgr_shm->instructor.telesim);
+				sts = telesim_parse(v[2].c_str(), value.c_str(), &simmgr_shm->instructor.telesim, &simmgr_shm->instructor.dirty[II_TELESIM]);
 			}
 			else if (v[1].compare("vocals") == 0)
 			{
-				sts = vocals_parse(v[2].c_str(), value.c_str(), &simmgr_shm->instructor.vocals);
+				sts = vocals_parse(v[2].c_str(), value.c_str(), &simmgr_shm->instructor.vocals, &simmgr_shm->instructor.dirty[II_MEDIA]);
 			}
 			else if (v[1].compare("media") == 0)
 			{
-				sts = media_parse(v[2].c_str(), value.c_str(), &simmgr_shm->instructor.media);
+				sts = media_parse(v[2].c_str(), value.c_str(), &simmgr_shm->instructor.media, &simmgr_shm->instructor.dirty[II_MEDIA]);
 			}
 			else if (v[1].compare("event") == 0)
 			{
@@ -700,11 +908,13 @@ simstatusHandleCommand(char *args)
 				if (v[2].compare("compression") == 0)
 				{
 					simmgr_shm->instructor.cpr.compression = atoi(value.c_str());
+					instructorMark(II_CPR, CPR_F_COMPRESSION);
 					sts = 0;
 				}
 				else if (v[2].compare("release") == 0)
 				{
 					simmgr_shm->instructor.cpr.release = atoi(value.c_str());
+					instructorMark(II_CPR, CPR_F_RELEASE);
 					sts = 0;
 				}
 				else
@@ -797,13 +1007,18 @@ simstatusHandleCommand(char *args)
 		}
 	}
 
+	if (sections)
+	{
+		releaseInstructorSections(sections);
+	}
+
 	htmlReply += "\n}\n";
-	if (ss_iiLockTaken)
+	if (set_count > 0)
 	{
-		releaseLock(ss_iiLockTaken);
+		// set:pulse and set:auscultation write the status block directly
+		notify_signal(NOTIFY_INSTRUCTOR);
+		notify_signal(NOTIFY_STATUS);
 	}
-	
-	ss_iiLockTaken = 0;
 	return (0);
 }
 
@@ -0,0 +1,346 @@
+/*
+ * simtrace.cpp
+ *
+ * Timeline trace of engine activity, exported as Chrome trace-event JSON.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vetsim.h"
+#include "simtrace.h"
+
+#define TRACE_DUMP_MARGIN	64		// Oldest records skipped in a wrapped ring; they may be mid-overwrite
+
+struct trace_record
+{
+	const char* name;
+	uint64_t ts;			// usec, metric_usec()
+	uint64_t dur;			// usec, spans only
+	char ph;				// 'X' span, 'i' instant
+	char arg[TRACE_ARG_SIZE];
+};
+
+struct trace_ring
+{
+	char thread[TASK_NAME_SIZE];	// Under traceRingMutex
+	std::atomic<uint32_t> head;		// Records written; only the owning thread stores
+	std::atomic<uint64_t> since;	// Records older than this are an earlier owner's
+	std::atomic<bool> used;			// Has a live owning thread
+	struct trace_record rec[TRACE_RING_SIZE];
+};
+
+// Gives the thread's ring up when the thread exits
+struct trace_owner
+{
+	struct trace_ring* ring = NULL;
+	bool none = false;				// No ring was free; do not record
+
+	~trace_owner()
+	{
+		if (ring)
+		{
+			ring->used.store(false, std::memory_order_release);
+		}
+	}
+};
+
+std::atomic<bool> traceEnabled(false);
+
+static struct trace_ring* traceRings[TRACE_MAX_THREADS];
+static std::atomic<int> traceRingCount(0);
+static std::mutex traceRingMutex;		// Ring allocation and the dump
+static thread_local struct trace_owner traceOwner;
+static std::atomic<uint64_t> traceStartUsec(0);
+static std::atomic<uint64_t> traceDeadline(0);	// clock_msec(), 0 for none
+
+// The ring's newest record time, 0 if it has none
+static uint64_t
+trace_ring_newest(struct trace_ring* ring)
+{
+	uint32_t head = ring->head.load(std::memory_order_acquire);
+
+	return (head ? ring->rec[(head - 1) & (TRACE_RING_SIZE - 1)].ts : 0);
+}
+
+/*
+ * A thread that exits gives its ring up for the next thread that records. A free
+ * ring whose records all predate the trace is taken first, then a new ring, and
+ * at TRACE_MAX_THREADS the free ring with the oldest records, whose records are
+ * then left out of the dump.
+ */
+static struct trace_ring*
+trace_ring_get(void)
+{
+	struct trace_ring* ring = NULL;
+	uint64_t start;
+	int count;
+	int i;
+
+	if (traceOwner.ring || traceOwner.none)
+	{
+		return (traceOwner.ring);
+	}
+	std::lock_guard<std::mutex> lock(traceRingMutex);
+	start = traceStartUsec.load(std::memory_order_relaxed);
+	count = traceRingCount.load(std::memory_order_relaxed);
+	for (i = 0; i < count; i++)
+	{
+		if (!traceRings[i]->used.load(std::memory_order_acquire) &&
+			(!ring || trace_ring_newest(traceRings[i]) < trace_ring_newest(ring)))
+		{
+			ring = traceRings[i];
+		}
+	}
+	if (ring && trace_ring_newest(ring) >= start && count < TRACE_MAX_THREADS)
+	{
+		ring = NULL;
+	}
+	if (!ring)
+	{
+		if (count >= TRACE_MAX_THREADS)
+		{
+			traceOwner.none = true;
+			return (NULL);
+		}
+		ring = new struct trace_ring;
+		ring->head.store(0, std::memory_order_relaxed);
+		traceRings[count] = ring;
+		traceRingCount.store(count + 1, std::memory_order_release);
+	}
+	snprintf(ring->thread, TASK_NAME_SIZE, "%s", task_self_name());
+	ring->since.store(trace_ring_newest(ring) + 1, std::memory_order_relaxed);
+	ring->used.store(true, std::memory_order_relaxed);
+	traceOwner.ring = ring;
+	return (ring);
+}
+
+static void
+trace_record(const char* name, char ph, uint64_t ts, uint64_t dur, const char* arg)
+{
+	struct trace_ring* ring;
+	struct trace_record* rec;
+	uint32_t head;
+
+	ring = trace_ring_get();
+	if (!ring)
+	{
+		return;
+	}
+	head = ring->head.load(std::memory_order_relaxed);
+	rec = &ring->rec[head & (TRACE_RING_SIZE - 1)];
+	rec->name = name;
+	rec->ts = ts;
+	rec->dur = dur;
+	rec->ph = ph;
+	if (arg)
+	{
+		snprintf(rec->arg, TRACE_ARG_SIZE, "%s", arg);
+	}
+	else
+	{
+		rec->arg[0] = 0;
+	}
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+void
+trace_instant_arg(const char* name, const char* arg)
+{
+	if (traceEnabled.load(std::memory_order_relaxed))
+	{
+		trace_record(name, 'i', metric_usec(), 0, arg);
+	}
+}
+
+void
+trace_span_arg(const char* name, uint64_t start_usec, const char* arg)
+{
+	uint64_t now;
+
+	if (traceEnabled.load(std::memory_order_relaxed))
+	{
+		now = metric_usec();
+		trace_record(name, 'X', start_usec, now - start_usec, arg);
+	}
+}
+
+/*
+ * FUNCTION: trace_start
+ *
+ * ARGUMENTS:
+ *		seconds	- Length of the trace window. When it ends trace_check writes the
+ *				  trace to simlogs. 0 traces until trace_stop.
+ */
+void
+trace_start(unsigned int seconds)
+{
+	traceStartUsec.store(metric_usec(), std::memory_order_relaxed);
+	traceDeadline.store(seconds ? clock_msec() + (uint64_t)seconds * 1000 : 0, std::memory_order_relaxed);
+	traceEnabled.store(true, std::memory_order_release);
+}
+
+void
+trace_stop(void)
+{
+	traceEnabled.store(false, std::memory_order_release);
+	traceDeadline.store(0, std::memory_order_relaxed);
+}
+
+/*
+ * FUNCTION: trace_check
+ *
+ * Periodic task. At the end of a trace window, stop tracing and write the
+ * trace to simlogs/trace-<date>-<time>.json.
+ */
+void
+trace_check(void)
+{
+	std::string out;
+	char filename[sizeof(localConfig.html_path) + 64];
+	char msg[sizeof(filename) + 64];
+	uint64_t deadline;
+	FILE* fp;
+	errno_t err;
+	time_t now;
+	struct tm tm;
+
+	deadline = traceDeadline.load(std::memory_order_relaxed);
+	if (deadline == 0 || clock_msec() < deadline)
+	{
+		return;
+	}
+	trace_stop();
+	trace_write(out);
+
+	now = time(NULL);
+#ifdef _WIN32
+	localtime_s(&tm, &now);
+#else
+	localtime_r(&now, &tm);
+#endif
+	snprintf(filename, sizeof(filename), "%s%ssimlogs%strace-%04d%02d%02d-%02d%02d%02d.json",
+		localConfig.html_path, PATH_SEP, PATH_SEP,
+		tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+	err = fopen_s(&fp, filename, "w");
+	if (err != 0 || fp == NULL)
+	{
+		snprintf(msg, sizeof(msg), "trace_check: Cannot write %s", filename);
+	}
+	else
+	{
+		fwrite(out.c_str(), 1, out.length(), fp);
+		fclose(fp);
+		snprintf(msg, sizeof(msg), "Trace written to %s", filename);
+	}
+	log_message("", msg);
+}
+
+static void
+trace_json_string(std::string& out, const char* str)
+{
+	out += '"';
+	for (; *str; str++)
+	{
+		if (*str == '"' || *str == '\\' || (unsigned char)*str < 0x20)
+		{
+			out += '_';
+		}
+		else
+		{
+			out += *str;
+		}
+	}
+	out += '"';
+}
+
+/*
+ * FUNCTION: trace_write
+ *
+ * ARGUMENTS:
+ *		out	- Receives the records since trace_start as trace-event JSON
+ */
+void
+trace_write(std::string& out)
+{
+	struct trace_ring* ring;
+	struct trace_record rec;
+	uint64_t start;
+	uint32_t head;
+	uint32_t first;
+	uint32_t n;
+	uint64_t since;
+	char buf[128];
+	int count;
+	int i;
+	bool comma = false;
+
+	std::lock_guard<std::mutex> lock(traceRingMutex);
+	start = traceStartUsec.load(std::memory_order_relaxed);
+	count = traceRingCount.load(std::memory_order_acquire);
+	out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	for (i = 0; i < count; i++)
+	{
+		ring = traceRings[i];
+		if (comma)
+		{
+			out += ",\n";
+		}
+		snprintf(buf, sizeof(buf), "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":", i + 1);
+		out += buf;
+		trace_json_string(out, ring->thread);
+		out += "}}";
+		comma = true;
+
+		since = std::max(start, ring->since.load(std::memory_order_relaxed));
+		head = ring->head.load(std::memory_order_acquire);
+		first = 0;
+		if (head > TRACE_RING_SIZE)
+		{
+			first = head - TRACE_RING_SIZE + TRACE_DUMP_MARGIN;
+		}
+		for (n = first; n != head; n++)
+		{
+			rec = ring->rec[n & (TRACE_RING_SIZE - 1)];
+			if (rec.ts < since || rec.name == NULL)
+			{
+				continue;
+			}
+			out += ",\n{\"name\":";
+			trace_json_string(out, rec.name);
+			if (rec.ph == 'X')
+			{
+				snprintf(buf, sizeof(buf), ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%llu,\"dur\":%llu",
+					i + 1, (unsigned long long)(rec.ts - start), (unsigned long long)rec.dur);
+			}
+			else
+			{
+				snprintf(buf, sizeof(buf), ",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"ts\":%llu",
+					i + 1, (unsigned long long)(rec.ts - start));
+			}
+			out += buf;
+			if (rec.arg[0])
+			{
+				rec.arg[TRACE_ARG_SIZE - 1] = 0;
+				out += ",\"args\":{\"arg\":";
+				trace_json_string(out, rec.arg);
+				out += "}";
+			}
+			out += "}";
+		}
+	}
+	out += "\n]}\n";
+}
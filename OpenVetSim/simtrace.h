@@ -0,0 +1,69 @@
+#pragma once
+
+/*
+ * simtrace.h
+ *
+ * Timeline trace of engine activity, exported as Chrome trace-event JSON.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#define TRACE_RING_SIZE		4096	// Records per thread; a power of 2
+#define TRACE_MAX_THREADS	32
+#define TRACE_ARG_SIZE		16
+
+/*
+ * Each thread writes to its own ring, so recording takes no lock. The ring is
+ * allocated the first time the thread records while tracing is on, and given
+ * up for another thread to reuse when the thread exits. When the ring wraps
+ * the oldest records are overwritten.
+ *
+ * The dump (trace_write, /trace on the status port) loads the file in
+ * chrome://tracing or ui.perfetto.dev. Names must be string literals; only
+ * the pointer is stored.
+ */
+extern std::atomic<bool> traceEnabled;
+
+void trace_instant_arg(const char* name, const char* arg);
+void trace_span_arg(const char* name, uint64_t start_usec, const char* arg);
+void trace_start(unsigned int seconds);
+void trace_stop(void);
+void trace_check(void);
+void trace_write(std::string& out);
+
+inline void
+trace_instant(const char* name)
+{
+	if (traceEnabled.load(std::memory_order_relaxed))
+	{
+		trace_instant_arg(name, NULL);
+	}
+}
+
+// Record a span from start_usec (metric_usec()) to now
+inline void
+trace_span(const char* name, uint64_t start_usec)
+{
+	if (traceEnabled.load(std::memory_order_relaxed))
+	{
+		trace_span_arg(name, start_usec, NULL);
+	}
+}
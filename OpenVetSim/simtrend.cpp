@@ -0,0 +1,297 @@
+/*
+ * simtrend.cpp
+ *
+ * Millisecond trend engine for the controlled vital signs.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * The trends are kept as a structure of arrays and all of them are evaluated
+ * in one pass by trend_process(). An idle trend has equal from and to values
+ * and a zero rate, so it evaluates to its own value without a branch. Each
+ * curve is blended in by a 0/1 weight rather than selected, which keeps the
+ * evaluation loop free of branches.
+ *
+ * All trends run on the SimMgr thread: trend_set() from scan_commands and
+ * trend_process() from the trend task. There is no locking.
+ */
+
+#include "vetsim.h"
+#include "simtrend.h"
+#include <cmath>
+
+#define TREND_PI		3.14159265358979323846
+
+static double trendFrom[TREND_COUNT];
+static double trendTo[TREND_COUNT];
+static double trendStart[TREND_COUNT];		// msec
+static double trendRate[TREND_COUNT];		// Fraction of the transfer time per msec; 0 when idle
+static double trendLinear[TREND_COUNT];		// Curve weights, one of the three is 1
+static double trendEase[TREND_COUNT];
+static double trendExp[TREND_COUNT];
+static int trendCurve[TREND_COUNT];
+static int trendValue[TREND_COUNT];			// Last reported (rounded) value
+static uint64_t trendNext[TREND_COUNT];		// msec when the reported value next changes
+static unsigned int trendActive = 0;
+
+static const double trendExpScale = 1.0 / (1.0 - exp(-TREND_EXP_RATE));
+
+/*
+ * Inverse of the curve: the fraction of the transfer time at which the curve
+ * reaches fraction f of the change.
+ */
+static double
+trend_inverse(int curve, double f)
+{
+	switch (curve)
+	{
+	case TREND_EASE:
+		return (acos(1.0 - 2.0 * f) / TREND_PI);
+	case TREND_EXPONENTIAL:
+		return (-log(1.0 - f / trendExpScale) / TREND_EXP_RATE);
+	case TREND_LINEAR:
+	default:
+		return (f);
+	}
+}
+
+/*
+ * Find when the rounded value of a running trend next changes: the time the
+ * curve crosses the next half step toward the end value.
+ */
+static uint64_t
+trend_next_change(int id, uint64_t now)
+{
+	double boundary;
+	double f;
+	uint64_t when;
+
+	if (trendTo[id] > trendFrom[id])
+	{
+		boundary = trendValue[id] + 0.5;
+		if (boundary >= trendTo[id])
+		{
+			boundary = trendTo[id];
+		}
+	}
+	else
+	{
+		boundary = trendValue[id] - 0.5;
+		if (boundary <= trendTo[id])
+		{
+			boundary = trendTo[id];
+		}
+	}
+	f = (boundary - trendFrom[id]) / (trendTo[id] - trendFrom[id]);
+	if (f >= 1.0)
+	{
+		when = (uint64_t)ceil(trendStart[id] + 1.0 / trendRate[id]);
+	}
+	else
+	{
+		when = (uint64_t)ceil(trendStart[id] + trend_inverse(trendCurve[id], f) / trendRate[id]);
+	}
+	if (when <= now)
+	{
+		when = now + 1;
+	}
+	return (when);
+}
+
+static void
+trend_idle(int id, int value)
+{
+	trendFrom[id] = value;
+	trendTo[id] = value;
+	trendStart[id] = 0;
+	trendRate[id] = 0;
+	trendValue[id] = value;
+	trendNext[id] = 0;
+	trendActive &= ~TREND_MASK(id);
+}
+
+/*
+ * FUNCTION: trend_set
+ *
+ * ARGUMENTS:
+ *		id		- TrendId
+ *		end		- Value at the end of the trend
+ *		current	- Value now
+ *		seconds	- Transfer time. 0 or less moves to the end value at once.
+ *		curve	- TrendCurve
+ *
+ * RETURNS:
+ *		The value to report now
+ */
+int
+trend_set(int id, int end, int current, int seconds, int curve)
+{
+	uint64_t now;
+
+	if (id < 0 || id >= TREND_COUNT)
+	{
+		return (end);
+	}
+	if (seconds <= 0 || end == current)
+	{
+		trend_idle(id, end);
+		return (end);
+	}
+	now = clock_msec();
+	trendFrom[id] = current;
+	trendTo[id] = end;
+	trendStart[id] = (double)now;
+	trendRate[id] = 1.0 / ((double)seconds * 1000.0);
+	trendCurve[id] = curve;
+	trendLinear[id] = (curve != TREND_EASE && curve != TREND_EXPONENTIAL) ? 1.0 : 0.0;
+	trendEase[id] = (curve == TREND_EASE) ? 1.0 : 0.0;
+	trendExp[id] = (curve == TREND_EXPONENTIAL) ? 1.0 : 0.0;
+	trendValue[id] = current;
+	trendActive |= TREND_MASK(id);
+	trendNext[id] = trend_next_change(id, now);
+	return (current);
+}
+
+int
+trend_clear(int id, int current)
+{
+	if (id >= 0 && id < TREND_COUNT)
+	{
+		trend_idle(id, current);
+	}
+	return (current);
+}
+
+/*
+ * FUNCTION: trend_process
+ *
+ * ARGUMENTS:
+ *		now_msec	- clock_msec() time to evaluate at
+ *		values		- Receives the value of every trend, TREND_COUNT entries
+ *
+ * RETURNS:
+ *		TREND_MASK() bits of the values that changed since the last call
+ */
+unsigned int
+trend_process(uint64_t now_msec, int* values)
+{
+	double now = (double)now_msec;
+	double pos[TREND_COUNT];
+	double value[TREND_COUNT];
+	unsigned int changed = 0;
+	int i;
+
+	if (trendActive == 0)
+	{
+		for (i = 0; i < TREND_COUNT; i++)
+		{
+			values[i] = trendValue[i];
+		}
+		return (0);
+	}
+
+	// One pass over all trends; idle ones evaluate to their own value
+	for (i = 0; i < TREND_COUNT; i++)
+	{
+		pos[i] = fmin(fmax((now - trendStart[i]) * trendRate[i], 0.0), 1.0);
+	}
+	for (i = 0; i < TREND_COUNT; i++)
+	{
+		value[i] = trendFrom[i] + (trendTo[i] - trendFrom[i]) *
+			(trendLinear[i] * pos[i] +
+			 trendEase[i] * (0.5 - 0.5 * cos(TREND_PI * pos[i])) +
+			 trendExp[i] * (1.0 - exp(-TREND_EXP_RATE * pos[i])) * trendExpScale);
+	}
+
+	for (i = 0; i < TREND_COUNT; i++)
+	{
+		if ((trendActive & TREND_MASK(i)) == 0)
+		{
+			values[i] = trendValue[i];
+			continue;
+		}
+		if (pos[i] >= 1.0)
+		{
+			values[i] = (int)trendTo[i];
+			if (values[i] != trendValue[i])
+			{
+				changed |= TREND_MASK(i);
+			}
+			trend_idle(i, values[i]);
+			continue;
+		}
+		values[i] = (int)round(value[i]);
+		if (values[i] != trendValue[i])
+		{
+			trendValue[i] = values[i];
+			changed |= TREND_MASK(i);
+		}
+		trendNext[i] = trend_next_change(i, now_msec);
+	}
+	return (changed);
+}
+
+/*
+ * FUNCTION: trend_next_deadline
+ *
+ * RETURNS:
+ *		clock_msec() time when a reported value next changes, or 0 when no
+ *		trend is running
+ */
+uint64_t
+trend_next_deadline(void)
+{
+	uint64_t next = 0;
+	int i;
+
+	for (i = 0; i < TREND_COUNT; i++)
+	{
+		if ((trendActive & TREND_MASK(i)) && (next == 0 || trendNext[i] < next))
+		{
+			next = trendNext[i];
+		}
+	}
+	return (next);
+}
+
+/*
+ * FUNCTION: trend_curve_parse
+ *
+ * ARGUMENTS:
+ *		name	- "linear", "ease" or "exponential"
+ *
+ * RETURNS:
+ *		TrendCurve, or -1 if the name is not known
+ */
+int
+trend_curve_parse(const char* name)
+{
+	if (strcmp(name, "linear") == 0)
+	{
+		return (TREND_LINEAR);
+	}
+	if (strcmp(name, "ease") == 0)
+	{
+		return (TREND_EASE);
+	}
+	if (strcmp(name, "exponential") == 0)
+	{
+		return (TREND_EXPONENTIAL);
+	}
+	return (-1);
+}
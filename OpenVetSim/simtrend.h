@@ -0,0 +1,60 @@
+#pragma once
+
+/*
+ * simtrend.h
+ *
+ * Millisecond trend engine for the controlled vital signs.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+
+#define TREND_EXP_RATE		5.0		// Time constants per transfer time for TREND_EXPONENTIAL
+
+enum TrendId
+{
+	TREND_CARDIAC_RATE = 0,
+	TREND_BPS_SYS,
+	TREND_BPS_DIA,
+	TREND_RESPIRATION_RATE,
+	TREND_SPO2,
+	TREND_ETCO2,
+	TREND_TEMPERATURE,
+	TREND_COUNT
+};
+
+#define TREND_MASK(id)	(1u << (id))
+
+/*
+ * Shape of a trend from its start value to its end value over the transfer time.
+ * TREND_EASE starts and ends slowly (half cosine). TREND_EXPONENTIAL moves fastest
+ * at the start and settles on the end value, like a physiological decay; it is
+ * scaled so it still arrives at the end of the transfer time.
+ */
+enum TrendCurve
+{
+	TREND_LINEAR = 0,
+	TREND_EASE,
+	TREND_EXPONENTIAL
+};
+
+int trend_set(int id, int end, int current, int seconds, int curve);
+int trend_clear(int id, int current);
+unsigned int trend_process(uint64_t now_msec, int* values);
+uint64_t trend_next_deadline(void);
+int trend_curve_parse(const char* name);
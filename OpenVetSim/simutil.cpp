@@ -48,7 +48,6 @@ initSHM(void)
 	simmgr_shm = &shmSpace;
 
 	// Initialise the mutex handles that live inside the struct
-	simmgr_shm->instructor.sema = sim_create_mutex();
 	simmgr_shm->logfile.sema    = sim_create_mutex();
 
 	return (0);
@@ -74,41 +73,70 @@ getTimeStr(char* timeStr)
 	return timeStr;
 }
 
-/*
- * Function: log_message_init
- *
- * Create the mutex for the common log file and write a startup message.
- *
- * Parameters: none
- * Returns:    none
- */
-
 #include <filesystem>
+#include <algorithm>
+#include <condition_variable>
+#include <map>
 namespace fs = std::filesystem;
 
 char log_dir[512]          = { 0, };
 char default_log_file[512] = { 0, };
 
-// Cross-platform mutex protecting log-file writes
-static SIM_MUTEX log_sema = nullptr;
+/*
+ * Each thread that logs gets a ring, so log_message takes no lock and does no
+ * I/O: the caller copies the message into its ring and returns. The logWriter
+ * task drains the rings, merges them by sequence number so the file keeps the
+ * order the messages were logged in, and writes them to files it keeps open.
+ *
+ * A ring is handed on to a new thread once its owner exits, since start_scenario
+ * and scenario_main are started again for each scenario. When a ring is full the
+ * message is dropped and counted, and the writer logs the count.
+ */
+struct log_record
+{
+	uint64_t seq;
+	time_t time;
+	char file[LOG_FILE_SIZE];		// Empty for the common log
+	char text[LOG_LINE_SIZE];
+};
 
-void
-log_message_init(void)
+struct log_ring
 {
-	sprintf_s(log_dir, 512, "%s/simlogs", localConfig.html_path);
-	printf("log_dir is %s\n", log_dir);
-	sprintf_s(default_log_file, 512, "%s/simlogs/vetsim.log", localConfig.html_path);
+	std::atomic<uint32_t> head;		// Records written; only the owning thread stores
+	std::atomic<uint32_t> tail;		// Records written out; only the drain stores
+	std::atomic<uint32_t> dropped;
+	std::atomic<uint64_t> claim;	// Lowest seq the owner may be filling a record for, or UINT64_MAX
+	std::atomic<bool> used;			// Has a live owning thread
+	struct log_record rec[LOG_RING_SIZE];
+};
+
+// Gives the thread's ring up when the thread exits
+struct log_owner
+{
+	struct log_ring* ring = NULL;
+	bool none = false;				// No ring was free; write directly
 
-	// Create log directory if it doesn't exist
-	if (!sim_dir_exists(log_dir))
+	~log_owner()
 	{
-		sim_mkdir(log_dir);
+		if (ring)
+		{
+			ring->used.store(false, std::memory_order_release);
+		}
 	}
-
-	log_sema = sim_create_mutex();
-
-	log_message("", "Log Started");
-}
+};
+
+static struct log_ring* logRings[LOG_MAX_THREADS];
+static std::atomic<int> logRingCount(0);
+static std::mutex logRingMutex;				// Ring allocation only
+static thread_local struct log_owner logOwner;
+static std::atomic<uint64_t> logSeq(0);
+static std::atomic<bool> logReady(false);	// log_message_init has run
+static std::atomic<bool> logWriting(false);	// The logWriter task is running
+static std::atomic<bool> logWake(false);
+static std::mutex logWakeMutex;
+static std::condition_variable logWakeCond;
+static std::mutex logDrainMutex;			// One drain at a time: logWriter or log_flush
+static std::map<std::string, FILE*> logFiles;	// Held with logDrainMutex
 
 // Windows-only: append text to the edit control in the GUI window
 #ifdef _WIN32
@@ -138,57 +166,93 @@ void append_text_to_edit(const wchar_t* newText)
 #endif // NDEBUG
 #endif // _WIN32
 
-/*
- * Function: log_message
- *
- * Log a message to the common log file or to a named file.
- * Thread-safe via the cross-platform log_sema mutex.
- *
- * Parameters:
- *   filename - filename to open for appending; empty string uses the default log
- *   message  - NULL-terminated message string
- */
-void
-log_message(const char* filename, const char* message)
+static struct log_ring*
+log_ring_get(void)
 {
-	FILE*   logfile = nullptr;
-	errno_t err;
-	char    timeBuf[32];
+	struct log_ring* ring;
+	int count;
+	int i;
 
-	if (log_sema == nullptr)
+	if (logOwner.ring || logOwner.none)
 	{
-		// Mutex not yet created — just write to stdout during early init
-		printf("%s\n", message);
-		return;
+		return (logOwner.ring);
+	}
+	std::lock_guard<std::mutex> lock(logRingMutex);
+	count = logRingCount.load(std::memory_order_relaxed);
+	for (i = 0; i < count; i++)
+	{
+		if (!logRings[i]->used.load(std::memory_order_acquire))
+		{
+			logRings[i]->used.store(true, std::memory_order_relaxed);
+			logOwner.ring = logRings[i];
+			return (logOwner.ring);
+		}
+	}
+	if (count >= LOG_MAX_THREADS)
+	{
+		logOwner.none = true;
+		return (NULL);
 	}
+	ring = new struct log_ring;
+	ring->head.store(0, std::memory_order_relaxed);
+	ring->tail.store(0, std::memory_order_relaxed);
+	ring->dropped.store(0, std::memory_order_relaxed);
+	ring->claim.store(UINT64_MAX, std::memory_order_relaxed);
+	ring->used.store(true, std::memory_order_relaxed);
+	logRings[count] = ring;
+	logRingCount.store(count + 1, std::memory_order_release);
+	logOwner.ring = ring;
+	return (ring);
+}
 
-	sim_lock_mutex(log_sema);
+static void
+log_wake(void)
+{
+	if (!logWake.exchange(true, std::memory_order_acq_rel))
+	{
+		logWakeCond.notify_one();
+	}
+}
 
-	if (strlen(filename) > 0)
-		err = fopen_s(&logfile, filename, "a");
-	else
-		err = fopen_s(&logfile, default_log_file, "a");
+// Write one message and echo it to the console. Call with logDrainMutex held.
+static void
+log_write(const struct log_record* rec)
+{
+	std::string name;
+	FILE* logfile;
+	errno_t err;
+	char timeBuf[32];
+	struct tm tm_info;
 
-	if (err != 0)
+	name = rec->file[0] ? rec->file : default_log_file;
+	auto it = logFiles.find(name);
+	if (it == logFiles.end())
 	{
-		char errstr[256];
-		strerror_s(errstr, sizeof(errstr), err);
-		fprintf(stderr, "log_message: fopen_s(%s) failed: %s\n", default_log_file, errstr);
+		logfile = nullptr;
+		err = fopen_s(&logfile, name.c_str(), "a");
+		if (err != 0)
+		{
+			char errstr[256];
+			strerror_s(errstr, sizeof(errstr), err);
+			fprintf(stderr, "log_message: fopen_s(%s) failed: %s\n", name.c_str(), errstr);
+		}
+		it = logFiles.emplace(name, logfile).first;
 	}
-	else if (logfile)
+	if (it->second)
 	{
-		(void)getTimeStr(timeBuf);
-		fprintf(logfile, "%s: %s\n", timeBuf, message);
-		fclose(logfile);
+		localtime_s(&tm_info, &rec->time);
+		strftime(timeBuf, sizeof(timeBuf), "%Y-%m-%d %H:%M:%S", &tm_info);
+		fprintf(it->second, "%s: %s\n", timeBuf, rec->text);
 	}
 
 	// Also print to stdout for console visibility
-	printf("%s\n", message);
+	printf("%s\n", rec->text);
 
 #ifdef _WIN32
 #ifdef NDEBUG
 	// On Windows GUI build: push message to the edit control
 	{
+		const char* message = rec->text;
 		size_t  origSize = strlen(message) + 1;
 		wchar_t wcstring[512 + 4];
 		size_t  convertedChars = 0;
@@ -217,8 +281,227 @@ log_message(const char* filename, const char* message)
 	}
 #endif // NDEBUG
 #endif // _WIN32
+}
 
-	sim_unlock_mutex(log_sema);
+static void
+log_fill(struct log_record* rec, const char* filename, const char* message)
+{
+	rec->seq = logSeq.fetch_add(1);
+	rec->time = time(NULL);
+	snprintf(rec->file, LOG_FILE_SIZE, "%s", filename);
+	if (snprintf(rec->text, LOG_LINE_SIZE, "%s", message) >= LOG_LINE_SIZE)
+	{
+		memcpy(&rec->text[LOG_LINE_SIZE - sizeof(LOG_TRUNCATED)], LOG_TRUNCATED, sizeof(LOG_TRUNCATED));
+	}
+}
+
+/*
+ * Function: log_drain
+ *
+ * Write out what the rings hold, oldest first, and flush the files.
+ *
+ * The seqs are handed out before the records are published, so a record may
+ * still be in the making when a later one is in a ring. The drain takes a cut:
+ * the next seq, lowered to the lowest seq any ring's owner may still be filling.
+ * Every record below the cut is in its ring, and only those are written; the
+ * rest wait for the next drain. Across drains the log stays in seq order.
+ */
+static void
+log_drain(void)
+{
+	std::lock_guard<std::mutex> lock(logDrainMutex);
+	std::vector<std::pair<uint64_t, struct log_record*>> batch;
+	uint32_t tails[LOG_MAX_THREADS];
+	struct log_record note;
+	struct log_ring* ring;
+	uint32_t head;
+	uint32_t tail;
+	uint32_t dropped = 0;
+	uint64_t start;
+	uint64_t cut;
+	int count;
+	int i;
+
+	start = metric_usec();
+	count = logRingCount.load(std::memory_order_acquire);
+	cut = logSeq.load();
+	for (i = 0; i < count; i++)
+	{
+		cut = std::min(cut, logRings[i]->claim.load());
+	}
+	for (i = 0; i < count; i++)
+	{
+		ring = logRings[i];
+		head = ring->head.load(std::memory_order_acquire);
+		for (tail = ring->tail.load(std::memory_order_relaxed); tail != head; tail++)
+		{
+			if (ring->rec[tail & (LOG_RING_SIZE - 1)].seq >= cut)
+			{
+				break;
+			}
+			batch.push_back(std::make_pair(ring->rec[tail & (LOG_RING_SIZE - 1)].seq,
+				&ring->rec[tail & (LOG_RING_SIZE - 1)]));
+		}
+		tails[i] = tail;
+		dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+	}
+	if (batch.empty() && dropped == 0)
+	{
+		return;
+	}
+	std::sort(batch.begin(), batch.end(),
+		[](const std::pair<uint64_t, struct log_record*>& a, const std::pair<uint64_t, struct log_record*>& b)
+		{ return (a.first < b.first); });
+	for (auto& entry : batch)
+	{
+		log_write(entry.second);
+	}
+	if (dropped)
+	{
+		log_fill(&note, "", "");
+		snprintf(note.text, LOG_LINE_SIZE, "log_message: %u messages dropped, log rings full", dropped);
+		log_write(&note);
+	}
+
+	// The records are written; give the slots back
+	for (i = 0; i < count; i++)
+	{
+		logRings[i]->tail.store(tails[i], std::memory_order_release);
+	}
+	for (auto& file : logFiles)
+	{
+		if (file.second)
+		{
+			fflush(file.second);
+		}
+	}
+	metric_time(METRIC_TIME_LOG, metric_usec() - start);
+}
+
+/*
+ * Function: log_writer
+ *
+ * The logWriter task. Drains the rings every LOG_FLUSH_MSEC, or when woken.
+ */
+static void
+log_writer(void)
+{
+	while (task_running())
+	{
+		{
+			std::unique_lock<std::mutex> lock(logWakeMutex);
+			logWakeCond.wait_for(lock, std::chrono::milliseconds(LOG_FLUSH_MSEC),
+				[]() { return (logWake.load(std::memory_order_acquire) || !task_running()); });
+		}
+		logWake.store(false, std::memory_order_release);
+		log_drain();
+	}
+	logWriting.store(false, std::memory_order_release);
+	log_drain();
+}
+
+/*
+ * Function: log_message_init
+ *
+ * Create the log directory, start the log writer and write a startup message.
+ *
+ * Parameters: none
+ * Returns:    none
+ */
+void
+log_message_init(void)
+{
+	sprintf_s(log_dir, 512, "%s/simlogs", localConfig.html_path);
+	printf("log_dir is %s\n", log_dir);
+	sprintf_s(default_log_file, 512, "%s/simlogs/vetsim.log", localConfig.html_path);
+
+	// Create log directory if it doesn't exist
+	if (!sim_dir_exists(log_dir))
+	{
+		sim_mkdir(log_dir);
+	}
+
+	logReady.store(true, std::memory_order_release);
+	if (!headless)
+	{
+		logWriting.store(true, std::memory_order_release);
+		(void)start_task("logWriter", log_writer);
+	}
+
+	log_message("", "Log Started");
+}
+
+/*
+ * Function: log_message
+ *
+ * Log a message to the common log file or to a named file. The message is
+ * queued for the logWriter task; without the task (headless, or once the tasks
+ * have stopped) it is written before this returns.
+ *
+ * Parameters:
+ *   filename - filename to open for appending; empty string uses the default log
+ *   message  - NULL-terminated message string. Longer than LOG_LINE_SIZE is cut,
+ *              ending in LOG_TRUNCATED.
+ */
+void
+log_message(const char* filename, const char* message)
+{
+	struct log_ring* ring;
+	struct log_record direct;
+	uint32_t head;
+
+	if (!logReady.load(std::memory_order_acquire))
+	{
+		// Not initialised yet — just write to stdout during early init
+		printf("%s\n", message);
+		return;
+	}
+
+	ring = log_ring_get();
+	if (!ring)
+	{
+		log_fill(&direct, filename, message);
+		std::lock_guard<std::mutex> lock(logDrainMutex);
+		log_write(&direct);
+		return;
+	}
+	head = ring->head.load(std::memory_order_relaxed);
+	if (head - ring->tail.load(std::memory_order_acquire) >= LOG_RING_SIZE)
+	{
+		ring->dropped.fetch_add(1, std::memory_order_relaxed);
+		metric_inc(METRIC_LOG_DROPPED);
+		log_wake();
+		return;
+	}
+	// The record's seq is at least the claim, until it is published
+	ring->claim.store(logSeq.load());
+	log_fill(&ring->rec[head & (LOG_RING_SIZE - 1)], filename, message);
+	ring->head.store(head + 1, std::memory_order_release);
+	ring->claim.store(UINT64_MAX);
+
+	if (!logWriting.load(std::memory_order_acquire))
+	{
+		log_drain();
+	}
+	else if (filename[0] || strncmp(message, "Error", 5) == 0 || strncmp(message, "ERROR", 5) == 0 ||
+		head + 1 - ring->tail.load(std::memory_order_relaxed) >= LOG_RING_SIZE / 2)
+	{
+		log_wake();
+	}
+}
+
+/*
+ * Function: log_flush
+ *
+ * Write out the queued messages now, before an exit.
+ */
+void
+log_flush(void)
+{
+	if (logReady.load(std::memory_order_acquire))
+	{
+		log_drain();
+	}
 }
 
 /*
@@ -347,26 +630,11 @@ cleanString(char* strIn)
 	*out = '\0';
 }
 
-/*
- * takeInstructorLock / releaseInstructorLock
- *
- * Wrapper around the cross-platform SIM_MUTEX embedded in simmgr_shm.
- */
-int
-takeInstructorLock()
-{
-	sim_lock_mutex(simmgr_shm->instructor.sema);
-	return 0;
-}
-
-void
-releaseInstructorLock()
-{
-	sim_unlock_mutex(simmgr_shm->instructor.sema);
-}
-
 /*
  * addEvent / addComment / lockAndComment / forceInstructorLock
+ *
+ * Callers of addEvent and addComment hold II_EVENTS. addEvent also writes the
+ * defibrillation block for "aed", so its callers hold II_CPR as well.
  */
 void
 addEvent(char* str)
@@ -374,6 +642,7 @@ addEvent(char* str)
 	int eventNext = simmgr_shm->eventListNextWrite;
 
 	sprintf_s(simmgr_shm->eventList[eventNext].eventName, STR_SIZE, "%s", str);
+	simmgr_shm->eventList[eventNext].eventId = getEventHandle(str);
 
 	snprintf(msg_buf, 2048, "Event %d: %s", eventNext, str);
 	log_message("", msg_buf);
@@ -384,7 +653,12 @@ addEvent(char* str)
 	simmgr_shm->eventListNextWrite = eventNext;
 
 	if (strcmp(str, "aed") == 0)
+	{
 		simmgr_shm->instructor.defibrillation.shock = 1;
+		instructorMark(II_CPR, DEFIB_F_SHOCK);
+		notify_signal(NOTIFY_INSTRUCTOR);
+	}
+	notify_signal(NOTIFY_EVENT);
 }
 
 void
@@ -401,15 +675,16 @@ addComment(char* str)
 	if (commentNext >= COMMENT_LIST_SIZE)
 		commentNext = 0;
 	simmgr_shm->commentListNext = commentNext;
+	notify_signal(NOTIFY_EVENT);
 }
 
 void
 lockAndComment(char* str)
 {
-	if (takeInstructorLock() == 0)
+	if (takeInstructorSections(II_MASK(II_EVENTS)) == 0)
 	{
 		addComment(str);
-		releaseInstructorLock();
+		releaseInstructorSections(II_MASK(II_EVENTS));
 	}
 }
 
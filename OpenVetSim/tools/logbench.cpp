@@ -0,0 +1,254 @@
+/*
+ * logbench.cpp
+ *
+ * Measure the time log_message takes its caller, against writing each message
+ * straight to the file as log_message did before the per-thread rings.
+ *
+ *	logbench [-t threads] [-n messages] [-g gap usec] [directory]
+ *
+ * Each of the threads logs the messages, sleeping the gap between them; a gap of
+ * 0 floods the rings. The log goes to <directory>/simlogs, by default a new
+ * directory under the system temporary directory. The written log is then read
+ * back to check that each thread's messages are all there and in order.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vetsim.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <io.h>
+#define dup		_dup
+#define dup2	_dup2
+#define fileno	_fileno
+#define NULL_DEVICE	"NUL"
+#else
+#include <unistd.h>
+#define NULL_DEVICE	"/dev/null"
+#endif
+
+char WVSversion[STR_SIZE];		// From main.cpp, which is not linked
+extern struct simmgr_shm shmSpace;
+extern char default_log_file[];
+
+static std::mutex directLock;
+static std::string directFile;
+
+// log_message echoes each message to stdout; keep that off the console
+static void
+mute_stdout(bool mute)
+{
+	static int stdoutFd = -1;
+
+	fflush(stdout);
+	if (mute)
+	{
+		stdoutFd = dup(fileno(stdout));
+		if (freopen(NULL_DEVICE, "w", stdout) == NULL)
+		{
+			stdoutFd = -1;
+		}
+	}
+	else if (stdoutFd >= 0)
+	{
+		dup2(stdoutFd, fileno(stdout));
+	}
+}
+
+// Open, write and close under one lock, as log_message did
+static void
+direct_log(const char* message)
+{
+	std::lock_guard<std::mutex> lock(directLock);
+	char timeBuf[32];
+	struct tm tm_info;
+	time_t now;
+	FILE* fp;
+
+	if (fopen_s(&fp, directFile.c_str(), "a") == 0 && fp)
+	{
+		now = time(NULL);
+		localtime_s(&tm_info, &now);
+		strftime(timeBuf, sizeof(timeBuf), "%Y-%m-%d %H:%M:%S", &tm_info);
+		fprintf(fp, "%s: %s\n", timeBuf, message);
+		fclose(fp);
+	}
+	printf("%s\n", message);
+}
+
+// The percentiles go into result, since stdout is muted until the log is flushed
+static void
+run(const char* label, bool rings, int threads, int count, int gap, std::string& result)
+{
+	char line[256];
+	std::vector<std::vector<double>> usec(threads);
+	std::vector<std::thread> workers;
+	std::vector<double> all;
+	int t;
+
+	for (t = 0; t < threads; t++)
+	{
+		workers.emplace_back([&usec, rings, count, gap, t]() {
+			char message[128];
+			uint64_t start;
+			int i;
+
+			usec[t].reserve(count);
+			for (i = 0; i < count; i++)
+			{
+				snprintf(message, sizeof(message), "logbench thread %d message %d, text the length of a log line", t, i);
+				start = metric_usec();
+				if (rings)
+				{
+					log_message("", message);
+				}
+				else
+				{
+					direct_log(message);
+				}
+				usec[t].push_back((double)(metric_usec() - start));
+				if (gap)
+				{
+					std::this_thread::sleep_for(std::chrono::microseconds(gap));
+				}
+			}
+			});
+	}
+	for (auto& w : workers)
+	{
+		w.join();
+	}
+
+	for (auto& v : usec)
+	{
+		all.insert(all.end(), v.begin(), v.end());
+	}
+	std::sort(all.begin(), all.end());
+	snprintf(line, sizeof(line), "  %-12s p50 %8.1f usec  p99 %8.1f usec  p99.9 %8.1f usec  max %8.1f usec\n", label,
+		all[all.size() / 2], all[all.size() * 99 / 100], all[all.size() * 999 / 1000], all.back());
+	result += line;
+}
+
+// Each thread's messages, in order and none missing, less any the rings dropped
+static int
+check_order(const char* path, int threads, int count, uint64_t dropped)
+{
+	std::ifstream in(path);
+	std::vector<int> next(threads, 0);
+	std::string line;
+	size_t pos;
+	long lines = 0;
+	long gaps = 0;
+	long back = 0;
+	int t;
+	int i;
+
+	while (std::getline(in, line))
+	{
+		pos = line.find("logbench thread ");
+		if (pos == std::string::npos || sscanf(line.c_str() + pos, "logbench thread %d message %d", &t, &i) != 2 ||
+			t < 0 || t >= threads)
+		{
+			continue;
+		}
+		lines++;
+		if (i < next[t])
+		{
+			back++;
+		}
+		else if (i > next[t])
+		{
+			gaps += i - next[t];
+		}
+		next[t] = i + 1;
+	}
+	printf("  %ld of %ld messages written, %ld out of order, %ld missing, %ju dropped\n",
+		lines, (long)threads * count, back, gaps, (uintmax_t)dropped);
+	return ((back == 0 && (uint64_t)gaps <= dropped) ? 0 : 1);
+}
+
+int
+main(int argc, char** argv)
+{
+	std::filesystem::path dir;
+	std::error_code ec;
+	std::string metrics;
+	std::string result;
+	uint64_t dropped = 0;
+	size_t pos;
+	int threads = 4;
+	int count = 5000;
+	int gap = 100;
+	int i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+		{
+			threads = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+		{
+			count = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc)
+		{
+			gap = atoi(argv[++i]);
+		}
+		else
+		{
+			dir = argv[i];
+		}
+	}
+	threads = std::max(1, threads);
+	count = std::max(1, count);
+	gap = std::max(0, gap);
+	if (dir.empty())
+	{
+		dir = std::filesystem::temp_directory_path(ec) / ("logbench-" + std::to_string(clock_real_nsec()));
+	}
+	std::filesystem::create_directories(dir, ec);
+
+	simmgr_shm = &shmSpace;
+	snprintf(localConfig.html_path, sizeof(localConfig.html_path), "%s", dir.string().c_str());
+	log_message_init();
+	directFile = (dir / "simlogs" / "direct.log").string();
+
+	printf("logbench: %d threads, %d messages each, %d usec apart, in %s\n", threads, count, gap, dir.string().c_str());
+	fflush(stdout);
+	mute_stdout(true);
+	run("direct", false, threads, count, gap, result);
+	run("log_message", true, threads, count, gap, result);
+	log_flush();
+	mute_stdout(false);
+	printf("%s", result.c_str());
+
+	metrics_write(metrics);
+	pos = metrics.find("\nvetsim_log_dropped_total ");
+	if (pos != std::string::npos)
+	{
+		dropped = (uint64_t)strtod(metrics.c_str() + pos + strlen("\nvetsim_log_dropped_total "), NULL);
+	}
+	i = check_order(default_log_file, threads, count, dropped);
+	fflush(stdout);
+	_exit(i);		// The logWriter task is still running
+}
@@ -0,0 +1,230 @@
+/*
+ * scenebench.cpp
+ *
+ * Measure how long a scene change takes, from the instructor's event to
+ * processInit returning with the new scene's parameters applied.
+ *
+ *	scenebench [-n changes] [-s scenario] [directory]
+ *
+ * The engine runs threaded, as WinVetSim does. The scenario, Example_Scenario by
+ * default or another with the same scenes and events, is started from
+ * <directory>/scenarios (default .) and moved between scenes 1 and 2 with its
+ * "advance" and "back" events. Each move back to scene 1, which sets parameters,
+ * is timed until vetsim_scene_init_seconds has counted it; the handoff is the
+ * part of that processInit spends waiting for scan_commands. Before the handoff
+ * was acknowledged, processInit slept a fixed 500 ms instead. The bench writes
+ * a scenario log to <directory>/simlogs, as a run does.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vetsim.h"
+#include <algorithm>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <io.h>
+#define dup		_dup
+#define dup2	_dup2
+#define fileno	_fileno
+#define NULL_DEVICE	"NUL"
+#else
+#include <unistd.h>
+#define NULL_DEVICE	"/dev/null"
+#endif
+
+#define SCENEBENCH_TIMEOUT_MSEC	5000
+
+char WVSversion[STR_SIZE];		// From main.cpp, which is not linked
+extern struct simmgr_shm shmSpace;
+extern std::string htmlReply;
+int simstatusHandleCommand(char* args);
+
+// The engine logs each scene change to stdout; keep that off the console
+static void
+mute_stdout(bool mute)
+{
+	static int stdoutFd = -1;
+
+	fflush(stdout);
+	if (mute)
+	{
+		stdoutFd = dup(fileno(stdout));
+		if (freopen(NULL_DEVICE, "w", stdout) == NULL)
+		{
+			stdoutFd = -1;
+		}
+	}
+	else if (stdoutFd >= 0)
+	{
+		dup2(stdoutFd, fileno(stdout));
+	}
+}
+
+static void
+command(const char* cmd)
+{
+	char args[STR_SIZE * 2];
+
+	snprintf(args, sizeof(args), "%s", cmd);
+	(void)simstatusHandleCommand(args);
+	htmlReply.clear();
+}
+
+// A sample from the metrics, or 0 if it is not there
+static double
+metric_value(const char* name)
+{
+	std::string out;
+	std::string key;
+	size_t pos;
+
+	metrics_write(out);
+	key = std::string("\n") + name + " ";
+	pos = out.find(key);
+	return (pos == std::string::npos ? 0 : strtod(out.c_str() + pos + key.size(), NULL));
+}
+
+// Send the event and wait for the scene, and for processInit if the scene sets
+// parameters. Returns msec, or -1.
+static double
+change_scene(const char* event, int sceneId, bool init)
+{
+	char cmd[STR_SIZE];
+	double inits;
+	uint64_t start;
+
+	inits = metric_value("vetsim_scene_init_seconds_count");
+	snprintf(cmd, sizeof(cmd), "set:event:event_id=%s", event);
+	start = metric_usec();
+	command(cmd);
+	while (simmgr_shm->status.scenario.scene_id != sceneId ||
+		(init && metric_value("vetsim_scene_init_seconds_count") <= inits))
+	{
+		if (metric_usec() - start > SCENEBENCH_TIMEOUT_MSEC * 1000)
+		{
+			return (-1);
+		}
+		sim_sleep_ms(1);
+	}
+	return ((double)(metric_usec() - start) / 1000);
+}
+
+int
+main(int argc, char** argv)
+{
+	std::filesystem::path dir(".");
+	std::vector<double> msec;
+	const char* scenario = "Example_Scenario";
+	char cmd[STR_SIZE * 2];
+	double sum;
+	double count;
+	double mean = 0;
+	int changes = 10;
+	int i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+		{
+			changes = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+		{
+			scenario = argv[++i];
+		}
+		else
+		{
+			dir = argv[i];
+		}
+	}
+	changes = std::max(1, changes);
+	if (!std::filesystem::exists(dir / "scenarios" / scenario / "main.xml"))
+	{
+		fprintf(stderr, "scenebench: no scenarios/%s/main.xml in %s\n", scenario, dir.string().c_str());
+		return (1);
+	}
+
+	simmgr_shm = &shmSpace;
+	snprintf(localConfig.html_path, sizeof(localConfig.html_path), "%s", std::filesystem::absolute(dir).lexically_normal().string().c_str());
+	localConfig.scan_period = DEFAULT_SCAN_PERIOD;
+	localConfig.event_period = DEFAULT_EVENT_PERIOD;
+	localConfig.cpr_period = DEFAULT_CPR_PERIOD;
+	localConfig.shock_period = DEFAULT_SHOCK_PERIOD;
+	localConfig.time_period = DEFAULT_TIME_PERIOD;
+	localConfig.comm_period = DEFAULT_COMM_PERIOD;
+
+	printf("scenebench: %d changes back to scene 1 in %s, %s\n", changes, scenario, localConfig.html_path);
+	mute_stdout(true);
+	simmgrInitialize();
+	(void)start_task("scenebench", []() { while (task_running()) { simmgrRun(); } });
+	snprintf(cmd, sizeof(cmd), "set:scenario:active=%s&set:scenario:state=running", scenario);
+	command(cmd);
+	for (i = 0; i < SCENEBENCH_TIMEOUT_MSEC && simmgr_shm->status.scenario.scene_id != 1; i++)
+	{
+		sim_sleep_ms(1);
+	}
+	// Let the scenario's and the first scene's parameters settle
+	for (i = 0; i < 10; i++)
+	{
+		count = metric_value("vetsim_scene_init_seconds_count");
+		sim_sleep_ms(600);
+		if (metric_value("vetsim_scene_init_seconds_count") == count)
+		{
+			break;
+		}
+	}
+
+	sum = metric_value("vetsim_scene_init_seconds_sum");
+	count = metric_value("vetsim_scene_init_seconds_count");
+	for (i = 0; i < changes; i++)
+	{
+		if (change_scene("advance", 2, false) < 0)
+		{
+			break;
+		}
+		sim_sleep_ms(50);
+		msec.push_back(change_scene("back", 1, true));
+		if (msec.back() < 0)
+		{
+			break;
+		}
+		sim_sleep_ms(50);
+	}
+	sum = metric_value("vetsim_scene_init_seconds_sum") - sum;
+	count = metric_value("vetsim_scene_init_seconds_count") - count;
+	command("set:scenario:state=terminate");
+	log_flush();
+	mute_stdout(false);
+
+	if ((int)msec.size() < changes || msec.back() < 0)
+	{
+		printf("  scene change %d did not finish\n", (int)msec.size() + 1);
+		fflush(stdout);
+		_exit(1);
+	}
+	std::sort(msec.begin(), msec.end());
+	if (count > 0)
+	{
+		mean = sum * 1000 / count;
+	}
+	printf("  event to scene ready  p50 %7.2f msec  max %7.2f msec\n", msec[msec.size() / 2], msec.back());
+	printf("  processInit handoff   mean %6.2f msec  max %7.2f msec (max since start)\n",
+		mean, metric_value("vetsim_scene_init_seconds_max") * 1000);
+	fflush(stdout);
+	_exit(0);		// The engine's tasks are still running
+}
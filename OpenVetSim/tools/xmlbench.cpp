@@ -0,0 +1,317 @@
+/*
+ * xmlbench.cpp
+ *
+ * Compare the scenario XML parsers, XMLPull and the earlier XMLRead, for time and
+ * heap allocations.
+ *
+ *	xmlbench [-n runs] [scenarios directory]
+ *
+ * The directory defaults to ./scenarios; each <name>/main.xml in it is parsed.
+ * XMLRead logs each open to stdout, so stdout is muted while it runs.
+ *
+ * This file is part of the sim-mgr distribution.
+ *
+ * Copyright (c) 2019-2025 ITown Design, Ithaca, NY
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vetsim.h"
+#include "XMLRead.h"
+#include "XMLPull.h"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <new>
+
+#ifdef _WIN32
+#include <io.h>
+#define dup		_dup
+#define dup2	_dup2
+#define fileno	_fileno
+#define NULL_DEVICE	"NUL"
+#else
+#include <unistd.h>
+#define NULL_DEVICE	"/dev/null"
+#endif
+
+/*
+ * Allocation counting. With glibc, malloc itself is wrapped, which also sees the
+ * C++ allocations and XMLRead's calloc. Elsewhere only operator new is counted.
+ */
+static std::atomic<uint64_t> allocCount(0);
+static std::atomic<uint64_t> allocBytes(0);
+
+#ifdef __GLIBC__
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t n, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+extern "C" void*
+malloc(size_t size)
+{
+	allocCount++;
+	allocBytes += size;
+	return (__libc_malloc(size));
+}
+
+extern "C" void*
+calloc(size_t n, size_t size)
+{
+	allocCount++;
+	allocBytes += n * size;
+	return (__libc_calloc(n, size));
+}
+
+extern "C" void*
+realloc(void* ptr, size_t size)
+{
+	allocCount++;
+	allocBytes += size;
+	return (__libc_realloc(ptr, size));
+}
+#define ALLOC_SCOPE	"all heap"
+#else
+void*
+operator new(size_t size)
+{
+	void* p;
+
+	allocCount++;
+	allocBytes += size;
+	p = malloc(size ? size : 1);
+	if (!p)
+	{
+		throw std::bad_alloc();
+	}
+	return (p);
+}
+
+void
+operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void
+operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+#define ALLOC_SCOPE	"operator new"
+#endif
+
+struct bench_result
+{
+	double usec;			// Per parse
+	double allocs;			// Per parse
+	double bytes;			// Per parse
+	int elements;
+	int texts;
+	int ok;
+};
+
+static volatile size_t valueSink;
+
+static uint64_t
+now_nsec(void)
+{
+	return ((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static int muteFd = -1;
+static int stdoutFd = -1;
+
+static void
+mute_stdout(bool mute)
+{
+	fflush(stdout);
+	if (mute)
+	{
+		if (stdoutFd < 0)
+		{
+			stdoutFd = dup(fileno(stdout));
+		}
+		if (muteFd < 0)
+		{
+			FILE* f = fopen(NULL_DEVICE, "w");
+
+			muteFd = f ? dup(fileno(f)) : -1;
+			if (f)
+			{
+				fclose(f);
+			}
+		}
+		if (muteFd >= 0)
+		{
+			dup2(muteFd, fileno(stdout));
+		}
+	}
+	else if (stdoutFd >= 0)
+	{
+		dup2(stdoutFd, fileno(stdout));
+	}
+}
+
+static void
+run_xmlread(const char* path, int runs, struct bench_result* r)
+{
+	uint64_t start;
+	uint64_t count0;
+	uint64_t bytes0;
+	int i;
+
+	r->elements = 0;
+	r->texts = 0;
+	r->ok = 1;
+	mute_stdout(true);
+	count0 = allocCount;
+	bytes0 = allocBytes;
+	start = now_nsec();
+	for (i = 0; i < runs; i++)
+	{
+		XMLRead xr;
+
+		if (xr.open(path) != 0)
+		{
+			r->ok = 0;
+		}
+		while (r->ok && xr.getEntry() == 0)
+		{
+			if (i == 0)
+			{
+				r->elements += (xr.type == XML_TYPE_ELEMENT);
+				r->texts += (xr.type == XML_TYPE_TEXT);
+			}
+		}
+	}
+	r->usec = (double)(now_nsec() - start) / 1000.0 / runs;
+	r->allocs = (double)(allocCount - count0) / runs;
+	r->bytes = (double)(allocBytes - bytes0) / runs;
+	mute_stdout(false);
+}
+
+static void
+run_xmlpull(const char* path, int runs, struct bench_result* r)
+{
+	XMLPull xp;
+	std::string_view v;
+	uint64_t start;
+	uint64_t count0;
+	uint64_t bytes0;
+	size_t total = 0;
+	int sts;
+	int i;
+
+	r->elements = 0;
+	r->texts = 0;
+	r->ok = 1;
+	count0 = allocCount;
+	bytes0 = allocBytes;
+	start = now_nsec();
+	for (i = 0; i < runs; i++)
+	{
+		if (xp.open(path) != 0)
+		{
+			r->ok = 0;
+			break;
+		}
+		while ((sts = xp.next()) == 0)
+		{
+			if (xp.type == XML_PULL_TEXT)
+			{
+				v = xp.value();
+				total += v.size();
+			}
+			if (i == 0)
+			{
+				r->elements += (xp.type == XML_PULL_ELEMENT);
+				r->texts += (xp.type == XML_PULL_TEXT);
+			}
+		}
+		if (sts < 0)
+		{
+			fprintf(stderr, "%s: %s\n", path, xp.error);
+			r->ok = 0;
+		}
+		xp.close();
+	}
+	r->usec = (double)(now_nsec() - start) / 1000.0 / runs;
+	r->allocs = (double)(allocCount - count0) / runs;
+	r->bytes = (double)(allocBytes - bytes0) / runs;
+	valueSink = total;
+}
+
+static void
+show(const char* parser, struct bench_result* r)
+{
+	printf("  %-8s %10.1f usec %8.1f allocs %10.0f bytes %5d elements %5d values%s\n",
+		parser, r->usec, r->allocs, r->bytes, r->elements, r->texts, r->ok ? "" : "  FAILED");
+}
+
+int
+main(int argc, char** argv)
+{
+	std::filesystem::path dir("scenarios");
+	std::error_code ec;
+	struct bench_result xr;
+	struct bench_result xp;
+	double xrTotal = 0;
+	double xpTotal = 0;
+	int runs = 200;
+	int files = 0;
+	int i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+		{
+			runs = atoi(argv[++i]);
+		}
+		else
+		{
+			dir = argv[i];
+		}
+	}
+	if (runs < 1)
+	{
+		runs = 1;
+	}
+	printf("xmlbench: %d runs per file, allocations counted by %s\n", runs, ALLOC_SCOPE);
+	for (const auto& entry : std::filesystem::directory_iterator(dir, ec))
+	{
+		std::string path = (entry.path() / "main.xml").string();
+
+		if (!std::filesystem::exists(path, ec))
+		{
+			continue;
+		}
+		run_xmlread(path.c_str(), runs, &xr);
+		run_xmlpull(path.c_str(), runs, &xp);
+		printf("%s (%ju bytes)\n", path.c_str(), (uintmax_t)std::filesystem::file_size(path, ec));
+		show("XMLRead", &xr);
+		show("XMLPull", &xp);
+		xrTotal += xr.usec;
+		xpTotal += xp.usec;
+		files++;
+	}
+	if (files == 0)
+	{
+		fprintf(stderr, "xmlbench: no */main.xml in %s\n", dir.string().c_str());
+		return (1);
+	}
+	printf("Total per pass: XMLRead %.1f usec, XMLPull %.1f usec (%.1fx)\n",
+		xrTotal, xpTotal, xpTotal > 0 ? xrTotal / xpTotal : 0.0);
+	return (0);
+}
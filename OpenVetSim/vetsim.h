@@ -27,6 +27,13 @@
 // On macOS/Linux it provides POSIX equivalents and compatible type aliases.
 #include "platform.h"
 #include "vetsimTasks.h"
+#include "simclock.h"
+#include "simnotify.h"
+#include "simmetrics.h"
+#include "simtrace.h"
+#include "simlock.h"
+#include "simtrend.h"
+#include "simrate.h"
 #include "version.h"
 
 // Defines
@@ -287,10 +294,147 @@ struct status
 	char 	eventName[STR_SIZE];
 };
 
+/*
+ * Instructor change sets. Every write into the instructor block sets the
+ * field's bit in instructor.dirty[section], and scan_commands handles only the
+ * fields whose bits are set. Bits are handled lowest first, so each list is in
+ * the order scan_commands applies the fields.
+ */
+enum ScenarioField
+{
+	SCENARIO_F_RECORD = 0,
+	SCENARIO_F_ERROR,			// error_flag and error_message
+	SCENARIO_F_STATE,
+	SCENARIO_F_ACTIVE
+};
+enum CardiacField
+{
+	CARDIAC_F_RHYTHM = 0,		// May also set rate and transfer_time
+	CARDIAC_F_RATE,
+	CARDIAC_F_NIBP_RATE,
+	CARDIAC_F_NIBP_READ,
+	CARDIAC_F_NIBP_LINKED_HR,
+	CARDIAC_F_NIBP_FREQ,
+	CARDIAC_F_PWAVE,
+	CARDIAC_F_PR_INTERVAL,
+	CARDIAC_F_QRS_INTERVAL,
+	CARDIAC_F_BPS_SYS,
+	CARDIAC_F_BPS_DIA,
+	CARDIAC_F_PEA,
+	CARDIAC_F_RIGHT_DORSAL_PULSE,
+	CARDIAC_F_RIGHT_FEMORAL_PULSE,
+	CARDIAC_F_LEFT_DORSAL_PULSE,
+	CARDIAC_F_LEFT_FEMORAL_PULSE,
+	CARDIAC_F_VPC_FREQ,
+	CARDIAC_F_VPC_DELAY,		// Unused
+	CARDIAC_F_VPC,
+	CARDIAC_F_VFIB_AMPLITUDE,
+	CARDIAC_F_HEART_SOUND,
+	CARDIAC_F_HEART_SOUND_VOLUME,
+	CARDIAC_F_HEART_SOUND_MUTE,
+	CARDIAC_F_ECG_INDICATOR,
+	CARDIAC_F_BP_CUFF,
+	CARDIAC_F_ARREST,
+	CARDIAC_F_TRANSFER_TIME		// Last; cleared after the trends that use it are set
+};
+enum RespirationField
+{
+	RESPIRATION_F_LEFT_LUNG_SOUND = 0,
+	RESPIRATION_F_RIGHT_LUNG_SOUND,
+	RESPIRATION_F_LEFT_LUNG_SOUND_VOLUME,
+	RESPIRATION_F_LEFT_LUNG_SOUND_MUTE,
+	RESPIRATION_F_RIGHT_LUNG_SOUND_VOLUME,
+	RESPIRATION_F_RIGHT_LUNG_SOUND_MUTE,
+	RESPIRATION_F_RATE,
+	RESPIRATION_F_SPO2,
+	RESPIRATION_F_ETCO2,
+	RESPIRATION_F_ETCO2_INDICATOR,
+	RESPIRATION_F_SPO2_INDICATOR,
+	RESPIRATION_F_CHEST_MOVEMENT,
+	RESPIRATION_F_MANUAL_COUNT,
+	RESPIRATION_F_MANUAL_BREATH,
+	RESPIRATION_F_TRANSFER_TIME
+};
+enum GeneralField
+{
+	GENERAL_F_TEMPERATURE = 0,
+	GENERAL_F_TEMPERATURE_UNITS,
+	GENERAL_F_TEMPERATURE_ENABLE,
+	GENERAL_F_CLOCK_START,
+	GENERAL_F_TRANSFER_TIME
+};
+enum MediaField				// II_MEDIA holds vocals and media
+{
+	VOCALS_F_FILENAME = 0,
+	VOCALS_F_REPEAT,
+	VOCALS_F_VOLUME,
+	VOCALS_F_PLAY,
+	VOCALS_F_MUTE,
+	MEDIA_F_FILENAME,
+	MEDIA_F_PLAY
+};
+enum TelesimField			// vid[v].command and param are applied with vid[v].next
+{
+	TELESIM_F_ENABLE = 0,
+	TELESIM_F_VID_NAME,
+	TELESIM_F_VID_NEXT = TELESIM_F_VID_NAME + TSIM_WINDOWS,
+	TELESIM_F_COUNT = TELESIM_F_VID_NEXT + TSIM_WINDOWS
+};
+enum CprField				// II_CPR holds cpr and defibrillation
+{
+	CPR_F_COMPRESSION = 0,
+	CPR_F_RELEASE,
+	CPR_F_DURATION,
+	DEFIB_F_SHOCK,
+	DEFIB_F_ENERGY
+};
+
+/*
+ * Status parameters a scenario trigger can test. getParamHandle() resolves a
+ * class and element name once, when the scenario is compiled, and
+ * getValueFromHandle() reads the value without comparing names.
+ */
+enum StatusParam
+{
+	PARAM_NONE = -1,
+	PARAM_CARDIAC_VPC_FREQ = 0,
+	PARAM_CARDIAC_VPC_DELAY,
+	PARAM_CARDIAC_PEA,
+	PARAM_CARDIAC_RATE,
+	PARAM_CARDIAC_AVG_RATE,
+	PARAM_CARDIAC_NIBP_RATE,
+	PARAM_CARDIAC_NIBP_READ,
+	PARAM_CARDIAC_NIBP_LINKED_HR,
+	PARAM_CARDIAC_NIBP_FREQ,
+	PARAM_CARDIAC_PR_INTERVAL,
+	PARAM_CARDIAC_QRS_INTERVAL,
+	PARAM_CARDIAC_BPS_SYS,
+	PARAM_CARDIAC_BPS_DIA,
+	PARAM_CARDIAC_ECG_INDICATOR,
+	PARAM_CARDIAC_BP_CUFF,
+	PARAM_CARDIAC_ARREST,
+	PARAM_RESPIRATION_SPO2,
+	PARAM_RESPIRATION_AWRR,
+	PARAM_RESPIRATION_RATE,
+	PARAM_RESPIRATION_ETCO2_INDICATOR,
+	PARAM_RESPIRATION_SPO2_INDICATOR,
+	PARAM_RESPIRATION_CHEST_MOVEMENT,
+	PARAM_RESPIRATION_MANUAL_COUNT,
+	PARAM_RESPIRATION_ETCO2,
+	PARAM_GENERAL_TEMPERATURE_ENABLE,
+	PARAM_GENERAL_TEMPERATURE,
+	PARAM_TELESIM_ENABLE,
+	PARAM_CPR_DURATION,
+	PARAM_PULSE_LEFT_FEMORAL,
+	PARAM_PULSE_RIGHT_FEMORAL,
+	PARAM_PULSE_DURATION,
+	PARAM_PULSE_ACTIVE,
+	PARAM_COUNT
+};
+
 // The instructor structure is commands from the Instructor Interface
 struct instructor
 {
-	SIM_MUTEX sema;	// Cross-platform mutex lock (was HANDLE on Windows)
 	struct cardiac		cardiac;
 	struct scenario 	scenario;
 	struct respiration	respiration;
@@ -301,12 +445,16 @@ struct instructor
 	struct defibrillation	defibrillation;
 	struct telesim			telesim;
 	char	eventName[STR_SIZE];
+	unsigned int dirty[II_SECTION_COUNT];	// II_FIELD() bits of the fields written, per section
 };
 
+#define EVENT_ID_NONE	-1
+
 struct event_inj
 {
 	time_t	time;
 	char 	eventName[STR_SIZE];
+	int		eventId;	// From getEventHandle(), or EVENT_ID_NONE
 };
 
 struct comment_inj
@@ -369,23 +517,23 @@ struct simmgr_shm
 	struct simControllers simControllers[MAX_CONTROLLERS];
 };
 
-// For generic trend processor
-struct trend
-{
-	double start;
-	double end;
-	double current;
-	double changePerSecond;
-	time_t nextTime;
-	time_t endTime;
-	int seconds;
-};
-
 // Prototypes
 //
 int	initSHM(void);
+
+// log_message queues the message on a ring of the calling thread and returns; the
+// logWriter task writes the queued messages, in the order they were logged, every
+// LOG_FLUSH_MSEC, or at once when a ring is half full or a message is an error
+#define LOG_RING_SIZE		256		// Messages per thread; a power of 2
+#define LOG_MAX_THREADS		32
+#define LOG_LINE_SIZE		1024
+#define LOG_TRUNCATED		" [truncated]"	// Ends a message cut to LOG_LINE_SIZE
+#define LOG_FILE_SIZE		128
+#define LOG_FLUSH_MSEC		200
+
 void log_message_init(void);
 void log_message(const char* filename, const char* message);
+void log_flush(void);
 char* do_command_read(const char* cmd_str, char* buffer, int max_len);
 void get_date(char* buffer, int maxLen);
 char* getETH0_IP();
@@ -399,42 +547,73 @@ std::string GetLastErrorAsString(void);
 
 void cleanString(char* strIn);
 
-// Defines and protos for sim-log
+// Defines and protos for sim-log. The log is kept open for the scenario and the
+// lines are written behind by the simlogWriter task.
 #define SIMLOG_MODE_READ	0
-#define SIMLOG_MODE_WRITE	1
-#define SIMLOG_MODE_CREATE	2
+#define SIMLOG_QUEUE_SIZE	1024	// Lines; simlog_write waits while the queue is full
+#define SIMLOG_FLUSH_MSEC	250
+#define SIMLOG_SYNC_MSEC	5000	// fdatasync interval while the scenario runs
+#define SIMLOG_BUFFER_SIZE	65536
+#define SIMLOG_RANGE_MAX	1000	// Lines per /simlog request
 
 int simlog_create(void);			// Create new file
-int simlog_open(int rw);			// Open for Read or Write - Takes Mutex if writing
-int simlog_write(char* msg);		// Write line
+int simlog_open(int rw);			// Open for Read
+int simlog_write(char* msg);		// Queue line
+void simlog_flush(void);			// Write the queued lines now
 size_t simlog_read(char* rbuf);		// Read next line
 size_t simlog_read_line(char* rbuf, int lineno);		// Read line from line number
-void simlog_close();				// Closes file and release Mutex if held
+int simlog_read_lines(int first, int count, std::string& out);	// Read a range of lines
+int simlog_line_count(void);		// Lines that can be read
+void simlog_close();				// Closes the file opened for reading
 void simlog_end();
 void simlog_entry(char* msg);
-int takeInstructorLock();
-void releaseInstructorLock();
+void simlog_set_dir(const char* dir);
 void addEvent(char* str);
 void addComment(char* str);
 void lockAndComment(char* str);
 void forceInstructorLock(void);
 void awrr_restart(void);
+void awrrLogBreath(uint64_t when);
+void hrLogBeat(uint64_t when);
 uint64_t msec_time_update(void);	// was ULONGLONG
 void initializeConfiguration(void);
 int getKeys(void);
 int64_t getDcode(void);				// was __int64
 
 // Shared Parse functions
-int cardiac_parse(const char* elem, const char* value, struct cardiac* card);
-int respiration_parse(const char* elem, const char* value, struct respiration* resp);
-int general_parse(const char* elem, const char* value, struct general* gen);
-int telesim_parse(const char* elem, const char* value, struct telesim* ts);
-int vocals_parse(const char* elem, const char* value, struct vocals* voc);
-int media_parse(const char* elem, const char* value, struct media* med);
-int cpr_parse(const char* elem, const char* value, struct cpr* cpr);
+int cardiac_parse(const char* elem, const char* value, struct cardiac* card, unsigned int* dirty);
+int respiration_parse(const char* elem, const char* value, struct respiration* resp, unsigned int* dirty);
+int general_parse(const char* elem, const char* value, struct general* gen, unsigned int* dirty);
+int telesim_parse(const char* elem, const char* value, struct telesim* ts, unsigned int* dirty);
+int vocals_parse(const char* elem, const char* value, struct vocals* voc, unsigned int* dirty);
+int media_parse(const char* elem, const char* value, struct media* med, unsigned int* dirty);
+int cpr_parse(const char* elem, const char* value, struct cpr* cpr, unsigned int* dirty);
 void initializeParameterStruct(struct instructor* initParams);
-void processInit(struct instructor* initParams);
+
+/*
+ * The fields a scenario or scene <init> sets. The <init> is parsed into a scratch
+ * struct instructor, and initPack() keeps a record of each field that was set,
+ * with its members' bytes. processInit() writes only those into the instructor
+ * block. A trend's length is the section's transfer_time field, as for set:.
+ */
+struct init_overrides
+{
+	unsigned char* data;		// Records, see sim-parse.cpp
+	unsigned int size;			// Bytes
+	unsigned int count;			// Records
+	unsigned int sections;		// II_MASK() of the sections written
+};
+
+#define INIT_ACK_TIMEOUT	2000	// msec processInit waits for scan_commands to apply the parameters
+void initPack(struct instructor* init, struct init_overrides* out);
+void initFree(struct init_overrides* ov);
+void processInit(struct init_overrides* init);
 int getValueFromName(char* param_class, char* param_element);
+int getParamHandle(const char* param_class, const char* param_element);
+int internEvent(const char* name);
+int getEventHandle(const char* name);
+int getValueFromHandle(int handle);
+int getParamLimits(int handle, int* min, int* max);
 
 // Global Data
 //
@@ -449,10 +628,16 @@ extern char* program_invocation_short_name;
 
 void pulseProcessChild(void);
 int pulseTask(void);
+int pulseListenerCount(void);
 void resetVpc(void);
 int bcastReply(void);
 
 int scenario_main(void);
+void scenario_headless_init(void);
+void scenario_cache_preload(void);
+int scenario_validate_main(const char* program, int argc, char* argv[]);
+int scenario_runner_main(const char* program, int argc, char* argv[]);
+extern int headless;
 
 // clock_gettime is a native POSIX function on macOS/Linux.
 // On Windows it is implemented in simutil.cpp.
@@ -478,6 +663,7 @@ struct obsData
 int vetsim(void);
 
 //In simmgrCommon
+void simmgrInitialize(void);
 void simmgrRun(void);
 int scan_commands(void);
 void comm_check(void);
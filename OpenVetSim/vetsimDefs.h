@@ -15,6 +15,25 @@
 #define DEFAULT_LOG_NAME			"simlogs/vetsim.log"
 #define DEFAULT_HTML_PATH			"WinVetSim\\html"
 
+// Scheduler periods in msec, set in the [Scheduler] section of winvetsim.ini
+#define DEFAULT_SCAN_PERIOD			100		// scan_commands: trends and NIBP. Instructor writes run it at once.
+#define DEFAULT_EVENT_PERIOD		200		// checkEvents. New events and comments run it at once.
+#define DEFAULT_CPR_PERIOD			100
+#define DEFAULT_SHOCK_PERIOD		100
+#define DEFAULT_TIME_PERIOD			200
+#define DEFAULT_COMM_PERIOD			1000
+
+// Real-time scheduling for the beat timer and broadcaster, set in the [Realtime] section.
+// A priority of 0 keeps normal scheduling; a CPU of -1 lets the thread run on any CPU.
+#define DEFAULT_RT_PRIORITY			0
+#define DEFAULT_RT_CPU				-1
+
+// Seconds of trace to record from startup, set in the [Trace] section. 0 for none.
+#define DEFAULT_TRACE_WINDOW		0
+
+// Shape of the vital sign trends, set in the [Trend] section.
+#define DEFAULT_TREND_CURVE			TREND_LINEAR
+
 struct localConfiguration
 {
 	int port_pulse;
@@ -23,6 +42,18 @@ struct localConfiguration
 	char php_server_addr[STR_SIZE];
 	char log_name[FILENAME_SIZE];
 	char html_path[FILENAME_SIZE];
+	int scan_period;
+	int event_period;
+	int cpr_period;
+	int shock_period;
+	int time_period;
+	int comm_period;
+	int beat_priority;
+	int beat_cpu;
+	int broadcast_priority;
+	int broadcast_cpu;
+	int trace_window;
+	int trend_curve;
 };
 
 
@@ -21,30 +21,471 @@
 */
 
 #include "vetsimTasks.h"
+#include "simnotify.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
 #include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif
 
 using namespace std;
 
+/*
+ * Every thread started through start_task or timer_start has a slot in the task
+ * table. The thread names itself, applies its priority and affinity, and marks the
+ * slot done when its function returns. Slots of finished tasks are reused, since
+ * start_scenario is started again for each scenario.
+ */
+struct task_entry
+{
+	char name[TASK_NAME_SIZE];
+	bool used;
+	bool done;
+	int realtime;			// SCHED_FIFO priority applied, 0 if none
+	double cpu_msec;		// Final CPU time, set when the task is done
+#ifdef _WIN32
+	HANDLE handle;
+#else
+	pthread_t handle;
+#endif
+	std::thread::id id;
+};
+
+static struct task_entry taskTable[TASK_MAX];
+static int taskHigh = 0;
+static std::mutex taskMutex;
+static std::condition_variable taskDoneCond;
+static std::atomic<bool> taskShutdown(false);
+static thread_local const char* taskSelfName = "main";
+
+// Inline mode: start_task queues the function for task_run_inline instead of
+// starting a thread. Used by the headless runner, which has only one thread.
+static bool taskInline = false;
+static std::vector<std::function<void(void)>> taskInlineQueue;
+
+static int
+task_alloc(const char* name)
+{
+	std::lock_guard<std::mutex> lock(taskMutex);
+	int i;
+
+	for (i = 0; i < TASK_MAX; i++)
+	{
+		if (!taskTable[i].used || taskTable[i].done)
+		{
+			break;
+		}
+	}
+	if (i == TASK_MAX)
+	{
+		return (-1);
+	}
+#ifdef _WIN32
+	if (taskTable[i].handle)
+	{
+		CloseHandle(taskTable[i].handle);
+	}
+	taskTable[i].handle = NULL;
+#endif
+	snprintf(taskTable[i].name, TASK_NAME_SIZE, "%s", name);
+	taskTable[i].used = true;
+	taskTable[i].done = false;
+	taskTable[i].realtime = 0;
+	taskTable[i].cpu_msec = -1;
+	taskTable[i].id = std::thread::id();
+	if (i >= taskHigh)
+	{
+		taskHigh = i + 1;
+	}
+	return (i);
+}
+
+// CPU time of the calling thread
+static double
+task_self_cpu_msec(void)
+{
+#ifdef _WIN32
+	FILETIME create, exit, kernel, user;
+	ULARGE_INTEGER k, u;
+
+	if (!GetThreadTimes(GetCurrentThread(), &create, &exit, &kernel, &user))
+	{
+		return (-1);
+	}
+	k.LowPart = kernel.dwLowDateTime;
+	k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime;
+	u.HighPart = user.dwHighDateTime;
+	return ((double)(k.QuadPart + u.QuadPart) / 10000.0);	// 100 nsec units
+#else
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+	{
+		return (-1);
+	}
+	return ((double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0);
+#endif
+}
+
+// CPU time of a task. Call with taskMutex held; the handle is only valid until done is set.
+static double
+task_cpu_msec(struct task_entry* task)
+{
+	if (task->done)
+	{
+		return (task->cpu_msec);
+	}
+	if (task->id == std::thread::id())
+	{
+		return (-1);	// Not yet started
+	}
+#ifdef _WIN32
+	FILETIME create, exit, kernel, user;
+	ULARGE_INTEGER k, u;
+
+	if (!task->handle || !GetThreadTimes(task->handle, &create, &exit, &kernel, &user))
+	{
+		return (-1);
+	}
+	k.LowPart = kernel.dwLowDateTime;
+	k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime;
+	u.HighPart = user.dwHighDateTime;
+	return ((double)(k.QuadPart + u.QuadPart) / 10000.0);
+#elif defined(__linux__)
+	clockid_t cid;
+	struct timespec ts;
+
+	if (pthread_getcpuclockid(task->handle, &cid) != 0 || clock_gettime(cid, &ts) != 0)
+	{
+		return (-1);
+	}
+	return ((double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0);
+#else
+	return (-1);
+#endif
+}
+
+/*
+ * FUNCTION: task_enter
+ *
+ * Runs on the new thread. Sets the thread name and, when asked, the real-time
+ * priority and CPU affinity. Failures are reported and the task runs anyway;
+ * SCHED_FIFO needs root or CAP_SYS_NICE.
+ */
+static void
+task_enter(int slot, const char* name, int priority, int cpu)
+{
+	int realtime = 0;
+
+	taskSelfName = name;
+#ifdef _WIN32
+	wchar_t wname[TASK_NAME_SIZE];
+
+	MultiByteToWideChar(CP_UTF8, 0, name, -1, wname, TASK_NAME_SIZE);
+	wname[TASK_NAME_SIZE - 1] = 0;
+	(void)SetThreadDescription(GetCurrentThread(), wname);
+	if (priority > 0)
+	{
+		if (SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
+		{
+			realtime = priority;
+		}
+		else
+		{
+			printf("Task %s: Failed to set priority (%lu)\n", name, GetLastError());
+		}
+	}
+	if (cpu >= 0 && cpu < (int)(sizeof(DWORD_PTR) * 8))
+	{
+		if (!SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu))
+		{
+			printf("Task %s: Failed to set CPU %d (%lu)\n", name, cpu, GetLastError());
+		}
+	}
+#else
+	char tname[TASK_NAME_SIZE];
+	struct sched_param param;
+	int err;
+
+	snprintf(tname, TASK_NAME_SIZE, "%s", name);
+#ifdef __APPLE__
+	(void)pthread_setname_np(tname);
+#else
+	(void)pthread_setname_np(pthread_self(), tname);
+#endif
+	if (priority > 0)
+	{
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = priority;
+		err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		if (err == 0)
+		{
+			realtime = priority;
+		}
+		else
+		{
+			printf("Task %s: SCHED_FIFO %d failed (%s)\n", name, priority, strerror(err));
+		}
+	}
+	if (cpu >= 0)
+	{
+#ifdef __linux__
+		cpu_set_t set;
+
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+		if (err != 0)
+		{
+			printf("Task %s: Failed to set CPU %d (%s)\n", name, cpu, strerror(err));
+		}
+#else
+		printf("Task %s: CPU affinity is not supported\n", name);
+#endif
+	}
+#endif
+
+	if (slot < 0)
+	{
+		return;
+	}
+	std::lock_guard<std::mutex> lock(taskMutex);
+#ifdef _WIN32
+	taskTable[slot].handle = OpenThread(THREAD_QUERY_LIMITED_INFORMATION, FALSE, GetCurrentThreadId());
+#else
+	taskTable[slot].handle = pthread_self();
+#endif
+	taskTable[slot].id = std::this_thread::get_id();
+	taskTable[slot].realtime = realtime;
+}
+
+static void
+task_leave(int slot)
+{
+	if (slot < 0)
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(taskMutex);
+		taskTable[slot].cpu_msec = task_self_cpu_msec();
+		taskTable[slot].done = true;
+	}
+	taskDoneCond.notify_all();
+}
+
 // Start a task to run once. Might run forever.
 std::thread::id start_task(const char* name, std::function<void(void)> func)
+{
+	return (start_rt_task(name, func, 0, -1));
+}
+
+/*
+ * FUNCTION: start_rt_task
+ *
+ * ARGUMENTS:
+ *		name		- Task name, also given to the thread
+ *		func		- Task function
+ *		priority	- SCHED_FIFO priority, or 0 for normal scheduling
+ *		cpu			- CPU to pin the task to, or -1 for any
+ *
+ * RETURNS:
+ *		Thread ID of the new task
+ */
+std::thread::id start_rt_task(const char* name, std::function<void(void)> func, int priority, int cpu)
 {
 	std::thread::id id;
+	int slot;
 
-	std::thread proc = std::thread([func]() {	func(); });
-	proc.detach();
+	if (taskInline)
+	{
+		std::lock_guard<std::mutex> lock(taskMutex);
+		taskInlineQueue.push_back(func);
+		return (std::this_thread::get_id());
+	}
+	slot = task_alloc(name);
+	if (slot < 0)
+	{
+		cout << "Task Table Full: " << name << endl;
+	}
+	std::thread proc = std::thread([func, slot, name, priority, cpu]() {
+		task_enter(slot, name, priority, cpu);
+		func();
+		task_leave(slot);
+		});
 	id = proc.get_id();
+	proc.detach();
 	cout << "Task Started: " << name << " " << id << endl;
 	return (id);
 }
 
 // Start a task to run every "interval" msec
-void timer_start(std::function<void(void)> func, unsigned int interval)
+void timer_start(const char* name, std::function<void(void)> func, unsigned int interval)
 {
-	std::thread([func, interval]() {
-		while (true)
+	(void)start_task(name, [func, interval]() {
+		while (task_running())
 		{
 			func();
 			std::this_thread::sleep_for(std::chrono::milliseconds(interval));
 		}
-		}).detach();
+		});
+}
+
+/*
+ * FUNCTION: task_set_inline
+ *
+ * ARGUMENTS:
+ *		on	- true to queue started tasks for task_run_inline
+ */
+void task_set_inline(bool on)
+{
+	taskInline = on;
+}
+
+/*
+ * FUNCTION: task_run_inline
+ *
+ * Run the queued tasks on the calling thread, in the order they were started,
+ * including any they start in turn.
+ *
+ * RETURNS:
+ *		Number of tasks run
+ */
+int task_run_inline(void)
+{
+	std::function<void(void)> func;
+	int runs = 0;
+
+	while (1)
+	{
+		{
+			std::lock_guard<std::mutex> lock(taskMutex);
+			if (taskInlineQueue.empty())
+			{
+				break;
+			}
+			func = taskInlineQueue.front();
+			taskInlineQueue.erase(taskInlineQueue.begin());
+		}
+		func();
+		runs++;
+	}
+	return (runs);
+}
+
+// False once stop_tasks has been called. Task loops should exit when it is.
+bool task_running(void)
+{
+	return (!taskShutdown.load(std::memory_order_acquire));
+}
+
+/*
+ * FUNCTION: stop_tasks
+ *
+ * ARGUMENTS:
+ *		timeout_msec	- Longest time to wait for the tasks to finish
+ *
+ * RETURNS:
+ *		Number of tasks still running, not counting the caller. Tasks blocked in
+ *		accept() or recv() will not see the request and are left to process exit.
+ */
+int stop_tasks(unsigned int timeout_msec)
+{
+	std::thread::id self = std::this_thread::get_id();
+	int running = 0;
+	int i;
+
+	taskShutdown.store(true, std::memory_order_release);
+	// Wake the tasks waiting for a change notification
+	for (i = 0; i < NOTIFY_TOPIC_COUNT; i++)
+	{
+		notify_signal(i);
+	}
+
+	std::unique_lock<std::mutex> lock(taskMutex);
+	taskDoneCond.wait_for(lock, std::chrono::milliseconds(timeout_msec), [self, &running]() {
+		running = 0;
+		for (int j = 0; j < taskHigh; j++)
+		{
+			if (taskTable[j].used && !taskTable[j].done && taskTable[j].id != self)
+			{
+				running++;
+			}
+		}
+		return (running == 0);
+		});
+	lock.unlock();
+
+	task_report();
+	return (running);
+}
+
+int task_count(void)
+{
+	std::lock_guard<std::mutex> lock(taskMutex);
+
+	return (taskHigh);
+}
+
+/*
+ * FUNCTION: task_get_info
+ *
+ * ARGUMENTS:
+ *		index	- Slot in the task table, 0 to task_count()-1
+ *		info	- Filled with a snapshot of the task
+ *
+ * RETURNS:
+ *		0 on success, -1 if the slot is unused
+ */
+int task_get_info(int index, struct task_info* info)
+{
+	std::lock_guard<std::mutex> lock(taskMutex);
+
+	if (index < 0 || index >= taskHigh || !taskTable[index].used)
+	{
+		return (-1);
+	}
+	memcpy(info->name, taskTable[index].name, TASK_NAME_SIZE);
+	info->running = taskTable[index].done ? 0 : 1;
+	info->realtime = taskTable[index].realtime;
+	info->cpu_msec = task_cpu_msec(&taskTable[index]);
+	return (0);
+}
+
+// Name of the calling task, "main" outside the registry
+const char* task_self_name(void)
+{
+	return (taskSelfName);
+}
+
+// Print the name, state and CPU time of every task
+void task_report(void)
+{
+	struct task_info info;
+	int count;
+	int i;
+
+	count = task_count();
+	for (i = 0; i < count; i++)
+	{
+		if (task_get_info(i, &info) == 0)
+		{
+			printf("Task %-16s %-8s cpu %10.1f msec%s\n", info.name,
+				info.running ? "running" : "done", info.cpu_msec,
+				info.realtime ? " (realtime)" : "");
+		}
+	}
 }
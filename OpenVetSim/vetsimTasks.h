@@ -5,6 +5,21 @@
 #include <thread>
 #include <functional>
 
+#define TASK_MAX			32
+#define TASK_NAME_SIZE		16		// Linux limit for a thread name, including the NUL
+#define TASK_JOIN_TIMEOUT	2000	// msec to wait for the tasks at shutdown
+
+/*
+ * Snapshot of a registered task. cpu_msec is the CPU time used by the thread,
+ * or -1 where the platform cannot report it.
+ */
+struct task_info
+{
+	char name[TASK_NAME_SIZE];
+	int running;
+	int realtime;
+	double cpu_msec;
+};
 
 int isServerRunning(void);
 int startPHPServer(void);
@@ -12,6 +27,15 @@ void stopPHPServer(void);
 void simstatusMain(void);
 
 std::thread::id start_task(const char* name, std::function<void(void)> func);
-void timer_start(std::function<void(void)> func, unsigned int interval);
+std::thread::id start_rt_task(const char* name, std::function<void(void)> func, int priority, int cpu);
+void timer_start(const char* name, std::function<void(void)> func, unsigned int interval);
+bool task_running(void);
+void task_set_inline(bool on);
+int task_run_inline(void);
+int stop_tasks(unsigned int timeout_msec);
+int task_count(void);
+int task_get_info(int index, struct task_info* info);
+void task_report(void);
+const char* task_self_name(void);
 
-void pulseProcessChild(void);
\ No newline at end of file
+void pulseProcessChild(void);